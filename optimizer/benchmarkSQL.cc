@@ -0,0 +1,386 @@
+// Micro benchmarks of the optimizer pipeline on the TPC-H query set
+// Compile the file like this:
+//
+// g++ -O2 -o benchmarkSQL -I../ -I../src/postgres/include/ -I../vendor/ -I../src/ -L../ benchmarkSQL.cc  ../src/optimizer/*.cc -lpg_query -pthread
+//
+// Usage: benchmarkSQL <benchmark> [query directory] [iterations] [baseline file]
+//   parse      raw parse tree vs protobuf parse path of SQLtoRA, and raw parse tree with hash consed constants
+//   optimize   optimize time and heap allocations of RaTree::optimize on TPC-H Q2/Q17/Q20/Q21,
+//              compared against the baseline file if it exists, else the results are saved to it
+//              (e.g. save on the old commit, rerun the same command on the new one)
+//   deparse    deparse time and heap allocations of RAtoSQL on the optimized TPC-H queries
+//   cache      parse+optimize+deparse vs plan cache hit
+//   threads    throughput of the worker pool at 1/2/4/8/16 threads, iterations is the number of passes over the queries
+
+#include <pg_query.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include <filesystem>
+#include <algorithm>
+#include <map>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include "optimizer/relational_algebra.h"
+#include "optimizer/parse_sql_to_ra.h"
+#include "optimizer/deparse_ra_to_sql.h"
+#include "optimizer/ra_tree.h"
+#include "optimizer/ra_plan_cache.h"
+#include "optimizer/ra_worker_pool.h"
+
+// heap allocations counters, count every operator new of the calling thread
+static thread_local size_t n_allocations = 0;
+static thread_local size_t n_allocated_bytes = 0;
+
+void* operator new(size_t size){
+  n_allocations++;
+  n_allocated_bytes += size;
+  void* p = std::malloc(size==0 ? 1 : size);
+  if(p==nullptr){
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+  std::free(p);
+}
+
+struct benchmark_query {
+  std::string name;
+  std::string sql;
+};
+
+std::vector<benchmark_query> read_queries(const std::string& directory){
+  std::vector<benchmark_query> queries;
+  for(const auto& entry: std::filesystem::directory_iterator(directory)){
+    if(entry.path().extension()!=".sql"){
+      continue;
+    }
+    std::ifstream file(entry.path());
+    std::stringstream sql;
+    sql << file.rdbuf();
+    queries.push_back({entry.path().stem().string(), sql.str()});
+  }
+  // tpch2 < tpch10
+  std::sort(queries.begin(), queries.end(), [](const benchmark_query& a, const benchmark_query& b){
+    return a.name.size()!=b.name.size() ? a.name.size()<b.name.size() : a.name<b.name;
+  });
+  return queries;
+}
+
+// mean runtime of fn in microseconds
+template<typename Fn>
+double time_us(size_t iterations, Fn fn){
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i=0; i<iterations; i++){
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end-start).count()/iterations;
+}
+
+std::string tree_to_string(std::shared_ptr<RaTree> raTree){
+  std::string result = raTree->root->to_string();
+  for(const auto& cte: raTree->ctes){
+    result += "\n" + cte->to_string();
+  }
+  return result;
+}
+
+void run_parse_benchmark(const std::vector<benchmark_query>& queries, size_t iterations){
+  std::cout << "===== parse: protobuf vs raw parse tree (us/query) =====" << std::endl;
+  std::cout << std::left << std::setw(10) << "query" << std::right << std::setw(12) << "protobuf" << std::setw(12) << "raw" << std::setw(10) << "speedup" << std::setw(12) << "consed" << std::endl;
+
+  double total_protobuf = 0;
+  double total_raw = 0;
+  double total_consed = 0;
+  for(const auto& query: queries){
+    // both paths have to produce the same relational algebra tree
+    auto protobuf_tree = std::make_shared<SQLtoRA>()->parse_protobuf(query.sql.c_str());
+    auto raw_tree = std::make_shared<SQLtoRA>()->parse(query.sql.c_str());
+    auto consed_tree = std::make_shared<SQLtoRA>(RaCatalog::tpch(), true)->parse(query.sql.c_str());
+    if(protobuf_tree==nullptr || raw_tree==nullptr || consed_tree==nullptr
+      || tree_to_string(protobuf_tree)!=tree_to_string(raw_tree) || tree_to_string(consed_tree)!=tree_to_string(raw_tree)){
+      std::cout << query.name << ": parse paths differ" << std::endl;
+      continue;
+    }
+
+    double protobuf_us = time_us(iterations, [&](){
+      std::make_shared<SQLtoRA>()->parse_protobuf(query.sql.c_str());
+    });
+    double raw_us = time_us(iterations, [&](){
+      std::make_shared<SQLtoRA>()->parse(query.sql.c_str());
+    });
+    double consed_us = time_us(iterations, [&](){
+      std::make_shared<SQLtoRA>(RaCatalog::tpch(), true)->parse(query.sql.c_str());
+    });
+    total_protobuf += protobuf_us;
+    total_raw += raw_us;
+    total_consed += consed_us;
+    std::cout << std::left << std::setw(10) << query.name << std::right << std::fixed << std::setprecision(1)
+      << std::setw(12) << protobuf_us << std::setw(12) << raw_us << std::setw(9) << protobuf_us/raw_us << "x" << std::setw(12) << consed_us << std::endl;
+  }
+  std::cout << std::left << std::setw(10) << "total" << std::right << std::fixed << std::setprecision(1)
+    << std::setw(12) << total_protobuf << std::setw(12) << total_raw << std::setw(9) << total_protobuf/total_raw << "x" << std::setw(12) << total_consed << std::endl;
+}
+
+struct optimize_measurement {
+  double optimize_us = 0;
+  size_t allocations = 0;
+  size_t bytes = 0;
+};
+
+// one line per query: name optimize_us allocations bytes
+std::map<std::string, optimize_measurement> read_optimize_baseline(const std::string& path){
+  std::map<std::string, optimize_measurement> baseline;
+  std::ifstream file(path);
+  std::string name;
+  optimize_measurement measurement;
+  while(file >> name >> measurement.optimize_us >> measurement.allocations >> measurement.bytes){
+    baseline[name] = measurement;
+  }
+  return baseline;
+}
+
+void print_optimize_row(const std::string& name, const optimize_measurement& measurement, const optimize_measurement* before){
+  std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+    << std::setw(12) << measurement.optimize_us << std::setw(14) << measurement.allocations << std::setw(12) << measurement.bytes;
+  if(before!=nullptr){
+    // reduction relative to the baseline, negative if the current build is worse
+    auto reduction = [](double old_value, double new_value){ return old_value==0 ? 0.0 : 100.0*(old_value-new_value)/old_value; };
+    std::cout << std::setw(10) << reduction(before->optimize_us, measurement.optimize_us) << "%"
+      << std::setw(13) << reduction(before->allocations, measurement.allocations) << "%"
+      << std::setw(11) << reduction(before->bytes, measurement.bytes) << "%";
+  }
+  std::cout << std::endl;
+}
+
+void run_optimize_benchmark(const std::vector<benchmark_query>& queries, size_t iterations, const std::string& baseline_path){
+  const std::vector<std::string> selected = {"tpch2", "tpch17", "tpch20", "tpch21"};
+
+  std::map<std::string, optimize_measurement> baseline;
+  if(!baseline_path.empty()){
+    baseline = read_optimize_baseline(baseline_path);
+  }
+  bool compare = !baseline.empty();
+
+  std::cout << "===== optimize: RaTree::optimize (us/query, heap allocations/query, bytes/query) =====" << std::endl;
+  std::cout << std::left << std::setw(10) << "query" << std::right << std::setw(12) << "optimize" << std::setw(14) << "allocations" << std::setw(12) << "bytes";
+  if(compare){
+    std::cout << std::setw(11) << "-time" << std::setw(14) << "-allocations" << std::setw(12) << "-bytes";
+  }
+  std::cout << std::endl;
+
+  std::map<std::string, optimize_measurement> results;
+
+  double total_us = 0;
+  size_t total_allocations = 0;
+  size_t total_bytes = 0;
+  for(const auto& query: queries){
+    if(std::find(selected.begin(), selected.end(), query.name)==selected.end()){
+      continue;
+    }
+
+    // parsing is not part of the measurement, only optimize
+    double optimize_us = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    for(size_t i=0; i<iterations; i++){
+      auto raTree = std::make_shared<SQLtoRA>()->parse(query.sql.c_str());
+      size_t allocations_before = n_allocations;
+      size_t bytes_before = n_allocated_bytes;
+      optimize_us += time_us(1, [&](){
+        raTree->optimize();
+      });
+      allocations += n_allocations-allocations_before;
+      bytes += n_allocated_bytes-bytes_before;
+    }
+    optimize_us /= iterations;
+    allocations /= iterations;
+    bytes /= iterations;
+    total_us += optimize_us;
+    total_allocations += allocations;
+    total_bytes += bytes;
+    results[query.name] = {optimize_us, allocations, bytes};
+    auto before = baseline.find(query.name);
+    print_optimize_row(query.name, results[query.name], before==baseline.end() ? nullptr : &before->second);
+  }
+  optimize_measurement total_before;
+  for(const auto& [name, measurement]: baseline){
+    if(results.count(name)!=0){
+      total_before.optimize_us += measurement.optimize_us;
+      total_before.allocations += measurement.allocations;
+      total_before.bytes += measurement.bytes;
+    }
+  }
+  print_optimize_row("total", {total_us, total_allocations, total_bytes}, compare ? &total_before : nullptr);
+
+  if(!baseline_path.empty() && !compare){
+    std::ofstream file(baseline_path);
+    for(const auto& [name, measurement]: results){
+      file << name << " " << measurement.optimize_us << " " << measurement.allocations << " " << measurement.bytes << std::endl;
+    }
+    std::cout << "baseline saved to " << baseline_path << std::endl;
+  }
+}
+
+void run_deparse_benchmark(const std::vector<benchmark_query>& queries, size_t iterations){
+  std::cout << "===== deparse: RAtoSQL::deparse of optimized queries (us/query, heap allocations/query, bytes/query) =====" << std::endl;
+  std::cout << std::left << std::setw(10) << "query" << std::right << std::setw(12) << "deparse" << std::setw(14) << "allocations" << std::setw(12) << "bytes" << std::endl;
+
+  double total_us = 0;
+  size_t total_allocations = 0;
+  size_t total_bytes = 0;
+  for(const auto& query: queries){
+    auto raTree = std::make_shared<SQLtoRA>()->parse(query.sql.c_str());
+    if(raTree==nullptr){
+      continue;
+    }
+    raTree->optimize();
+    auto ra_to_sql = std::make_shared<RAtoSQL>(raTree);
+
+    size_t allocations_before = n_allocations;
+    size_t bytes_before = n_allocated_bytes;
+    double deparse_us = time_us(iterations, [&](){
+      ra_to_sql->deparse();
+    });
+    size_t allocations = (n_allocations-allocations_before)/iterations;
+    size_t bytes = (n_allocated_bytes-bytes_before)/iterations;
+    total_us += deparse_us;
+    total_allocations += allocations;
+    total_bytes += bytes;
+    std::cout << std::left << std::setw(10) << query.name << std::right << std::fixed << std::setprecision(1)
+      << std::setw(12) << deparse_us << std::setw(14) << allocations << std::setw(12) << bytes << std::endl;
+  }
+  std::cout << std::left << std::setw(10) << "total" << std::right << std::fixed << std::setprecision(1)
+    << std::setw(12) << total_us << std::setw(14) << total_allocations << std::setw(12) << total_bytes << std::endl;
+}
+
+void run_cache_benchmark(const std::vector<benchmark_query>& queries, size_t iterations){
+  std::cout << "===== cache: parse+optimize+deparse vs plan cache hit (us/query) =====" << std::endl;
+  std::cout << std::left << std::setw(10) << "query" << std::right << std::setw(12) << "uncached" << std::setw(12) << "hit" << std::setw(10) << "speedup" << std::endl;
+
+  RaPlanCache cache;
+  double total_uncached = 0;
+  double total_hit = 0;
+  for(const auto& query: queries){
+    // a hit has to return the same SQL as the full pipeline
+    auto raTree = std::make_shared<SQLtoRA>()->parse(query.sql.c_str());
+    if(raTree==nullptr){
+      continue;
+    }
+    raTree->optimize();
+    std::string expected = std::make_shared<RAtoSQL>(raTree)->deparse();
+    std::string optimized;
+    cache.optimize(query.sql.c_str(), optimized);
+    cache.optimize(query.sql.c_str(), optimized);
+    if(optimized!=expected){
+      std::cout << query.name << ": cached SQL differs" << std::endl;
+      continue;
+    }
+
+    double uncached_us = time_us(iterations, [&](){
+      auto raTree = std::make_shared<SQLtoRA>()->parse(query.sql.c_str());
+      raTree->optimize();
+      std::make_shared<RAtoSQL>(raTree)->deparse();
+    });
+    double hit_us = time_us(iterations, [&](){
+      cache.optimize(query.sql.c_str(), optimized);
+    });
+    total_uncached += uncached_us;
+    total_hit += hit_us;
+    std::cout << std::left << std::setw(10) << query.name << std::right << std::fixed << std::setprecision(1)
+      << std::setw(12) << uncached_us << std::setw(12) << hit_us << std::setw(9) << uncached_us/hit_us << "x" << std::endl;
+  }
+  std::cout << std::left << std::setw(10) << "total" << std::right << std::fixed << std::setprecision(1)
+    << std::setw(12) << total_uncached << std::setw(12) << total_hit << std::setw(9) << total_uncached/total_hit << "x" << std::endl;
+
+  Ra__Plan_Cache__Stats stats = cache.stats();
+  std::cout << "hits: " << stats.hits << ", misses: " << stats.misses << ", uncacheable: " << stats.uncacheable
+    << ", evictions: " << stats.evictions << ", entries: " << stats.entries << std::endl;
+}
+
+void run_threads_benchmark(const std::vector<benchmark_query>& queries, size_t iterations){
+  const std::vector<size_t> thread_counts = {1, 2, 4, 8, 16};
+
+  std::cout << "===== threads: worker pool throughput, " << queries.size()*iterations << " statements (statements/s) =====" << std::endl;
+  std::cout << std::left << std::setw(10) << "threads" << std::right << std::setw(14) << "uncached" << std::setw(10) << "speedup"
+    << std::setw(14) << "cached" << std::setw(10) << "speedup" << std::endl;
+
+  double uncached_base = 0;
+  double cached_base = 0;
+  for(size_t threads: thread_counts){
+    double throughput[2];
+    for(size_t cached=0; cached<2; cached++){
+      RaPlanCache cache(cached ? 1024 : 0);
+      size_t delivered = 0;
+      auto start = std::chrono::steady_clock::now();
+      {
+        RaWorkerPool pool(threads, cache, [&](Ra__Worker_Pool__Result&){
+          delivered++;
+        });
+        for(size_t i=0; i<iterations; i++){
+          for(const auto& query: queries){
+            pool.submit(query.sql);
+          }
+        }
+      }
+      auto end = std::chrono::steady_clock::now();
+      throughput[cached] = delivered/std::chrono::duration<double>(end-start).count();
+    }
+    if(threads==1){
+      uncached_base = throughput[0];
+      cached_base = throughput[1];
+    }
+    std::cout << std::left << std::setw(10) << threads << std::right << std::fixed << std::setprecision(1)
+      << std::setw(14) << throughput[0] << std::setw(9) << throughput[0]/uncached_base << "x"
+      << std::setw(14) << throughput[1] << std::setw(9) << throughput[1]/cached_base << "x" << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  if(argc<2){
+    std::cout << "usage: benchmarkSQL <parse|optimize|deparse|cache|threads> [query directory] [iterations] [baseline file]" << std::endl;
+    return 1;
+  }
+  std::string benchmark = argv[1];
+  std::string directory = argc>2 ? argv[2] : "benchmarks/queries/original/tpch";
+  size_t iterations = argc>3 ? std::stoul(argv[3]) : 1000;
+  std::string baseline_path = argc>4 ? argv[4] : "";
+
+  std::vector<benchmark_query> queries = read_queries(directory);
+
+  if(benchmark=="parse"){
+    run_parse_benchmark(queries, iterations);
+  }
+  else if(benchmark=="optimize"){
+    run_optimize_benchmark(queries, iterations, baseline_path);
+  }
+  else if(benchmark=="deparse"){
+    run_deparse_benchmark(queries, iterations);
+  }
+  else if(benchmark=="cache"){
+    run_cache_benchmark(queries, iterations);
+  }
+  else if(benchmark=="threads"){
+    run_threads_benchmark(queries, iterations);
+  }
+  else{
+    std::cout << "unknown benchmark: " << benchmark << std::endl;
+    return 1;
+  }
+
+  // Optional, this ensures all memory is freed upon program exit (useful when running Valgrind)
+  pg_query_exit();
+
+  return 0;
+}
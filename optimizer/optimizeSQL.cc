@@ -2,17 +2,26 @@
 // Compile the file like this:
 //
 // g++ -g -o optimizeSQL -I../ -I../src/postgres/include/ -I../vendor/ -I../src/ -L../ optimizeSQL.cc  ../src/optimizer/*.cc -lpg_query -pthread
+//
+// Usage: cat queries.sql | sqlOptimizer [--timing] > optimized.sql, see print_usage for all options
 
 #include <pg_query.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
 #include <memory>
 #include "protobuf/pg_query.pb-c.h"
 #include "optimizer/relational_algebra.h"
 #include "optimizer/parse_sql_to_ra.h"
 #include "optimizer/deparse_ra_to_sql.h"
 #include "optimizer/ra_tree.h"
+#include "optimizer/ra_plan_cache.h"
+#include "optimizer/ra_worker_pool.h"
+#include "optimizer/ra_worker_process.h"
 
 std::vector<const char*> tests = {
   "SELECT s.name, s.id from students s, exams e where s.id=1 and s.name='Thomas' or not s.avg>2.0",
@@ -217,6 +226,28 @@ void run_tpch_uncorrelated(){
   }
 }
 
+// optimizes a query decoupled and not decoupled, prints both variants with their estimated costs and the tree annotated with estimated rows and widths
+void print_decouple_variants(const std::string& query, std::shared_ptr<const RaCatalog> catalog){
+  std::vector<std::pair<Ra__Decouple__Strategy, std::string>> variants = {
+    {RA__DECOUPLE__ALWAYS, "decoupled"},
+    {RA__DECOUPLE__NEVER, "not decoupled"},
+    {RA__DECOUPLE__COST_BASED, "cost based"},
+  };
+  for(auto& variant: variants){
+    auto sql_to_ra = std::make_shared<SQLtoRA>(catalog);
+    std::shared_ptr<RaTree> raTree = sql_to_ra->parse(query.c_str());
+    if(raTree==nullptr){
+      return;
+    }
+    raTree->optimize(variant.first);
+    auto ra_to_sql = std::make_shared<RAtoSQL>(raTree);
+    std::cout << "-- " << variant.second << ", estimated cost: " << raTree->estimate_cost() << std::endl;
+    raTree->annotate_estimates();
+    std::cout << "-- " << raTree->root->to_string() << std::endl;
+    std::cout << ra_to_sql->deparse() << ";\n" << std::endl;
+  }
+}
+
 void deparse_protobuf(const char* test){
   PgQueryProtobufParseResult result = pg_query_parse_protobuf(test);
   PgQueryDeparseResult deparsed_result = pg_query_deparse_protobuf(result.parse_tree);
@@ -226,17 +257,268 @@ void deparse_protobuf(const char* test){
   pg_query_free_protobuf_parse_result(result);
 }
 
-int main() {
-  // run_tests();
-  // run_tests_correlated();
-  // run_q1q2();
-  // run_q_extended();
-  run_tpch_correlated();
-  // run_tpch_uncorrelated();
-  // run_tpch_extended();
-  // parse_json();
+// options of the batch mode
+struct batch_options {
+  bool timing = false;
+  size_t threads = 1;
+  size_t cache_size = 1024;
+  std::shared_ptr<const RaCatalog> catalog = RaCatalog::tpch();
+  Ra__Decouple__Strategy decouple_strategy = RA__DECOUPLE__COST_BASED;
+  size_t join_order_dp_threshold = RaTree::default_join_order_dp_threshold;
+};
+
+struct batch_stats {
+  size_t statements = 0;
+  size_t failed = 0;
+  double total_us = 0;
+};
+
+std::string trim_statement(const std::string& statement){
+  size_t start = statement.find_first_not_of(" \t\r\n");
+  if(start==std::string::npos){
+    return "";
+  }
+  size_t end = statement.find_last_not_of(" \t\r\n");
+  return statement.substr(start, end-start+1);
+}
+
+// writes a result of the worker pool to out, statements which could not be optimized are written unchanged
+void write_result(Ra__Worker_Pool__Result& result, const batch_options& options, batch_stats& stats, std::ostream& out){
+  stats.statements++;
+  stats.total_us += result.optimize_us;
+  if(options.timing){
+    out << "-- statement " << result.sequence+1 << ": " << std::fixed << std::setprecision(1) << result.optimize_us << " us"
+      << (result.cached ? ", cached" : "") << "\n";
+  }
+  if(result.optimized){
+    out << trim_statement(result.sql) << ";\n\n";
+  }
+  else{
+    stats.failed++;
+    // a trailing line comment would swallow the semicolon
+    size_t last_line = result.sql.rfind('\n');
+    bool line_comment = result.sql.find("--", last_line==std::string::npos ? 0 : last_line)!=std::string::npos;
+    out << result.sql << (line_comment ? "\n;\n\n" : ";\n\n");
+  }
+}
+
+// submits all statements of buffer to the worker pool, returns false if the last statement is not complete yet
+bool optimize_statements(const std::string& buffer, bool end_of_input, RaWorkerProcess& pool){
+  PgQuerySplitResult split = pg_query_split_with_parser(buffer.c_str());
+  if(split.error!=nullptr){
+    // either a syntax error or a statement continuing on the next lines (e.g. semicolon in a multi-line string),
+    // only the latter fails to scan, syntactically wrong statements are written unchanged
+    pg_query_free_split_result(split);
+    split = pg_query_split_with_scanner(buffer.c_str());
+    if(split.error!=nullptr){
+      pg_query_free_split_result(split);
+      if(!end_of_input){
+        return false;
+      }
+      // unterminated at the end of the input, fails to parse and is written unchanged
+      std::string rest = trim_statement(buffer);
+      if(!rest.empty()){
+        pool.submit(rest);
+      }
+      return true;
+    }
+  }
+  for(int i=0; i<split.n_stmts; i++){
+    std::string statement = trim_statement(buffer.substr(split.stmts[i]->stmt_location, split.stmts[i]->stmt_len));
+    if(!statement.empty()){
+      pool.submit(std::move(statement));
+    }
+  }
+  pg_query_free_split_result(split);
+  return true;
+}
+
+// reads statements line by line and submits them as soon as they are complete,
+// only the statement currently read and the statements in the worker pool are kept in memory
+void optimize_stream(std::istream& input, RaWorkerProcess& pool){
+  std::string buffer;
+  std::string line;
+  while(std::getline(input, line)){
+    buffer += line;
+    buffer += '\n';
+    size_t last = line.find_last_not_of(" \t\r");
+    if(last!=std::string::npos && line[last]==';' && optimize_statements(buffer, false, pool)){
+      buffer.clear();
+    }
+  }
+  optimize_statements(buffer, true, pool);
+}
+
+void run_test_suite(const std::string& name){
+  if(name=="tests") run_tests();
+  else if(name=="correlated") run_tests_correlated();
+  else if(name=="q1q2") run_q1q2();
+  else if(name=="q_extended") run_q_extended();
+  else if(name=="tpch_correlated") run_tpch_correlated();
+  else if(name=="tpch_uncorrelated") run_tpch_uncorrelated();
+  else if(name=="tpch_extended") run_tpch_extended();
+  else if(name=="json") parse_json();
+  else std::cout << "unknown test suite: " << name << std::endl;
+}
+
+void print_usage(){
+  std::cout << "usage: sqlOptimizer [options] [file ...]    optimizes all statements of the files, stdin if no file or -\n"
+    << "  --catalog <file>          schema as DDL or snapshot, TPC-H if not given\n"
+    << "  --stats <file>            column statistics of the catalog, CSV dump of pg_stats with header\n"
+    << "  --timing                  prints the optimization time of every statement\n"
+    << "  --threads <n>             number of worker threads (default 1), output keeps the input order\n"
+    << "  --cache-size <n>          number of query shapes in the plan cache, 0 disables the cache (default 1024)\n"
+    << "  --decouple <strategy>     cost, always or never (default cost)\n"
+    << "  --join-dp-threshold <n>   joins of up to n relations are ordered by dynamic programming, larger ones greedily (default "
+    << RaTree::default_join_order_dp_threshold << ")\n"
+    << "       sqlOptimizer --decouple-variants <query file> [catalog file|-] [stats file]\n"
+    << "       sqlOptimizer --save-catalog <snapshot file> [catalog file|-] [stats file]    snapshot for --catalog, loads faster than DDL\n"
+    << "       sqlOptimizer --test-suite <tests|correlated|q1q2|q_extended|tpch_correlated|tpch_uncorrelated|tpch_extended|json>" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  // optimizeSQL --decouple-variants <query file> [catalog file] [stats file]
+  if(argc>2 && std::string(argv[1])=="--decouple-variants"){
+    std::ifstream file(argv[2]);
+    std::stringstream query;
+    query << file.rdbuf();
+    // catalog "-": TPC-H, e.g. to add stats to it
+    std::shared_ptr<RaCatalog> catalog = argc>3 && std::string(argv[3])!="-" ? RaCatalog::load(argv[3]) : RaCatalog::create_tpch();
+    if(catalog==nullptr || (argc>4 && !catalog->load_stats_file(argv[4]))){
+      return 1;
+    }
+    print_decouple_variants(query.str(), catalog);
+    pg_query_exit();
+    return 0;
+  }
+
+  // optimizeSQL --save-catalog <snapshot file> [catalog file] [stats file]
+  if(argc>2 && std::string(argv[1])=="--save-catalog"){
+    std::shared_ptr<RaCatalog> catalog = argc>3 && std::string(argv[3])!="-" ? RaCatalog::load(argv[3]) : RaCatalog::create_tpch();
+    if(catalog==nullptr || (argc>4 && !catalog->load_stats_file(argv[4]))){
+      return 1;
+    }
+    std::string snapshot;
+    catalog->save_snapshot(snapshot);
+    std::ofstream file(argv[2], std::ios::binary);
+    file.write(snapshot.data(), snapshot.size());
+    if(!file){
+      std::cerr << "could not write catalog snapshot " << argv[2] << std::endl;
+      return 1;
+    }
+    pg_query_exit();
+    return 0;
+  }
+
+  // optimizeSQL --test-suite <name>
+  if(argc>2 && std::string(argv[1])=="--test-suite"){
+    run_test_suite(argv[2]);
+    pg_query_exit();
+    return 0;
+  }
+
+  batch_options options;
+  std::vector<std::string> files;
+  // catalog given by --catalog, stats are added after all options are read
+  std::shared_ptr<RaCatalog> catalog;
+  std::string stats_path;
+  for(int i=1; i<argc; i++){
+    std::string arg = argv[i];
+    if(arg=="--timing"){
+      options.timing = true;
+    }
+    else if(arg=="--catalog" && i+1<argc){
+      catalog = RaCatalog::load(argv[++i]);
+      if(catalog==nullptr){
+        std::cerr << "could not load catalog " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if(arg=="--stats" && i+1<argc){
+      stats_path = argv[++i];
+    }
+    else if(arg=="--threads" && i+1<argc){
+      options.threads = std::stoul(argv[++i]);
+    }
+    else if(arg=="--cache-size" && i+1<argc){
+      options.cache_size = std::stoul(argv[++i]);
+    }
+    else if(arg=="--decouple" && i+1<argc){
+      std::string strategy = argv[++i];
+      if(strategy=="cost") options.decouple_strategy = RA__DECOUPLE__COST_BASED;
+      else if(strategy=="always") options.decouple_strategy = RA__DECOUPLE__ALWAYS;
+      else if(strategy=="never") options.decouple_strategy = RA__DECOUPLE__NEVER;
+      else{
+        print_usage();
+        return 1;
+      }
+    }
+    else if(arg=="--join-dp-threshold" && i+1<argc){
+      options.join_order_dp_threshold = std::stoul(argv[++i]);
+    }
+    else if(arg=="--help" || (arg.size()>1 && arg[0]=='-' && arg!="-")){
+      print_usage();
+      return arg=="--help" ? 0 : 1;
+    }
+    else{
+      files.push_back(arg);
+    }
+  }
+  if(files.empty()){
+    files.push_back("-");
+  }
+  if(!stats_path.empty()){
+    if(catalog==nullptr){
+      catalog = RaCatalog::create_tpch();
+    }
+    if(!catalog->load_stats_file(stats_path)){
+      std::cerr << "could not load stats " << stats_path << std::endl;
+      return 1;
+    }
+  }
+  if(catalog!=nullptr){
+    options.catalog = catalog;
+  }
+
+  // optimized SQL is the only output on stdout, diagnostics of parser and optimizer go to stderr
+  std::ios::sync_with_stdio(false);
+
+  RaPlanCache cache(options.cache_size, options.catalog, options.decouple_strategy, options.join_order_dp_threshold);
+  batch_stats stats;
+  Ra__Plan_Cache__Stats cache_stats;
+  int exit_code = 0;
+  {
+    // statements crashing the optimizer only end the worker process, they are written unchanged
+    RaWorkerProcess pool(options.threads, cache, [&](Ra__Worker_Pool__Result& result){
+      write_result(result, options, stats, std::cout);
+    });
+    for(const auto& file_name: files){
+      if(file_name=="-"){
+        optimize_stream(std::cin, pool);
+        continue;
+      }
+      std::ifstream file(file_name);
+      if(!file){
+        std::cerr << "could not open " << file_name << std::endl;
+        exit_code = 1;
+        continue;
+      }
+      optimize_stream(file, pool);
+    }
+    pool.stop();
+    cache_stats = pool.cache_stats();
+  }
+  std::cout.flush();
+
+  if(options.timing){
+    std::cerr << "statements: " << stats.statements << ", failed: " << stats.failed
+      << ", total: " << std::fixed << std::setprecision(1) << stats.total_us/1000 << " ms"
+      << ", cache hits: " << cache_stats.hits << ", misses: " << cache_stats.misses
+      << ", uncacheable: " << cache_stats.uncacheable << std::endl;
+  }
+
   // Optional, this ensures all memory is freed upon program exit (useful when running Valgrind)
   pg_query_exit();
 
-  return 0;
-}
\ No newline at end of file
+  return exit_code;
+}
@@ -12,218 +12,327 @@ RAtoSQL::RAtoSQL(std::shared_ptr<RaTree> _raTree)
 };
 
 std::string RAtoSQL::deparse(){
-    std::string cte_str = deparse_ctes(raTree->ctes);
-    std::string select_str = deparse_projection(raTree->root);
-    return cte_str + select_str;
+    RaSqlWriter out;
+    deparse(out);
+    return std::move(out.str());
 }
 
-std::string RAtoSQL::deparse_ctes(std::vector<std::shared_ptr<Ra__Node>> ctes){
-    std::string sql = "";
-    if(ctes.size()>0){
-        sql += "with ";
-        for(auto& cte: ctes){
-            auto cte_pr = std::static_pointer_cast<Ra__Node__Projection>(cte);
-            std::string cte_cols = "";
-            if(cte_pr->subquery_columns.size()>0){
-                cte_cols += "(";
-                for(auto& col: cte_pr->subquery_columns){
-                    cte_cols += col + ",";
+void RAtoSQL::deparse(std::ostream& stream){
+    RaSqlWriter out(&stream);
+    deparse(out);
+    out.flush();
+}
+
+void RAtoSQL::deparse(RaSqlWriter& out){
+    deparse_ctes(raTree->ctes, out);
+    deparse_projection(raTree->root, out);
+}
+
+void RAtoSQL::deparse_ctes(const std::vector<Ra__Node*>& ctes, RaSqlWriter& out){
+    if(ctes.size()==0){
+        return;
+    }
+    out << "with ";
+    for(size_t i=0; i<ctes.size(); i++){
+        auto cte_pr = static_cast<Ra__Node__Projection*>(ctes[i]);
+        if(i>0){
+            out << ',';
+        }
+        out << cte_pr->subquery_alias.str();
+        if(cte_pr->subquery_columns.size()>0){
+            out << '(';
+            for(size_t j=0; j<cte_pr->subquery_columns.size(); j++){
+                if(j>0){
+                    out << ',';
                 }
-                cte_cols.pop_back();
-                cte_cols += ")";
+                out << cte_pr->subquery_columns[j];
             }
-            sql += cte_pr->subquery_alias + cte_cols + " as (\n";
-            sql += deparse_projection(cte);
-            sql += "),";
+            out << ')';
+        }
+        out << " as ";
+        if(cte_pr->cte_materialize==RA__CTE__MATERIALIZE_ALWAYS){
+            out << "materialized ";
         }
-        sql.pop_back();
-        sql += "\n";
+        else if(cte_pr->cte_materialize==RA__CTE__MATERIALIZE_NEVER){
+            out << "not materialized ";
+        }
+        out << "(\n";
+        deparse_projection(cte_pr, out);
+        out << ')';
     }
-    return sql;
+    out << '\n';
 }
 
-std::string RAtoSQL::deparse_projection(std::shared_ptr<Ra__Node> node){
+bool RAtoSQL::add_clause(Ra__Node* node, Select_Clauses& clauses){
+    switch(node->node_case){
+        case RA__NODE__ROOT: return true;
+        case RA__NODE__SELECTION: {
+            clauses.selections.push_back(node);
+            return true;
+        }
+        case RA__NODE__GROUP_BY: {
+            if(clauses.group_by==nullptr){
+                clauses.group_by = static_cast<Ra__Node__Group_By*>(node);
+            }
+            return true;
+        }
+        case RA__NODE__HAVING: {
+            if(clauses.having==nullptr){
+                clauses.having = static_cast<Ra__Node__Having*>(node);
+            }
+            return true;
+        }
+        case RA__NODE__ORDER_BY: {
+            if(clauses.order_by==nullptr){
+                clauses.order_by = static_cast<Ra__Node__Order_By*>(node);
+            }
+            return true;
+        }
+        case RA__NODE__LIMIT: {
+            if(clauses.limit==nullptr){
+                clauses.limit = static_cast<Ra__Node__Limit*>(node);
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
 
-    std::string select = "";
-    std::string from = "";
-    std::string where = "";
-    std::string group_by = "";
-    std::string having = "";
-    std::string order_by = "";
+void RAtoSQL::deparse_projection(Ra__Node* node, RaSqlWriter& out){
 
-    deparse_ra_node(node, 0, select, where, from, group_by, having, order_by);
+    // the tree holds the clauses above the from clause, collect them up to the select projection and the node below it
+    Ra__Node__Projection* projection = nullptr;
+    Select_Clauses clauses;
+    Ra__Node* from = node;
+    while(from!=nullptr){
+        assert(from->is_full());
+        if(from->node_case==RA__NODE__PROJECTION && projection==nullptr){
+            projection = static_cast<Ra__Node__Projection*>(from);
+        }
+        else if(!add_clause(from, clauses)){
+            break;
+        }
+        from = from->n_children>0 ? from->childNodes[0] : nullptr;
+    }
 
-    if(select.length()==0){
-        select = "*";
+    if(projection==nullptr){
+        out << '*';
     }
     else{
-        select.pop_back();
-        select.pop_back();
+        out << "select ";
+        if(projection->distinct){
+            out << "distinct ";
+        }
+        deparse_expressions(projection->args, out);
     }
-    std::string sql = select + "\n";
-    
-    if(from.length()>0){
-        sql += "from " + from + "\n";
+    out << '\n';
+
+    // selections below joins in the from clause are added to the where clause
+    if(from!=nullptr && (from->node_case==RA__NODE__RELATION || from->node_case==RA__NODE__JOIN
+        || from->node_case==RA__NODE__VALUES || from->node_case==RA__NODE__PROJECTION || from->node_case==RA__NODE__UNION)){
+        out << "from ";
+        deparse_from(from, clauses, out);
+        out << '\n';
     }
-    
-    if(where.length()>0){
-        sql += "where " + where + "\n";
+
+    if(clauses.selections.size()>0){
+        out << "where ";
+        for(size_t i=0; i<clauses.selections.size(); i++){
+            Ra__Node* predicate = static_cast<Ra__Node__Selection*>(clauses.selections[i])->predicate;
+            if(i==0){
+                deparse_predicate(predicate, out);
+            }
+            else if(predicate->node_case==RA__NODE__BOOL_PREDICATE){
+                out << " and (";
+                deparse_predicate(predicate, out);
+                out << ')';
+            }
+            else{
+                out << " and ";
+                deparse_predicate(predicate, out);
+            }
+        }
+        out << '\n';
     }
 
-    if(group_by.length()>0){
-        sql += "group by " + group_by + "\n";
+    if(clauses.group_by!=nullptr && !clauses.group_by->implicit){
+        out << "group by ";
+        deparse_expressions(clauses.group_by->args, out);
+        out << '\n';
     }
 
-    if(having.length()>0){
-        sql += "having " + having + "\n";
+    if(clauses.having!=nullptr){
+        out << "having ";
+        deparse_predicate(clauses.having->predicate, out);
+        out << '\n';
     }
 
-    if(order_by.length()>0){
-        sql += "order by " + order_by + "\n";
+    if(clauses.order_by!=nullptr){
+        out << "order by ";
+        deparse_order_by_expressions(clauses.order_by->args, clauses.order_by->directions, out);
+        out << '\n';
     }
 
-    return sql;
+    if(clauses.limit!=nullptr){
+        // "with ties" only exists in the standard syntax, whose offset comes first
+        if(clauses.limit->with_ties){
+            if(clauses.limit->offset!=nullptr){
+                out << "offset ";
+                deparse_expression(clauses.limit->offset, out);
+                out << " rows\n";
+            }
+            out << "fetch first ";
+            bool is_constant = clauses.limit->count->node_case==RA__NODE__CONST;
+            if(!is_constant){
+                out << '(';
+            }
+            deparse_expression(clauses.limit->count, out);
+            if(!is_constant){
+                out << ')';
+            }
+            out << " rows with ties\n";
+        }
+        else{
+            if(clauses.limit->count!=nullptr){
+                out << "limit ";
+                deparse_expression(clauses.limit->count, out);
+                out << '\n';
+            }
+            if(clauses.limit->offset!=nullptr){
+                out << "offset ";
+                deparse_expression(clauses.limit->offset, out);
+                out << '\n';
+            }
+        }
+    }
 }
 
-void RAtoSQL::deparse_ra_node(std::shared_ptr<Ra__Node> node, size_t layer, 
-    std::string& select, 
-    std::string& where, 
-    std::string& from,
-    std::string& group_by,
-    std::string& having,
-    std::string& order_by){
+void RAtoSQL::deparse_from(Ra__Node* node, Select_Clauses& clauses, RaSqlWriter& out){
 
     assert(node->is_full());
+    if(add_clause(node, clauses)){
+        deparse_from(node->childNodes[0], clauses, out);
+        return;
+    }
     switch(node->node_case){
-        case RA__NODE__ROOT: {
-            deparse_ra_node(node->childNodes[0], layer, select, where, from, group_by, having, order_by);
-            break;
-        }
-        case RA__NODE__SELECTION: {
-            if(where.length()>0 && std::static_pointer_cast<Ra__Node__Selection>(node)->predicate->node_case==RA__NODE__BOOL_PREDICATE){
-                where += " and ";
-                where += "(" + deparse_selection(node) + ")";
-            }
-            else if(where.length()>0){
-                where += " and ";
-                where += deparse_selection(node);
-            }
-            else{
-                where += deparse_selection(node);
-            }
-            deparse_ra_node(node->childNodes[0], layer, select, where, from, group_by, having, order_by);
-            break;
-        }
         case RA__NODE__PROJECTION: {
-            auto pr = std::static_pointer_cast<Ra__Node__Projection>(node);
-            if(layer==0){
-                select = "select ";
-                if(pr->distinct){
-                    select += "distinct ";
-                }
-                select += deparse_expressions(pr->args) + ", ";
-                layer++;
-                deparse_ra_node(node->childNodes[0], layer, select, where, from, group_by, having, order_by);
-            }
-            else{
-                if(pr->subquery_columns.size()>0){
-                    std::string subquery_columns = "";
-                    for(auto& col_rename: pr->subquery_columns){
-                        subquery_columns += col_rename + ",";
+            auto pr = static_cast<Ra__Node__Projection*>(node);
+            out << '(';
+            deparse_projection(node, out);
+            out << ") as " << pr->subquery_alias.str();
+            if(pr->subquery_columns.size()>0){
+                out << '(';
+                for(size_t i=0; i<pr->subquery_columns.size(); i++){
+                    if(i>0){
+                        out << ',';
                     }
-                    subquery_columns.pop_back();
-                    from += "(" + deparse_projection(node) + ") as " + pr->subquery_alias + "(" + subquery_columns + ")";
-                }
-                else{
-                    from += "(" + deparse_projection(node) + ") as " + pr->subquery_alias; 
+                    out << pr->subquery_columns[i];
                 }
+                out << ')';
             }
             break;
         }
-        case RA__NODE__GROUP_BY: {
-            auto gb = std::static_pointer_cast<Ra__Node__Group_By>(node);
-            if(!gb->implicit){
-                group_by += deparse_expressions(gb->args);
-            }
-            deparse_ra_node(gb->childNodes[0], layer, select, where, from, group_by, having, order_by);
-            break;
-        }
-        case RA__NODE__ORDER_BY: {
-            auto ob = std::static_pointer_cast<Ra__Node__Order_By>(node);
-            order_by += deparse_order_by_expressions(ob->args, ob->directions);
-            deparse_ra_node(ob->childNodes[0], layer, select, where, from, group_by, having, order_by);
-            break;
-        }
-        case RA__NODE__HAVING: {
-            auto ha = std::static_pointer_cast<Ra__Node__Having>(node);
-            having += deparse_predicate(ha->predicate);
-            deparse_ra_node(ha->childNodes[0], layer, select, where, from, group_by, having, order_by);
-            break;
-        }
         case RA__NODE__RELATION: {
-            from += deparse_relation(node);
+            deparse_relation(node, out);
             break;
         }
         case RA__NODE__JOIN: {
-            auto join = std::static_pointer_cast<Ra__Node__Join>(node);
+            auto join = static_cast<Ra__Node__Join*>(node);
             // switch case join type
             assert(join->is_full());
-            if(std::static_pointer_cast<Ra__Node__Join>(node)->right_where_subquery_marker->marker>0){
-                deparse_ra_node(join->childNodes[0], layer, select, where, from, group_by, having, order_by);
+            if(join->right_where_subquery_marker->marker>0){
+                deparse_from(join->childNodes[0], clauses, out);
                 break;
             }
             switch(join->type){
                 case RA__JOIN__CROSS_PRODUCT:{
-                    deparse_ra_node(join->childNodes[0], layer, select, where, from, group_by, having, order_by);
-                    from += ", ";
-                    deparse_ra_node(join->childNodes[1], layer, select, where, from, group_by, having, order_by);
+                    deparse_from(join->childNodes[0], clauses, out);
+                    out << ", ";
+                    deparse_from(join->childNodes[1], clauses, out);
                     break;
                 }
-                case RA__JOIN__INNER: 
-                case RA__JOIN__LEFT: 
+                case RA__JOIN__INNER:
+                case RA__JOIN__LEFT:
+                case RA__JOIN__FULL_OUTER:
                 case RA__JOIN__DEPENDENT_INNER_LEFT:  {
-                    // from += "(";
-                    deparse_ra_node(join->childNodes[0],layer, select, where, from, group_by, having, order_by);
-                    from += join->join_name();
-                    deparse_ra_node(join->childNodes[1],layer, select, where, from, group_by, having, order_by);
+                    deparse_from(join->childNodes[0], clauses, out);
+                    out << join->join_name();
+                    deparse_from(join->childNodes[1], clauses, out);
                     if(join->predicate!=nullptr){
-                        from +=  " on " + deparse_predicate(join->predicate);
+                        out << " on ";
+                        deparse_predicate(join->predicate, out);
+                    }
+                    if(!join->alias.empty()){
+                        out << " as " << join->alias.str();
                     }
-                    // from += ")";
-                    if(join->alias.length()>0){
-                        from += " as " + join->alias; 
-                    } 
                     if(join->columns.size()>0){
-                        std::string columns = "(";
-                        for(auto& col: join->columns){
-                            columns += col + ",";
+                        out << '(';
+                        for(size_t i=0; i<join->columns.size(); i++){
+                            if(i>0){
+                                out << ',';
+                            }
+                            out << join->columns[i];
                         }
-                        columns.pop_back();
-                        columns += ")";
-                        from += columns;
-                    };
+                        out << ')';
+                    }
                     break;
                 }
                 // exists, not exists
-                case RA__JOIN__SEMI_LEFT: 
+                case RA__JOIN__SEMI_LEFT:
                 case RA__JOIN__SEMI_LEFT_DEPENDENT:
-                case RA__JOIN__ANTI_LEFT: 
+                case RA__JOIN__ANTI_LEFT:
                 case RA__JOIN__ANTI_LEFT_DEPENDENT: {
-                    std::cout << "Right subquery should have marker" << std::endl;
+                    std::cerr << "Right subquery should have marker" << std::endl;
                     break;
                 }
-                default: std::cout << "Join type not supported in decorrelation" << std::endl;
+                default: std::cerr << "Join type not supported in decorrelation" << std::endl;
             }
             break;
         }
+        case RA__NODE__UNION:{
+            auto union_node = static_cast<Ra__Node__Union*>(node);
+            out << '(';
+            for(size_t i=0; i<union_node->childNodes.size(); i++){
+                if(i>0){
+                    out << "union all\n";
+                }
+                // a branch with its own limit (and order by) is parenthesized
+                Ra__Node* it = union_node->childNodes[i]->childNodes[0];
+                while(it->node_case==RA__NODE__ORDER_BY){
+                    it = it->childNodes[0];
+                }
+                if(it->node_case==RA__NODE__LIMIT){
+                    out << '(';
+                    deparse_projection(union_node->childNodes[i], out);
+                    out << ")\n";
+                }
+                else{
+                    deparse_projection(union_node->childNodes[i], out);
+                }
+            }
+            out << ") as " << union_node->alias.str() << '(';
+            for(size_t i=0; i<union_node->columns.size(); i++){
+                if(i>0){
+                    out << ',';
+                }
+                out << union_node->columns[i];
+            }
+            out << ')';
+            break;
+        }
         case RA__NODE__VALUES:{
-            auto values = std::static_pointer_cast<Ra__Node__Values>(node);
-            from += "(values";
-            for(auto& v: values->values){
-                from += "(" + deparse_expression(v) + "),";
+            auto values = static_cast<Ra__Node__Values*>(node);
+            // constants which differ in the SQL may still be equal (1 and 1.0, collations), a join would repeat their rows
+            out << "(select distinct " << values->column << " from (values";
+            for(size_t i=0; i<values->values.size(); i++){
+                if(i>0){
+                    out << ',';
+                }
+                out << '(';
+                deparse_expression(values->values[i], out);
+                out << ')';
             }
-            from.pop_back();
-            from += ") as " + values->alias + "(" + values->column + ")";
+            out << ") as " << values->alias << '(' << values->column << ")) as " << values->alias;
             break;
         }
         default: {
@@ -233,298 +342,329 @@ void RAtoSQL::deparse_ra_node(std::shared_ptr<Ra__Node> node, size_t layer,
     }
 }
 
-std::string RAtoSQL::deparse_expression(std::shared_ptr<Ra__Node> arg){
-    std::string result = "";
+void RAtoSQL::deparse_expression(Ra__Node* arg, RaSqlWriter& out){
 
     switch(arg->node_case){
         case RA__NODE__CONST: {
-            auto constant = std::static_pointer_cast<Ra__Node__Constant>(arg);
-            result += constant->to_string();
+            auto constant = static_cast<Ra__Node__Constant*>(arg);
+            if(constant->dataType==RA__CONST_DATATYPE__STRING){
+                out << '\'' << constant->data << '\'';
+            }
+            else{
+                out << constant->data;
+            }
             break;
         }
         case RA__NODE__ATTRIBUTE: {
-            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(arg);
-            result += attr->to_string();
+            auto attr = static_cast<Ra__Node__Attribute*>(arg);
+            if(!attr->alias.empty()){
+                out << attr->alias.str() << '.';
+            }
+            out << attr->name.str();
             break;
         }
         case RA__NODE__FUNC_CALL: {
-            auto func_call = std::static_pointer_cast<Ra__Node__Func_Call>(arg);
+            auto func_call = static_cast<Ra__Node__Func_Call*>(arg);
             if(func_call->func_name=="substring"){
-                switch(func_call->args.size()){
-                    case 1: result += func_call->func_name + "(" + deparse_expression(func_call->args[0]) + ")"; break;
-                    case 2: result += func_call->func_name + "(" + deparse_expression(func_call->args[0]) + " from " + deparse_expression(func_call->args[1]) + ")"; break;
-                    case 3: result += func_call->func_name + "(" + deparse_expression(func_call->args[0]) + " from " + deparse_expression(func_call->args[1]) + " for " + deparse_expression(func_call->args[2]) + ")"; break;
-                    default: std::cout << "too many args in substring func call" << std::endl;
-                };
+                if(func_call->args.size()<1 || func_call->args.size()>3){
+                    std::cerr << "too many args in substring func call" << std::endl;
+                    break;
+                }
+                out << func_call->func_name << '(';
+                deparse_expression(func_call->args[0], out);
+                if(func_call->args.size()>1){
+                    out << " from ";
+                    deparse_expression(func_call->args[1], out);
+                }
+                if(func_call->args.size()>2){
+                    out << " for ";
+                    deparse_expression(func_call->args[2], out);
+                }
+                out << ')';
             }
             else if(func_call->func_name=="extract"){
                 assert(func_call->args.size()==2);
-                std::string date_part = deparse_expression(func_call->args[0]);
-                date_part.erase(std::remove(date_part.begin(), date_part.end(), '\''), date_part.end());
-                result += func_call->func_name + "(" + date_part + " from " + deparse_expression(func_call->args[1]) + ")"; break;
+                // date part is a string constant, written without quotes
+                RaSqlWriter date_part;
+                deparse_expression(func_call->args[0], date_part);
+                std::string& date_part_str = date_part.str();
+                date_part_str.erase(std::remove(date_part_str.begin(), date_part_str.end(), '\''), date_part_str.end());
+                out << func_call->func_name << '(' << date_part_str << " from ";
+                deparse_expression(func_call->args[1], out);
+                out << ')';
             }
             else if(func_call->is_aggregating && func_call->agg_distinct){
-                result += func_call->func_name + "(distinct " + deparse_expressions(func_call->args) + ")";
+                out << func_call->func_name << "(distinct ";
+                deparse_expressions(func_call->args, out);
+                out << ')';
             }
             else{
-                result += func_call->func_name + "(" + deparse_expressions(func_call->args) + ")";
+                out << func_call->func_name << '(';
+                deparse_expressions(func_call->args, out);
+                out << ')';
+            }
+            if(func_call->is_window){
+                out << " over (";
+                if(!func_call->window_partition.empty()){
+                    out << "partition by ";
+                    deparse_expressions(func_call->window_partition, out);
+                }
+                out << ')';
             }
             break;
         }
         case RA__NODE__TYPE_CAST: {
-            auto type_cast = std::static_pointer_cast<Ra__Node__Type_Cast>(arg);
-            if(type_cast->typ_mod.length()>0)
-                result += type_cast->type + " " + deparse_expression(type_cast->expression) + " " + type_cast->typ_mod;
-            else
-                result += type_cast->type + " " + deparse_expression(type_cast->expression);
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(arg);
+            out << type_cast->type << ' ';
+            deparse_expression(type_cast->expression, out);
+            if(type_cast->typ_mod.length()>0){
+                out << ' ' << type_cast->typ_mod;
+            }
             break;
         }
         case RA__NODE__SELECT_EXPRESSION:{
-            auto sel_expr = std::static_pointer_cast<Ra__Node__Select_Expression>(arg);
-            result += deparse_expression(sel_expr->expression);
+            auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+            deparse_expression(sel_expr->expression, out);
             if(sel_expr->rename.size()>0){
-                result += " as " + sel_expr->rename;
+                out << " as " << sel_expr->rename;
             }
             break;
         }
         case RA__NODE__EXPRESSION:{
-            auto expr = std::static_pointer_cast<Ra__Node__Expression>(arg);
-            result += "(";
+            auto expr = static_cast<Ra__Node__Expression*>(arg);
+            out << '(';
             if(expr->l_arg!=nullptr){
-                result += deparse_expression(expr->l_arg);
+                deparse_expression(expr->l_arg, out);
             }
-            result += expr->operator_;
+            out << expr->operator_;
             if(expr->r_arg!=nullptr){
-                result += deparse_expression(expr->r_arg);
+                deparse_expression(expr->r_arg, out);
             }
-            result += ")";
+            out << ')';
             break;
         }
         case RA__NODE__LIST:{
-            auto list = std::static_pointer_cast<Ra__Node__List>(arg);
+            auto list = static_cast<Ra__Node__List*>(arg);
             for(size_t i=0;i<list->args.size();i++){
-                result += i<list->args.size()-1 ? deparse_expression(list->args[i])+" and " : deparse_expression(list->args[i]);
+                if(i>0){
+                    out << " and ";
+                }
+                deparse_expression(list->args[i], out);
             }
             break;
         }
         case RA__NODE__CASE_EXPR:{
-            auto case_expr = std::static_pointer_cast<Ra__Node__Case_Expr>(arg);
-            result += "case";
+            auto case_expr = static_cast<Ra__Node__Case_Expr*>(arg);
+            out << "case";
             for(auto& arg: case_expr->args){
-                result += " when " + deparse_predicate(arg->when) + " then " + deparse_expression(arg->then);
+                out << " when ";
+                deparse_predicate(arg->when, out);
+                out << " then ";
+                deparse_expression(arg->then, out);
             }
             if(case_expr->else_default!=nullptr){
-                result += " else " + deparse_expression(case_expr->else_default);
+                out << " else ";
+                deparse_expression(case_expr->else_default, out);
             }
-            result += " end";
+            out << " end";
             break;
         }
         case RA__NODE__DUMMY: break; //e.g. (dummy)-name
-        default: std::cout << "error deparse select" << std::endl;
+        default: std::cerr << "error deparse select" << std::endl;
     }
-
-    return result;
 }
 
-std::string RAtoSQL::deparse_order_by_expressions(std::vector<std::shared_ptr<Ra__Node>>& expressions, std::vector<Ra__Order_By__SortDirection>& directions){
-    std::string result = "";
+void RAtoSQL::deparse_order_by_expressions(const std::vector<Ra__Node*>& expressions, const std::vector<Ra__Order_By__SortDirection>& directions, RaSqlWriter& out){
     assert(expressions.size()>0);
     assert(expressions.size()==directions.size());
-    size_t n = expressions.size();
 
-    for(size_t i=0; i<n; i++){
-        std::string direction;
+    for(size_t i=0; i<expressions.size(); i++){
+        if(i>0){
+            out << ", ";
+        }
+        deparse_expression(expressions[i], out);
         switch(directions[i]){
-            case RA__ORDER_BY__DEFAULT: direction = ""; break;
-            case RA__ORDER_BY__ASC: direction = " asc"; break;
-            case RA__ORDER_BY__DESC: direction = " desc"; break;
-            default: std::cout << "deparse order by order error" << std::endl; direction = "";
+            case RA__ORDER_BY__DEFAULT: break;
+            case RA__ORDER_BY__ASC: out << " asc"; break;
+            case RA__ORDER_BY__DESC: out << " desc"; break;
+            default: std::cerr << "deparse order by order error" << std::endl;
         }
-        result += deparse_expression(expressions[i]) + direction + ", ";
     }
-    result.pop_back();
-    result.pop_back();
-    return result;
 }
 
-std::string RAtoSQL::deparse_expressions(std::vector<std::shared_ptr<Ra__Node>>& expressions){
-    std::string result = "";
-
+void RAtoSQL::deparse_expressions(const std::vector<Ra__Node*>& expressions, RaSqlWriter& out){
     assert(expressions.size()>0);
-    for(auto expression: expressions){
-        result += deparse_expression(expression) + ", ";
+    for(size_t i=0; i<expressions.size(); i++){
+        if(i>0){
+            out << ", ";
+        }
+        deparse_expression(expressions[i], out);
     }
-    result.pop_back();
-    result.pop_back();
-    return result;
 }
 
-std::string RAtoSQL::deparse_predicate(std::shared_ptr<Ra__Node> node){
+void RAtoSQL::deparse_predicate(Ra__Node* node, RaSqlWriter& out){
     switch(node->node_case){
         case RA__NODE__BOOL_PREDICATE: {
-            std::string result = "";
-            auto p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(node);
-            std::string op;
+            auto p = static_cast<Ra__Node__Bool_Predicate*>(node);
             switch(p->bool_operator){
-                case RA__BOOL_OPERATOR__AND: {
-                    op = " and ";   
-                    for(auto arg: p->args){
-                        if(arg->node_case==RA__NODE__BOOL_PREDICATE){
-                            result += "(" + deparse_predicate(arg) + ")" + op;
-                        }
-                        else{
-                            result += deparse_predicate(arg) + op;
-                        }
-                    }
-                    for(size_t i=0; i<op.length();i++){
-                        result.pop_back();
-                    }
-                    break;
-                }
+                case RA__BOOL_OPERATOR__AND:
                 case RA__BOOL_OPERATOR__OR: {
-                    op = " or ";    
-                    for(auto arg: p->args){
-                        if(arg->node_case==RA__NODE__BOOL_PREDICATE){
-                            result += "(" + deparse_predicate(arg) + ")" + op;
+                    std::string_view op = p->bool_operator==RA__BOOL_OPERATOR__AND ? " and " : " or ";
+                    for(size_t i=0; i<p->args.size(); i++){
+                        if(i>0){
+                            out << op;
+                        }
+                        if(p->args[i]->node_case==RA__NODE__BOOL_PREDICATE){
+                            out << '(';
+                            deparse_predicate(p->args[i], out);
+                            out << ')';
                         }
                         else{
-                            result += deparse_predicate(arg) + op;
+                            deparse_predicate(p->args[i], out);
                         }
                     }
-                    for(size_t i=0; i<op.length();i++){
-                        result.pop_back();
-                    }
                     break;
                 }
                 case RA__BOOL_OPERATOR__NOT: {
-                    op = "not ";
                     for(auto arg: p->args){
                         switch(arg->node_case){
                             case RA__NODE__BOOL_PREDICATE:{
-                                result += op + "(" + deparse_predicate(arg) + ")";
+                                out << "not (";
+                                deparse_predicate(arg, out);
+                                out << ')';
                                 break;
                             }
                             case RA__NODE__WHERE_SUBQUERY_MARKER:{
-                                if(std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(arg)->type==RA__JOIN__ANTI_IN_LEFT 
-                                || std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(arg)->type==RA__JOIN__ANTI_IN_LEFT_DEPENDENT){
-                                    result += deparse_predicate(arg);
-                                }
-                                else{
-                                    result += op + deparse_predicate(arg);
+                                // not in is deparsed by the marker
+                                if(static_cast<Ra__Node__Where_Subquery_Marker*>(arg)->type!=RA__JOIN__ANTI_IN_LEFT
+                                && static_cast<Ra__Node__Where_Subquery_Marker*>(arg)->type!=RA__JOIN__ANTI_IN_LEFT_DEPENDENT){
+                                    out << "not ";
                                 }
+                                deparse_predicate(arg, out);
                                 break;
                             }
                             case RA__NODE__NULL_TEST:{
-                                result += deparse_predicate(arg);
+                                deparse_predicate(arg, out);
                                 break;
                             }
-                            default: result += op + deparse_predicate(arg);
+                            default: {
+                                out << "not ";
+                                deparse_predicate(arg, out);
+                            }
                         }
                     }
                     break;
                 }
             }
-            return result;
+            break;
         }
         case RA__NODE__PREDICATE: {
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(node);
-            return deparse_predicate(p->left) + p->binaryOperator + deparse_predicate(p->right);
+            auto p = static_cast<Ra__Node__Predicate*>(node);
+            deparse_predicate(p->left, out);
+            out << p->binaryOperator;
+            deparse_predicate(p->right, out);
+            break;
         }
         case RA__NODE__NULL_TEST:{
-            std::string result;
-            auto null_test = std::static_pointer_cast<Ra__Node__Null_Test>(node);
-            result += deparse_expression(null_test->arg);
+            auto null_test = static_cast<Ra__Node__Null_Test*>(node);
+            deparse_expression(null_test->arg, out);
             switch(null_test->type){
                 case RA__NULL_TEST__IS_NULL:{
-                    result += " is null";
+                    out << " is null";
                     break;
                 }
                 case RA__NULL_TEST__IS_NOT_NULL:{
-                    result += " is not null";
+                    out << " is not null";
                     break;
                 }
             }
-            return result;
+            break;
         }
         case RA__NODE__IN_LIST: {
-            auto list = std::static_pointer_cast<Ra__Node__In_List>(node);
-            std::string str = "(";
-            for(auto& arg: list->args){
-                str += deparse_expression(arg) + ",";
+            auto list = static_cast<Ra__Node__In_List*>(node);
+            out << '(';
+            for(size_t i=0; i<list->args.size(); i++){
+                if(i>0){
+                    out << ',';
+                }
+                deparse_expression(list->args[i], out);
             }
-            str.pop_back();
-            str += ")";
-
-            return str;
+            out << ')';
+            break;
         }
         case RA__NODE__WHERE_SUBQUERY_MARKER:{
-            auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(node);
+            auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(node);
             // find join
-            std::shared_ptr<Ra__Node> it = raTree->root;
-            assert(find_marker_subquery(it, marker));
-            auto join = std::static_pointer_cast<Ra__Node__Join>(it);
-            std::shared_ptr<Ra__Node> subquery = nullptr;
-            subquery = join->childNodes[1];
+            Ra__Node* it = raTree->root;
+            bool found = find_marker_subquery(it, marker);
+            assert(found);
+            (void) found;
+            auto join = static_cast<Ra__Node__Join*>(it);
+            Ra__Node* subquery = join->childNodes[1];
             switch(join->type){
-                case RA__JOIN__SEMI_LEFT: 
+                case RA__JOIN__SEMI_LEFT:
                 case RA__JOIN__SEMI_LEFT_DEPENDENT:
-                case RA__JOIN__ANTI_LEFT: 
+                case RA__JOIN__ANTI_LEFT:
                 case RA__JOIN__ANTI_LEFT_DEPENDENT: {
                     // exists
-                    return "exists (" + deparse_projection(subquery)+")";
+                    out << "exists (";
+                    break;
                 }
                 case RA__JOIN__IN_LEFT:
                 case RA__JOIN__IN_LEFT_DEPENDENT:{
                     // in
-                    auto p = std::static_pointer_cast<Ra__Node__Predicate>(join->predicate);
-                    return deparse_expression(p->left) + " in (" + deparse_projection(subquery)+")";
+                    deparse_expression(static_cast<Ra__Node__Predicate*>(join->predicate)->left, out);
+                    out << " in (";
+                    break;
                 }
                 case RA__JOIN__ANTI_IN_LEFT:
                 case RA__JOIN__ANTI_IN_LEFT_DEPENDENT:{
                     // not in
-                    auto p = std::static_pointer_cast<Ra__Node__Predicate>(join->predicate);
-                    return deparse_expression(p->left) + " not in (" + deparse_projection(subquery)+")";
+                    deparse_expression(static_cast<Ra__Node__Predicate*>(join->predicate)->left, out);
+                    out << " not in (";
+                    break;
                 }
-                default: return "("+deparse_projection(subquery)+")";
+                default: out << '(';
             }
             // deparse subquery
-            
+            deparse_projection(subquery, out);
+            out << ')';
+            break;
         }
         default: {
-            auto expression = std::static_pointer_cast<Ra__Node__Expression>(node);
-            return deparse_expression(expression);
+            deparse_expression(node, out);
+            break;
         }
     }
 }
 
-bool RAtoSQL::find_marker_subquery(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker){
+bool RAtoSQL::find_marker_subquery(Ra__Node*& it, Ra__Node__Where_Subquery_Marker* marker){
     if(it->node_case==RA__NODE__JOIN){
-        auto join = std::static_pointer_cast<Ra__Node__Join>(it);
+        auto join = static_cast<Ra__Node__Join*>(it);
         if(join->right_where_subquery_marker==marker){
             return true;
         }
     }
-    
+
     if(it->n_children == 0){
         return false;
     }
 
-    bool found = false;
-    std::vector<std::shared_ptr<Ra__Node>> childNodes = it->childNodes;
-    for(auto child: childNodes){
-        if(!found){
-            it = child;
-            found = find_marker_subquery(it, marker);
+    // it is overwritten by the search, iterate over the children of the node it pointed to
+    Ra__Node* node = it;
+    for(size_t i=0; i<node->childNodes.size(); i++){
+        it = node->childNodes[i];
+        if(find_marker_subquery(it, marker)){
+            return true;
         }
     }
-    return found;
-}
-
-std::string RAtoSQL::deparse_selection(std::shared_ptr<Ra__Node> node){
-    return deparse_predicate(std::static_pointer_cast<Ra__Node__Selection>(node)->predicate);
+    return false;
 }
 
-std::string RAtoSQL::deparse_relation(std::shared_ptr<Ra__Node> node){
-    auto relation = std::static_pointer_cast<Ra__Node__Relation>(node);
-    return relation->alias.length()>0 ? relation->name + " " + relation->alias : relation->name;
+void RAtoSQL::deparse_relation(Ra__Node* node, RaSqlWriter& out){
+    auto relation = static_cast<Ra__Node__Relation*>(node);
+    out << relation->name.str();
+    if(!relation->alias.empty()){
+        out << ' ' << relation->alias.str();
+    }
 }
@@ -2,112 +2,181 @@
 #define deparse_ra_to_sql
 
 #include <string>
+#include <string_view>
+#include <ostream>
 #include <memory>
 #include "relational_algebra.h"
 #include "ra_tree.h"
 
+/**
+ * Append-only output of the deparser.
+ * Text is appended to a growable buffer, if a stream is given the buffer is written to it
+ * whenever it exceeds flush_size, so large statements are not held in memory completely.
+ */
+class RaSqlWriter {
+    public:
+        /**
+         * @param _stream stream the output is written to, nullptr to keep all output in the buffer
+         * @param _flush_size buffer size at which the buffer is written to the stream
+         */
+        RaSqlWriter(std::ostream* _stream=nullptr, size_t _flush_size=1<<16): stream(_stream), flush_size(_flush_size){}
+
+        RaSqlWriter& operator<<(std::string_view text){
+            buffer.append(text);
+            if(stream!=nullptr && buffer.size()>=flush_size){
+                flush();
+            }
+            return *this;
+        }
+
+        RaSqlWriter& operator<<(char c){
+            buffer.push_back(c);
+            return *this;
+        }
+
+        /**
+         * Writes the buffer to the stream, nothing to do without stream
+         */
+        void flush(){
+            if(stream!=nullptr){
+                stream->write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+
+        /**
+         * @return output not yet written to the stream, all output if there is no stream
+         */
+        std::string& str(){ return buffer; }
+
+    private:
+        std::string buffer;
+        std::ostream* stream;
+        size_t flush_size;
+};
+
 class RAtoSQL{
     public:
         RAtoSQL(std::shared_ptr<RaTree> _raTree);
 
         /**
          * Deparses relational algebra tree to SQL
-         * 
+         *
          * @return SQL statement as string
          */
         std::string deparse();
 
+        /**
+         * Deparses relational algebra tree to SQL and writes it to a stream
+         *
+         * @param stream output stream
+         */
+        void deparse(std::ostream& stream);
+
+        /**
+         * Deparses relational algebra tree to SQL and appends it to a writer
+         *
+         * @param out output writer
+         */
+        void deparse(RaSqlWriter& out);
+
     private:
+        /// clauses of a select statement, nodes above the from clause or below a join in the from clause
+        struct Select_Clauses {
+            std::vector<Ra__Node*> selections;
+            Ra__Node__Group_By* group_by = nullptr;
+            Ra__Node__Having* having = nullptr;
+            Ra__Node__Order_By* order_by = nullptr;
+            Ra__Node__Limit* limit = nullptr;
+        };
+
         /// root node of relational algebra tree
         std::shared_ptr<RaTree> raTree;
 
         /**
-         * 
-         * Deparses a relational algebra projection node to a SQL select statement
-         * 
-         * @param ra_root pointer to root of relational algebra tree
-         * @return SQL select statement as string
+         * Deparses common table expressions to a SQL with clause
+         *
+         * @param ctes projections of the common table expressions
+         * @param out output writer
          */
-        std::string deparse_ctes(std::vector<std::shared_ptr<Ra__Node>>);
+        void deparse_ctes(const std::vector<Ra__Node*>& ctes, RaSqlWriter& out);
 
         /**
-         * Deparses a relational algebra projection node to a SQL select statement
-         * 
-         * @param ra_root pointer to root of relational algebra tree
-         * @return SQL select statement as string
+         * Deparses a relational algebra projection node to a SQL select statement.
+         * The clauses are collected first, the tree holds them in another order than SQL (where above from)
+         *
+         * @param node projection or node above the projection
+         * @param out output writer
          */
-        std::string deparse_projection(std::shared_ptr<Ra__Node> node);
+        void deparse_projection(Ra__Node* node, RaSqlWriter& out);
 
         /**
-         * Deparses a relational algebra tree node to SQL. Recursively called on all children
-         * 
-         * @param node pointer to relational algebra node
-         * @param layer Subquery layer of node, 0 for main query
-         * @param select SQL select output string
-         * @param where SQL where output string
-         * @param from SQL from output string
-         * @param group_by SQL group by output string
-         * @param having SQL having output string
-         * @param order_by SQL order by output string
+         * Records a clause node of a select statement, the first group by, having and order by are kept
+         *
+         * @param node node of the select statement
+         * @param clauses clauses found so far
+         * @return false if node is not a clause node
          */
-        void deparse_ra_node(std::shared_ptr<Ra__Node> node, size_t layer, std::string& select, std::string& where, std::string& from, std::string& group_by, std::string& having, std::string& order_by);
+        static bool add_clause(Ra__Node* node, Select_Clauses& clauses);
 
         /**
-         * Deparses relation to SQL
-         * 
-         * @param node relation
-         * @return Relation as SQL string
+         * Deparses the from clause of a select statement. Recursively called on all children
+         *
+         * @param node relation, join, values, subquery projection or selection in the from clause
+         * @param clauses clauses found in the from clause, selections are deparsed to the where clause
+         * @param out output writer
          */
-        std::string deparse_relation(std::shared_ptr<Ra__Node> node);
-        
+        void deparse_from(Ra__Node* node, Select_Clauses& clauses, RaSqlWriter& out);
+
         /**
-         * Deparses selection to SQL
-         * 
-         * @param node selection
-         * @return selection as SQL string
+         * Deparses relation to SQL
+         *
+         * @param node relation
+         * @param out output writer
          */
-        std::string deparse_selection(std::shared_ptr<Ra__Node> node);
+        void deparse_relation(Ra__Node* node, RaSqlWriter& out);
 
         /**
          * Deparses predicate to SQL
-         * 
+         *
          * @param node predicate
-         * @return predicate as SQL string
+         * @param out output writer
          */
-        std::string deparse_predicate(std::shared_ptr<Ra__Node> node);
+        void deparse_predicate(Ra__Node* node, RaSqlWriter& out);
 
         /**
          * Deparses list of expressions to SQL
-         * 
+         *
          * @param expressions vector of expressions
-         * @return expressions as comma separated SQL string
+         * @param out output writer, expressions are comma separated
          */
-        std::string deparse_expressions(std::vector<std::shared_ptr<Ra__Node>>& expressions);
+        void deparse_expressions(const std::vector<Ra__Node*>& expressions, RaSqlWriter& out);
 
         /**
          * Deparses list of order by expressions to SQL
-         * 
+         *
          * @param expressions vector of expressions
-         * @return expressions as comma separated SQL string
+         * @param directions sort direction of every expression
+         * @param out output writer, expressions are comma separated
          */
-        std::string deparse_order_by_expressions(std::vector<std::shared_ptr<Ra__Node>>& expressions, std::vector<Ra__Order_By__SortDirection>& directions);
+        void deparse_order_by_expressions(const std::vector<Ra__Node*>& expressions, const std::vector<Ra__Order_By__SortDirection>& directions, RaSqlWriter& out);
 
         /**
          * Deparses an expression to SQL
-         * 
-         * @param expression expression
-         * @return expression as SQL string
+         *
+         * @param arg expression
+         * @param out output writer
          */
-        std::string deparse_expression(std::shared_ptr<Ra__Node> arg);
+        void deparse_expression(Ra__Node* arg, RaSqlWriter& out);
 
         /**
          * Finds the join with corresponding subquery marker, sets it = join when found
-         * 
+         *
          * @param it pointer to node to search
          * @param marker the marker to be found
          * @return if marker is found
          */
-        bool find_marker_subquery(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker);
+        bool find_marker_subquery(Ra__Node*& it, Ra__Node__Where_Subquery_Marker* marker);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,94 +1,190 @@
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
 #include <cassert>
 #include <set>
 #include "parse_sql_to_ra.h"
 
-SQLtoRA::SQLtoRA(){
+// postgres headers are plain C and redefine printf & co, keep them after all standard headers
+extern "C" {
+#include "pg_query_internal.h"
+#include "pg_query_readfuncs.h"
+#include "nodes/parsenodes.h"
+}
+
+SQLtoRA::SQLtoRA(std::shared_ptr<const RaCatalog> _catalog, bool _hash_consing)
+:catalog(std::move(_catalog)),hash_consing(_hash_consing){
     ra_tree_root = nullptr;
 }
 
+// constants, casts and arithmetic of constants, never modified by the optimizer
+static bool is_constant_expression(Ra__Node* expression){
+    switch(expression->node_case){
+        case RA__NODE__CONST: return true;
+        case RA__NODE__TYPE_CAST: return is_constant_expression(static_cast<Ra__Node__Type_Cast*>(expression)->expression);
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            return (expr->l_arg!=nullptr || expr->r_arg!=nullptr)
+                && (expr->l_arg==nullptr || is_constant_expression(expr->l_arg))
+                && (expr->r_arg==nullptr || is_constant_expression(expr->r_arg));
+        }
+        default: return false;
+    }
+}
+
+Ra__Node* SQLtoRA::hash_cons(Ra__Node* expression){
+    if(!hash_consing || !is_constant_expression(expression)){
+        return expression;
+    }
+    // operands are consed before, equal operands are the same node and compared by pointer
+    auto& same_hash = consed_expressions[expression->structural_hash(hash_cons_epoch)];
+    for(auto consed_expression: same_hash){
+        if(consed_expression->is_structurally_equal(expression, hash_cons_epoch)){
+            return consed_expression;
+        }
+    }
+    same_hash.push_back(expression);
+    return expression;
+}
+
 std::shared_ptr<RaTree> SQLtoRA::parse(const char* query){
 
+    arena = std::make_unique<RaArena>();
+    symbols = std::make_unique<RaSymbolTable>();
+    consed_expressions.clear();
+
+    // raw parse tree is allocated in the pg_query memory context, freed on exit
+    MemoryContext ctx = pg_query_enter_memory_context();
+    PgQueryInternalParsetreeAndError result = pg_query_raw_parse(query);
+
+    if(result.error!=nullptr){
+        std::cerr << "error parsing query: " << result.error->message << std::endl;
+        pg_query_free_error(result.error);
+        free(result.stderr_buffer);
+        pg_query_exit_memory_context(ctx);
+        return nullptr;
+    }
+    auto tree = parse_statements(result.tree);
+
+    // relational algebra nodes hold copies of all strings, parse tree can be freed
+    free(result.stderr_buffer);
+    pg_query_exit_memory_context(ctx);
+
+    return tree;
+}
+
+std::shared_ptr<RaTree> SQLtoRA::parse_protobuf(const char* query){
+
+    arena = std::make_unique<RaArena>();
+    symbols = std::make_unique<RaSymbolTable>();
+    consed_expressions.clear();
     PgQueryProtobufParseResult result = pg_query_parse_protobuf(query);
-    std::shared_ptr<PgQuery__ParseResult> parse_result(pg_query__parse_result__unpack(NULL, result.parse_tree.len, (const uint8_t*) result.parse_tree.data));
+    if(result.error!=nullptr){
+        std::cerr << "error parsing query: " << result.error->message << std::endl;
+        pg_query_free_protobuf_parse_result(result);
+        return nullptr;
+    }
+
+    // read back into raw parse tree nodes, allocated in the pg_query memory context and freed on exit
+    MemoryContext ctx = pg_query_enter_memory_context();
+    auto tree = parse_statements(pg_query_protobuf_to_nodes(result.parse_tree));
+    pg_query_exit_memory_context(ctx);
+    pg_query_free_protobuf_parse_result(result);
+
+    return tree;
+}
+
+std::shared_ptr<RaTree> SQLtoRA::parse_statements(List* raw_stmts){
 
-    // currently only supports parsing the first statement
-    assert(parse_result->n_stmts==1);
-    std::shared_ptr<PgQuery__Node> stmt(parse_result->stmts[0]->stmt);
-    ra_tree_root = parse_select_statement(stmt->select_stmt);
+    // currently only supports a single select statement
+    if(list_length(raw_stmts)!=1 || !IsA(linitial_node(RawStmt, raw_stmts)->stmt, SelectStmt)){
+        std::cerr << "error parsing query: only single select statements are supported" << std::endl;
+        return nullptr;
+    }
+    RawStmt* raw_stmt = linitial_node(RawStmt, raw_stmts);
+    unsupported_expression = false;
+    scopes.clear();
+    ra_tree_root = parse_select_statement(castNode(SelectStmt, raw_stmt->stmt));
+    // an untranslated operand would be missing from the tree, e.g. x+(select ...) would read as unary +
+    if(unsupported_expression){
+        return nullptr;
+    }
 
-    return std::make_shared<RaTree>(ra_tree_root, ctes, counter);
+    return std::make_shared<RaTree>(ra_tree_root, ctes, counter, std::move(arena), std::move(symbols), catalog);
 }
 
-void SQLtoRA::parse_expression(PgQuery__Node* node, std::shared_ptr<Ra__Node>& ra_arg, bool& has_aggregate){
-    switch(node->node_case){
-        case PG_QUERY__NODE__NODE_COLUMN_REF: {
-            PgQuery__ColumnRef* columnRef = node->column_ref;
-            std::shared_ptr<Ra__Node__Attribute> attr;
-            switch(columnRef->n_fields){
+void SQLtoRA::parse_expression(Node* node, Ra__Node*& ra_arg, bool& has_aggregate){
+    switch(nodeTag(node)){
+        case T_ColumnRef: {
+            ColumnRef* columnRef = (ColumnRef*) node;
+            Ra__Node__Attribute* attr = nullptr;
+            switch(list_length(columnRef->fields)){
                 case 1: {
-                    if(columnRef->fields[0]->node_case==PG_QUERY__NODE__NODE_A_STAR){
-                        attr = std::make_shared<Ra__Node__Attribute>("*");
+                    if(IsA(linitial(columnRef->fields), A_Star)){
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern("*"));
                     }
                     else{
-                        attr = std::make_shared<Ra__Node__Attribute>(columnRef->fields[0]->string->str);
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern(strVal(linitial(columnRef->fields))));
+                        resolve_attribute(attr);
                     }
-                    break; 
+                    break;
                 }
                 case 2: {
-                    if(columnRef->fields[1]->node_case==PG_QUERY__NODE__NODE_A_STAR){
-                        attr = std::make_shared<Ra__Node__Attribute>("*", columnRef->fields[0]->string->str);
+                    if(IsA(lsecond(columnRef->fields), A_Star)){
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern("*"), symbols->intern(strVal(linitial(columnRef->fields))));
                     }
                     else{
-                        attr = std::make_shared<Ra__Node__Attribute>(columnRef->fields[1]->string->str, columnRef->fields[0]->string->str);
-                    } 
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern(strVal(lsecond(columnRef->fields))), symbols->intern(strVal(linitial(columnRef->fields))));
+                    }
                     break;
-                } 
+                }
             }
             ra_arg = attr;
             return;
         }
-        case PG_QUERY__NODE__NODE_A_CONST: {
-            PgQuery__AConst* aConst = node->a_const;
-            std::shared_ptr<Ra__Node__Constant> constant;
-            switch(node->a_const->val->node_case){
-                case PG_QUERY__NODE__NODE_INTEGER: { 
-                    constant = std::make_shared<Ra__Node__Constant>(std::to_string(aConst->val->integer->ival), RA__CONST_DATATYPE__INT);
+        case T_A_Const: {
+            A_Const* aConst = (A_Const*) node;
+            Ra__Node__Constant* constant = nullptr;
+            switch(nodeTag(&aConst->val)){
+                case T_Integer: {
+                    constant = arena->make<Ra__Node__Constant>(std::to_string(intVal(&aConst->val)), RA__CONST_DATATYPE__INT);
                     break;
                 }
-                case PG_QUERY__NODE__NODE_FLOAT: {
-                    constant = std::make_shared<Ra__Node__Constant>(aConst->val->float_->str, RA__CONST_DATATYPE__FLOAT);
+                case T_Float: {
+                    constant = arena->make<Ra__Node__Constant>(strVal(&aConst->val), RA__CONST_DATATYPE__FLOAT);
                     break;
                 }
-                case PG_QUERY__NODE__NODE_STRING: {
-                    constant = std::make_shared<Ra__Node__Constant>(aConst->val->string->str, RA__CONST_DATATYPE__STRING);
+                case T_String: {
+                    constant = arena->make<Ra__Node__Constant>(strVal(&aConst->val), RA__CONST_DATATYPE__STRING);
                     break;
                 }
                 default:
-                    std::cout << "error a_const" << std::endl;
+                    std::cerr << "error a_const" << std::endl;
+                    unsupported_expression = true;
+                    return;
             }
-            ra_arg = constant;
+            ra_arg = hash_cons(constant);
             return;
         }
-        case PG_QUERY__NODE__NODE_A_EXPR: {
-            PgQuery__AExpr* a_expr = node->a_expr;
-            auto ra_expr = std::make_shared<Ra__Node__Expression>();
+        case T_A_Expr: {
+            A_Expr* a_expr = (A_Expr*) node;
+            auto ra_expr = arena->make<Ra__Node__Expression>();
             if(a_expr->lexpr!=nullptr){
                 parse_expression(a_expr->lexpr, ra_expr->l_arg, has_aggregate);
             }
             if(a_expr->rexpr!=nullptr){
                 parse_expression(a_expr->rexpr, ra_expr->r_arg, has_aggregate);
             }
-            ra_expr->operator_=a_expr->name[0]->string->str;
-            ra_arg = ra_expr;
+            ra_expr->operator_=strVal(linitial(a_expr->name));
+            ra_arg = hash_cons(ra_expr);
             return;
         }
-        case PG_QUERY__NODE__NODE_FUNC_CALL: {
-            PgQuery__FuncCall* func_call = node->func_call;
+        case T_FuncCall: {
+            FuncCall* func_call = (FuncCall*) node;
+
+            auto ra_func_call = arena->make<Ra__Node__Func_Call>(strVal(llast(func_call->funcname)));
 
-            auto ra_func_call = std::make_shared<Ra__Node__Func_Call>(func_call->funcname[func_call->n_funcname-1]->string->str);
-            
             if(ra_func_call->func_name=="date_part"){
                 ra_func_call->func_name = "extract";
             }
@@ -98,8 +194,11 @@ void SQLtoRA::parse_expression(PgQuery__Node* node, std::shared_ptr<Ra__Node>& r
                 || ra_func_call->func_name=="avg")
             {
                 ra_func_call->is_aggregating = true;
-                has_aggregate = true;
-                if(func_call->agg_distinct==1){
+                // aggregates over a window do not group the query
+                if(func_call->over==nullptr){
+                    has_aggregate = true;
+                }
+                if(func_call->agg_distinct){
                     ra_func_call->agg_distinct = true;
                 }
             }
@@ -107,91 +206,114 @@ void SQLtoRA::parse_expression(PgQuery__Node* node, std::shared_ptr<Ra__Node>& r
                 ra_func_call->is_aggregating = false;
             }
 
-            for(size_t i = 0; i<func_call->n_args; i++){
-                std::shared_ptr<Ra__Node> expr;
-                parse_expression(func_call->args[i], expr, has_aggregate);
+            ListCell* lc;
+            foreach(lc, func_call->args){
+                Ra__Node* expr = nullptr;
+                parse_expression((Node*) lfirst(lc), expr, has_aggregate);
                 ra_func_call->args.push_back(expr);
             }
-            if(func_call->agg_star==1){
-                auto attr = std::make_shared<Ra__Node__Attribute>("*");
+            if(func_call->agg_star){
+                auto attr = arena->make<Ra__Node__Attribute>(symbols->intern("*"));
                 ra_func_call->args.push_back(attr);
             }
+            if(func_call->over!=nullptr){
+                ra_func_call->is_window = true;
+                if(func_call->over->orderClause!=NIL || func_call->over->refname!=nullptr || func_call->over->name!=nullptr){
+                    std::cerr << "window order by and named windows not supported" << std::endl;
+                    unsupported_expression = true;
+                }
+                foreach(lc, func_call->over->partitionClause){
+                    Ra__Node* expr = nullptr;
+                    parse_expression((Node*) lfirst(lc), expr, has_aggregate);
+                    ra_func_call->window_partition.push_back(expr);
+                }
+            }
 
             ra_arg = ra_func_call;
             break;
         }
-        case PG_QUERY__NODE__NODE_TYPE_CAST:{
-            PgQuery__TypeCast* type_cast = node->type_cast;
-            std::shared_ptr<Ra__Node__Type_Cast> ra_type_cast;
-            if(type_cast->type_name->n_typmods>0){
-                switch(type_cast->type_name->typmods[0]->a_const->val->integer->ival){
-                    case 4: ra_type_cast = std::make_shared<Ra__Node__Type_Cast>(type_cast->type_name->names[type_cast->type_name->n_names-1]->string->str, "year"); break;
-                    case 2: ra_type_cast = std::make_shared<Ra__Node__Type_Cast>(type_cast->type_name->names[type_cast->type_name->n_names-1]->string->str, "month"); break;
-                    case 8: ra_type_cast = std::make_shared<Ra__Node__Type_Cast>(type_cast->type_name->names[type_cast->type_name->n_names-1]->string->str, "day"); break;
-                    default: std::cout << "type cast typmod not supported" << std::endl;
+        case T_TypeCast:{
+            TypeCast* type_cast = (TypeCast*) node;
+            std::string type_name = strVal(llast(type_cast->typeName->names));
+            Ra__Node__Type_Cast* ra_type_cast = nullptr;
+            if(list_length(type_cast->typeName->typmods)>0){
+                switch(intVal(&linitial_node(A_Const, type_cast->typeName->typmods)->val)){
+                    case 4: ra_type_cast = arena->make<Ra__Node__Type_Cast>(type_name, "year"); break;
+                    case 2: ra_type_cast = arena->make<Ra__Node__Type_Cast>(type_name, "month"); break;
+                    case 8: ra_type_cast = arena->make<Ra__Node__Type_Cast>(type_name, "day"); break;
+                    default:
+                        std::cerr << "type cast typmod not supported" << std::endl;
+                        unsupported_expression = true;
+                        return;
                 };
             }
             else{
-                ra_type_cast = std::make_shared<Ra__Node__Type_Cast>(type_cast->type_name->names[type_cast->type_name->n_names-1]->string->str);
+                ra_type_cast = arena->make<Ra__Node__Type_Cast>(type_name);
             }
             parse_expression(type_cast->arg, ra_type_cast->expression, has_aggregate);
-            ra_arg = ra_type_cast;
+            ra_arg = hash_cons(ra_type_cast);
             break;
         }
-        case PG_QUERY__NODE__NODE_CASE_EXPR:{
-            PgQuery__CaseExpr* case_expr = node->case_expr;
-            auto ra_case_expr = std::make_shared<Ra__Node__Case_Expr>();
-            // case_expr->n_args;
-            for(size_t i=0; i<case_expr->n_args;i++){
-                std::shared_ptr<Ra__Node> when;
-                std::shared_ptr<Ra__Node> then;
-                when = parse_where_expression(case_expr->args[i]->case_when->expr, when);
-                // parse_expression(case_expr->args[i]->case_when->expr, &when, has_aggregate);
-                parse_expression(case_expr->args[i]->case_when->result, then, has_aggregate);
-                auto case_when = std::make_shared<Ra__Node__Case_When>(when, then);
+        case T_CaseExpr:{
+            CaseExpr* case_expr = (CaseExpr*) node;
+            auto ra_case_expr = arena->make<Ra__Node__Case_Expr>();
+            ListCell* lc;
+            foreach(lc, case_expr->args){
+                CaseWhen* case_when_expr = lfirst_node(CaseWhen, lc);
+                Ra__Node* when = nullptr;
+                Ra__Node* then = nullptr;
+                when = parse_where_expression((Node*) case_when_expr->expr, when);
+                parse_expression((Node*) case_when_expr->result, then, has_aggregate);
+                auto case_when = arena->make<Ra__Node__Case_When>(when, then);
                 ra_case_expr->args.push_back(case_when);
             }
             if(case_expr->defresult!=nullptr){
-                std::shared_ptr<Ra__Node> else_default;
-                parse_expression(case_expr->defresult, else_default, has_aggregate);
+                Ra__Node* else_default = nullptr;
+                parse_expression((Node*) case_expr->defresult, else_default, has_aggregate);
                 ra_case_expr->else_default = else_default;
             }
             ra_arg = ra_case_expr;
             break;
         }
+        default:{
+            // e.g. subqueries in arithmetic or the select list, coalesce
+            std::cerr << "expression kind not supported" << std::endl;
+            unsupported_expression = true;
+            break;
+        }
     }
 }
 
-void SQLtoRA::find_expression_attributes(PgQuery__Node* node, std::vector<std::shared_ptr<Ra__Node__Attribute>>& attributes){
-    switch(node->node_case){
-        case PG_QUERY__NODE__NODE_COLUMN_REF: {
-            PgQuery__ColumnRef* columnRef = node->column_ref;
-            std::shared_ptr<Ra__Node__Attribute> attr;
-            switch(columnRef->n_fields){
+void SQLtoRA::find_expression_attributes(Node* node, std::vector<Ra__Node__Attribute*>& attributes){
+    switch(nodeTag(node)){
+        case T_ColumnRef: {
+            ColumnRef* columnRef = (ColumnRef*) node;
+            Ra__Node__Attribute* attr = nullptr;
+            switch(list_length(columnRef->fields)){
                 case 1: {
-                    if(columnRef->fields[0]->node_case==PG_QUERY__NODE__NODE_A_STAR){
-                        attr = std::make_shared<Ra__Node__Attribute>("*");
+                    if(IsA(linitial(columnRef->fields), A_Star)){
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern("*"));
                     }
                     else{
-                        attr = std::make_shared<Ra__Node__Attribute>(columnRef->fields[0]->string->str);
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern(strVal(linitial(columnRef->fields))));
                     }
-                    break; 
+                    break;
                 }
                 case 2: {
-                    if(columnRef->fields[1]->node_case==PG_QUERY__NODE__NODE_A_STAR){
-                        attr = std::make_shared<Ra__Node__Attribute>("*", columnRef->fields[0]->string->str);
+                    if(IsA(lsecond(columnRef->fields), A_Star)){
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern("*"), symbols->intern(strVal(linitial(columnRef->fields))));
                     }
                     else{
-                        attr = std::make_shared<Ra__Node__Attribute>(columnRef->fields[1]->string->str, columnRef->fields[0]->string->str);
-                    } 
+                        attr = arena->make<Ra__Node__Attribute>(symbols->intern(strVal(lsecond(columnRef->fields))), symbols->intern(strVal(linitial(columnRef->fields))));
+                    }
                     break;
-                } 
+                }
             }
             attributes.push_back(attr);
             break;
         }
-        case PG_QUERY__NODE__NODE_A_EXPR: {
-            PgQuery__AExpr* a_expr = node->a_expr;
+        case T_A_Expr: {
+            A_Expr* a_expr = (A_Expr*) node;
             if(a_expr->lexpr!=nullptr){
                 find_expression_attributes(a_expr->lexpr, attributes);
             }
@@ -200,148 +322,133 @@ void SQLtoRA::find_expression_attributes(PgQuery__Node* node, std::vector<std::s
             }
             break;
         }
-        case PG_QUERY__NODE__NODE_FUNC_CALL: {
-            PgQuery__FuncCall* func_call = node->func_call;
-            for(size_t i = 0; i<func_call->n_args; i++){
-                find_expression_attributes(func_call->args[i], attributes);
+        case T_FuncCall: {
+            FuncCall* func_call = (FuncCall*) node;
+            ListCell* lc;
+            foreach(lc, func_call->args){
+                find_expression_attributes((Node*) lfirst(lc), attributes);
             }
             break;
         }
-        case PG_QUERY__NODE__NODE_JOIN_EXPR: {
-            PgQuery__JoinExpr* join_expr = node->join_expr;
+        case T_JoinExpr: {
+            JoinExpr* join_expr = (JoinExpr*) node;
             find_where_expression_attributes(join_expr->quals, attributes);
         }
         default: break;
     }
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_select(PgQuery__SelectStmt* select_stmt){
+Ra__Node* SQLtoRA::parse_select(SelectStmt* select_stmt){
 
-    auto subtree_root = std::make_shared<Ra__Node>();
-    subtree_root->node_case = Ra__Node__NodeCase::RA__NODE__ROOT;
-    std::shared_ptr<Ra__Node> it = subtree_root;
-    
-    auto pr = std::make_shared<Ra__Node__Projection>();
+    auto pr = arena->make<Ra__Node__Projection>();
 
     bool has_aggregate = false;
-    if(select_stmt->n_distinct_clause>0){ // when is n_distinct_clause > 1?
+    if(list_length(select_stmt->distinctClause)>0){
         pr->distinct = true;
     }
 
     // loop through each select target
-    for(size_t i=0; i<select_stmt->n_target_list; i++){
-        PgQuery__Node* target = select_stmt->target_list[i];
-        PgQuery__ResTarget* res_target = target->res_target;
-        auto sel_expr = std::make_shared<Ra__Node__Select_Expression>();
-        std::shared_ptr<Ra__Node> expr;
+    ListCell* lc;
+    foreach(lc, select_stmt->targetList){
+        ResTarget* res_target = lfirst_node(ResTarget, lc);
+        auto sel_expr = arena->make<Ra__Node__Select_Expression>();
+        Ra__Node* expr = nullptr;
         parse_expression(res_target->val, expr, has_aggregate);
         sel_expr->expression = expr;
         pr->args.push_back(sel_expr);
 
-        if(strlen(res_target->name) > 0){
+        if(res_target->name!=nullptr && strlen(res_target->name) > 0){
             sel_expr->rename=res_target->name;
         }
     }
 
     // if projection expressions have aggretating func calls, add group by dummy
-    if(select_stmt->n_group_clause == 0 && has_aggregate){
+    if(list_length(select_stmt->groupClause) == 0 && has_aggregate){
         // add group by dummy
-        auto group_by = std::make_shared<Ra__Node__Group_By>(true);
+        auto group_by = arena->make<Ra__Node__Group_By>(true);
         add_subtree(pr, group_by);
     }
 
     return pr;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_from_subquery(PgQuery__RangeSubselect* range_subselect){
-    // ->subquery->select_stmt
-    std::shared_ptr<Ra__Node> result;
-    std::shared_ptr<Ra__Node__Projection> pr = std::static_pointer_cast<Ra__Node__Projection>(parse_select_statement(range_subselect->subquery->select_stmt));
-    pr->subquery_alias = range_subselect->alias->aliasname;
+Ra__Node* SQLtoRA::parse_from_subquery(RangeSubselect* range_subselect){
+    SelectStmt* subquery = castNode(SelectStmt, range_subselect->subquery);
+    Ra__Node__Projection* pr = static_cast<Ra__Node__Projection*>(parse_select_statement(subquery));
+    pr->subquery_alias = symbols->intern(range_subselect->alias->aliasname);
 
-    for(size_t i=0; i<range_subselect->alias->n_colnames; i++){
-        pr->subquery_columns.push_back(range_subselect->alias->colnames[i]->string->str);
+    ListCell* lc;
+    foreach(lc, range_subselect->alias->colnames){
+        pr->subquery_columns.push_back(strVal(lfirst(lc)));
     }
 
-    if(is_correlated_subquery(range_subselect->subquery->select_stmt)){
+    if(is_correlated_subquery(subquery)){
         // TODO: if subquery in from clause is correlated, then parent should be dependent join
-        std::cout << "correlated subquery in from clause is not supported" << std::endl;
-    }
-    else{
-        result = pr;
+        std::cerr << "correlated subquery in from clause is not supported" << std::endl;
+        unsupported_expression = true;
     }
-    return result;
+    return pr;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_where_subquery(PgQuery__SelectStmt* select_stmt, std::shared_ptr<Ra__Node>& ra_arg){
-    
-    auto predicate_expr = std::make_shared<Ra__Node__Expression>();
+Ra__Node* SQLtoRA::parse_where_subquery(SelectStmt* select_stmt, Ra__Node*& ra_arg){
 
-    std::shared_ptr<Ra__Node> join;
+    Ra__Node* join = nullptr;
     uint64_t marker = ++counter;
     if(is_correlated_subquery(select_stmt)){
-        join = std::make_shared<Ra__Node__Join>(RA__JOIN__DEPENDENT_INNER_LEFT,marker);
+        join = arena->make<Ra__Node__Join>(RA__JOIN__DEPENDENT_INNER_LEFT,marker);
     }
     else{
-        join = std::make_shared<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT,marker);
+        join = arena->make<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT,marker);
     }
 
-    std::shared_ptr<Ra__Node__Attribute> attr;
-    std::shared_ptr<Ra__Node__Projection> pr = std::static_pointer_cast<Ra__Node__Projection>(parse_select_statement(select_stmt));
-    
-    // selection predicate
-    // auto sel_expr = static_cast<Ra__Node__Select_Expression*>(pr->args[0]);
-    // counter++;
-    // sel_expr->rename = "a_" + std::to_string(counter); // nested select can only produce one output
-    // pr->subquery_alias = "r_" + std::to_string(counter);
-    // attr = new Ra__Node__Attribute(sel_expr->rename, pr->subquery_alias);
-    // predicate_expr->add_arg(attr);
-    // *ra_arg = predicate_expr;
+    Ra__Node__Projection* pr = static_cast<Ra__Node__Projection*>(parse_select_statement(select_stmt));
 
-    ra_arg = std::static_pointer_cast<Ra__Node__Join>(join)->right_where_subquery_marker;
+    ra_arg = static_cast<Ra__Node__Join*>(join)->right_where_subquery_marker;
 
     join->childNodes.push_back(pr);
     return join;
 };
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_where_in_list(PgQuery__Node* r_expr){  
-    
-    auto list = std::make_shared<Ra__Node__In_List>();
+Ra__Node* SQLtoRA::parse_where_in_list(Node* r_expr){
 
-    list->args.resize(r_expr->list->n_items);
+    auto list = arena->make<Ra__Node__In_List>();
+    List* items = (List*) r_expr;
+
+    list->args.resize(list_length(items));
     for(size_t i=0; i<list->args.size(); i++){
-        std::shared_ptr<Ra__Node> constant;
+        Ra__Node* constant = nullptr;
         bool dummy_has_aggregate;
-        parse_expression(r_expr->list->items[i], constant, dummy_has_aggregate);
+        parse_expression((Node*) list_nth(items, i), constant, dummy_has_aggregate);
         list->args[i] = constant;
     }
 
     return list;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_where_in_subquery(PgQuery__SubLink* sub_link, bool negated){    
-    std::shared_ptr<Ra__Node__Join> join;
+Ra__Node* SQLtoRA::parse_where_in_subquery(SubLink* sub_link, bool negated){
+    Ra__Node__Join* join = nullptr;
+    SelectStmt* subselect = castNode(SelectStmt, sub_link->subselect);
     uint64_t marker = ++counter;
-    if(is_correlated_subquery(sub_link->subselect->select_stmt)){
+    if(is_correlated_subquery(subselect)){
         if(negated){
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__ANTI_IN_LEFT_DEPENDENT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__ANTI_IN_LEFT_DEPENDENT,marker);
         }
         else{
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__IN_LEFT_DEPENDENT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__IN_LEFT_DEPENDENT,marker);
         }
     }
     else{
         if(negated){
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__ANTI_IN_LEFT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__ANTI_IN_LEFT,marker);
         }
         else{
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__IN_LEFT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__IN_LEFT,marker);
         }
     }
 
-    std::shared_ptr<Ra__Node> subquery_root = parse_select_statement(sub_link->subselect->select_stmt); 
+    Ra__Node* subquery_root = parse_select_statement(subselect);
     bool dummy_has_aggregate;
-    auto p = std::make_shared<Ra__Node__Predicate>();
+    auto p = arena->make<Ra__Node__Predicate>();
     parse_expression(sub_link->testexpr, p->left, dummy_has_aggregate);
     join->predicate = p;
 
@@ -349,106 +456,215 @@ std::shared_ptr<Ra__Node> SQLtoRA::parse_where_in_subquery(PgQuery__SubLink* sub
     return join;
 };
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_where_exists_subquery(PgQuery__SelectStmt* select_stmt, bool negated){
-    std::shared_ptr<Ra__Node> join;
+Ra__Node* SQLtoRA::parse_where_exists_subquery(SelectStmt* select_stmt, bool negated){
+    Ra__Node* join = nullptr;
     uint64_t marker = ++counter;
     if(is_correlated_subquery(select_stmt)){
         if(negated){
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__ANTI_LEFT_DEPENDENT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__ANTI_LEFT_DEPENDENT,marker);
         }
         else{
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__SEMI_LEFT_DEPENDENT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__SEMI_LEFT_DEPENDENT,marker);
         }
     }
     else{
         if(negated){
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__ANTI_LEFT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__ANTI_LEFT,marker);
         }
         else{
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__SEMI_LEFT,marker);
+            join = arena->make<Ra__Node__Join>(RA__JOIN__SEMI_LEFT,marker);
         }
     }
-    
+
     join->childNodes.push_back(parse_select_statement(select_stmt));
     return join;
 };
 
-bool SQLtoRA::is_tpch_attribute(std::string attr, std::string relation){
-    std::string::size_type pos = attr.find('_');
-    std::string attr_prefix;
-    attr_prefix = attr.substr(0, pos);
-
-    if(attr_prefix=="p" && relation=="part"
-        || attr_prefix=="s" && relation=="supplier"
-        || attr_prefix=="ps" && relation=="partsupp"
-        || attr_prefix=="c" && relation=="customer"
-        || attr_prefix=="n" && relation=="nation"
-        || attr_prefix=="l" && relation=="lineitem"
-        || attr_prefix=="r" && relation=="region"
-        || attr_prefix=="o" && relation=="orders")
-    {
-        return true;
+bool SQLtoRA::is_catalog_attribute(Ra__Symbol attr, Ra__Symbol relation){
+    return catalog->has_column(relation.str(), attr.str());
+}
+
+void SQLtoRA::resolve_attribute(Ra__Node__Attribute* attr){
+    // a column of one catalog table is found by the catalog
+    const std::string& name = attr->name.str();
+    if(catalog->find_tables_of_column(name).size()<2){
+        return;
+    }
+    ListCell* lc;
+    // order by c, where c is named in the select list
+    if(parsing_order_by && !scopes.empty()){
+        foreach(lc, scopes.back()->targetList){
+            ResTarget* res_target = lfirst_node(ResTarget, lc);
+            if(res_target->name!=nullptr && name==res_target->name){
+                return;
+            }
+        }
+    }
+    // innermost scope first, subqueries see the from items of the enclosing queries
+    for(auto scope = scopes.rbegin(); scope!=scopes.rend(); scope++){
+        std::vector<Ra__Symbol> qualifiers;
+        bool known_columns = true;
+        foreach(lc, (*scope)->fromClause){
+            known_columns &= find_from_items_with_column((Node*) lfirst(lc), name, qualifiers);
+        }
+        if(qualifiers.size()==1 && known_columns){
+            attr->alias = qualifiers[0];
+            return;
+        }
+        if(!qualifiers.empty() || !known_columns){
+            std::cerr << "attribute " << name << " is ambiguous" << std::endl;
+            unsupported_expression = true;
+            return;
+        }
+    }
+}
+
+bool SQLtoRA::find_from_items_with_column(Node* from_item, const std::string& column, std::vector<Ra__Symbol>& qualifiers){
+    switch(nodeTag(from_item)){
+        case T_RangeVar:{
+            RangeVar* range_var = (RangeVar*) from_item;
+            Ra__Symbol qualifier = symbols->intern(range_var->alias==nullptr ? range_var->relname : range_var->alias->aliasname);
+            // references of CTEs parsed before
+            Ra__Symbol relname = symbols->intern(range_var->relname);
+            for(auto cte: ctes){
+                auto cte_pr = static_cast<Ra__Node__Projection*>(cte);
+                if(cte_pr->subquery_alias!=relname){
+                    continue;
+                }
+                for(size_t i=0; i<cte_pr->args.size(); i++){
+                    auto sel_expr = static_cast<Ra__Node__Select_Expression*>(cte_pr->args[i]);
+                    std::string cte_column = sel_expr->rename;
+                    if(i<cte_pr->subquery_columns.size()){
+                        cte_column = cte_pr->subquery_columns[i];
+                    }
+                    else if(cte_column.empty() && sel_expr->expression!=nullptr && sel_expr->expression->node_case==RA__NODE__ATTRIBUTE){
+                        cte_column = static_cast<Ra__Node__Attribute*>(sel_expr->expression)->name.str();
+                        if(cte_column=="*"){
+                            return false;
+                        }
+                    }
+                    if(cte_column==column){
+                        qualifiers.push_back(qualifier);
+                        break;
+                    }
+                }
+                return true;
+            }
+            if(catalog->has_column(range_var->relname, column)){
+                qualifiers.push_back(qualifier);
+            }
+            return catalog->find_table(range_var->relname)!=nullptr;
+        }
+        case T_RangeSubselect:{
+            RangeSubselect* range_subselect = (RangeSubselect*) from_item;
+            SelectStmt* subquery = castNode(SelectStmt, range_subselect->subquery);
+            // union and values
+            if(list_length(subquery->targetList)==0){
+                return false;
+            }
+            Ra__Symbol qualifier = symbols->intern(range_subselect->alias->aliasname);
+            int position = 0;
+            ListCell* lc;
+            foreach(lc, subquery->targetList){
+                ResTarget* res_target = lfirst_node(ResTarget, lc);
+                std::string subquery_column;
+                if(position<list_length(range_subselect->alias->colnames)){
+                    subquery_column = strVal(list_nth(range_subselect->alias->colnames, position));
+                }
+                else if(res_target->name!=nullptr){
+                    subquery_column = res_target->name;
+                }
+                else if(IsA(res_target->val, ColumnRef)){
+                    Node* field = (Node*) llast(((ColumnRef*) res_target->val)->fields);
+                    if(IsA(field, A_Star)){
+                        return false;
+                    }
+                    subquery_column = strVal(field);
+                }
+                if(subquery_column==column){
+                    qualifiers.push_back(qualifier);
+                    break;
+                }
+                position++;
+            }
+            return true;
+        }
+        case T_JoinExpr:{
+            JoinExpr* join_expr = (JoinExpr*) from_item;
+            // using and natural joins merge the columns of both sides, a join alias hides their names
+            if(join_expr->alias!=nullptr || join_expr->usingClause!=NIL || join_expr->isNatural){
+                return false;
+            }
+            return find_from_items_with_column(join_expr->larg, column, qualifiers) & find_from_items_with_column(join_expr->rarg, column, qualifiers);
+        }
+        default: return false;
     }
-    return false;
 }
 
-bool SQLtoRA::is_correlated_subquery(PgQuery__SelectStmt* select_stmt){
+bool SQLtoRA::is_correlated_subquery(SelectStmt* select_stmt){
 
     // get relation names + aliases in subquery from
-    std::set<std::pair<std::string,std::string>> relations_aliases;
-    for(size_t i=0; i<select_stmt->n_from_clause; i++){
-        switch(select_stmt->from_clause[i]->node_case){
-            case PG_QUERY__NODE__NODE_RANGE_VAR:{
-                PgQuery__RangeVar* range_var = select_stmt->from_clause[i]->range_var;
+    std::set<std::pair<Ra__Symbol,Ra__Symbol>> relations_aliases;
+    ListCell* lc;
+    foreach(lc, select_stmt->fromClause){
+        Node* from_item = (Node*) lfirst(lc);
+        switch(nodeTag(from_item)){
+            case T_RangeVar:{
+                RangeVar* range_var = (RangeVar*) from_item;
                 std::string relname = range_var->relname;
                 std::string alias = range_var->alias==nullptr ? "" : range_var->alias->aliasname;
-                relations_aliases.insert({relname,alias});
+                relations_aliases.insert({symbols->intern(relname),symbols->intern(alias)});
                 break;
             }
             // handles attributes of a join without rename (TPCH Q13)
-            case PG_QUERY__NODE__NODE_JOIN_EXPR:{
-                PgQuery__JoinExpr* join_expr = select_stmt->from_clause[i]->join_expr;
-                PgQuery__RangeVar* l_range_var = join_expr->larg->range_var;
+            case T_JoinExpr:{
+                JoinExpr* join_expr = (JoinExpr*) from_item;
+                // other join inputs are rejected by parse_from_join
+                if(!IsA(join_expr->larg, RangeVar) || !IsA(join_expr->rarg, RangeVar)){
+                    break;
+                }
+                RangeVar* l_range_var = castNode(RangeVar, join_expr->larg);
                 std::string l_relname = l_range_var->relname;
                 std::string l_alias = l_range_var->alias==nullptr ? "" : l_range_var->alias->aliasname;
-                relations_aliases.insert({l_relname,l_alias});
+                relations_aliases.insert({symbols->intern(l_relname),symbols->intern(l_alias)});
 
-                PgQuery__RangeVar* r_range_var = join_expr->rarg->range_var;
+                RangeVar* r_range_var = castNode(RangeVar, join_expr->rarg);
                 std::string r_relname = r_range_var->relname;
                 std::string r_alias = r_range_var->alias==nullptr ? "" : r_range_var->alias->aliasname;
-                relations_aliases.insert({r_relname,r_alias});
+                relations_aliases.insert({symbols->intern(r_relname),symbols->intern(r_alias)});
                 break;
             }
+            default: break;
         }
     }
 
     // get all attributes used in subquery select, where, and join predicates
-    std::vector<std::shared_ptr<Ra__Node__Attribute>> attributes;
-    for(size_t i=0; i<select_stmt->n_target_list; i++){
-        find_expression_attributes(select_stmt->target_list[i]->res_target->val, attributes);
+    std::vector<Ra__Node__Attribute*> attributes;
+    foreach(lc, select_stmt->targetList){
+        find_expression_attributes(lfirst_node(ResTarget, lc)->val, attributes);
     }
-    if(select_stmt->where_clause!=nullptr){
-        find_where_expression_attributes(select_stmt->where_clause, attributes);
+    if(select_stmt->whereClause!=nullptr){
+        find_where_expression_attributes(select_stmt->whereClause, attributes);
     }
-    //
-    for(size_t i=0; i<select_stmt->n_from_clause; i++){
-        find_expression_attributes(select_stmt->from_clause[i], attributes);
+    foreach(lc, select_stmt->fromClause){
+        find_expression_attributes((Node*) lfirst(lc), attributes);
     }
 
     // if attribute used in select/where has not been defined in from -> correlated subquery
+    Ra__Symbol star = symbols->intern("*");
     for(const auto& attr: attributes){
         bool found = false;
-        if(attr->name=="*"){
+        if(attr->name==star){
             continue;
         }
         for(const auto& rel: relations_aliases){
             // if matching alias with relation name/alias
-            if((attr->alias==rel.first) || (attr->alias.length()>0 && attr->alias==rel.second)){
+            if((attr->alias==rel.first) || (!attr->alias.empty() && attr->alias==rel.second)){
                 found = true;
                 break;
             }
-            // check tpch naming
-            else if(attr->alias.length()==0 && is_tpch_attribute(attr->name,rel.first)){
+            // check catalog
+            else if(attr->alias.empty() && is_catalog_attribute(attr->name,rel.first)){
                 found = true;
                 break;
             }
@@ -459,17 +675,18 @@ bool SQLtoRA::is_correlated_subquery(PgQuery__SelectStmt* select_stmt){
     return false; // is not correlated subquery
 };
 
-void SQLtoRA::find_where_expression_attributes(PgQuery__Node* node, std::vector<std::shared_ptr<Ra__Node__Attribute>>& attributes){
-    switch(node->node_case){
-        case PG_QUERY__NODE__NODE_BOOL_EXPR: {
-            PgQuery__BoolExpr* expr = node->bool_expr;
-            for(size_t i=0; i<expr->n_args; i++){
-                find_where_expression_attributes(expr->args[i], attributes);
+void SQLtoRA::find_where_expression_attributes(Node* node, std::vector<Ra__Node__Attribute*>& attributes){
+    switch(nodeTag(node)){
+        case T_BoolExpr: {
+            BoolExpr* expr = (BoolExpr*) node;
+            ListCell* lc;
+            foreach(lc, expr->args){
+                find_where_expression_attributes((Node*) lfirst(lc), attributes);
             }
             break;
         }
-        case PG_QUERY__NODE__NODE_A_EXPR: {
-            PgQuery__AExpr* a_expr = node->a_expr;
+        case T_A_Expr: {
+            A_Expr* a_expr = (A_Expr*) node;
             find_expression_attributes(a_expr->lexpr, attributes);
             find_expression_attributes(a_expr->rexpr, attributes);
             break;
@@ -478,92 +695,92 @@ void SQLtoRA::find_where_expression_attributes(PgQuery__Node* node, std::vector<
     }
 }
 
-// case subquery: return marker
-// no more return nullptr
-std::shared_ptr<Ra__Node> SQLtoRA::parse_where_expression(PgQuery__Node* node, std::shared_ptr<Ra__Node> ra_selection, bool sublink_negated){
-    switch(node->node_case){
-        case PG_QUERY__NODE__NODE_BOOL_EXPR: {
-            PgQuery__BoolExpr* expr = node->bool_expr;
-            auto p = std::make_shared<Ra__Node__Bool_Predicate>();
+Ra__Node* SQLtoRA::parse_where_expression(Node* node, Ra__Node* ra_selection, bool sublink_negated){
+    switch(nodeTag(node)){
+        case T_BoolExpr: {
+            BoolExpr* expr = (BoolExpr*) node;
+            auto p = arena->make<Ra__Node__Bool_Predicate>();
             bool is_not = false;
             switch(expr->boolop){
-                case PG_QUERY__BOOL_EXPR_TYPE__AND_EXPR: {
+                case AND_EXPR: {
                     p->bool_operator = RA__BOOL_OPERATOR__AND;
                     break;
                 }
-                case PG_QUERY__BOOL_EXPR_TYPE__OR_EXPR: {
+                case OR_EXPR: {
                     p->bool_operator = RA__BOOL_OPERATOR__OR;
                     break;
                 }
-                case PG_QUERY__BOOL_EXPR_TYPE__NOT_EXPR: {
+                case NOT_EXPR: {
                     p->bool_operator = RA__BOOL_OPERATOR__NOT;
                     is_not = true;
                     break;
                 }
             }
-            for(size_t i=0; i<expr->n_args; i++){
-                std::shared_ptr<Ra__Node> predicate = parse_where_expression(expr->args[i], ra_selection, is_not);
+            ListCell* lc;
+            foreach(lc, expr->args){
+                Ra__Node* predicate = parse_where_expression((Node*) lfirst(lc), ra_selection, is_not);
                 if(predicate!=nullptr){
                     p->args.push_back(predicate);
                 }
             }
             return p;
         }
-        case PG_QUERY__NODE__NODE_A_EXPR: {
-            PgQuery__AExpr* a_expr = node->a_expr;
-            auto p = std::make_shared<Ra__Node__Predicate>();
-            std::shared_ptr<Ra__Node> ra_l_expr;
-            std::shared_ptr<Ra__Node> ra_r_expr;
+        case T_A_Expr: {
+            A_Expr* a_expr = (A_Expr*) node;
+            auto p = arena->make<Ra__Node__Predicate>();
+            Ra__Node* ra_l_expr = nullptr;
+            Ra__Node* ra_r_expr = nullptr;
 
             switch(a_expr->kind){
-                case PG_QUERY__A__EXPR__KIND__AEXPR_OP:{
-                    p->binaryOperator = a_expr->name[0]->string->str; 
+                case AEXPR_OP:{
+                    p->binaryOperator = strVal(linitial(a_expr->name));
                     break;
                 }
-                case PG_QUERY__A__EXPR__KIND__AEXPR_LIKE:{
-                    if(a_expr->name[0]->string->str[0]=='!'){
+                case AEXPR_LIKE:{
+                    if(strVal(linitial(a_expr->name))[0]=='!'){
                         p->binaryOperator = " not like ";
                     }
                     else{
                         p->binaryOperator = " like ";
                     }
                     break;
-                } 
-                case PG_QUERY__A__EXPR__KIND__AEXPR_BETWEEN:{
+                }
+                case AEXPR_BETWEEN:{
                     p->binaryOperator = " between ";
                     break;
-                } 
+                }
                 // only covers in list (not subquery)
-                case PG_QUERY__A__EXPR__KIND__AEXPR_IN:{
-                    std::string s(a_expr->name[0]->string->str);
+                case AEXPR_IN:{
+                    std::string s(strVal(linitial(a_expr->name)));
                     // "in"
                     if(s == "="){
                         p->binaryOperator = " in ";
-                        // add_subtree(ra_selection, parse_where_in_list(a_expr->lexpr, a_expr->rexpr, false));  
                     }
                     // "not in"
                     else if(s == "<>") {
                         p->binaryOperator = " not in ";
-                        // add_subtree(ra_selection, parse_where_in_list(a_expr->lexpr, a_expr->rexpr, true)); 
                     }
                     bool dummy_has_aggregate;
                     parse_expression(a_expr->lexpr, p->left, dummy_has_aggregate);
                     p->right = parse_where_in_list(a_expr->rexpr);
                     return p;
                 }
-                default: std::cout << "expr kind not supported" << std::endl;
+                default:
+                    std::cerr << "expr kind not supported" << std::endl;
+                    unsupported_expression = true;
+                    return p;
             }
 
-            // case a=b: parse left and right, return predicate for selection  
+            // case a=b: parse left and right, return predicate for selection
             // case uncorrelated subquery: add crossproduct(s), return predicate for selection
             // case correlated subquery: add dependent join(s), set predicate to the "higher" join
-            std::shared_ptr<Ra__Node> left_subquery_join = nullptr;
-            std::shared_ptr<Ra__Node> right_subquery_join = nullptr;
+            Ra__Node* left_subquery_join = nullptr;
+            Ra__Node* right_subquery_join = nullptr;
 
-            switch(a_expr->lexpr->node_case){
-                case PG_QUERY__NODE__NODE_SUB_LINK:{
-                    PgQuery__SubLink* sub_link = a_expr->lexpr->sub_link;
-                    left_subquery_join = parse_where_subquery(sub_link->subselect->select_stmt, ra_l_expr);
+            switch(nodeTag(a_expr->lexpr)){
+                case T_SubLink:{
+                    SubLink* sub_link = (SubLink*) a_expr->lexpr;
+                    left_subquery_join = parse_where_subquery(castNode(SelectStmt, sub_link->subselect), ra_l_expr);
                     add_subtree(ra_selection, left_subquery_join);
                     break;
                 }
@@ -573,20 +790,21 @@ std::shared_ptr<Ra__Node> SQLtoRA::parse_where_expression(PgQuery__Node* node, s
                 }
             }
 
-            switch(a_expr->rexpr->node_case){
-                case PG_QUERY__NODE__NODE_SUB_LINK:{
-                    PgQuery__SubLink* sub_link = a_expr->rexpr->sub_link;
-                    right_subquery_join = parse_where_subquery(sub_link->subselect->select_stmt, ra_r_expr);
+            switch(nodeTag(a_expr->rexpr)){
+                case T_SubLink:{
+                    SubLink* sub_link = (SubLink*) a_expr->rexpr;
+                    right_subquery_join = parse_where_subquery(castNode(SelectStmt, sub_link->subselect), ra_r_expr);
                     break;
                 }
-                case PG_QUERY__NODE__NODE_LIST:{
+                case T_List:{
                     // between
-                    auto list = std::make_shared<Ra__Node__List>();
-                    list->args.resize(a_expr->rexpr->list->n_items);
+                    List* items = (List*) a_expr->rexpr;
+                    auto list = arena->make<Ra__Node__List>();
+                    list->args.resize(list_length(items));
                     for(size_t i=0; i<list->args.size(); i++){
-                        std::shared_ptr<Ra__Node> expr;
+                        Ra__Node* expr = nullptr;
                         bool dummy_has_aggregate;
-                        parse_expression(a_expr->rexpr->list->items[i], expr, dummy_has_aggregate);
+                        parse_expression((Node*) list_nth(items, i), expr, dummy_has_aggregate);
                         list->args[i]=expr;
                     }
                     ra_r_expr = list;
@@ -597,163 +815,147 @@ std::shared_ptr<Ra__Node> SQLtoRA::parse_where_expression(PgQuery__Node* node, s
                     parse_expression(a_expr->rexpr, ra_r_expr, dummy_has_aggregate);
                 }
             }
-            
+
             p->left = ra_l_expr;
             p->right = ra_r_expr;
-            
 
             // left and right are subqueries
             if(left_subquery_join!=nullptr && right_subquery_join!=nullptr){
                 // if both joins are dependent
                 if(left_subquery_join->node_case==RA__NODE__JOIN && right_subquery_join->node_case==RA__NODE__JOIN){
-                    // give predicate to "higher" dependent join
-                    // static_cast<Ra__Node__Join*>(left_subquery_join)->predicate = p;
                     // left join added first, is higher
                     add_subtree(ra_selection, left_subquery_join);
                     add_subtree(ra_selection, right_subquery_join);
                 }
                 // if left is dependent, right not
                 else if(left_subquery_join->node_case==RA__NODE__JOIN){
-                    // add predicate to dependent join
-                    // static_cast<Ra__Node__Join*>(left_subquery_join)->predicate = p;
-
                     // first add dependent join, then cp
                     add_subtree(ra_selection, left_subquery_join);
                     add_subtree(ra_selection, right_subquery_join);
                 }
                 // if right is dependent, left not
                 else if(right_subquery_join->node_case==RA__NODE__JOIN){
-                    // add predicate to dependent join
-                    // static_cast<Ra__Node__Join*>(right_subquery_join)->predicate = p;
-                    
                     // first add dependent join, then cp
                     add_subtree(ra_selection, right_subquery_join);
                     add_subtree(ra_selection, left_subquery_join);
                 }
                 return p;
             }
-            // left is subquery
+            // left is subquery, cp/join already added to selection
             else if(left_subquery_join!=nullptr){
-                // if dependent join, add predicate
-                if(left_subquery_join->node_case==RA__NODE__JOIN){
-                    // static_cast<Ra__Node__Join*>(left_subquery_join)->predicate = p;
-                    // add cp/join to selection
-                    add_subtree(ra_selection, left_subquery_join);
-                    return p;
-                }
-                else{
-                    add_subtree(ra_selection, left_subquery_join);
-                    return p;
-                }
+                add_subtree(ra_selection, left_subquery_join);
+                return p;
             }
-            // right is subquery
+            // right is subquery, add cp/join to selection
             else if(right_subquery_join!=nullptr){
-                // if dependent join, add predicate
-                if(right_subquery_join->node_case==RA__NODE__JOIN){
-                    // static_cast<Ra__Node__Join*>(right_subquery_join)->predicate = p;
-                    // add cp/join to selection
-                    add_subtree(ra_selection, right_subquery_join);
-                    return p;
-                }
-                else{
-                    add_subtree(ra_selection, right_subquery_join);
-                    return p;
-                }
+                add_subtree(ra_selection, right_subquery_join);
+                return p;
             }
             return p;
         }
         // for "Exists" and "In" subqueries
-        case PG_QUERY__NODE__NODE_SUB_LINK: {
+        case T_SubLink: {
             // no predicate to return for selection, subquery is connected through join
             // add subquery to from
-            PgQuery__SubLink* sub_link = node->sub_link;
-            std::shared_ptr<Ra__Node> join = nullptr;
-            switch(sub_link->sub_link_type){
-                case PG_QUERY__SUB_LINK_TYPE__EXISTS_SUBLINK:{
-                    join = parse_where_exists_subquery(sub_link->subselect->select_stmt, sublink_negated);
+            SubLink* sub_link = (SubLink*) node;
+            Ra__Node* join = nullptr;
+            switch(sub_link->subLinkType){
+                case EXISTS_SUBLINK:{
+                    join = parse_where_exists_subquery(castNode(SelectStmt, sub_link->subselect), sublink_negated);
                     break;
                 }
                 // "in"
-                case PG_QUERY__SUB_LINK_TYPE__ANY_SUBLINK: {
+                case ANY_SUBLINK: {
                     join = parse_where_in_subquery(sub_link, sublink_negated);
                     break;
                 }
-                default: std::cout << "sublink type not supported" << std::endl;;
+                default:
+                    // e.g. all, scalar subqueries as predicates
+                    std::cerr << "sublink type not supported" << std::endl;
+                    unsupported_expression = true;
+                    return nullptr;
             }
             add_subtree(ra_selection,join);
             // put marker into predicate for in and exists
-            return std::static_pointer_cast<Ra__Node__Join>(join)->right_where_subquery_marker;
+            return static_cast<Ra__Node__Join*>(join)->right_where_subquery_marker;
         }
-        case PG_QUERY__NODE__NODE_NULL_TEST:{
-            PgQuery__NullTest* null_test = node->null_test;
-            null_test->arg;
-            auto ra_null_test = std::make_shared<Ra__Node__Null_Test>(); 
+        case T_NullTest:{
+            NullTest* null_test = (NullTest*) node;
+            auto ra_null_test = arena->make<Ra__Node__Null_Test>();
             switch(null_test->nulltesttype){
-                case PG_QUERY__NULL_TEST_TYPE__IS_NULL: {
+                case IS_NULL: {
                     ra_null_test->type = RA__NULL_TEST__IS_NULL;
                     break;
                 }
-                case PG_QUERY__NULL_TEST_TYPE__IS_NOT_NULL: {
+                case IS_NOT_NULL: {
                     ra_null_test->type = RA__NULL_TEST__IS_NOT_NULL;
                     break;
                 }
             };
             bool dummy_has_aggregate;
-            parse_expression(null_test->arg, ra_null_test->arg, dummy_has_aggregate);
+            parse_expression((Node*) null_test->arg, ra_null_test->arg, dummy_has_aggregate);
             return ra_null_test;
         }
-        default: std::cout << "error parse where expr" << std::endl; return nullptr;
+        default:
+            std::cerr << "error parse where expr" << std::endl;
+            unsupported_expression = true;
+            return nullptr;
     }
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_where(PgQuery__Node* where_clause){
+Ra__Node* SQLtoRA::parse_where(Node* where_clause){
 
     // case: no where clause
     if(where_clause==nullptr){
         return nullptr;
-    }  
+    }
 
-    auto ra_selection = std::make_shared<Ra__Node__Selection>();
+    auto ra_selection = arena->make<Ra__Node__Selection>();
     ra_selection->predicate = parse_where_expression(where_clause, ra_selection);
 
     // case: if selection has no predicates (e.g. where only had exists subquery), skip selection node
     if (ra_selection->predicate == nullptr){
-        return ra_selection->childNodes[0];
+        return ra_selection->childNodes.empty() ? nullptr : ra_selection->childNodes[0];
     }
 
     return ra_selection;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_from(PgQuery__Node** from_clause, size_t n_from_clause){
+Ra__Node* SQLtoRA::parse_from(List* from_clause){
 
-    if(n_from_clause==0){
+    if(list_length(from_clause)==0){
         // Dummy child for edge case: no from clause
-        return std::make_shared<Ra__Node__Dummy>();
+        return arena->make<Ra__Node__Dummy>();
     }
 
     // add from clause relations
-    std::vector<std::shared_ptr<Ra__Node>> relations;
-    for(size_t j=0; j<n_from_clause; j++){
-        switch(from_clause[j]->node_case){
-            case PG_QUERY__NODE__NODE_RANGE_VAR:{
-                PgQuery__RangeVar* from_range_var = from_clause[j]->range_var;
-                auto relation = std::make_shared<Ra__Node__Relation>(from_range_var->relname);
+    std::vector<Ra__Node*> relations;
+    ListCell* lc;
+    foreach(lc, from_clause){
+        Node* from_item = (Node*) lfirst(lc);
+        switch(nodeTag(from_item)){
+            case T_RangeVar:{
+                RangeVar* from_range_var = (RangeVar*) from_item;
+                auto relation = arena->make<Ra__Node__Relation>(symbols->intern(from_range_var->relname));
                 if(from_range_var->alias!=nullptr){
-                    relation->alias = from_range_var->alias->aliasname;
+                    relation->alias = symbols->intern(from_range_var->alias->aliasname);
                 }
                 relations.push_back(relation);
                 break;
             }
-            case PG_QUERY__NODE__NODE_RANGE_SUBSELECT:{
-                PgQuery__RangeSubselect* range_subselect = from_clause[j]->range_subselect;
-                relations.push_back(parse_from_subquery(range_subselect));
+            case T_RangeSubselect:{
+                relations.push_back(parse_from_subquery((RangeSubselect*) from_item));
                 break;
             }
-            case PG_QUERY__NODE__NODE_JOIN_EXPR:{
-                PgQuery__JoinExpr* join_expr = from_clause[j]->join_expr;
-                relations.push_back(parse_from_join(join_expr));
+            case T_JoinExpr:{
+                relations.push_back(parse_from_join((JoinExpr*) from_item));
                 break;
             }
+            default:
+                // e.g. table functions
+                std::cerr << "from item not supported" << std::endl;
+                unsupported_expression = true;
+                relations.push_back(arena->make<Ra__Node__Dummy>());
         }
     }
 
@@ -761,58 +963,73 @@ std::shared_ptr<Ra__Node> SQLtoRA::parse_from(PgQuery__Node** from_clause, size_
         return relations[0];
     }
 
-    auto cp = std::make_shared<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT);
+    auto cp = arena->make<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT);
 
     for(size_t i=0; i<relations.size(); i++){
         add_subtree(cp, relations[i]);
         if(i<relations.size()-2){
-            add_subtree(cp, std::make_shared<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT));
+            add_subtree(cp, arena->make<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT));
         }
     }
 
     return cp;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_from_join(PgQuery__JoinExpr* join_expr){
-    std::shared_ptr<Ra__Node__Join> join;
+Ra__Node* SQLtoRA::parse_from_join(JoinExpr* join_expr){
+    Ra__Node__Join* join = nullptr;
 
     switch(join_expr->jointype){
-        case PG_QUERY__JOIN_TYPE__JOIN_INNER:{
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__INNER);
+        case JOIN_INNER:{
+            join = arena->make<Ra__Node__Join>(RA__JOIN__INNER);
+            break;
+        }
+        case JOIN_LEFT:{
+            join = arena->make<Ra__Node__Join>(RA__JOIN__LEFT);
             break;
         }
-        case PG_QUERY__JOIN_TYPE__JOIN_LEFT:{
-            join = std::make_shared<Ra__Node__Join>(RA__JOIN__LEFT);
+        case JOIN_FULL:{
+            join = arena->make<Ra__Node__Join>(RA__JOIN__FULL_OUTER);
             break;
         }
-        default: std::cout << "join type not supported yet" << std::endl;
+        default:
+            std::cerr << "join type not supported yet" << std::endl;
+            unsupported_expression = true;
+            return arena->make<Ra__Node__Dummy>();
+    }
+
+    // nested joins and subqueries as join inputs
+    if(!IsA(join_expr->larg, RangeVar) || !IsA(join_expr->rarg, RangeVar)){
+        std::cerr << "join of a join or subquery not supported yet" << std::endl;
+        unsupported_expression = true;
+        return arena->make<Ra__Node__Dummy>();
     }
 
     if(join_expr->alias!=nullptr){
-        join->alias = join_expr->alias->aliasname;
-        for(size_t i=0; i<join_expr->alias->n_colnames; i++){
-            join->columns.push_back(join_expr->alias->colnames[i]->string->str);
+        join->alias = symbols->intern(join_expr->alias->aliasname);
+        ListCell* lc;
+        foreach(lc, join_expr->alias->colnames){
+            join->columns.push_back(strVal(lfirst(lc)));
         }
     }
 
     // left join expression
-    PgQuery__RangeVar* l_range_var = join_expr->larg->range_var;
-    auto l_relation = std::make_shared<Ra__Node__Relation>(l_range_var->relname);
+    RangeVar* l_range_var = castNode(RangeVar, join_expr->larg);
+    auto l_relation = arena->make<Ra__Node__Relation>(symbols->intern(l_range_var->relname));
     if(l_range_var->alias!=nullptr){
-        l_relation->alias = l_range_var->alias->aliasname;
+        l_relation->alias = symbols->intern(l_range_var->alias->aliasname);
     }
     join->childNodes.push_back(l_relation);
-           
+
     // right join expression
-    PgQuery__RangeVar* r_range_var = join_expr->rarg->range_var;
-    auto r_relation = std::make_shared<Ra__Node__Relation>(r_range_var->relname);
+    RangeVar* r_range_var = castNode(RangeVar, join_expr->rarg);
+    auto r_relation = arena->make<Ra__Node__Relation>(symbols->intern(r_range_var->relname));
     if(r_range_var->alias!=nullptr){
-        r_relation->alias = r_range_var->alias->aliasname;
+        r_relation->alias = symbols->intern(r_range_var->alias->aliasname);
     }
     join->childNodes.push_back(r_relation);
-    
+
     // join predicate
-    std::shared_ptr<Ra__Node> dummy;
+    Ra__Node* dummy = nullptr;
     if(join_expr->quals!=nullptr){
         join->predicate = parse_where_expression(join_expr->quals, dummy);
     }
@@ -820,8 +1037,8 @@ std::shared_ptr<Ra__Node> SQLtoRA::parse_from_join(PgQuery__JoinExpr* join_expr)
     return join;
 }
 
-void SQLtoRA::add_subtree(std::shared_ptr<Ra__Node> base, std::shared_ptr<Ra__Node> subtree){
-    std::shared_ptr<Ra__Node> it = base;
+void SQLtoRA::add_subtree(Ra__Node* base, Ra__Node* subtree){
+    Ra__Node* it = base;
     assert(find_empty_leaf(it));
     if(it->node_case==RA__NODE__JOIN){
         it->childNodes.insert(it->childNodes.begin(), subtree);
@@ -831,7 +1048,7 @@ void SQLtoRA::add_subtree(std::shared_ptr<Ra__Node> base, std::shared_ptr<Ra__No
     }
 }
 
-bool SQLtoRA::find_empty_leaf(std::shared_ptr<Ra__Node>& it){
+bool SQLtoRA::find_empty_leaf(Ra__Node*& it){
     if(it->n_children == 0){
         return false;
     }
@@ -841,7 +1058,7 @@ bool SQLtoRA::find_empty_leaf(std::shared_ptr<Ra__Node>& it){
     }
 
     bool found = false;
-    std::vector<std::shared_ptr<Ra__Node>> childNodes = it->childNodes;
+    std::vector<Ra__Node*> childNodes = it->childNodes;
     for(auto child: childNodes){
         if(!found){
             it = child;
@@ -851,60 +1068,88 @@ bool SQLtoRA::find_empty_leaf(std::shared_ptr<Ra__Node>& it){
     return found;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_order_by(PgQuery__Node** sort_clause, size_t n_sort_clause){
+Ra__Node* SQLtoRA::parse_order_by(List* sort_clause){
 
-    if(n_sort_clause == 0){
+    if(list_length(sort_clause) == 0){
         return nullptr;
     }
 
-    auto order_by = std::make_shared<Ra__Node__Order_By>();
-    for(size_t i=0; i<n_sort_clause; i++){
+    auto order_by = arena->make<Ra__Node__Order_By>();
+    parsing_order_by = true;
+    ListCell* lc;
+    foreach(lc, sort_clause){
+        SortBy* sort_by = lfirst_node(SortBy, lc);
         bool dummy_has_aggregate; // has_aggregate used by parse_select to detect implicit group by
-        std::shared_ptr<Ra__Node> ra_expr;
-        parse_expression(sort_clause[i]->sort_by->node, ra_expr, dummy_has_aggregate);
+        Ra__Node* ra_expr = nullptr;
+        parse_expression(sort_by->node, ra_expr, dummy_has_aggregate);
         order_by->args.push_back(ra_expr);
-        switch(sort_clause[i]->sort_by->sortby_dir){
-            case PG_QUERY__SORT_BY_DIR__SORTBY_DEFAULT:{
+        switch(sort_by->sortby_dir){
+            case SORTBY_DEFAULT:{
                 order_by->directions.push_back(RA__ORDER_BY__DEFAULT);
                 break;
             }
-            case PG_QUERY__SORT_BY_DIR__SORTBY_ASC:{
+            case SORTBY_ASC:{
                 order_by->directions.push_back(RA__ORDER_BY__ASC);
                 break;
             }
-            case PG_QUERY__SORT_BY_DIR__SORTBY_DESC:{
+            case SORTBY_DESC:{
                 order_by->directions.push_back(RA__ORDER_BY__DESC);
                 break;
             }
+            default: break;
         }
     }
+    parsing_order_by = false;
     return order_by;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_group_by(PgQuery__Node** group_clause, size_t n_group_clause){
-    if(n_group_clause == 0){
+Ra__Node* SQLtoRA::parse_limit(SelectStmt* select_stmt){
+    // "limit all" is a null constant
+    auto is_null_constant = [](Node* node){
+        return IsA(node, A_Const) && nodeTag(&((A_Const*) node)->val)==T_Null;
+    };
+    Node* limit_count = select_stmt->limitCount!=nullptr && !is_null_constant(select_stmt->limitCount) ? select_stmt->limitCount : nullptr;
+    if(limit_count==nullptr && select_stmt->limitOffset==nullptr){
         return nullptr;
     }
 
-    auto group_by = std::make_shared<Ra__Node__Group_By>(false);
-    for(size_t i=0; i<n_group_clause; i++){
-        std::shared_ptr<Ra__Node> ra_expr;
+    auto limit = arena->make<Ra__Node__Limit>();
+    bool dummy_has_aggregate; // has_aggregate used by parse_select to detect implicit group by
+    if(limit_count!=nullptr){
+        parse_expression(limit_count, limit->count, dummy_has_aggregate);
+    }
+    if(select_stmt->limitOffset!=nullptr){
+        parse_expression(select_stmt->limitOffset, limit->offset, dummy_has_aggregate);
+    }
+    limit->with_ties = select_stmt->limitOption==LIMIT_OPTION_WITH_TIES;
+    return limit;
+}
+
+Ra__Node* SQLtoRA::parse_group_by(List* group_clause){
+    if(list_length(group_clause) == 0){
+        return nullptr;
+    }
+
+    auto group_by = arena->make<Ra__Node__Group_By>(false);
+    ListCell* lc;
+    foreach(lc, group_clause){
+        Ra__Node* ra_expr = nullptr;
         bool dummy_has_aggregate; // has_aggregate used by parse_select to detect implicit group by
-        
-        parse_expression(group_clause[i], ra_expr, dummy_has_aggregate);
+
+        parse_expression((Node*) lfirst(lc), ra_expr, dummy_has_aggregate);
         group_by->args.push_back(ra_expr);
     }
 
     return group_by;
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_having(PgQuery__Node* having_clause){
+Ra__Node* SQLtoRA::parse_having(Node* having_clause){
     if(having_clause==nullptr){
         return nullptr;
     }
 
-    auto having = std::make_shared<Ra__Node__Having>();
-    std::shared_ptr<Ra__Node> predicate = parse_where_expression(having_clause, having);
+    auto having = arena->make<Ra__Node__Having>();
+    Ra__Node* predicate = parse_where_expression(having_clause, having);
     if(predicate==nullptr){
         return nullptr;
     }
@@ -913,60 +1158,86 @@ std::shared_ptr<Ra__Node> SQLtoRA::parse_having(PgQuery__Node* having_clause){
     return having;
 }
 
-void SQLtoRA::parse_with(PgQuery__WithClause* with_clause){
+void SQLtoRA::parse_with(WithClause* with_clause){
     if(with_clause!=nullptr){
-        for(size_t i=0; i<with_clause->n_ctes; i++){
+        ListCell* lc;
+        foreach(lc, with_clause->ctes){
             // parse cte subqueries, for substitution
-            PgQuery__CommonTableExpr* cte = with_clause->ctes[i]->common_table_expr;
-            std::shared_ptr<Ra__Node__Projection> pr = std::static_pointer_cast<Ra__Node__Projection>(parse_select_statement(cte->ctequery->select_stmt));
-            pr->subquery_alias = cte->ctename;
-            for(size_t j=0; j<cte->n_aliascolnames; j++){
-                pr->subquery_columns.push_back(cte->aliascolnames[j]->string->str);
+            CommonTableExpr* cte = lfirst_node(CommonTableExpr, lc);
+            Ra__Node__Projection* pr = static_cast<Ra__Node__Projection*>(parse_select_statement(castNode(SelectStmt, cte->ctequery)));
+            pr->subquery_alias = symbols->intern(cte->ctename);
+            ListCell* col_lc;
+            foreach(col_lc, cte->aliascolnames){
+                pr->subquery_columns.push_back(strVal(lfirst(col_lc)));
+            }
+            if(cte->ctematerialized==CTEMaterializeAlways){
+                pr->cte_materialize = RA__CTE__MATERIALIZE_ALWAYS;
+            }
+            else if(cte->ctematerialized==CTEMaterializeNever){
+                pr->cte_materialize = RA__CTE__MATERIALIZE_NEVER;
             }
             ctes.push_back(pr);
         }
     }
 }
 
-std::shared_ptr<Ra__Node> SQLtoRA::parse_select_statement(PgQuery__SelectStmt* select_stmt){
+Ra__Node* SQLtoRA::parse_select_statement(SelectStmt* select_stmt){
+    // set operations and values lists have no target list of their own
+    if(select_stmt->op!=SETOP_NONE || select_stmt->valuesLists!=NIL){
+        std::cerr << "set operations and values lists are not supported" << std::endl;
+        unsupported_expression = true;
+        return arena->make<Ra__Node__Projection>();
+    }
+
     /* WITH */
-    parse_with(select_stmt->with_clause);
+    parse_with(select_stmt->withClause);
+
+    // the attributes of the statement and its subqueries are resolved in the scope of its from clause
+    scopes.push_back(select_stmt);
 
     /* SELECT */
-    std::shared_ptr<Ra__Node> root(parse_select(select_stmt));
+    Ra__Node* root(parse_select(select_stmt));
+
+    /* LIMIT */
+    Ra__Node* limit = parse_limit(select_stmt);
+    if(limit != nullptr){
+        // add limit underneath projection, above the sort
+        add_subtree(root, limit);
+    }
 
     /* ORDER BY */
-    std::shared_ptr<Ra__Node> sort_operator = parse_order_by(select_stmt->sort_clause, select_stmt->n_sort_clause);
+    Ra__Node* sort_operator = parse_order_by(select_stmt->sortClause);
     if(sort_operator != nullptr){
         // add sort underneath projection
         add_subtree(root, sort_operator);
     }
 
     /* HAVING */
-    std::shared_ptr<Ra__Node> having_operator = parse_having(select_stmt->having_clause);
+    Ra__Node* having_operator = parse_having(select_stmt->havingClause);
     if(having_operator != nullptr){
         add_subtree(root, having_operator);
     }
 
     /* GROUP BY */
-    std::shared_ptr<Ra__Node> group_by = parse_group_by(select_stmt->group_clause, select_stmt->n_group_clause);
+    Ra__Node* group_by = parse_group_by(select_stmt->groupClause);
     if(group_by != nullptr){
         add_subtree(root, group_by);
     }
 
     /* WHERE */
-    std::shared_ptr<Ra__Node> selections = parse_where(select_stmt->where_clause);
+    Ra__Node* selections = parse_where(select_stmt->whereClause);
     if(selections != nullptr){
         // add selections to bottom of linear subtree
         add_subtree(root, selections);
     }
 
     /* FROM */
-    std::shared_ptr<Ra__Node> cross_products = parse_from(select_stmt->from_clause, select_stmt->n_from_clause);
+    Ra__Node* cross_products = parse_from(select_stmt->fromClause);
     if(cross_products != nullptr){
         // add cross products to first empty child ("where" could have produced cp already)
         add_subtree(root, cross_products);
     }
 
+    scopes.pop_back();
     return root;
-};
\ No newline at end of file
+};
@@ -3,98 +3,171 @@
 
 #include <pg_query.h>
 #include <memory>
-#include "protobuf/pg_query.pb-c.h"
+#include <unordered_map>
 #include "relational_algebra.h"
 #include "ra_tree.h"
+#include "ra_arena.h"
+#include "ra_symbol_table.h"
+#include "ra_catalog.h"
+
+// raw parse tree nodes of the postgres parser (src/postgres/include/nodes/parsenodes.h)
+struct Node;
+struct List;
+struct SelectStmt;
+struct WithClause;
+struct JoinExpr;
+struct SubLink;
+struct RangeSubselect;
 
 class SQLtoRA{
     public:
-        SQLtoRA();
+        /**
+         * @param _catalog schema the queries run against, TPC-H if not given
+         * @param _hash_consing share structurally equal constant expressions (constants, casts and arithmetic of constants)
+         * between their uses instead of allocating a node per use, e.g. for the repeated literals of generated queries
+         */
+        SQLtoRA(std::shared_ptr<const RaCatalog> _catalog=RaCatalog::tpch(), bool _hash_consing=false);
 
         /**
-         * Parses SQL and translates to relational algebra
+         * Parses SQL and translates to relational algebra. 
+         * Walks the raw postgres parse tree directly, inside the pg_query memory context.
          * 
          * @param query SQL query
-         * @return Pointer to root node of relational algebra tree
+         * @return Pointer to relational algebra tree, nullptr if query could not be parsed
          */
         std::shared_ptr<RaTree> parse(const char* query);
 
+        /**
+         * Parses SQL and translates to relational algebra, 
+         * via the protobuf serialized parse tree of pg_query_parse_protobuf, read back into raw parse tree nodes
+         * 
+         * @param query SQL query
+         * @return Pointer to relational algebra tree, nullptr if query could not be parsed
+         */
+        std::shared_ptr<RaTree> parse_protobuf(const char* query);
+
     private:
         // to generate unique ids
         uint64_t counter = 0;
 
+        /// Storage of the nodes being parsed, handed over to the RaTree
+        std::unique_ptr<RaArena> arena;
+
+        /// Interned identifiers of the nodes being parsed, handed over to the RaTree
+        std::unique_ptr<RaSymbolTable> symbols;
+
+        /// Schema used to resolve attributes without alias, shared with the RaTrees
+        std::shared_ptr<const RaCatalog> catalog;
+
         /// Root node of main relational algebra tree
-        std::shared_ptr<Ra__Node> ra_tree_root;
+        Ra__Node* ra_tree_root = nullptr;
 
         /// Relational algebra trees of Common Table Expressions
-        std::vector<std::shared_ptr<Ra__Node>> ctes;
+        std::vector<Ra__Node*> ctes;
+
+        /// whether constant expressions are hash consed
+        bool hash_consing = false;
+
+        /// set if an expression of the query being parsed could not be translated, the query is rejected then
+        bool unsupported_expression = false;
+
+        /// select statements whose from clauses are in scope of the expressions being parsed, innermost last
+        std::vector<SelectStmt*> scopes;
+
+        /// set while an order by is parsed, its attributes may name output columns of the select list
+        bool parsing_order_by = false;
+
+        /// hash consed constant expressions of the query being parsed by structural hash
+        std::unordered_map<size_t, std::vector<Ra__Node*>> consed_expressions;
+
+        /// epoch of the structural hashes cached by hash consing, constant expressions are not modified afterwards
+        static constexpr uint64_t hash_cons_epoch = 1;
+
+        /**
+         * Returns the node of a structurally equal constant expression of the query parsed before, if hash consing
+         * @param expression parsed expression, its operands are hash consed
+         * @return equal node parsed before, expression if it is the first of its structure, not constant or not hash consing
+         */
+        Ra__Node* hash_cons(Ra__Node* expression);
+
+        /**
+         * Translates the raw statements of the postgres parser, used by both parse paths
+         *
+         * @param raw_stmts List of RawStmt, allocated in the pg_query memory context
+         * @return Pointer to relational algebra tree, nullptr if not a single select statement
+         */
+        std::shared_ptr<RaTree> parse_statements(List* raw_stmts);
 
         /**
          * Builds relational algebra tree for "select" statement
          *
-         * @param select_stmt Pointer to parsed select statement
+         * @param select_stmt Pointer to raw select statement
          * @return Pointer to root node of relational algebra tree
          */
-        std::shared_ptr<Ra__Node> parse_select_statement(PgQuery__SelectStmt* select_stmt);
-        
+        Ra__Node* parse_select_statement(SelectStmt* select_stmt);
+
         /**
          * Parses a with clause
          *
-         * @param select_stmt pointer to with clause 
+         * @param with_clause pointer to raw with clause 
          */
-        void parse_with(PgQuery__WithClause* with_clause);
+        void parse_with(WithClause* with_clause);
 
         /**
          * Parses a select clause
          *
-         * @param select_stmt pointer to select
+         * @param select_stmt pointer to raw select statement
          * @return Relational algebra subtree with projection
          */
-        std::shared_ptr<Ra__Node> parse_select(PgQuery__SelectStmt* select_stmt);
+        Ra__Node* parse_select(SelectStmt* select_stmt);
 
         /**
          * Parses a from clause 
          *
-         * @param from_clause Pointer to from clause arguments
-         * @param n_from_clause Number of from clause arguments
+         * @param from_clause List of from clause arguments
          * @return Pointer to relational algebra subtree (with relations, cross products, joins)
          */
-        std::shared_ptr<Ra__Node> parse_from(PgQuery__Node** from_clause, size_t n_from_clause);
+        Ra__Node* parse_from(List* from_clause);
 
         /**
          * Parses a where clause 
          *
-         * @param from_clause Pointer to where clause
+         * @param where_clause Pointer to raw where clause
          * @return Pointer to relational algebra subtree
          */
-        std::shared_ptr<Ra__Node> parse_where(PgQuery__Node* where_clause);
+        Ra__Node* parse_where(Node* where_clause);
 
         /**
          * Builds relational algebra tree for "having" clause
          *
-         * @param select_stmt Pointer to a relational algebra tree node
-         * @param relations Vector which is filled with pointers to all relations
+         * @param having_clause Pointer to raw having clause
          * @return Pointer to Ra__Node__Having node (may have subquery)
          */
-        std::shared_ptr<Ra__Node> parse_having(PgQuery__Node* having_clause);
+        Ra__Node* parse_having(Node* having_clause);
 
         /**
          * Builds relational algebra tree for "group by" clause
          *
-         * @param group_by_args Pointer to group by arguments
-         * @param n_group_by_args Number of group by arguments
+         * @param group_clause List of group by arguments
          * @return Pointer to Ra__Node__Group_By node
          */
-        std::shared_ptr<Ra__Node> parse_group_by(PgQuery__Node** group_clause, size_t n_group_clause);
+        Ra__Node* parse_group_by(List* group_clause);
 
         /**
          * Builds relational algebra tree for "order by" clause
          *
-         * @param sort_clause Pointer to order by arguments
-         * @param n_sort_clause Number of order by arguments
+         * @param sort_clause List of order by arguments
          * @return Pointer to Ra__Node__Order_By node
          */
-        std::shared_ptr<Ra__Node> parse_order_by(PgQuery__Node** sort_clause, size_t n_sort_clause);
+        Ra__Node* parse_order_by(List* sort_clause);
+
+        /**
+         * Builds relational algebra tree for "limit"/"offset" clauses (also "fetch first")
+         *
+         * @param select_stmt Pointer to raw select statement
+         * @return Pointer to Ra__Node__Limit node, nullptr without limit and offset
+         */
+        Ra__Node* parse_limit(SelectStmt* select_stmt);
 
         /**
          * Finds first empty leaf in relational algebra tree (DFS)
@@ -102,7 +175,7 @@ class SQLtoRA{
          * @param it Pointer to a relational algebra node
          * @return True if empty leaf found, else false
          */
-        bool find_empty_leaf(std::shared_ptr<Ra__Node>& it);
+        bool find_empty_leaf(Ra__Node*& it);
 
         /**
          * Attaches a relational algebra subtree to an existing relational algebra tree, at first empty leaf found (DFS)
@@ -110,115 +183,130 @@ class SQLtoRA{
          * @param base Pointer to the base relational algebra tree
          * @param subtree Pointer to a relational algebra subtree to be attached to base
          */
-        void add_subtree(std::shared_ptr<Ra__Node> base, std::shared_ptr<Ra__Node> subtree);
+        void add_subtree(Ra__Node* base, Ra__Node* subtree);
 
         /**
          * Parses a join expression (in "from" clause) 
          *
-         * @param join_expr Pointer to the join expression
+         * @param join_expr Pointer to the raw join expression
          * @return Pointer to Ra__Node__Join node 
          */
-        std::shared_ptr<Ra__Node> parse_from_join(PgQuery__JoinExpr* join_expr);
+        Ra__Node* parse_from_join(JoinExpr* join_expr);
 
-        // parses whole where expression, returns predicate for selection
-        // adds childnodes to selection if needed
         /**
          * Parses a where expression 
          *
-         * @param node Pointer to where expression
+         * @param node Pointer to raw where expression
          * @param ra_selection Selection node belonging to the parent where clause. 
          *      If where expression contains subqueries, their subtrees are attached to selection node.
          * @param sublink_negated True if current expression is a subquery (exists, in) that is negated with "not"
          * @return Pointer to predicate, to be added to parent selection node
          */
-        std::shared_ptr<Ra__Node> parse_where_expression(PgQuery__Node* node, std::shared_ptr<Ra__Node> ra_selection, bool sublink_negated=false);
+        Ra__Node* parse_where_expression(Node* node, Ra__Node* ra_selection, bool sublink_negated=false);
 
         /**
          * Finds all attributes used in a where expression
          *
-         * @param node Pointer to where expression
+         * @param node Pointer to raw where expression
          * @param attributes Vector of attributes, filled with any attributes found 
          */
-        void find_where_expression_attributes(PgQuery__Node* node, std::vector<std::shared_ptr<Ra__Node__Attribute>>& attributes);
+        void find_where_expression_attributes(Node* node, std::vector<Ra__Node__Attribute*>& attributes);
 
         /**
          * Checks whether a subquery is correlated or not
          *
-         * @param select_stmt Pointer to select statement
+         * @param select_stmt Pointer to raw select statement
          * @return True if subquery is correlated, else false
          */
-        bool is_correlated_subquery(PgQuery__SelectStmt* select_stmt);
+        bool is_correlated_subquery(SelectStmt* select_stmt);
 
         /**
-         * Checks whether an attribute is an attribute belonging to a tpch relation
+         * Checks whether an attribute is a column of a catalog relation
          *
          * @param attr name of attribute
          * @param name of relation
-         * @return True if relation is tpch and attribute belongs to relation
+         * @return True if relation is in catalog and attribute belongs to relation
          */
-        bool is_tpch_attribute(std::string attr, std::string relation);
+        bool is_catalog_attribute(Ra__Symbol attr, Ra__Symbol relation);
+
+        /**
+         * Qualifies an attribute without alias whose name is a column of several catalog tables
+         * by the from item of the innermost scope having such a column, like postgres resolves it.
+         * Sets unsupported_expression if the name is ambiguous in that scope or a from item with unknown columns might have it
+         *
+         * @param attr attribute without alias
+         */
+        void resolve_attribute(Ra__Node__Attribute* attr);
+
+        /**
+         * Finds the from items having a column
+         *
+         * @param from_item raw from item (relation, subquery or join)
+         * @param column column name
+         * @param qualifiers filled with the alias or name of each from item having the column
+         * @return false if the from item has unknown columns, e.g. a subquery selecting "*"
+         */
+        bool find_from_items_with_column(Node* from_item, const std::string& column, std::vector<Ra__Symbol>& qualifiers);
 
         /**
          * Parses an "in" subquery
          *
-         * @param sub_link pointer to in subquery
+         * @param sub_link pointer to raw in subquery
          * @param negated if the exists subquery is negated
          * @return Relational algebra subtree with join node and subquery on one side of join
          */
-        std::shared_ptr<Ra__Node> parse_where_in_subquery(PgQuery__SubLink* sub_link, bool negated);
+        Ra__Node* parse_where_in_subquery(SubLink* sub_link, bool negated);
 
         /**
          * Parses an "in" list expression
          *
-         * @param l_expr pointer to left expression of "in" 
          * @param r_expr pointer to right expression of "in" (list) 
-         * @param negated if the in subquery is negated
-         * @return Relational algebra subtree with join node and subquery on one side of join
+         * @return Ra__Node__In_List with the list items
          */
-        std::shared_ptr<Ra__Node> parse_where_in_list(PgQuery__Node* r_expr);
+        Ra__Node* parse_where_in_list(Node* r_expr);
 
         /**
          * Parses an exists subquery
          *
-         * @param select_stmt pointer to select statement of subquery
+         * @param select_stmt pointer to raw select statement of subquery
          * @param negated if the exists subquery is negated
          * @return Relational algebra subtree with join node and subquery on one side of join
          */
-        std::shared_ptr<Ra__Node> parse_where_exists_subquery(PgQuery__SelectStmt* select_stmt, bool negated);
+        Ra__Node* parse_where_exists_subquery(SelectStmt* select_stmt, bool negated);
 
         /**
          * Parses a subquery in where expression of type: "x = subquery"
          *
-         * @param select_stmt pointer to select statement of subquery
+         * @param select_stmt pointer to raw select statement of subquery
          * @param ra_arg pointer to predicate of the subquery side, to be assigned
          * @return Relational algebra subtree with join node and subquery on one side of join
          */
-        std::shared_ptr<Ra__Node> parse_where_subquery(PgQuery__SelectStmt* select_stmt, std::shared_ptr<Ra__Node>& ra_arg);
+        Ra__Node* parse_where_subquery(SelectStmt* select_stmt, Ra__Node*& ra_arg);
 
         /**
          * Parses a subquery in from clause
          *
-         * @param range_subselect pointer to subquery
+         * @param range_subselect pointer to raw subquery
          * @return Relational algebra subtree with projection
          */
-        std::shared_ptr<Ra__Node> parse_from_subquery(PgQuery__RangeSubselect* range_subselect);
+        Ra__Node* parse_from_subquery(RangeSubselect* range_subselect);
 
         /**
          * Finds all attributes referenced in an expression (E.g. min(s.id) -> s.id)
          *
-         * @param node pointer to expression
+         * @param node pointer to raw expression
          * @param attributes vector of attributes, filled with all attributes found
          */
-        void find_expression_attributes(PgQuery__Node* node, std::vector<std::shared_ptr<Ra__Node__Attribute>>& attributes);
+        void find_expression_attributes(Node* node, std::vector<Ra__Node__Attribute*>& attributes);
 
         /**
          * Parses an expression
          *
-         * @param node pointer to expression
+         * @param node pointer to raw expression
          * @param ra_arg Pointer to relational algebra node, to be assigned with the parsed expression
          * @param has_aggregate Flag which is set to true, if aggregating expression is found
          */
-        void parse_expression(PgQuery__Node* node, std::shared_ptr<Ra__Node>& ra_arg, bool& has_aggregate);
+        void parse_expression(Node* node, Ra__Node*& ra_arg, bool& has_aggregate);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "ra_arena.h"
+#include "relational_algebra.h"
+
+RaArena::RaArena(size_t _block_size)
+: block_size(_block_size), current(nullptr), end(nullptr)
+{
+}
+
+RaArena::~RaArena(){
+    for(auto it=nodes.rbegin(); it!=nodes.rend(); it++){
+        (*it)->~Ra__Node();
+    }
+    for(char* block: blocks){
+        ::operator delete(block);
+    }
+}
+
+void* RaArena::allocate(size_t size, size_t alignment){
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if(current==nullptr || aligned + size > reinterpret_cast<uintptr_t>(end)){
+        // oversized nodes get a block of their own
+        size_t new_block_size = size + alignment > block_size ? size + alignment : block_size;
+        char* block = static_cast<char*>(::operator new(new_block_size));
+        blocks.push_back(block);
+        block_sizes.push_back(new_block_size);
+        current = block;
+        end = block + new_block_size;
+        aligned = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+    current = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+}
+
+size_t RaArena::n_nodes() const{
+    return nodes.size();
+}
+
+size_t RaArena::n_bytes_reserved() const{
+    size_t bytes = 0;
+    for(size_t block_size: block_sizes){
+        bytes += block_size;
+    }
+    return bytes;
+}
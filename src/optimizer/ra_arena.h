@@ -0,0 +1,72 @@
+#ifndef ra_arena
+#define ra_arena
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <new>
+
+class Ra__Node;
+
+/**
+ * Bump pointer allocator for relational algebra nodes. 
+ * Nodes of a query are placed contiguously in large blocks, 
+ * and are destroyed and freed in one shot when the arena is destroyed.
+ * Node pointers handed out by the arena are non-owning, they stay valid as long as the arena lives.
+ */
+class RaArena {
+    public:
+        /**
+         * @param _block_size size in bytes of the blocks nodes are allocated from
+         */
+        RaArena(size_t _block_size=32*1024);
+        ~RaArena();
+
+        RaArena(const RaArena&) = delete;
+        RaArena& operator=(const RaArena&) = delete;
+
+        /**
+         * Constructs a relational algebra node in the arena
+         * 
+         * @param args constructor arguments of node type T
+         * @return non-owning pointer to the new node
+         */
+        template<typename T, typename... Args>
+        T* make(Args&&... args){
+            T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            nodes.push_back(node);
+            return node;
+        }
+
+        /**
+         * @return number of nodes allocated in the arena
+         */
+        size_t n_nodes() const;
+
+        /**
+         * @return number of bytes reserved by the arena blocks
+         */
+        size_t n_bytes_reserved() const;
+
+    private:
+        /**
+         * Reserves memory for a node, opens a new block if current block is full
+         * 
+         * @param size size of node in bytes
+         * @param alignment alignment of node type
+         * @return pointer to uninitialized memory
+         */
+        void* allocate(size_t size, size_t alignment);
+
+        size_t block_size;
+        std::vector<char*> blocks;
+        std::vector<size_t> block_sizes;
+        char* current;
+        char* end;
+
+        /// all nodes in allocation order, to run their destructors (nodes own strings and vectors)
+        std::vector<Ra__Node*> nodes;
+};
+
+#endif
@@ -0,0 +1,811 @@
+#include "ra_catalog.h"
+#include <pg_query.h>
+#include "protobuf/pg_query.pb-c.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cassert>
+
+// TPC-H schema, types and keys as in benchmarks/data loading, row counts of scale factor 1
+static const char* tpch_ddl = R"(
+create table region (
+    r_regionkey integer not null primary key,
+    r_name char(25) not null,
+    r_comment varchar(152)
+) with (row_count=5);
+
+create table nation (
+    n_nationkey integer not null primary key,
+    n_name char(25) not null,
+    n_regionkey integer not null references region(r_regionkey),
+    n_comment varchar(152)
+) with (row_count=25);
+
+create table part (
+    p_partkey bigint not null primary key,
+    p_name varchar(55) not null,
+    p_mfgr char(25) not null,
+    p_brand char(10) not null,
+    p_type varchar(25) not null,
+    p_size integer not null,
+    p_container char(10) not null,
+    p_retailprice double precision not null,
+    p_comment varchar(23) not null
+) with (row_count=200000);
+
+create table supplier (
+    s_suppkey bigint not null primary key,
+    s_name char(25) not null,
+    s_address varchar(40) not null,
+    s_nationkey integer not null references nation(n_nationkey),
+    s_phone char(15) not null,
+    s_acctbal double precision not null,
+    s_comment varchar(101) not null
+) with (row_count=10000);
+
+create table partsupp (
+    ps_partkey bigint not null references part(p_partkey),
+    ps_suppkey bigint not null references supplier(s_suppkey),
+    ps_availqty bigint not null,
+    ps_supplycost double precision not null,
+    ps_comment varchar(199) not null,
+    primary key (ps_partkey, ps_suppkey)
+) with (row_count=800000);
+
+create table customer (
+    c_custkey bigint not null primary key,
+    c_name varchar(25) not null,
+    c_address varchar(40) not null,
+    c_nationkey integer not null references nation(n_nationkey),
+    c_phone char(15) not null,
+    c_acctbal double precision not null,
+    c_mktsegment char(10) not null,
+    c_comment varchar(117) not null
+) with (row_count=150000);
+
+create table orders (
+    o_orderkey bigint not null primary key,
+    o_custkey bigint not null references customer(c_custkey),
+    o_orderstatus char(1) not null,
+    o_totalprice double precision not null,
+    o_orderdate date not null,
+    o_orderpriority char(15) not null,
+    o_clerk char(15) not null,
+    o_shippriority integer not null,
+    o_comment varchar(79) not null
+) with (row_count=1500000);
+
+create table lineitem (
+    l_orderkey bigint not null references orders(o_orderkey),
+    l_partkey bigint not null references part(p_partkey),
+    l_suppkey bigint not null references supplier(s_suppkey),
+    l_linenumber bigint not null,
+    l_quantity double precision not null,
+    l_extendedprice double precision not null,
+    l_discount double precision not null,
+    l_tax double precision not null,
+    l_returnflag char(1) not null,
+    l_linestatus char(1) not null,
+    l_shipdate date not null,
+    l_commitdate date not null,
+    l_receiptdate date not null,
+    l_shipinstruct char(25) not null,
+    l_shipmode char(10) not null,
+    l_comment varchar(44) not null,
+    primary key (l_orderkey, l_linenumber),
+    foreign key (l_partkey, l_suppkey) references partsupp(ps_partkey, ps_suppkey)
+) with (row_count=6001215);
+)";
+
+// v2 adds column stats, v3 unique keys, v1 and v2 snapshots are still read
+static const char snapshot_magic[] = "RACATv3\n";
+static const char snapshot_magic_v2[] = "RACATv2\n";
+static const char snapshot_magic_v1[] = "RACATv1\n";
+
+int64_t Ra__Catalog__Table::column_index(std::string_view column) const{
+    for(size_t i=0; i<columns.size(); i++){
+        if(columns[i].name==column){
+            return i;
+        }
+    }
+    return -1;
+}
+
+std::shared_ptr<const RaCatalog> RaCatalog::tpch(){
+    static std::shared_ptr<const RaCatalog> catalog = create_tpch();
+    return catalog;
+}
+
+std::shared_ptr<RaCatalog> RaCatalog::create_tpch(){
+    auto tpch_catalog = std::make_shared<RaCatalog>();
+    bool loaded = tpch_catalog->load_ddl(tpch_ddl);
+    assert(loaded);
+    return tpch_catalog;
+}
+
+std::shared_ptr<RaCatalog> RaCatalog::load(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    if(!file){
+        std::cerr << "error reading catalog: " << path << std::endl;
+        return nullptr;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string data = content.str();
+
+    auto catalog = std::make_shared<RaCatalog>();
+    bool loaded;
+    if(data.compare(0, sizeof(snapshot_magic)-1, snapshot_magic)==0 || data.compare(0, sizeof(snapshot_magic_v2)-1, snapshot_magic_v2)==0
+        || data.compare(0, sizeof(snapshot_magic_v1)-1, snapshot_magic_v1)==0){
+        loaded = catalog->load_snapshot(data);
+    }
+    else{
+        loaded = catalog->load_ddl(data.c_str());
+    }
+    return loaded ? catalog : nullptr;
+}
+
+static std::string get_string(PgQuery__Node* node){
+    assert(node->node_case==PG_QUERY__NODE__NODE_STRING);
+    return node->string->str;
+}
+
+// resolves key column names of a constraint to column indexes of the table
+static bool get_column_indexes(const Ra__Catalog__Table& table, PgQuery__Node** keys, size_t n_keys, std::vector<size_t>& indexes){
+    for(size_t i=0; i<n_keys; i++){
+        std::string column = get_string(keys[i]);
+        int64_t index = table.column_index(column);
+        if(index<0){
+            std::cerr << "error in catalog: table " << table.name << " has no column " << column << std::endl;
+            return false;
+        }
+        indexes.push_back(index);
+    }
+    return true;
+}
+
+static bool add_foreign_key(Ra__Catalog__Table& table, std::vector<size_t> columns, PgQuery__Constraint* constraint){
+    Ra__Catalog__Foreign_Key foreign_key;
+    foreign_key.columns = std::move(columns);
+    foreign_key.referenced_table = constraint->pktable->relname;
+    for(size_t i=0; i<constraint->n_pk_attrs; i++){
+        foreign_key.referenced_columns.push_back(get_string(constraint->pk_attrs[i]));
+    }
+    // references without column list refer to the primary key, only supported with explicit columns
+    if(foreign_key.referenced_columns.size()!=foreign_key.columns.size()){
+        std::cerr << "error in catalog: foreign key of table " << table.name << " needs explicit referenced columns" << std::endl;
+        return false;
+    }
+    table.foreign_keys.push_back(std::move(foreign_key));
+    return true;
+}
+
+// table constraint of CREATE TABLE or ALTER TABLE ... ADD CONSTRAINT
+static bool add_table_constraint(Ra__Catalog__Table& table, PgQuery__Constraint* constraint){
+    switch(constraint->contype){
+        case PG_QUERY__CONSTR_TYPE__CONSTR_PRIMARY:{
+            table.primary_key.clear();
+            if(!get_column_indexes(table, constraint->keys, constraint->n_keys, table.primary_key)){
+                return false;
+            }
+            for(auto index: table.primary_key){
+                table.columns[index].nullable = false;
+            }
+            return true;
+        }
+        case PG_QUERY__CONSTR_TYPE__CONSTR_FOREIGN:{
+            std::vector<size_t> columns;
+            if(!get_column_indexes(table, constraint->fk_attrs, constraint->n_fk_attrs, columns)){
+                return false;
+            }
+            return add_foreign_key(table, std::move(columns), constraint);
+        }
+        case PG_QUERY__CONSTR_TYPE__CONSTR_UNIQUE:{
+            std::vector<size_t> columns;
+            if(!get_column_indexes(table, constraint->keys, constraint->n_keys, columns)){
+                return false;
+            }
+            table.unique_keys.push_back(std::move(columns));
+            return true;
+        }
+        default: return true; // check, exclusion, ... not needed by the optimizer
+    }
+}
+
+static bool parse_create_table(PgQuery__CreateStmt* create_stmt, Ra__Catalog__Table& table){
+    table.name = create_stmt->relation->relname;
+
+    // columns first, table constraints may refer to columns defined after them
+    std::vector<PgQuery__Constraint*> table_constraints;
+    for(size_t i=0; i<create_stmt->n_table_elts; i++){
+        PgQuery__Node* element = create_stmt->table_elts[i];
+        switch(element->node_case){
+            case PG_QUERY__NODE__NODE_COLUMN_DEF:{
+                PgQuery__ColumnDef* column_def = element->column_def;
+                Ra__Catalog__Column column;
+                column.name = column_def->colname;
+                // last name without schema (pg_catalog.int8 -> int8)
+                PgQuery__TypeName* type_name = column_def->type_name;
+                column.type = get_string(type_name->names[type_name->n_names-1]);
+                column.nullable = !column_def->is_not_null;
+                table.columns.push_back(column);
+                size_t index = table.columns.size()-1;
+
+                for(size_t j=0; j<column_def->n_constraints; j++){
+                    PgQuery__Constraint* constraint = column_def->constraints[j]->constraint;
+                    switch(constraint->contype){
+                        case PG_QUERY__CONSTR_TYPE__CONSTR_NOTNULL:{
+                            table.columns[index].nullable = false;
+                            break;
+                        }
+                        case PG_QUERY__CONSTR_TYPE__CONSTR_PRIMARY:{
+                            table.columns[index].nullable = false;
+                            table.primary_key = {index};
+                            break;
+                        }
+                        case PG_QUERY__CONSTR_TYPE__CONSTR_UNIQUE:{
+                            table.unique_keys.push_back({index});
+                            break;
+                        }
+                        case PG_QUERY__CONSTR_TYPE__CONSTR_FOREIGN:{
+                            if(!add_foreign_key(table, {index}, constraint)){
+                                return false;
+                            }
+                            break;
+                        }
+                        default: break;
+                    }
+                }
+                break;
+            }
+            case PG_QUERY__NODE__NODE_CONSTRAINT:{
+                table_constraints.push_back(element->constraint);
+                break;
+            }
+            default: break; // like clauses
+        }
+    }
+    for(auto constraint: table_constraints){
+        if(!add_table_constraint(table, constraint)){
+            return false;
+        }
+    }
+
+    // WITH (row_count=...)
+    for(size_t i=0; i<create_stmt->n_options; i++){
+        PgQuery__DefElem* option = create_stmt->options[i]->def_elem;
+        if(std::string(option->defname)!="row_count" || option->arg==nullptr){
+            continue;
+        }
+        switch(option->arg->node_case){
+            case PG_QUERY__NODE__NODE_INTEGER:{
+                table.row_count = option->arg->integer->ival;
+                break;
+            }
+            // integers exceeding 32 bit are parsed as float
+            case PG_QUERY__NODE__NODE_FLOAT:{
+                table.row_count = std::strtoull(option->arg->float_->str, nullptr, 10);
+                break;
+            }
+            case PG_QUERY__NODE__NODE_STRING:{
+                table.row_count = std::strtoull(option->arg->string->str, nullptr, 10);
+                break;
+            }
+            default: break;
+        }
+    }
+    return true;
+}
+
+bool RaCatalog::load_ddl(const char* ddl){
+    PgQueryProtobufParseResult result = pg_query_parse_protobuf(ddl);
+    if(result.error!=nullptr){
+        std::cerr << "error parsing catalog: " << result.error->message << std::endl;
+        pg_query_free_protobuf_parse_result(result);
+        return false;
+    }
+    PgQuery__ParseResult* parse_result = pg_query__parse_result__unpack(NULL, result.parse_tree.len, (const uint8_t*) result.parse_tree.data);
+
+    bool loaded = true;
+    for(size_t i=0; i<parse_result->n_stmts && loaded; i++){
+        PgQuery__Node* stmt = parse_result->stmts[i]->stmt;
+        switch(stmt->node_case){
+            case PG_QUERY__NODE__NODE_CREATE_STMT:{
+                Ra__Catalog__Table table;
+                loaded = parse_create_table(stmt->create_stmt, table);
+                if(loaded){
+                    add_table(std::move(table));
+                }
+                break;
+            }
+            case PG_QUERY__NODE__NODE_ALTER_TABLE_STMT:{
+                PgQuery__AlterTableStmt* alter_table_stmt = stmt->alter_table_stmt;
+                auto found = tables_by_name.find(alter_table_stmt->relation->relname);
+                if(found==tables_by_name.end()){
+                    std::cerr << "error in catalog: alter of unknown table " << alter_table_stmt->relation->relname << std::endl;
+                    loaded = false;
+                    break;
+                }
+                for(size_t j=0; j<alter_table_stmt->n_cmds && loaded; j++){
+                    PgQuery__AlterTableCmd* cmd = alter_table_stmt->cmds[j]->alter_table_cmd;
+                    if(cmd->subtype==PG_QUERY__ALTER_TABLE_TYPE__AT_AddConstraint){
+                        loaded = add_table_constraint(*found->second, cmd->def->constraint);
+                    }
+                }
+                break;
+            }
+            default: break; // inserts, indexes, ...
+        }
+    }
+
+    pg_query__parse_result__free_unpacked(parse_result, NULL);
+    pg_query_free_protobuf_parse_result(result);
+    return loaded;
+}
+
+// reads the fields of the next CSV record, quoted fields may contain separators, newlines and doubled quotes
+static bool read_csv_record(const std::string& csv, size_t& pos, std::vector<std::string>& fields){
+    fields.clear();
+    if(pos>=csv.size()){
+        return false;
+    }
+    std::string field;
+    bool quoted = false;
+    while(pos<csv.size()){
+        char c = csv[pos++];
+        if(quoted){
+            if(c=='"' && pos<csv.size() && csv[pos]=='"'){
+                field.push_back('"');
+                pos++;
+            }
+            else if(c=='"'){
+                quoted = false;
+            }
+            else{
+                field.push_back(c);
+            }
+        }
+        else if(c=='"'){
+            quoted = true;
+        }
+        else if(c==','){
+            fields.push_back(std::move(field));
+            field.clear();
+        }
+        else if(c=='\n'){
+            break;
+        }
+        else if(c!='\r'){
+            field.push_back(c);
+        }
+    }
+    fields.push_back(std::move(field));
+    return true;
+}
+
+// parses the text representation of a one dimensional postgres array, e.g. {1,2} or {"a b",c}
+static bool parse_pg_array(const std::string& text, std::vector<std::string>& values){
+    values.clear();
+    if(text.empty()){
+        return true;
+    }
+    if(text.size()<2 || text.front()!='{' || text.back()!='}'){
+        return false;
+    }
+    size_t pos = 1;
+    size_t end = text.size()-1;
+    while(pos<end){
+        std::string value;
+        if(text[pos]=='"'){
+            pos++;
+            while(pos<end && text[pos]!='"'){
+                if(text[pos]=='\\' && pos+1<end){
+                    pos++;
+                }
+                value.push_back(text[pos++]);
+            }
+            if(pos>=end){
+                return false;
+            }
+            pos++;
+        }
+        else{
+            while(pos<end && text[pos]!=','){
+                value.push_back(text[pos++]);
+            }
+        }
+        values.push_back(std::move(value));
+        if(pos<end && text[pos]==','){
+            pos++;
+        }
+    }
+    return true;
+}
+
+static bool parse_stats_number(const std::string& text, double& value){
+    if(text.empty()){
+        value = 0;
+        return true;
+    }
+    char* end;
+    value = std::strtod(text.c_str(), &end);
+    return *end=='\0';
+}
+
+bool RaCatalog::load_stats(const std::string& csv){
+    static const char* used_fields[] = {"tablename", "attname", "null_frac", "avg_width", "n_distinct", "most_common_vals", "most_common_freqs", "histogram_bounds"};
+    enum { TABLENAME, ATTNAME, NULL_FRAC, AVG_WIDTH, N_DISTINCT, MOST_COMMON_VALS, MOST_COMMON_FREQS, HISTOGRAM_BOUNDS, N_USED_FIELDS };
+
+    size_t pos = 0;
+    std::vector<std::string> fields;
+    if(!read_csv_record(csv, pos, fields)){
+        std::cerr << "error in stats: missing header" << std::endl;
+        return false;
+    }
+    size_t field_index[N_USED_FIELDS];
+    size_t max_field_index = 0;
+    for(size_t i=0; i<N_USED_FIELDS; i++){
+        size_t j = 0;
+        while(j<fields.size() && fields[j]!=used_fields[i]){
+            j++;
+        }
+        if(j==fields.size()){
+            std::cerr << "error in stats: missing field " << used_fields[i] << std::endl;
+            return false;
+        }
+        field_index[i] = j;
+        max_field_index = std::max(max_field_index, j);
+    }
+
+    size_t line = 1;
+    while(read_csv_record(csv, pos, fields)){
+        line++;
+        if(fields.size()==1 && fields[0].empty()){
+            continue;
+        }
+        if(fields.size()<=max_field_index){
+            std::cerr << "error in stats: missing fields in record " << line << std::endl;
+            return false;
+        }
+        auto found = tables_by_name.find(fields[field_index[TABLENAME]]);
+        if(found==tables_by_name.end()){
+            continue;
+        }
+        Ra__Catalog__Table* table = found->second;
+        int64_t column_index = table->column_index(fields[field_index[ATTNAME]]);
+        if(column_index<0){
+            continue;
+        }
+
+        Ra__Catalog__Column_Stats stats;
+        std::vector<std::string> freqs;
+        bool valid = parse_stats_number(fields[field_index[NULL_FRAC]], stats.null_frac)
+            && parse_stats_number(fields[field_index[AVG_WIDTH]], stats.avg_width)
+            && parse_stats_number(fields[field_index[N_DISTINCT]], stats.n_distinct)
+            && parse_pg_array(fields[field_index[MOST_COMMON_VALS]], stats.most_common_values)
+            && parse_pg_array(fields[field_index[MOST_COMMON_FREQS]], freqs)
+            && parse_pg_array(fields[field_index[HISTOGRAM_BOUNDS]], stats.histogram_bounds)
+            && freqs.size()==stats.most_common_values.size();
+        for(size_t i=0; i<freqs.size() && valid; i++){
+            double freq;
+            valid = parse_stats_number(freqs[i], freq);
+            stats.most_common_freqs.push_back(freq);
+        }
+        if(!valid){
+            std::cerr << "error in stats: malformed record " << line << std::endl;
+            return false;
+        }
+        Ra__Catalog__Column& column = table->columns[column_index];
+        column.stats = std::move(stats);
+        column.has_stats = true;
+    }
+    return true;
+}
+
+bool RaCatalog::load_stats_file(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    if(!file){
+        std::cerr << "error reading stats: " << path << std::endl;
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    return load_stats(content.str());
+}
+
+static void write_u32(std::string& out, uint32_t value){
+    for(int i=0; i<4; i++){
+        out.push_back(static_cast<char>((value >> (8*i)) & 0xff));
+    }
+}
+
+static void write_u64(std::string& out, uint64_t value){
+    write_u32(out, static_cast<uint32_t>(value));
+    write_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static void write_string(std::string& out, const std::string& value){
+    write_u32(out, value.size());
+    out.append(value);
+}
+
+static void write_double(std::string& out, double value){
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_u64(out, bits);
+}
+
+static void write_strings(std::string& out, const std::vector<std::string>& values){
+    write_u32(out, values.size());
+    for(const auto& value: values){
+        write_string(out, value);
+    }
+}
+
+// little endian reader over a snapshot, fails instead of reading past the end
+class Snapshot_Reader {
+    public:
+        Snapshot_Reader(const std::string& _data, size_t _pos): data(_data), pos(_pos){}
+
+        bool read_u32(uint32_t& value){
+            if(data.size()-pos<4){
+                return false;
+            }
+            value = 0;
+            for(int i=0; i<4; i++){
+                value |= static_cast<uint32_t>(static_cast<unsigned char>(data[pos++])) << (8*i);
+            }
+            return true;
+        }
+
+        bool read_u64(uint64_t& value){
+            uint32_t low, high;
+            if(!read_u32(low) || !read_u32(high)){
+                return false;
+            }
+            value = (static_cast<uint64_t>(high) << 32) | low;
+            return true;
+        }
+
+        bool read_bool(bool& value){
+            if(data.size()-pos<1){
+                return false;
+            }
+            value = data[pos++]!=0;
+            return true;
+        }
+
+        bool read_string(std::string& value){
+            uint32_t size;
+            if(!read_u32(size) || data.size()-pos<size){
+                return false;
+            }
+            value.assign(data, pos, size);
+            pos += size;
+            return true;
+        }
+
+        bool read_double(double& value){
+            uint64_t bits;
+            if(!read_u64(bits)){
+                return false;
+            }
+            std::memcpy(&value, &bits, sizeof(value));
+            return true;
+        }
+
+        bool read_strings(std::vector<std::string>& values){
+            uint32_t n;
+            bool valid = read_u32(n);
+            for(uint32_t i=0; i<n && valid; i++){
+                std::string value;
+                valid = read_string(value);
+                values.push_back(std::move(value));
+            }
+            return valid;
+        }
+
+        bool read_index(size_t& value, size_t n){
+            uint32_t index;
+            if(!read_u32(index) || index>=n){
+                return false;
+            }
+            value = index;
+            return true;
+        }
+
+    private:
+        const std::string& data;
+        size_t pos;
+};
+
+void RaCatalog::save_snapshot(std::string& snapshot) const{
+    snapshot.append(snapshot_magic, sizeof(snapshot_magic)-1);
+    write_u32(snapshot, tables.size());
+    for(const auto& table: tables){
+        write_string(snapshot, table.name);
+        write_u64(snapshot, table.row_count);
+        write_u32(snapshot, table.columns.size());
+        for(const auto& column: table.columns){
+            write_string(snapshot, column.name);
+            write_string(snapshot, column.type);
+            snapshot.push_back(column.nullable ? 1 : 0);
+            snapshot.push_back(column.has_stats ? 1 : 0);
+            if(column.has_stats){
+                const auto& stats = column.stats;
+                write_double(snapshot, stats.null_frac);
+                write_double(snapshot, stats.n_distinct);
+                write_double(snapshot, stats.avg_width);
+                write_strings(snapshot, stats.most_common_values);
+                write_u32(snapshot, stats.most_common_freqs.size());
+                for(auto freq: stats.most_common_freqs){
+                    write_double(snapshot, freq);
+                }
+                write_strings(snapshot, stats.histogram_bounds);
+            }
+        }
+        write_u32(snapshot, table.primary_key.size());
+        for(auto index: table.primary_key){
+            write_u32(snapshot, index);
+        }
+        write_u32(snapshot, table.foreign_keys.size());
+        for(const auto& foreign_key: table.foreign_keys){
+            write_u32(snapshot, foreign_key.columns.size());
+            for(size_t i=0; i<foreign_key.columns.size(); i++){
+                write_u32(snapshot, foreign_key.columns[i]);
+                write_string(snapshot, foreign_key.referenced_columns[i]);
+            }
+            write_string(snapshot, foreign_key.referenced_table);
+        }
+        write_u32(snapshot, table.unique_keys.size());
+        for(const auto& unique_key: table.unique_keys){
+            write_u32(snapshot, unique_key.size());
+            for(auto index: unique_key){
+                write_u32(snapshot, index);
+            }
+        }
+    }
+}
+
+bool RaCatalog::load_snapshot(const std::string& snapshot){
+    bool has_unique_keys = snapshot.compare(0, sizeof(snapshot_magic)-1, snapshot_magic)==0;
+    bool has_stats = has_unique_keys || snapshot.compare(0, sizeof(snapshot_magic_v2)-1, snapshot_magic_v2)==0;
+    if(!has_stats && snapshot.compare(0, sizeof(snapshot_magic_v1)-1, snapshot_magic_v1)!=0){
+        std::cerr << "error in catalog snapshot: unknown format" << std::endl;
+        return false;
+    }
+    Snapshot_Reader reader(snapshot, sizeof(snapshot_magic)-1);
+
+    uint32_t n_tables;
+    bool valid = reader.read_u32(n_tables);
+    for(uint32_t t=0; t<n_tables && valid; t++){
+        Ra__Catalog__Table table;
+        uint32_t n_columns, n_primary_key, n_foreign_keys;
+        valid = reader.read_string(table.name) && reader.read_u64(table.row_count) && reader.read_u32(n_columns);
+        for(uint32_t i=0; i<n_columns && valid; i++){
+            Ra__Catalog__Column column;
+            valid = reader.read_string(column.name) && reader.read_string(column.type) && reader.read_bool(column.nullable);
+            if(has_stats){
+                valid = valid && reader.read_bool(column.has_stats);
+            }
+            if(column.has_stats && valid){
+                auto& stats = column.stats;
+                uint32_t n_freqs;
+                valid = reader.read_double(stats.null_frac) && reader.read_double(stats.n_distinct) && reader.read_double(stats.avg_width)
+                    && reader.read_strings(stats.most_common_values) && reader.read_u32(n_freqs);
+                for(uint32_t j=0; j<n_freqs && valid; j++){
+                    double freq;
+                    valid = reader.read_double(freq);
+                    stats.most_common_freqs.push_back(freq);
+                }
+                valid = valid && reader.read_strings(stats.histogram_bounds);
+            }
+            table.columns.push_back(std::move(column));
+        }
+        valid = valid && reader.read_u32(n_primary_key);
+        for(uint32_t i=0; i<n_primary_key && valid; i++){
+            size_t index;
+            valid = reader.read_index(index, table.columns.size());
+            table.primary_key.push_back(index);
+        }
+        valid = valid && reader.read_u32(n_foreign_keys);
+        for(uint32_t i=0; i<n_foreign_keys && valid; i++){
+            Ra__Catalog__Foreign_Key foreign_key;
+            uint32_t n_fk_columns;
+            valid = reader.read_u32(n_fk_columns);
+            for(uint32_t j=0; j<n_fk_columns && valid; j++){
+                size_t index;
+                std::string referenced_column;
+                valid = reader.read_index(index, table.columns.size()) && reader.read_string(referenced_column);
+                foreign_key.columns.push_back(index);
+                foreign_key.referenced_columns.push_back(referenced_column);
+            }
+            valid = valid && reader.read_string(foreign_key.referenced_table);
+            table.foreign_keys.push_back(std::move(foreign_key));
+        }
+        uint32_t n_unique_keys = 0;
+        if(has_unique_keys){
+            valid = valid && reader.read_u32(n_unique_keys);
+        }
+        for(uint32_t i=0; i<n_unique_keys && valid; i++){
+            std::vector<size_t> unique_key;
+            uint32_t n_unique_columns;
+            valid = reader.read_u32(n_unique_columns);
+            for(uint32_t j=0; j<n_unique_columns && valid; j++){
+                size_t index;
+                valid = reader.read_index(index, table.columns.size());
+                unique_key.push_back(index);
+            }
+            table.unique_keys.push_back(std::move(unique_key));
+        }
+        if(valid){
+            add_table(std::move(table));
+        }
+    }
+    if(!valid){
+        std::cerr << "error in catalog snapshot: truncated or corrupt" << std::endl;
+    }
+    return valid;
+}
+
+void RaCatalog::add_table(Ra__Catalog__Table table){
+    auto found = tables_by_name.find(table.name);
+    if(found!=tables_by_name.end()){
+        *found->second = std::move(table);
+        index_tables();
+        return;
+    }
+    tables.push_back(std::move(table));
+    index_table(&tables.back());
+}
+
+void RaCatalog::index_table(Ra__Catalog__Table* table){
+    tables_by_name[table->name] = table;
+    for(const auto& column: table->columns){
+        tables_by_column[column.name].push_back(table);
+    }
+}
+
+void RaCatalog::index_tables(){
+    tables_by_name.clear();
+    tables_by_column.clear();
+    for(auto& table: tables){
+        index_table(&table);
+    }
+}
+
+const Ra__Catalog__Table* RaCatalog::find_table(std::string_view name) const{
+    auto found = tables_by_name.find(name);
+    return found==tables_by_name.end() ? nullptr : found->second;
+}
+
+const Ra__Catalog__Table* RaCatalog::find_table_of_column(std::string_view column) const{
+    const auto& column_tables = find_tables_of_column(column);
+    return column_tables.size()==1 ? column_tables[0] : nullptr;
+}
+
+const std::vector<const Ra__Catalog__Table*>& RaCatalog::find_tables_of_column(std::string_view column) const{
+    static const std::vector<const Ra__Catalog__Table*> no_tables;
+    auto found = tables_by_column.find(column);
+    return found==tables_by_column.end() ? no_tables : found->second;
+}
+
+bool RaCatalog::has_column(std::string_view table, std::string_view column) const{
+    auto found = tables_by_column.find(column);
+    if(found==tables_by_column.end()){
+        return false;
+    }
+    for(auto t: found->second){
+        if(t->name==table){
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t RaCatalog::size() const{
+    return tables.size();
+}
@@ -0,0 +1,202 @@
+#ifndef ra_catalog
+#define ra_catalog
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/// column statistics as in pg_stats, values are in their text representation
+struct Ra__Catalog__Column_Stats {
+    /// fraction of null values
+    double null_frac = 0;
+    /// number of distinct non-null values, negative: minus the number of distinct values divided by the number of rows
+    double n_distinct = 0;
+    /// average width in bytes of non-null values
+    double avg_width = 0;
+    std::vector<std::string> most_common_values;
+    /// fraction of rows of each most common value
+    std::vector<double> most_common_freqs;
+    /// bounds of equal frequency buckets of the values which are not most common values, ascending
+    std::vector<std::string> histogram_bounds;
+};
+
+struct Ra__Catalog__Column {
+    std::string name;
+    /// type name as in the DDL, without schema and type modifiers (e.g. "int8", "varchar", "date")
+    std::string type;
+    bool nullable = true;
+    /// true if stats were loaded for this column
+    bool has_stats = false;
+    Ra__Catalog__Column_Stats stats;
+};
+
+struct Ra__Catalog__Foreign_Key {
+    /// indexes of the referencing columns in the table
+    std::vector<size_t> columns;
+    std::string referenced_table;
+    /// referenced columns, in the order of columns
+    std::vector<std::string> referenced_columns;
+};
+
+struct Ra__Catalog__Table {
+    std::string name;
+    std::vector<Ra__Catalog__Column> columns;
+    /// indexes of the primary key columns
+    std::vector<size_t> primary_key;
+    /// indexes of the columns of each unique constraint besides the primary key
+    std::vector<std::vector<size_t>> unique_keys;
+    std::vector<Ra__Catalog__Foreign_Key> foreign_keys;
+    /// estimated number of rows, 0 if unknown
+    uint64_t row_count = 0;
+
+    /**
+     * @param column column name
+     * @return index of the column in columns, -1 if table has no such column
+     */
+    int64_t column_index(std::string_view column) const;
+};
+
+/**
+ * Schema of the database the queries run against: tables, columns, types, keys, nullability, row counts and column statistics.
+ * Used to resolve attributes without alias to their relation and by cost based rewrites.
+ * Can be filled from CREATE TABLE / ALTER TABLE ... ADD CONSTRAINT statements or from a binary snapshot.
+ * Row counts are given in the DDL as storage parameter: CREATE TABLE t (...) WITH (row_count=1000)
+ * Column statistics are imported from a CSV dump of pg_stats, see load_stats.
+ * A catalog is not modified once handed to the parser, it can be shared by concurrently optimized queries.
+ */
+class RaCatalog {
+    public:
+        RaCatalog() = default;
+
+        RaCatalog(const RaCatalog&) = delete;
+        RaCatalog& operator=(const RaCatalog&) = delete;
+
+        /**
+         * @return catalog of the TPC-H schema (scale factor 1 row counts), used if no catalog is given
+         */
+        static std::shared_ptr<const RaCatalog> tpch();
+
+        /**
+         * @return new catalog of the TPC-H schema, which can be modified (e.g. by loading stats)
+         */
+        static std::shared_ptr<RaCatalog> create_tpch();
+
+        /**
+         * Loads a catalog from a file, binary snapshots are detected by their header, anything else is parsed as DDL
+         *
+         * @param path path to DDL or snapshot file
+         * @return catalog, nullptr if file could not be read or parsed
+         */
+        static std::shared_ptr<RaCatalog> load(const std::string& path);
+
+        /**
+         * Adds the tables of CREATE TABLE statements and the keys of ALTER TABLE ... ADD CONSTRAINT statements,
+         * other statements are ignored
+         *
+         * @param ddl SQL statements
+         * @return false if ddl could not be parsed
+         */
+        bool load_ddl(const char* ddl);
+
+        /**
+         * Adds column statistics of a CSV dump of pg_stats with header, e.g. by
+         * psql -c "\\copy (select * from pg_stats where schemaname='public') to 'stats.csv' csv header"
+         * The columns tablename, attname, null_frac, avg_width, n_distinct, most_common_vals, most_common_freqs
+         * and histogram_bounds are used, rows of unknown tables or columns are ignored
+         *
+         * @param csv content of the dump
+         * @return false if csv could not be parsed
+         */
+        bool load_stats(const std::string& csv);
+
+        /**
+         * Adds column statistics of a pg_stats CSV file, see load_stats
+         *
+         * @param path path to CSV file
+         * @return false if file could not be read or parsed
+         */
+        bool load_stats_file(const std::string& path);
+
+        /**
+         * Adds the tables of a snapshot written by save_snapshot
+         *
+         * @param snapshot snapshot bytes
+         * @return false if snapshot is malformed
+         */
+        bool load_snapshot(const std::string& snapshot);
+
+        /**
+         * Writes all tables in a compact binary format
+         *
+         * @param snapshot string to which the snapshot is appended
+         */
+        void save_snapshot(std::string& snapshot) const;
+
+        /**
+         * Adds a table, replaces a previous table with the same name
+         *
+         * @param table table definition
+         */
+        void add_table(Ra__Catalog__Table table);
+
+        /**
+         * @param name table name
+         * @return table, nullptr if catalog has no such table
+         */
+        const Ra__Catalog__Table* find_table(std::string_view name) const;
+
+        /**
+         * Finds the table an attribute without alias refers to
+         *
+         * @param column column name
+         * @return table, nullptr if no table or more than one table has a column with this name
+         */
+        const Ra__Catalog__Table* find_table_of_column(std::string_view column) const;
+
+        /**
+         * @param column column name
+         * @return all tables having a column with this name
+         */
+        const std::vector<const Ra__Catalog__Table*>& find_tables_of_column(std::string_view column) const;
+
+        /**
+         * @param table table name
+         * @param column column name
+         * @return true if table exists and has the column
+         */
+        bool has_column(std::string_view table, std::string_view column) const;
+
+        /**
+         * @return number of tables
+         */
+        size_t size() const;
+
+    private:
+        /// table storage, deque keeps addresses stable when growing
+        std::deque<Ra__Catalog__Table> tables;
+
+        /// tables by name, keys point into tables
+        std::unordered_map<std::string_view, Ra__Catalog__Table*> tables_by_name;
+
+        /// tables having a column, by column name, keys point into tables
+        std::unordered_map<std::string_view, std::vector<const Ra__Catalog__Table*>> tables_by_column;
+
+        /**
+         * Adds the names of a table and its columns to the indexes
+         *
+         * @param table table stored in tables
+         */
+        void index_table(Ra__Catalog__Table* table);
+
+        /**
+         * Rebuilds the indexes after a table has been replaced
+         */
+        void index_tables();
+};
+
+#endif
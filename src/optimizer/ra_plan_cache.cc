@@ -0,0 +1,488 @@
+#include <cstring>
+#include <cstdlib>
+#include <cassert>
+#include "ra_plan_cache.h"
+#include "parse_sql_to_ra.h"
+#include "deparse_ra_to_sql.h"
+
+// postgres headers are plain C and redefine printf & co, keep them after all standard headers
+extern "C" {
+#include "pg_query_internal.h"
+#include "nodes/parsenodes.h"
+#include "parser/gramparse.h"
+}
+
+// sentinel literals replacing the literals of a query while building its template,
+// numeric sentinels are 10 digit integers starting at numeric_sentinel_base
+static const char string_sentinel_start = '\x01';
+static const char string_sentinel_end = '\x02';
+static const int64_t numeric_sentinel_base = 1000000000;
+static const char float_sentinel_suffix[] = ".5";
+
+/**
+ * Finds the string and numeric literals of a query with the postgres scanner and
+ * builds the cache key, the query text with every literal replaced by a placeholder of its token type
+ *
+ * @param query SQL query
+ * @param key normalized query
+ * @param literals literals in order of their position in query
+ * @return false if query could not be scanned
+ */
+static bool scan_literals(const char* query, std::string& key, std::vector<Ra__Plan_Cache__Literal>& literals){
+    bool scanned = true;
+    MemoryContext ctx = pg_query_enter_memory_context();
+
+    // scanner errors are raised with longjmp, no C++ objects may be created on the stack inside PG_TRY
+    PG_TRY();
+    {
+        core_yy_extra_type yyextra;
+        core_YYSTYPE yylval;
+        YYLTYPE yylloc;
+        core_yyscan_t yyscanner = scanner_init(query, &yyextra, &ScanKeywords, ScanKeywordTokens);
+        size_t position = 0;
+        for(;;){
+            int token = core_yylex(&yylval, &yylloc, yyscanner);
+            if(token==0){
+                break;
+            }
+            if(token!=SCONST && token!=ICONST && token!=FCONST){
+                continue;
+            }
+            size_t start = yylloc;
+            size_t end = 0;
+            switch(token){
+                case SCONST: end = yyextra.yyllocend; break;
+                case ICONST: end = start + strspn(query+start, "0123456789"); break;
+                case FCONST: end = start + strlen(yylval.str); break;
+            }
+            key.append(query+position, start-position);
+            key.push_back(string_sentinel_start);
+            key.push_back(token==SCONST ? 's' : (token==ICONST ? 'i' : 'f'));
+            literals.push_back({start, end, token, token==ICONST ? std::to_string(yylval.ival) : std::string(yylval.str)});
+            position = end;
+        }
+        scanner_finish(yyscanner);
+        key.append(query+position);
+    }
+    PG_CATCH();
+    {
+        MemoryContextSwitchTo(ctx);
+        FlushErrorState();
+        scanned = false;
+    }
+    PG_END_TRY();
+
+    pg_query_exit_memory_context(ctx);
+    return scanned;
+}
+
+/**
+ * @param constant constant of the sentinel query
+ * @param literals literals of the query
+ * @return index of the literal the constant is the sentinel of, -1 if it is no sentinel
+ */
+static int32_t sentinel_parameter(const Ra__Node__Constant* constant, const std::vector<Ra__Plan_Cache__Literal>& literals){
+    const std::string& data = constant->data;
+    int token;
+    std::string digits;
+    if(constant->dataType==RA__CONST_DATATYPE__STRING){
+        if(data.size()<3 || data[0]!=string_sentinel_start || data.back()!=string_sentinel_end){
+            return -1;
+        }
+        token = SCONST;
+        digits = data.substr(1, data.size()-2);
+    }
+    else{
+        token = constant->dataType==RA__CONST_DATATYPE__INT ? ICONST : FCONST;
+        std::string suffix = token==FCONST ? float_sentinel_suffix : "";
+        if(data.size()!=10+suffix.size() || data.compare(10, std::string::npos, suffix)!=0){
+            return -1;
+        }
+        digits = data.substr(0, 10);
+    }
+    if(digits.empty() || digits.size()>10 || digits.find_first_not_of("0123456789")!=std::string::npos){
+        return -1;
+    }
+    int64_t parameter = std::stoll(digits)-(token==SCONST ? 0 : numeric_sentinel_base);
+    if(parameter<0 || (size_t) parameter>=literals.size() || literals[parameter].token!=token){
+        return -1;
+    }
+    return parameter;
+}
+
+/**
+ * Appends an expression of the sentinel query to a fold
+ *
+ * @param expression constant, type cast or arithmetic expression
+ * @param literals literals of the query
+ * @param fold fold
+ * @return node index of the expression
+ */
+static int32_t add_fold_node(Ra__Node* expression, const std::vector<Ra__Plan_Cache__Literal>& literals, Ra__Plan_Cache__Fold& fold){
+    Ra__Plan_Cache__Fold::Node node;
+    node.node_case = expression->node_case;
+    switch(expression->node_case){
+        case RA__NODE__CONST:{
+            auto constant = static_cast<Ra__Node__Constant*>(expression);
+            node.text = constant->data;
+            node.data_type = constant->dataType;
+            node.parameter = sentinel_parameter(constant, literals);
+            break;
+        }
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+            node.text = type_cast->type;
+            node.typ_mod = type_cast->typ_mod;
+            node.l_arg = add_fold_node(type_cast->expression, literals, fold);
+            break;
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            node.text = expr->operator_;
+            node.l_arg = expr->l_arg!=nullptr ? add_fold_node(expr->l_arg, literals, fold) : -1;
+            node.r_arg = add_fold_node(expr->r_arg, literals, fold);
+            break;
+        }
+        default: assert(false);
+    }
+    fold.nodes.push_back(std::move(node));
+    return fold.nodes.size()-1;
+}
+
+/**
+ * Writes a folded constant like RAtoSQL does
+ */
+static void deparse_folded(Ra__Node* folded, std::string& sql){
+    if(folded->node_case==RA__NODE__TYPE_CAST){
+        auto type_cast = static_cast<Ra__Node__Type_Cast*>(folded);
+        sql += type_cast->type;
+        sql += ' ';
+        deparse_folded(type_cast->expression, sql);
+        if(!type_cast->typ_mod.empty()){
+            sql += ' ';
+            sql += type_cast->typ_mod;
+        }
+        return;
+    }
+    auto constant = static_cast<Ra__Node__Constant*>(folded);
+    if(constant->dataType==RA__CONST_DATATYPE__STRING){
+        sql += '\'';
+        sql += constant->data;
+        sql += '\'';
+    }
+    else{
+        sql += constant->data;
+    }
+}
+
+/**
+ * @param fold expression over literals
+ * @param literals values of the parameters
+ * @param sql SQL the folded expression is appended to
+ * @return false if the expression does not fold for these literals (e.g. overflow, invalid date)
+ */
+static bool fill_fold(const Ra__Plan_Cache__Fold& fold, const std::vector<Ra__Plan_Cache__Literal>& literals, std::string& sql){
+    RaArena arena(1024);
+    std::vector<Ra__Node*> nodes;
+    nodes.reserve(fold.nodes.size());
+    for(const auto& node: fold.nodes){
+        switch(node.node_case){
+            case RA__NODE__CONST:{
+                nodes.push_back(arena.make<Ra__Node__Constant>(node.parameter>=0 ? literals[node.parameter].value : node.text, node.data_type));
+                break;
+            }
+            case RA__NODE__TYPE_CAST:{
+                nodes.push_back(arena.make<Ra__Node__Type_Cast>(node.text, node.typ_mod, nodes[node.l_arg]));
+                break;
+            }
+            default:{
+                auto expr = arena.make<Ra__Node__Expression>();
+                expr->l_arg = node.l_arg>=0 ? nodes[node.l_arg] : nullptr;
+                expr->r_arg = nodes[node.r_arg];
+                expr->operator_ = node.text;
+                nodes.push_back(expr);
+            }
+        }
+    }
+    Ra__Node* folded = RaTree::evaluate_constant_expression(arena, nodes.back(), fold.is_compared);
+    if(folded==nullptr){
+        return false;
+    }
+    deparse_folded(folded, sql);
+    return true;
+}
+
+/**
+ * @param segments template
+ * @param literals values of the parameters
+ * @param sql filled template
+ * @return false if a folded expression of the template does not fold for these literals
+ */
+static bool fill_template(const std::vector<Ra__Plan_Cache__Segment>& segments, const std::vector<Ra__Plan_Cache__Literal>& literals, std::string& sql){
+    size_t size = 0;
+    for(const auto& segment: segments){
+        size += segment.text.size();
+        if(segment.parameter>=0){
+            size += literals[segment.parameter].value.size();
+        }
+    }
+    sql.clear();
+    sql.reserve(size);
+    for(const auto& segment: segments){
+        sql += segment.text;
+        if(segment.parameter>=0){
+            sql += literals[segment.parameter].value;
+        }
+        else if(segment.fold!=nullptr && !fill_fold(*segment.fold, literals, sql)){
+            return false;
+        }
+    }
+    return true;
+}
+
+RaPlanCache::RaPlanCache(size_t _capacity, std::shared_ptr<const RaCatalog> _catalog, Ra__Decouple__Strategy _decouple_strategy, size_t _join_order_dp_threshold):
+    capacity(_capacity), catalog(_catalog), decouple_strategy(_decouple_strategy), join_order_dp_threshold(_join_order_dp_threshold){}
+
+bool RaPlanCache::optimize(const char* query, std::string& optimized, bool* cached){
+    if(cached!=nullptr){
+        *cached = false;
+    }
+    if(capacity==0){
+        misses++;
+        return optimize_uncached(query, optimized);
+    }
+
+    std::string key;
+    std::vector<Ra__Plan_Cache__Literal> literals;
+    if(!scan_literals(query, key, literals)){
+        // let the parser report the error
+        misses++;
+        return optimize_uncached(query, optimized);
+    }
+
+    std::shared_ptr<const std::vector<Ra__Plan_Cache__Segment>> segments;
+    bool known_uncacheable = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries_by_key.find(key);
+        if(it!=entries_by_key.end()){
+            entries.splice(entries.begin(), entries, it->second);
+            segments = it->second->segments;
+            known_uncacheable = !it->second->cacheable;
+        }
+    }
+
+    if(segments!=nullptr){
+        if(fill_template(*segments, literals, optimized)){
+            hits++;
+            if(cached!=nullptr){
+                *cached = true;
+            }
+            return true;
+        }
+        // folded expressions of the template do not fold for these literals
+        misses++;
+        return optimize_uncached(query, optimized);
+    }
+
+    misses++;
+    if(!optimize_uncached(query, optimized)){
+        return false;
+    }
+    if(known_uncacheable){
+        uncacheable++;
+        return true;
+    }
+
+    auto new_segments = std::make_shared<std::vector<Ra__Plan_Cache__Segment>>();
+    bool cacheable = build_template(query, literals, *new_segments);
+    if(cacheable){
+        // the template has to reproduce the optimized query, otherwise optimization depends on the literals
+        std::string filled;
+        cacheable = fill_template(*new_segments, literals, filled) && filled==optimized;
+    }
+    if(!cacheable){
+        uncacheable++;
+        new_segments = nullptr;
+    }
+
+    insert({std::move(key), cacheable, std::move(new_segments)});
+    return true;
+}
+
+bool RaPlanCache::optimize_uncached(const char* query, std::string& optimized){
+    auto sql_to_ra = std::make_shared<SQLtoRA>(catalog);
+    std::shared_ptr<RaTree> raTree = sql_to_ra->parse(query);
+    if(raTree==nullptr){
+        return false;
+    }
+    raTree->optimize(decouple_strategy, join_order_dp_threshold);
+    auto ra_to_sql = std::make_shared<RAtoSQL>(raTree);
+    optimized = ra_to_sql->deparse();
+    return true;
+}
+
+bool RaPlanCache::optimize_template(const std::string& sentinel_query, const std::vector<Ra__Plan_Cache__Literal>& literals,
+    std::string& sentinel_sql, std::vector<std::shared_ptr<const Ra__Plan_Cache__Fold>>& folds){
+    auto sql_to_ra = std::make_shared<SQLtoRA>(catalog);
+    std::shared_ptr<RaTree> raTree = sql_to_ra->parse(sentinel_query.c_str());
+    if(raTree==nullptr){
+        return false;
+    }
+    raTree->template_literal = [&](const Ra__Node__Constant* constant, std::string& value){
+        int32_t parameter = sentinel_parameter(constant, literals);
+        if(parameter<0){
+            return false;
+        }
+        value = literals[parameter].value;
+        return true;
+    };
+    raTree->optimize(decouple_strategy, join_order_dp_threshold);
+    auto ra_to_sql = std::make_shared<RAtoSQL>(raTree);
+    sentinel_sql = ra_to_sql->deparse();
+
+    folds.clear();
+    for(const auto& template_fold: raTree->template_folds){
+        auto fold = std::make_shared<Ra__Plan_Cache__Fold>();
+        add_fold_node(template_fold.expression, literals, *fold);
+        fold->is_compared = template_fold.is_compared;
+        folds.push_back(fold);
+    }
+    return true;
+}
+
+bool RaPlanCache::build_template(const char* query, const std::vector<Ra__Plan_Cache__Literal>& literals, std::vector<Ra__Plan_Cache__Segment>& segments){
+    // literal i is replaced by a sentinel of the same token type
+    std::string sentinel_query;
+    size_t position = 0;
+    for(size_t i=0; i<literals.size(); i++){
+        const auto& literal = literals[i];
+        sentinel_query.append(query+position, literal.start-position);
+        switch(literal.token){
+            case SCONST:
+                sentinel_query += "'";
+                sentinel_query += string_sentinel_start + std::to_string(i) + string_sentinel_end;
+                sentinel_query += "'";
+                break;
+            case ICONST:
+                sentinel_query += std::to_string(numeric_sentinel_base+i);
+                break;
+            case FCONST:
+                sentinel_query += std::to_string(numeric_sentinel_base+i) + float_sentinel_suffix;
+                break;
+        }
+        position = literal.end;
+    }
+    sentinel_query.append(query+position);
+
+    std::string sentinel_sql;
+    std::vector<std::shared_ptr<const Ra__Plan_Cache__Fold>> folds;
+    if(!optimize_template(sentinel_query, literals, sentinel_sql, folds)){
+        return false;
+    }
+
+    // split deparsed SQL at the sentinels
+    segments.clear();
+    segments.emplace_back();
+    size_t i = 0;
+    while(i<sentinel_sql.size()){
+        char c = sentinel_sql[i];
+        // placeholder of a folded expression, a string constant
+        if(c=='\'' && i+1<sentinel_sql.size() && sentinel_sql[i+1]==RaTree::template_fold_start){
+            size_t end = sentinel_sql.find(RaTree::template_fold_end, i);
+            if(end==std::string::npos || end+1>=sentinel_sql.size() || sentinel_sql[end+1]!='\''){
+                return false;
+            }
+            size_t fold = std::stoul(sentinel_sql.substr(i+2, end-i-2));
+            if(fold>=folds.size()){
+                return false;
+            }
+            segments.back().fold = folds[fold];
+            segments.emplace_back();
+            i = end+2;
+            continue;
+        }
+        if(c==string_sentinel_start){
+            size_t end = sentinel_sql.find(string_sentinel_end, i);
+            if(end==std::string::npos){
+                return false;
+            }
+            size_t parameter = std::stoul(sentinel_sql.substr(i+1, end-i-1));
+            if(parameter>=literals.size() || literals[parameter].token!=SCONST){
+                return false;
+            }
+            segments.back().parameter = parameter;
+            segments.emplace_back();
+            i = end+1;
+            continue;
+        }
+        // numeric sentinels are whole tokens, not part of an identifier or another number
+        bool token_start = i==0 || !(isalnum((unsigned char) sentinel_sql[i-1]) || sentinel_sql[i-1]=='_' || sentinel_sql[i-1]=='.' || sentinel_sql[i-1]=='$');
+        if(token_start && isdigit((unsigned char) c)){
+            size_t end = i + strspn(sentinel_sql.c_str()+i, "0123456789");
+            int64_t value = end-i==10 ? std::stoll(sentinel_sql.substr(i, 10)) : -1;
+            if(value>=numeric_sentinel_base && (size_t) (value-numeric_sentinel_base)<literals.size()){
+                size_t parameter = value-numeric_sentinel_base;
+                const auto& literal = literals[parameter];
+                if(literal.token==FCONST && sentinel_sql.compare(end, strlen(float_sentinel_suffix), float_sentinel_suffix)==0){
+                    end += strlen(float_sentinel_suffix);
+                }
+                else if(literal.token!=ICONST){
+                    return false;
+                }
+                segments.back().parameter = parameter;
+                segments.emplace_back();
+                i = end;
+                continue;
+            }
+            segments.back().text.append(sentinel_sql, i, end-i);
+            i = end;
+            continue;
+        }
+        segments.back().text.push_back(c);
+        i++;
+    }
+    return true;
+}
+
+void RaPlanCache::insert(Entry entry){
+    if(capacity==0){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // another thread may have optimized the same shape in the meantime
+    auto it = entries_by_key.find(entry.key);
+    if(it!=entries_by_key.end()){
+        entries.splice(entries.begin(), entries, it->second);
+        it->second->cacheable = entry.cacheable;
+        it->second->segments = std::move(entry.segments);
+        return;
+    }
+
+    entries.push_front(std::move(entry));
+    entries_by_key.emplace(entries.front().key, entries.begin());
+
+    if(entries.size()>capacity){
+        entries_by_key.erase(entries.back().key);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+Ra__Plan_Cache__Stats RaPlanCache::stats() const{
+    Ra__Plan_Cache__Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.uncacheable = uncacheable;
+    stats.evictions = evictions;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.entries = entries.size();
+    return stats;
+}
+
+void RaPlanCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    entries_by_key.clear();
+    entries.clear();
+}
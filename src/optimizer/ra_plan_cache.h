@@ -0,0 +1,186 @@
+#ifndef ra_plan_cache
+#define ra_plan_cache
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "ra_tree.h"
+#include "ra_catalog.h"
+
+/**
+ * Literal of a query found by the scanner, replaced by a parameter in the cached template
+ */
+struct Ra__Plan_Cache__Literal {
+    /// byte range of the literal token in the query
+    size_t start;
+    size_t end;
+    /// scanner token (SCONST, ICONST, FCONST)
+    int token;
+    /// value as deparsed by RAtoSQL (string without quotes and escapes, integer in decimal)
+    std::string value;
+};
+
+/**
+ * Constant expression over literals which the optimizer folds (e.g. date '1998-12-01' - interval '90' day),
+ * it is folded again whenever the template is filled
+ */
+struct Ra__Plan_Cache__Fold {
+    struct Node {
+        /// RA__NODE__CONST, RA__NODE__TYPE_CAST or RA__NODE__EXPRESSION
+        Ra__Node__NodeCase node_case = RA__NODE__CONST;
+        /// data of a constant, type of a type cast, operator of an expression
+        std::string text;
+        /// type modifier of a type cast
+        std::string typ_mod;
+        Ra__Const_DataType__DataType data_type = RA__CONST_DATATYPE__INT;
+        /// index of the literal a constant stands for, -1 for other constants
+        int32_t parameter = -1;
+        /// node indexes of the operands of an expression (l_arg -1 for unary operators) or the expression of a type cast (l_arg)
+        int32_t l_arg = -1;
+        int32_t r_arg = -1;
+    };
+    /// operands before the nodes using them, the expression itself is the last node
+    std::vector<Node> nodes;
+    bool is_compared = false;
+};
+
+/**
+ * Part of a cached template: text followed by a literal parameter or a folded expression
+ */
+struct Ra__Plan_Cache__Segment {
+    std::string text;
+    /// index of the literal following text, -1 for the last segment or a folded expression
+    int32_t parameter = -1;
+    /// expression folded with the literals following text, nullptr if none
+    std::shared_ptr<const Ra__Plan_Cache__Fold> fold;
+};
+
+struct Ra__Plan_Cache__Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    /// misses whose optimized SQL depends on the literal values, optimized without cache
+    uint64_t uncacheable = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+};
+
+/**
+ * Cache of optimized queries for queries differing only in their literals.
+ * Queries are keyed by their text with all string and numeric literals replaced by a placeholder,
+ * the key is built by the postgres scanner which is much cheaper than parsing.
+ * On a miss, the query is optimized with every literal replaced by a unique sentinel literal,
+ * the sentinels in the deparsed SQL become the parameters of the template.
+ * Constant expressions over literals which the optimizer folds are kept unfolded in the template and folded when it is filled.
+ * On a hit, the template is filled with the literals of the query, parse, optimize and deparse are skipped.
+ * A template is only cached if filling it with the literals of the query reproduces the SQL
+ * of optimizing the query itself, shapes whose optimization depends on literal values are remembered as uncacheable.
+ * Bounded by the number of entries, least recently used entries are evicted. Thread-safe.
+ */
+class RaPlanCache {
+    public:
+        /**
+         * @param _capacity maximum number of cached query shapes, 0 disables the cache
+         * @param _catalog schema the queries run against
+         * @param _decouple_strategy strategy passed to RaTree::optimize
+         * @param _join_order_dp_threshold join graph size up to which RaTree::optimize orders joins by dynamic programming
+         */
+        RaPlanCache(size_t _capacity=1024, std::shared_ptr<const RaCatalog> _catalog=RaCatalog::tpch(), Ra__Decouple__Strategy _decouple_strategy=RA__DECOUPLE__COST_BASED,
+            size_t _join_order_dp_threshold=RaTree::default_join_order_dp_threshold);
+
+        RaPlanCache(const RaPlanCache&) = delete;
+        RaPlanCache& operator=(const RaPlanCache&) = delete;
+
+        /**
+         * Optimizes a query, from the cached template if a query of the same shape was optimized before
+         *
+         * @param query SQL query
+         * @param optimized SQL of the optimized query
+         * @param cached set to true if optimized was filled from a cached template
+         * @return false if query could not be parsed
+         */
+        bool optimize(const char* query, std::string& optimized, bool* cached=nullptr);
+
+        /**
+         * @return counters and number of cached entries
+         */
+        Ra__Plan_Cache__Stats stats() const;
+
+        /**
+         * Removes all entries, counters are kept
+         */
+        void clear();
+
+    private:
+        struct Entry {
+            /// normalized query, referenced by the key in entries_by_key
+            std::string key;
+            /// false if optimization depends on the literal values
+            bool cacheable;
+            /// template, shared with lookups filling it outside of the lock, nullptr if not cacheable
+            std::shared_ptr<const std::vector<Ra__Plan_Cache__Segment>> segments;
+        };
+
+        size_t capacity;
+        std::shared_ptr<const RaCatalog> catalog;
+        Ra__Decouple__Strategy decouple_strategy;
+        size_t join_order_dp_threshold;
+
+        /// guards entries and entries_by_key
+        mutable std::mutex mutex;
+        /// entries, most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> entries_by_key;
+
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> uncacheable{0};
+        std::atomic<uint64_t> evictions{0};
+
+        /**
+         * Parses, optimizes and deparses a query
+         *
+         * @param query SQL query
+         * @param optimized SQL of the optimized query
+         * @return false if query could not be parsed
+         */
+        bool optimize_uncached(const char* query, std::string& optimized);
+
+        /**
+         * Optimizes the query with sentinel literals of a template, expressions the optimizer would fold are kept
+         * as placeholders
+         *
+         * @param sentinel_query SQL query with sentinel literals
+         * @param literals literals of the query the template is built for
+         * @param sentinel_sql SQL of the optimized query
+         * @param folds folded expressions by placeholder index
+         * @return false if sentinel_query could not be parsed
+         */
+        bool optimize_template(const std::string& sentinel_query, const std::vector<Ra__Plan_Cache__Literal>& literals,
+            std::string& sentinel_sql, std::vector<std::shared_ptr<const Ra__Plan_Cache__Fold>>& folds);
+
+        /**
+         * Builds the template of a query shape by optimizing the query with sentinel literals
+         *
+         * @param query SQL query
+         * @param literals literals of query
+         * @param segments template
+         * @return false if sentinel query could not be optimized
+         */
+        bool build_template(const char* query, const std::vector<Ra__Plan_Cache__Literal>& literals, std::vector<Ra__Plan_Cache__Segment>& segments);
+
+        /**
+         * Stores an entry as most recently used, evicts the least recently used entry if cache is full
+         *
+         * @param entry new entry
+         */
+        void insert(Entry entry);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "ra_symbol_table.h"
+
+RaSymbolTable::RaSymbolTable(){
+    // id 0 is reserved for the empty identifier, equal to default constructed symbols
+    intern("");
+}
+
+Ra__Symbol RaSymbolTable::intern(std::string_view identifier){
+    auto found = ids.find(identifier);
+    if(found!=ids.end()){
+        return Ra__Symbol(found->second, &strings[found->second]);
+    }
+    uint32_t id = strings.size();
+    strings.emplace_back(identifier);
+    ids.emplace(strings.back(), id);
+    return Ra__Symbol(id, &strings.back());
+}
+
+size_t RaSymbolTable::size() const{
+    return strings.size();
+}
@@ -0,0 +1,76 @@
+#ifndef ra_symbol_table
+#define ra_symbol_table
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Interned identifier (relation name, alias, attribute name).
+ * Symbols handed out by the same RaSymbolTable are compared by their id only,
+ * the string is kept for deparsing and printing.
+ * Symbol id 0 is the empty identifier in every table, a default constructed symbol is empty.
+ */
+class Ra__Symbol {
+    public:
+        Ra__Symbol(): id(0), string(&empty_string){}
+
+        /// unique id of the identifier within its symbol table
+        uint32_t id;
+
+        /**
+         * @return identifier as string
+         */
+        const std::string& str() const { return *string; }
+
+        /**
+         * @return true if identifier is the empty string
+         */
+        bool empty() const { return id==0; }
+
+        bool operator==(const Ra__Symbol& other) const { return id==other.id; }
+        bool operator!=(const Ra__Symbol& other) const { return id!=other.id; }
+        bool operator<(const Ra__Symbol& other) const { return id<other.id; }
+
+    private:
+        friend class RaSymbolTable;
+        Ra__Symbol(uint32_t _id, const std::string* _string): id(_id), string(_string){}
+
+        const std::string* string;
+        inline static const std::string empty_string;
+};
+
+/**
+ * Per-tree table of interned identifiers.
+ * Every distinct identifier is stored once, symbols point into the table and stay valid as long as the table lives.
+ */
+class RaSymbolTable {
+    public:
+        RaSymbolTable();
+
+        RaSymbolTable(const RaSymbolTable&) = delete;
+        RaSymbolTable& operator=(const RaSymbolTable&) = delete;
+
+        /**
+         * Returns the symbol of an identifier, adds identifier to table if not seen before
+         *
+         * @param identifier identifier to intern
+         * @return symbol of identifier
+         */
+        Ra__Symbol intern(std::string_view identifier);
+
+        /**
+         * @return number of distinct identifiers in the table (incl. the empty identifier)
+         */
+        size_t size() const;
+
+    private:
+        /// identifier storage, deque keeps addresses stable when growing
+        std::deque<std::string> strings;
+        std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+#endif
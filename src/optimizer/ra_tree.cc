@@ -1,16 +1,49 @@
 #include "ra_tree.h"
 #include <tuple>
 #include <algorithm>
+#include <unordered_set>
 
-RaTree::RaTree(std::shared_ptr<Ra__Node> _root, std::vector<std::shared_ptr<Ra__Node>> _ctes, uint64_t _counter)
-:root(_root), ctes(_ctes), counter(_counter){
+RaTree::RaTree(Ra__Node* _root, std::vector<Ra__Node*> _ctes, uint64_t _counter, std::unique_ptr<RaArena> _arena, std::unique_ptr<RaSymbolTable> _symbols, std::shared_ptr<const RaCatalog> _catalog)
+:root(_root), ctes(_ctes), counter(_counter), arena(std::move(_arena)), symbols(std::move(_symbols)), catalog(std::move(_catalog)){
+    symbol_d = symbols->intern("d");
+    link_parents(root);
+    for(auto cte: ctes){
+        link_parents(cte);
+    }
+}
+
+void RaTree::link_parents(Ra__Node* it){
+    for(auto child: it->childNodes){
+        child->parent = it;
+        child->n_parents++;
+        // shared subtree is linked only once
+        if(child->n_parents==1){
+            link_parents(child);
+        }
+    }
 }
 
-void RaTree::optimize(){
+void RaTree::optimize(Ra__Decouple__Strategy _decouple_strategy, size_t _join_order_dp_threshold){
+    decouple_strategy = _decouple_strategy;
+    join_order_dp_threshold = _join_order_dp_threshold;
+    fold_constants();
+    // before the CTEs are optimized independently and get different generated names
+    while(merge_identical_ctes()){}
+    simplify_outer_joins();
     push_down_predicates(false);
     decorrelate_all_exists_in_subqueries();
+    convert_correlated_aggregates_to_windows();
     general_query_unnesting();
+    eliminate_joins();
+    split_disjunctions();
+    convert_in_lists_to_values();
     push_down_predicates(convert_cp_to_join);
+    reorder_joins();
+    push_down_aggregations();
+    share_common_subexpressions();
+    remove_redundant_distincts();
+    push_down_limits();
+    prune_columns();
 }
 
 void RaTree::push_down_predicates(bool cp_to_join){
@@ -32,17 +65,29 @@ void RaTree::push_down_predicates(bool cp_to_join){
         // 2.3 if all predicates have new node, remove old selection
 
     // 1.1
-    std::vector<std::shared_ptr<Ra__Node>> selections;
+    std::vector<Ra__Node*> selections;
     get_all_selections(root, selections);
 
     // vector(selections),Ra__Node(sel child),vec(predicates),Ra__Node(predicate),vector(relations),string(rel_id)
-    std::vector<std::pair<std::shared_ptr<Ra__Node>,std::vector<std::pair<std::shared_ptr<Ra__Node>,std::vector<std::string>>>>> selections_predicates_relations;
+    std::vector<std::pair<Ra__Node*,std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>>>> selections_predicates_relations;
     for(const auto& selection: selections){
-        auto sel = std::static_pointer_cast<Ra__Node__Selection>(selection);
-        std::vector<std::pair<std::shared_ptr<Ra__Node>,std::vector<std::string>>> predicates_relations; // splitted predicates, and relations referenced
+        auto sel = static_cast<Ra__Node__Selection*>(selection);
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations; // splitted predicates, and relations referenced
 
-        // 1.2
+        // 1.2 (add predicates implied by equivalence classes, duplicate conjuncts are pushed down once)
         split_selection_predicates(sel->predicate, predicates_relations);
+        std::vector<Ra__Node*> conjuncts;
+        for(const auto& p_r: predicates_relations){
+            conjuncts.push_back(p_r.first);
+        }
+        bool conjuncts_changed = infer_equivalent_predicates(conjuncts, sel);
+        remove_duplicate_predicates(conjuncts);
+        if(conjuncts_changed || conjuncts.size()<predicates_relations.size()){
+            predicates_relations.clear();
+            for(auto conjunct: conjuncts){
+                predicates_relations.push_back({conjunct,{}});
+            }
+        }
 
         // 1.3
         for(auto& p_r: predicates_relations){
@@ -52,20 +97,20 @@ void RaTree::push_down_predicates(bool cp_to_join){
         if(push_down_correlating_predicates){
             // preparing pushing down correlated predicates -> remove correlated relation for required relations_aliases
             // get relations defined for selection
-            std::vector<std::pair<std::string,std::string>> defined_relations_aliases;
+            std::vector<std::pair<Ra__Symbol,Ra__Symbol>> defined_relations_aliases;
             get_relations_aliases(selection->childNodes[0], defined_relations_aliases);
             for(auto& p_r: predicates_relations){
                 // check if predicate is correlating
                 bool dummy_is_boolean_predicate;
-                std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates;
-                // is_correlating_predicate(std::static_pointer_cast<Ra__Node__Predicate>(p_r.first), defined_relations_aliases);
+                std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates;
+                // is_correlating_predicate(static_cast<Ra__Node__Predicate*>(p_r.first), defined_relations_aliases);
                 get_correlating_predicates(p_r.first, correlating_predicates, dummy_is_boolean_predicate, defined_relations_aliases);
                 
                 // remove correlated predicate relations from required relations_aliases
                 for(const auto& correlating_predicate: correlating_predicates){
-                    std::string relation_alias = get_relation_from_attribute(std::get<0>(correlating_predicate));
+                    Ra__Symbol relation_alias = get_relation_from_attribute(std::get<0>(correlating_predicate));
                     p_r.second.erase(
-                        std::remove_if(p_r.second.begin(),p_r.second.end(),[&](std::string const& required_name){return required_name==relation_alias;}), 
+                        std::remove_if(p_r.second.begin(),p_r.second.end(),[&](Ra__Symbol const& required_name){return required_name==relation_alias;}), 
                         p_r.second.end()
                     );
                 }
@@ -90,19 +135,19 @@ void RaTree::push_down_predicates(bool cp_to_join){
             }
         }
         // 2.3
-        if(std::static_pointer_cast<Ra__Node__Selection>(selection.first)->predicate==nullptr){
-            std::shared_ptr<Ra__Node> sel_parent = root;
+        if(static_cast<Ra__Node__Selection*>(selection.first)->predicate==nullptr){
+            Ra__Node* sel_parent = root;
             int child_index = -1;
             get_node_parent(sel_parent, selection.first, child_index);
-            sel_parent->childNodes[child_index] = selection.first->childNodes[0];
-            selection.first->childNodes.pop_back();
+            sel_parent->set_child(child_index, selection.first->childNodes[0]);
+            selection.first->clear_children();
         }
     }
 }
 
 void RaTree::decorrelate_all_exists_in_subqueries(){
     // find marker in selection
-    std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>> markers_joins; // markers, joins
+    std::vector<std::pair<Ra__Node*, Ra__Node*>> markers_joins; // markers, joins
     
     // 1.
     find_subquery_markers(root, markers_joins, {RA__JOIN__SEMI_LEFT_DEPENDENT,RA__JOIN__ANTI_LEFT_DEPENDENT,RA__JOIN__IN_LEFT_DEPENDENT,RA__JOIN__ANTI_IN_LEFT_DEPENDENT});
@@ -114,46 +159,130 @@ void RaTree::decorrelate_all_exists_in_subqueries(){
     for(int i=markers_joins.size()-1; i>=0; i--){
         // assert each marker found corresponding join
         assert(markers_joins[i].second!=nullptr);
+        // rows of a subquery with a limit depend on its correlation, it is kept nested
+        if(has_limit(markers_joins[i].second->childNodes[1])){
+            continue;
+        }
         decorrelate_exists_in_subquery(markers_joins[i]);
     };
 }
 
 // decorrelate exists/!exists & in/!in
-void RaTree::decorrelate_exists_in_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> marker_join){
+void RaTree::decorrelate_exists_in_subquery(std::pair<Ra__Node*, Ra__Node*> marker_join){
     // 2. find correlating predicates and attributes
     // 3. move subquery into CTE
         // 3.1 remove correlating predicates
     // 4. in original subquery, select where on correlating attributes
         // 4.1 select from cte
 
-    std::shared_ptr<Ra__Node> subquery_projection = (marker_join.second)->childNodes[1];
+    Ra__Node* subquery_projection = (marker_join.second)->childNodes[1];
 
     // 2.
     // get defined relations and their aliases
-    std::vector<std::pair<std::string,std::string>> relations_aliases;
-    std::shared_ptr<Ra__Node> it = subquery_projection->childNodes[0];
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> relations_aliases;
+    Ra__Node* it = subquery_projection->childNodes[0];
     get_relations_aliases(it, relations_aliases);
     // find (first & only) selection in correlated subquery
     it = subquery_projection->childNodes[0];
     // correlated exists must have selection
     assert(get_first_selection(it));
-    auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
+    auto sel = static_cast<Ra__Node__Selection*>(it);
 
-    std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates;
+    std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates;
     bool is_boolean_predicate = false;
     get_correlating_predicates(sel->predicate, correlating_predicates, is_boolean_predicate, relations_aliases);
-    
+
+    // the correlating predicates are removed from the subquery, the other predicates are moved into the CTE:
+    // correlating predicates must be conjuncts of the selection and the other predicates must not refer to the outer query
+    if(correlating_predicates.empty()){
+        return;
+    }
+    std::vector<Ra__Node*> residual_predicates;
+    if(is_boolean_predicate){
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(sel->predicate);
+        if(bool_p->bool_operator!=RA__BOOL_OPERATOR__AND){
+            return;
+        }
+        for(size_t i=0; i<bool_p->args.size(); i++){
+            bool is_correlating = false;
+            for(const auto& correlating_predicate: correlating_predicates){
+                if(std::get<3>(correlating_predicate)==i){
+                    if(bool_p->args[i]->node_case!=RA__NODE__PREDICATE){
+                        return;
+                    }
+                    is_correlating = true;
+                }
+            }
+            if(!is_correlating && bool_p->args[i]->node_case!=RA__NODE__WHERE_SUBQUERY_MARKER){
+                residual_predicates.push_back(bool_p->args[i]);
+            }
+        }
+    }
+    std::vector<Ra__Node*> residual_attributes;
+    for(auto residual_predicate: residual_predicates){
+        get_predicate_attributes(residual_predicate, residual_attributes);
+    }
+
+    // columns of the CTE: the inner correlating attributes and the attributes of the subquery's select list,
+    // named by the attributes, attributes of different relations with the same name can not be told apart
+    auto is_subquery_attribute = [&](Ra__Node__Attribute* attr){
+        for(const auto& relation_alias: relations_aliases){
+            if(attr->alias.empty() ? is_catalog_attribute(attr->name, relation_alias.first)
+                : (attr->alias==relation_alias.first || attr->alias==relation_alias.second)){
+                return true;
+            }
+        }
+        return false;
+    };
+    for(auto node: residual_attributes){
+        auto attr = static_cast<Ra__Node__Attribute*>(node);
+        if(attr->name.str()!="*" && !is_subquery_attribute(attr)){
+            return;
+        }
+    }
+    std::vector<Ra__Node__Attribute*> cte_attributes;
+    auto add_cte_attribute = [&](Ra__Node__Attribute* attr){
+        for(auto cte_attribute: cte_attributes){
+            if(cte_attribute->name==attr->name){
+                return cte_attribute->alias==attr->alias;
+            }
+        }
+        cte_attributes.push_back(attr);
+        return true;
+    };
+    for(auto correlating_predicate: correlating_predicates){
+        if(!add_cte_attribute(static_cast<Ra__Node__Attribute*>(std::get<1>(correlating_predicate)))){
+            return;
+        }
+    }
+    std::vector<Ra__Node*> select_attributes;
+    for(auto arg: static_cast<Ra__Node__Projection*>(subquery_projection)->args){
+        get_expression_attributes(static_cast<Ra__Node__Select_Expression*>(arg)->expression, select_attributes);
+    }
+    for(auto node: select_attributes){
+        auto attr = static_cast<Ra__Node__Attribute*>(node);
+        if(attr->name.str()!="*" && is_subquery_attribute(attr) && !add_cte_attribute(attr)){
+            return;
+        }
+    }
+
     // 3.
-    auto cte_projection = std::make_shared<Ra__Node__Projection>();
-    cte_projection->childNodes.push_back(subquery_projection->childNodes[0]);
-    std::string cte_name = "cte_" + std::to_string(counter++);
+    auto cte_projection = arena->make<Ra__Node__Projection>();
+    cte_projection->add_child(subquery_projection->childNodes[0]);
+    Ra__Symbol cte_name = symbols->intern("cte_" + std::to_string(counter++));
     cte_projection->subquery_alias = cte_name;
-    for(auto correlating_predicate: correlating_predicates){
-        auto inner_attribute = std::static_pointer_cast<Ra__Node__Attribute>(std::get<1>(correlating_predicate));
-        cte_projection->args.push_back(inner_attribute);
-        cte_projection->subquery_columns.push_back(inner_attribute->name);
+    for(auto cte_attribute: cte_attributes){
+        cte_projection->args.push_back(arena->make<Ra__Node__Attribute>(cte_attribute->name, cte_attribute->alias));
+        cte_projection->subquery_columns.push_back(cte_attribute->name.str());
     }
     ctes.push_back(cte_projection);
+    // the select list reads the columns of the CTE
+    for(auto node: select_attributes){
+        auto attr = static_cast<Ra__Node__Attribute*>(node);
+        if(!attr->alias.empty() && attr->name.str()!="*" && is_subquery_attribute(attr)){
+            attr->alias = cte_name;
+        }
+    }
 
     // 3.1
     if(!is_boolean_predicate){
@@ -161,18 +290,19 @@ void RaTree::decorrelate_exists_in_subquery(std::pair<std::shared_ptr<Ra__Node>,
         int child_index = -1;
         get_node_parent(it, sel, child_index);
         assert(it->n_children==1 && child_index==0); // parent should have single child
-        it->childNodes[child_index] = sel->childNodes[0];
-        sel->childNodes.pop_back();
+        it->set_child(child_index, sel->childNodes[0]);
+        sel->clear_children();
     }
     // if part of boolean predicate
     else{
-        auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(sel->predicate);
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(sel->predicate);
         assert(bool_p->args.size()>1);
-        // sort descending based on child index
-        std::sort(begin(correlating_predicates), end(correlating_predicates), [](auto const &t1, auto const &t2) {
+        // erase descending based on child index
+        auto erased_predicates = correlating_predicates;
+        std::sort(begin(erased_predicates), end(erased_predicates), [](auto const &t1, auto const &t2) {
                 return std::get<3>(t1) > std::get<3>(t2);
         });
-        for(auto correlating_predicate: correlating_predicates){
+        for(auto correlating_predicate: erased_predicates){
             bool_p->args.erase(bool_p->args.begin() + std::get<3>(correlating_predicate));
         }
         // if only 1 predicate left, convert boolean to single normal predicate
@@ -186,55 +316,57 @@ void RaTree::decorrelate_exists_in_subquery(std::pair<std::shared_ptr<Ra__Node>,
             int child_index = -1;
             get_node_parent(it, sel, child_index);
             assert(it->n_children==1 && child_index==0); // parent should have single child
-            it->childNodes[child_index] = sel->childNodes[0];
-            sel->childNodes.pop_back();
+            it->set_child(child_index, sel->childNodes[0]);
+            sel->clear_children();
         }
     }
 
     // 4.
-    auto new_subquery_selection = std::make_shared<Ra__Node__Selection>();
+    auto new_subquery_selection = arena->make<Ra__Node__Selection>();
     if(correlating_predicates.size()==1){
-        auto outer_attribute = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(correlating_predicates[0]));
-        auto inner_attribute = std::static_pointer_cast<Ra__Node__Attribute>(std::get<1>(correlating_predicates[0]));
-        auto left = std::make_shared<Ra__Node__Attribute>(inner_attribute->name, cte_name);
-        auto right = std::make_shared<Ra__Node__Attribute>(outer_attribute->name, outer_attribute->alias);
-        new_subquery_selection->predicate = std::make_shared<Ra__Node__Predicate>(left, right, std::get<2>(correlating_predicates[0]));
+        auto outer_attribute = static_cast<Ra__Node__Attribute*>(std::get<0>(correlating_predicates[0]));
+        auto inner_attribute = static_cast<Ra__Node__Attribute*>(std::get<1>(correlating_predicates[0]));
+        auto left = arena->make<Ra__Node__Attribute>(inner_attribute->name, cte_name);
+        auto right = arena->make<Ra__Node__Attribute>(outer_attribute->name, outer_attribute->alias);
+        new_subquery_selection->predicate = arena->make<Ra__Node__Predicate>(left, right, std::get<2>(correlating_predicates[0]));
     }
     else{
-        auto bool_p = std::make_shared<Ra__Node__Bool_Predicate>();
+        auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
         bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
         for(auto correlating_predicate: correlating_predicates){
-            auto outer_attribute = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(correlating_predicate));
-            auto inner_attribute = std::static_pointer_cast<Ra__Node__Attribute>(std::get<1>(correlating_predicate));
-            auto left = std::make_shared<Ra__Node__Attribute>(inner_attribute->name, cte_name);
-            auto right = std::make_shared<Ra__Node__Attribute>(outer_attribute->name, outer_attribute->alias);
-            bool_p->args.push_back(std::make_shared<Ra__Node__Predicate>(left, right, std::get<2>(correlating_predicate)));
+            auto outer_attribute = static_cast<Ra__Node__Attribute*>(std::get<0>(correlating_predicate));
+            auto inner_attribute = static_cast<Ra__Node__Attribute*>(std::get<1>(correlating_predicate));
+            auto left = arena->make<Ra__Node__Attribute>(inner_attribute->name, cte_name);
+            auto right = arena->make<Ra__Node__Attribute>(outer_attribute->name, outer_attribute->alias);
+            bool_p->args.push_back(arena->make<Ra__Node__Predicate>(left, right, std::get<2>(correlating_predicate)));
         }
         new_subquery_selection->predicate = bool_p;
     }
 
     // 4.1
-    new_subquery_selection->childNodes.push_back(std::make_shared<Ra__Node__Relation>(cte_name));
-    auto new_subquery_projection = std::make_shared<Ra__Node__Projection>();
-    new_subquery_projection->args = std::static_pointer_cast<Ra__Node__Projection>(subquery_projection)->args;
-    // new_subquery_projection->args.push_back(std::make_shared<Ra__Node__Attribute>("*"));
-    new_subquery_projection->childNodes.push_back(new_subquery_selection);
+    new_subquery_selection->add_child(arena->make<Ra__Node__Relation>(cte_name));
+    auto new_subquery_projection = arena->make<Ra__Node__Projection>();
+    new_subquery_projection->args = static_cast<Ra__Node__Projection*>(subquery_projection)->args;
+    // new_subquery_projection->args.push_back(arena->make<Ra__Node__Attribute>("*"));
+    new_subquery_projection->add_child(new_subquery_selection);
     
-    (marker_join.second)->childNodes[1] = new_subquery_projection;
+    (marker_join.second)->set_child(1, new_subquery_projection);
+    // subquery body now lives in the CTE
+    subquery_projection->clear_children();
 }
 
-void RaTree::add_predicate_to_selection(std::shared_ptr<Ra__Node> predicate, std::shared_ptr<Ra__Node> selection){
-    auto sel = std::static_pointer_cast<Ra__Node__Selection>(selection);
+void RaTree::add_predicate_to_selection(Ra__Node* predicate, Ra__Node* selection){
+    auto sel = static_cast<Ra__Node__Selection*>(selection);
     if(sel->predicate==nullptr){
         sel->predicate = predicate;
     }
     else if(sel->predicate->node_case==RA__NODE__BOOL_PREDICATE){
-        auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(sel->predicate);
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(sel->predicate);
         if(bool_p->bool_operator==RA__BOOL_OPERATOR__AND){
             bool_p->args.push_back(predicate);
         }
         else{
-            auto bool_p = std::make_shared<Ra__Node__Bool_Predicate>();
+            auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
             bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
             bool_p->args.push_back(sel->predicate);
             bool_p->args.push_back(predicate);
@@ -243,7 +375,7 @@ void RaTree::add_predicate_to_selection(std::shared_ptr<Ra__Node> predicate, std
     }
     else if(sel->predicate->node_case==RA__NODE__PREDICATE
         || sel->predicate->node_case==RA__NODE__NULL_TEST){
-        auto bool_p = std::make_shared<Ra__Node__Bool_Predicate>();
+        auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
         bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
         bool_p->args.push_back(sel->predicate);
         bool_p->args.push_back(predicate);
@@ -251,8 +383,8 @@ void RaTree::add_predicate_to_selection(std::shared_ptr<Ra__Node> predicate, std
     }
 }
 
-void RaTree::add_predicate_to_join(std::shared_ptr<Ra__Node> predicate, std::shared_ptr<Ra__Node> join_node){
-    auto join = std::static_pointer_cast<Ra__Node__Join>(join_node);
+void RaTree::add_predicate_to_join(Ra__Node* predicate, Ra__Node* join_node){
+    auto join = static_cast<Ra__Node__Join*>(join_node);
     if(join->type==RA__JOIN__CROSS_PRODUCT){
         join->type = RA__JOIN__INNER;
     }
@@ -260,12 +392,12 @@ void RaTree::add_predicate_to_join(std::shared_ptr<Ra__Node> predicate, std::sha
         join->predicate = predicate;
     }
     else if(join->predicate->node_case==RA__NODE__BOOL_PREDICATE){
-        auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(join->predicate);
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(join->predicate);
         if(bool_p->bool_operator==RA__BOOL_OPERATOR__AND){
             bool_p->args.push_back(predicate);
         }
         else{
-            auto bool_p = std::make_shared<Ra__Node__Bool_Predicate>();
+            auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
             bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
             bool_p->args.push_back(join->predicate);
             bool_p->args.push_back(predicate);
@@ -274,7 +406,7 @@ void RaTree::add_predicate_to_join(std::shared_ptr<Ra__Node> predicate, std::sha
     }
     else if(join->predicate->node_case==RA__NODE__PREDICATE
         || join->predicate->node_case==RA__NODE__NULL_TEST){
-        auto bool_p = std::make_shared<Ra__Node__Bool_Predicate>();
+        auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
         bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
         bool_p->args.push_back(join->predicate);
         bool_p->args.push_back(predicate);
@@ -282,10 +414,10 @@ void RaTree::add_predicate_to_join(std::shared_ptr<Ra__Node> predicate, std::sha
     }
 }
 
-bool RaTree::predicate_contains_subquery(std::shared_ptr<Ra__Node> node){
+bool RaTree::predicate_contains_subquery(Ra__Node* node){
     switch(node->node_case){
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(node);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(node);
             bool found_subquery = false;
             for(auto arg: bool_p->args){
                 if(!found_subquery){
@@ -295,7 +427,7 @@ bool RaTree::predicate_contains_subquery(std::shared_ptr<Ra__Node> node){
             return found_subquery;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(node);
+            auto p = static_cast<Ra__Node__Predicate*>(node);
             return predicate_contains_subquery(p->left) || predicate_contains_subquery(p->right);
         }
         case RA__NODE__WHERE_SUBQUERY_MARKER:{
@@ -305,22 +437,24 @@ bool RaTree::predicate_contains_subquery(std::shared_ptr<Ra__Node> node){
     }
 }
 
-bool RaTree::find_lowest_child_insert_selection(const std::pair<std::shared_ptr<Ra__Node>,std::vector<std::string>>& predicate_relations, std::shared_ptr<Ra__Node> selection, bool cp_to_join){
+bool RaTree::find_lowest_child_insert_selection(const std::pair<Ra__Node*,std::vector<Ra__Symbol>>& predicate_relations, Ra__Node* selection, bool cp_to_join){
     // keep pointer to parent, iterate through tree
     // from bottom, check relations and joins for which relations are defined
     // if all relations needed for predicate are defined, add selection above join/relation
         // if parent is already selection
 
     // 1. find if lower node has all relations defined
-    std::shared_ptr<Ra__Node> it = selection->childNodes[0];
-    std::shared_ptr<Ra__Node> child_it = nullptr;
+    Ra__Node* it = selection->childNodes[0];
     if(find_node_where_relations_defined(it, predicate_relations.second)){
-        if(it->node_case==RA__NODE__JOIN && cp_to_join && !predicate_contains_subquery(predicate_relations.first)){
+        // a predicate above an outer join filters its result, in the join predicate it would only restrict matching
+        bool is_outer_join = it->node_case==RA__NODE__JOIN
+            && (static_cast<Ra__Node__Join*>(it)->type==RA__JOIN__LEFT || static_cast<Ra__Node__Join*>(it)->type==RA__JOIN__FULL_OUTER);
+        if(it->node_case==RA__NODE__JOIN && cp_to_join && !is_outer_join && !predicate_contains_subquery(predicate_relations.first)){
             add_predicate_to_join(predicate_relations.first, it);
         }
         else{
             int child_index = -1;
-            std::shared_ptr<Ra__Node> parent = root;
+            Ra__Node* parent = root;
             get_node_parent(parent, it, child_index);
             // 2. insert selection
             if(parent->node_case==RA__NODE__SELECTION){
@@ -329,10 +463,10 @@ bool RaTree::find_lowest_child_insert_selection(const std::pair<std::shared_ptr<
             }
             else{
                 // insert new selection node
-                auto sel = std::make_shared<Ra__Node__Selection>();
+                auto sel = arena->make<Ra__Node__Selection>();
                 sel->predicate = predicate_relations.first;
-                sel->childNodes.push_back(parent->childNodes[child_index]);
-                parent->childNodes[child_index] = sel;
+                sel->add_child(parent->childNodes[child_index]);
+                parent->set_child(child_index, sel);
             }
         }
         return true;
@@ -340,13 +474,23 @@ bool RaTree::find_lowest_child_insert_selection(const std::pair<std::shared_ptr<
     return false;
 }
 
-bool RaTree::find_node_where_relations_defined(std::shared_ptr<Ra__Node>& it, const std::vector<std::string>& relations){
+bool RaTree::find_node_where_relations_defined(Ra__Node*& it, const std::vector<Ra__Symbol>& relations){
     
     // if relations defined here, check if also defined in children
     if(has_relations_defined(it, relations)){
         bool found = false;
-        std::shared_ptr<Ra__Node> temp_this_node = it;
+        Ra__Node* temp_this_node = it;
         auto childNodes = it->childNodes;
+        // rows of a nullable side of an outer join are not filtered below it (null-extended rows would be added instead)
+        if(it->node_case==RA__NODE__JOIN){
+            auto join = static_cast<Ra__Node__Join*>(it);
+            if(join->type==RA__JOIN__LEFT){
+                childNodes.resize(1);
+            }
+            else if(join->type==RA__JOIN__FULL_OUTER){
+                childNodes.clear();
+            }
+        }
         for(int i=0; i<childNodes.size(); i++){
             if(!found){
                 it = childNodes[i];
@@ -364,8 +508,8 @@ bool RaTree::find_node_where_relations_defined(std::shared_ptr<Ra__Node>& it, co
     return false;
 }
 
-bool RaTree::has_relations_defined(std::shared_ptr<Ra__Node> node, const std::vector<std::string>& relations){
-    std::vector<std::pair<std::string,std::string>> defined_relations_aliases;
+bool RaTree::has_relations_defined(Ra__Node* node, const std::vector<Ra__Symbol>& relations){
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> defined_relations_aliases;
     get_relations_aliases(node, defined_relations_aliases);
 
     for(const auto& needed_relation: relations){
@@ -384,117 +528,107 @@ bool RaTree::has_relations_defined(std::shared_ptr<Ra__Node> node, const std::ve
 }
 
 // fill relations vector with all relations referenced by predicate
-void RaTree::get_predicate_relations(std::shared_ptr<Ra__Node> predicate, std::vector<std::string>& relations){
+void RaTree::get_predicate_relations(Ra__Node* predicate, std::vector<Ra__Symbol>& relations){
     switch(predicate->node_case){
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(predicate);
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
             get_expression_relations(p->left, relations);
             get_expression_relations(p->right, relations);
             break;
         }
         case RA__NODE__WHERE_SUBQUERY_MARKER:{
-            auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(predicate);
+            auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(predicate);
             get_expression_relations(marker, relations);
             break;
         }
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(predicate);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
             for(const auto& arg: bool_p->args){
                 get_predicate_relations(arg, relations);
             }
             break;
         }
         case RA__NODE__NULL_TEST:{
-            auto null_test = std::static_pointer_cast<Ra__Node__Null_Test>(predicate);
+            auto null_test = static_cast<Ra__Node__Null_Test*>(predicate);
             get_expression_relations(null_test->arg, relations);
             break;
         }
-        default: std::cout << "node case should not be in split predicates" << std::endl;
+        default: std::cerr << "node case should not be in split predicates" << std::endl;
     }
     
 }
 
-void RaTree::get_expression_relations(std::shared_ptr<Ra__Node> expression, std::vector<std::string>& relations){
+void RaTree::get_expression_relations(Ra__Node* expression, std::vector<Ra__Symbol>& relations){
     switch(expression->node_case){
         case RA__NODE__ATTRIBUTE:{
             relations.push_back(get_relation_from_attribute(expression));
             break;
         }
         case RA__NODE__EXPRESSION:{
-            auto expr = std::static_pointer_cast<Ra__Node__Expression>(expression);
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
             get_expression_relations(expr->l_arg, relations);
             get_expression_relations(expr->r_arg, relations);
             break;
         }
         case RA__NODE__FUNC_CALL:{
-            auto func_call = std::static_pointer_cast<Ra__Node__Func_Call>(expression);
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
             for(const auto& arg: func_call->args){
                 get_expression_relations(arg, relations);
             }
+            for(const auto& arg: func_call->window_partition){
+                get_expression_relations(arg, relations);
+            }
             break;
         }
         case RA__NODE__TYPE_CAST:{
-            auto type_cast = std::static_pointer_cast<Ra__Node__Type_Cast>(expression);
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
             get_expression_relations(type_cast->expression, relations);
             break;
         }
         case RA__NODE__WHERE_SUBQUERY_MARKER:{
-            auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(expression);
-            relations.push_back("marker_"+std::to_string(marker->marker));
+            auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(expression);
+            relations.push_back(symbols->intern("marker_"+std::to_string(marker->marker)));
             break;
         }
         default: break; // const
     }
 }
 
-std::string RaTree::get_relation_from_attribute(std::shared_ptr<Ra__Node> attribute){
-    auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
+Ra__Symbol RaTree::get_relation_from_attribute(Ra__Node* attribute){
+    auto attr = static_cast<Ra__Node__Attribute*>(attribute);
     // if has alias, return alias
-    if(attr->alias.length()>0){
+    if(!attr->alias.empty()){
         return attr->alias;
     }
     else{
-        // if no alias, refer through tpch name
-        return get_tpch_relation_name(attr->name);
+        // if no alias, refer through catalog
+        return get_catalog_relation_name(attr->name);
     }
 }
 
-std::string RaTree::get_tpch_relation_name(std::string attr_name){
-    std::string::size_type pos = attr_name.find('_');
-    std::string attr_prefix = attr_name.substr(0, pos);
-
-    if(attr_prefix=="p"){
-        return "part";
-    }
-    else if(attr_prefix=="s"){
-        return "supplier";
-    }
-    else if(attr_prefix=="ps"){
-        return "partsupp";
+Ra__Symbol RaTree::get_catalog_relation_name(Ra__Symbol attr_name){
+    Ra__Symbol relation = lookup_catalog_relation(attr_name);
+    if(relation.empty() && !reported_missing_attribute){
+        reported_missing_attribute = true;
+        std::cerr << "attribute " << attr_name.str() << " is not in catalog" << std::endl;
     }
-    else if(attr_prefix=="c"){
-        return "customer";
-    }
-    else if(attr_prefix=="n"){
-        return "nation";
-    }
-    else if(attr_prefix=="l"){
-        return "lineitem";
-    }
-    else if(attr_prefix=="r"){
-        return "region";
-    }
-    else if(attr_prefix=="o"){
-        return "orders";
-    }
-    else{
-        std::cout << "attribute is not tpch" << std::endl;
-        return "";
+    return relation;
+}
+
+Ra__Symbol RaTree::lookup_catalog_relation(Ra__Symbol attr_name){
+    auto cached = catalog_relation_names.find(attr_name.id);
+    if(cached!=catalog_relation_names.end()){
+        return cached->second;
     }
+
+    const Ra__Catalog__Table* table = catalog->find_table_of_column(attr_name.str());
+    Ra__Symbol relation = table==nullptr ? Ra__Symbol() : symbols->intern(table->name);
+    catalog_relation_names[attr_name.id] = relation;
+    return relation;
 }
 
 // split by "and"
-void RaTree::split_selection_predicates(std::shared_ptr<Ra__Node> predicate, std::vector<std::pair<std::shared_ptr<Ra__Node>,std::vector<std::string>>>& predicates_relations){
+void RaTree::split_selection_predicates(Ra__Node* predicate, std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>>& predicates_relations){
     switch(predicate->node_case){
         case RA__NODE__WHERE_SUBQUERY_MARKER:
         case RA__NODE__NULL_TEST:
@@ -503,7 +637,7 @@ void RaTree::split_selection_predicates(std::shared_ptr<Ra__Node> predicate, std
             break;
         }
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(predicate);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
             switch(bool_p->bool_operator){
                 case RA__BOOL_OPERATOR__AND:{
                     for(const auto& arg: bool_p->args){
@@ -520,13 +654,13 @@ void RaTree::split_selection_predicates(std::shared_ptr<Ra__Node> predicate, std
             }
             break;
         }
-        default: std::cout << "this node case should not be in selection predicate" << std::endl;
+        default: std::cerr << "this node case should not be in selection predicate" << std::endl;
     }
 }
 
 void RaTree::general_query_unnesting(){
     // find marker in selection
-    std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>> markers_joins; // markers, joins
+    std::vector<std::pair<Ra__Node*, Ra__Node*>> markers_joins; // markers, joins
     
     // 1.
     find_subquery_markers(root, markers_joins, {RA__JOIN__DEPENDENT_INNER_LEFT});
@@ -538,11 +672,15 @@ void RaTree::general_query_unnesting(){
     for(int i=markers_joins.size()-1; i>=0; i--){
         // assert each marker found corresponding join
         assert(markers_joins[i].second!=nullptr);
+        // rows of a subquery with a limit depend on its correlation, it is kept nested
+        if(has_limit(markers_joins[i].second->childNodes[1])){
+            continue;
+        }
         decorrelate_subquery(markers_joins[i]);
     };
 }
 
-void RaTree::decorrelate_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins){
+void RaTree::decorrelate_subquery(std::pair<Ra__Node*, Ra__Node*> markers_joins){
 
     // 0. Replace selection marker with produced attribute
     // 1. replace dep join with inner join, remove marker
@@ -555,7 +693,7 @@ void RaTree::decorrelate_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shar
         // 2.2 in right child, replace all outer query aliases with d
     // 3. push down dep join
         // 3.1 convert dep join to cp
-    // 4. Decouple (if possible: only correlated equi predicates (no expressions supported))
+    // 4. Decouple (if possible: only correlated equi predicates (no expressions supported), and if estimated to be cheaper)
         // 4.1 remove join 
         // 4.2 rename all d attribute alias to their original alias (whole right side)
         // 4.3 remove a=a predicates
@@ -567,15 +705,15 @@ void RaTree::decorrelate_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shar
         // 5.5 go through whole tree, rename all attributes with CTE relations/alises
 
     // 0. replace selection marker with produced attribute
-    std::shared_ptr<Ra__Node> it = root;
-    auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(markers_joins.first);
+    Ra__Node* it = root;
+    auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(markers_joins.first);
     int child_index = -1;
-    std::string subquery_alias = "t" + std::to_string(counter++);
+    Ra__Symbol subquery_alias = symbols->intern("t" + std::to_string(counter++));
     assert(find_marker_parent(it, marker, child_index));
-    replace_subquery_marker(it, child_index, std::make_shared<Ra__Node__Attribute>("m",subquery_alias));
+    replace_subquery_marker(it, child_index, arena->make<Ra__Node__Attribute>(symbols->intern("m"),subquery_alias));
     
     // 1.
-    auto original_dep_join = std::static_pointer_cast<Ra__Node__Join>(markers_joins.second);
+    auto original_dep_join = static_cast<Ra__Node__Join*>(markers_joins.second);
     original_dep_join->type = RA__JOIN__CROSS_PRODUCT;
     original_dep_join->right_where_subquery_marker->marker = 0;
 
@@ -583,64 +721,67 @@ void RaTree::decorrelate_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shar
     assert(original_dep_join->predicate==nullptr);
 
     // 1.2
-    auto right_projection = std::static_pointer_cast<Ra__Node__Projection>(original_dep_join->childNodes[1]);
+    auto right_projection = static_cast<Ra__Node__Projection*>(original_dep_join->childNodes[1]);
     right_projection->subquery_alias = subquery_alias;
     right_projection->subquery_columns.push_back("m"); 
 
     // 2.
-    auto dep_join = std::make_shared<Ra__Node__Join>(RA__JOIN__DEPENDENT_INNER_LEFT);
+    auto dep_join = arena->make<Ra__Node__Join>(RA__JOIN__DEPENDENT_INNER_LEFT);
     dep_join->childNodes.resize(2);
-    dep_join->childNodes[1] = right_projection->childNodes[0];
-    right_projection->childNodes[0] = dep_join;
+    dep_join->set_child(1, right_projection->childNodes[0]);
+    right_projection->set_child(0, dep_join);
 
     // add selection above original dep join for the join predicate (using cross product)
     child_index = -1;
-    std::shared_ptr<Ra__Node> original_dep_join_selection = root;
+    Ra__Node* original_dep_join_selection = root;
     assert(get_node_parent(original_dep_join_selection, original_dep_join, child_index));
     if(original_dep_join_selection->node_case!=RA__NODE__SELECTION){
-        auto sel = std::make_shared<Ra__Node__Selection>();
-        sel->childNodes.push_back(original_dep_join_selection->childNodes[child_index]);
-        original_dep_join_selection->childNodes[child_index] = sel;
+        auto sel = arena->make<Ra__Node__Selection>();
+        sel->add_child(original_dep_join_selection->childNodes[child_index]);
+        original_dep_join_selection->set_child(child_index, sel);
     }
 
     // 2.1
-    auto d_projection = std::make_shared<Ra__Node__Projection>();
-    d_projection->childNodes.push_back(original_dep_join->childNodes[0]);
-    d_projection->subquery_alias = "d";
-    dep_join->childNodes[0] = d_projection;
+    auto d_projection = arena->make<Ra__Node__Projection>();
+    d_projection->add_child(original_dep_join->childNodes[0]);
+    d_projection->subquery_alias = symbol_d;
+    // D is duplicate free, joining it must not multiply the rows aggregated by the subquery
+    d_projection->distinct = true;
+    dep_join->set_child(0, d_projection);
     auto correlated_attributes = intersect_correlated_attributes(dep_join->childNodes[0],dep_join->childNodes[1]->childNodes[0]);
-    std::vector<std::string> temp_duplicate_tracker;
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> temp_duplicate_tracker;
     for(auto& correlated_attribute: correlated_attributes){
-        auto attr = std::static_pointer_cast<Ra__Node__Attribute>(correlated_attribute);
+        auto attr = static_cast<Ra__Node__Attribute*>(correlated_attribute);
 
         // duplicate check
-        if(std::find(temp_duplicate_tracker.begin(),temp_duplicate_tracker.end(),attr->alias+attr->name)==temp_duplicate_tracker.end()){
-            temp_duplicate_tracker.push_back(attr->alias+attr->name);
+        if(std::find(temp_duplicate_tracker.begin(),temp_duplicate_tracker.end(),std::pair<Ra__Symbol,Ra__Symbol>(attr->alias,attr->name))==temp_duplicate_tracker.end()){
+            temp_duplicate_tracker.push_back({attr->alias,attr->name});
 
-            right_projection->args.push_back(std::make_shared<Ra__Node__Attribute>(attr->name, "d"));
+            right_projection->args.push_back(arena->make<Ra__Node__Attribute>(attr->name, symbol_d));
         
             // 2.1.2
-            d_projection->args.push_back(std::make_shared<Ra__Node__Attribute>(attr->name));
-            d_projection->subquery_columns.push_back(attr->name);
+            d_projection->args.push_back(arena->make<Ra__Node__Attribute>(attr->name));
+            d_projection->subquery_columns.push_back(attr->name.str());
 
             // 1.1 
-            add_predicate_to_selection(std::make_shared<Ra__Node__Predicate>(std::make_shared<Ra__Node__Attribute>(attr->name, attr->alias),std::make_shared<Ra__Node__Attribute>(subquery_alias+"_"+attr->name, subquery_alias),"="), original_dep_join_selection);
-            right_projection->subquery_columns.push_back(subquery_alias+"_"+attr->name);
+            std::string produced_column = subquery_alias.str()+"_"+attr->name.str();
+            add_predicate_to_selection(arena->make<Ra__Node__Predicate>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias),arena->make<Ra__Node__Attribute>(symbols->intern(produced_column), subquery_alias),"="), original_dep_join_selection);
+            right_projection->subquery_columns.push_back(produced_column);
         }
         
         // 2.2
-        attr->alias = "d";
+        attr->alias = symbol_d;
     }
 
     // pushing down
         // queue of dep joins
         // while not empty -> push down dep join
         // when done pushing down a dep join, add to vector, pop from queue
-    std::vector<std::shared_ptr<Ra__Node__Join>> dep_joins_vector;
-    std::queue<std::shared_ptr<Ra__Node__Join>> push_down_dep_joins_queue; 
+    std::vector<Ra__Node__Join*> dep_joins_vector;
+    std::queue<Ra__Node__Join*> push_down_dep_joins_queue; 
     push_down_dep_joins_queue.push(dep_join);
     while(!push_down_dep_joins_queue.empty()){
-        std::shared_ptr<Ra__Node__Join> dep_join_ = push_down_dep_joins_queue.front();
+        Ra__Node__Join* dep_join_ = push_down_dep_joins_queue.front();
         while(!intersect_correlated_attributes(dep_join_->childNodes[0],dep_join_->childNodes[1]).empty()){
             // DONE: change push_down to take dep join and find parent inside the function
             // DONE: add push_down takes dep_join_queue
@@ -657,120 +798,194 @@ void RaTree::decorrelate_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shar
         // decouple if possible: check "d" predicates going up to first parent projection
         // set flag if can't decouple
     bool cte_already_setup = false;
-    std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>> rename_d_attributes;
+    std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>> rename_d_attributes;
     for(auto dep_join_: dep_joins_vector){
         dep_join_->type = RA__JOIN__CROSS_PRODUCT;
 
         // find dep join parent
         int dep_join_parent_child_id = 0;
-        std::shared_ptr<Ra__Node> dep_join_parent = right_projection;
+        Ra__Node* dep_join_parent = right_projection;
         assert(get_node_parent(dep_join_parent, dep_join_, dep_join_parent_child_id));
 
         // find parent projection of dep join 
-        std::shared_ptr<Ra__Node> parent_projection = right_projection;
-        std::shared_ptr<Ra__Node> find_parent_of = dep_join_parent->childNodes[dep_join_parent_child_id];
+        Ra__Node* parent_projection = dep_join_parent->childNodes[dep_join_parent_child_id];
         int child_index;
-        while(get_node_parent(parent_projection, find_parent_of, child_index)){
+        while(Ra__Node* parent = get_parent(parent_projection, right_projection, child_index)){
+            parent_projection = parent;
             if(parent_projection->node_case==RA__NODE__PROJECTION){
                 break;
             }
-            find_parent_of = parent_projection;
-            parent_projection = right_projection;
         }
 
-        if(decouple && can_decouple(dep_join_, parent_projection, rename_d_attributes)){
+        if(decouple_strategy!=RA__DECOUPLE__NEVER && can_decouple(dep_join_, parent_projection, rename_d_attributes)
+            && (decouple_strategy==RA__DECOUPLE__ALWAYS || is_decoupling_cheaper(d_projection, original_dep_join->childNodes[0]))){
 
             // remove join
-            dep_join_parent->childNodes[dep_join_parent_child_id] = dep_join_parent->childNodes[dep_join_parent_child_id]->childNodes[1];
+            Ra__Node* decoupled_input = dep_join_->childNodes[1];
+            dep_join_parent->set_child(dep_join_parent_child_id, decoupled_input);
+            dep_join_->clear_children();
 
             // 4.2
             rename_attributes(parent_projection, rename_d_attributes);
 
             // 4.3
-            std::vector<std::shared_ptr<Ra__Node>> selections;
+            std::vector<Ra__Node*> selections;
             get_all_selections(parent_projection, selections);
             for(auto& sel: selections){
                 remove_redundant_predicates(sel, sel);
             } 
+
+            // 4.4 magic set: restrict the decoupled subquery to the correlation values of a selective outer query
+            // (4.3 may have removed the parent selection)
+            Ra__Node* decoupled_input_parent = right_projection;
+            int decoupled_input_child_id = -1;
+            if(decouple_strategy==RA__DECOUPLE__COST_BASED && get_node_parent(decoupled_input_parent, decoupled_input, decoupled_input_child_id)
+                && add_magic_set_filter(decoupled_input_parent, decoupled_input_child_id, original_dep_join, d_projection, rename_d_attributes, cte_already_setup)){
+                cte_already_setup = true;
+            }
         }
         // run through can't-decouple sequence: create CTE, point d_projection to CTE
         else{
-            if(cte_already_setup){
-
-            }
-            else{
+            if(!cte_already_setup){
                 cte_already_setup = true;
-                // 5.1
-                auto cte_projection = std::make_shared<Ra__Node__Projection>();
-                cte_projection->childNodes.push_back(original_dep_join->childNodes[0]);
-                std::string cte_name = "cte_" + std::to_string(counter++);
-                cte_projection->subquery_alias = cte_name;
-                ctes.push_back(cte_projection);
-
-                // 5.2
-                std::vector<std::pair<std::string, std::string>> cte_relations_aliases;
-                get_relations_aliases(cte_projection->childNodes[0], cte_relations_aliases);
-
-                // 5.4
-                original_dep_join->childNodes[0] = std::make_shared<Ra__Node__Relation>(cte_name);
-                d_projection->childNodes[0] = original_dep_join->childNodes[0];
-
-                // 5.3
-                std::vector<std::shared_ptr<Ra__Node>> attributes;
-                // extract either alias or relation
-                std::vector<std::string> cte_aliases;
-                for(const auto& cte_relation_alias: cte_relations_aliases){
-                    // relation has alias
-                    if(cte_relation_alias.second!=""){
-                        cte_aliases.push_back(cte_relation_alias.second);
-                    }
-                    // relation has no alias
-                    else{
-                        cte_aliases.push_back(cte_relation_alias.first);
-                    }
-                }
-                find_attributes_using_alias(this->root, cte_aliases, attributes);
-                std::vector<std::string> temp_select_attr_tracker;
-                for(auto attribute: attributes){
-                    auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-                    if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),attr->alias+attr->name)==temp_select_attr_tracker.end()){
-                        temp_select_attr_tracker.push_back(attr->alias+attr->name);
-                        cte_projection->args.push_back(std::make_shared<Ra__Node__Select_Expression>(std::make_shared<Ra__Node__Attribute>(attr->name, attr->alias)));
-                    }
-                    // attr->alias = cte_name;
-                }
-
-                // 5.5
-                std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>> rename_map;
-                for(const auto& cte_relation_alias: cte_relations_aliases){
-                    // relation has alias
-                    if(cte_relation_alias.second!=""){
-                        rename_map[{cte_relation_alias.second,""}] = {cte_name,""};
-                    }
-                    // relation has no alias
-                    else{
-                        rename_map[{cte_relation_alias.first,""}] = {cte_name,""};
-                    }
-                }
-                rename_attributes(root, rename_map);
+                materialize_outer_as_cte(original_dep_join, d_projection);
             }
         }
     }
 }
 
-void RaTree::find_attributes_using_alias(std::shared_ptr<Ra__Node> it, std::vector<std::string>& aliases, std::vector<std::shared_ptr<Ra__Node>>& attributes, std::shared_ptr<Ra__Node> stop_node, bool incl_stop_node){
+Ra__Symbol RaTree::materialize_outer_as_cte(Ra__Node__Join* original_dep_join, Ra__Node__Projection* d_projection){
+    // 5.1
+    auto cte_projection = arena->make<Ra__Node__Projection>();
+    cte_projection->add_child(original_dep_join->childNodes[0]);
+    Ra__Symbol cte_name = symbols->intern("cte_" + std::to_string(counter++));
+    cte_projection->subquery_alias = cte_name;
+    ctes.push_back(cte_projection);
+
+    // 5.2
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> cte_relations_aliases;
+    get_relations_aliases(cte_projection->childNodes[0], cte_relations_aliases);
+
+    // 5.4
+    original_dep_join->set_child(0, arena->make<Ra__Node__Relation>(cte_name));
+    d_projection->set_child(0, original_dep_join->childNodes[0]);
+
+    // 5.3
+    std::vector<Ra__Node*> attributes;
+    // extract either alias or relation
+    std::vector<Ra__Symbol> cte_aliases;
+    for(const auto& cte_relation_alias: cte_relations_aliases){
+        // relation has alias
+        if(!cte_relation_alias.second.empty()){
+            cte_aliases.push_back(cte_relation_alias.second);
+        }
+        // relation has no alias
+        else{
+            cte_aliases.push_back(cte_relation_alias.first);
+        }
+    }
+    // unqualified attributes are found by the relation names, also of relations with alias (o_orderkey of "orders o")
+    std::vector<Ra__Symbol> cte_aliases_relations = cte_aliases;
+    for(const auto& cte_relation_alias: cte_relations_aliases){
+        cte_aliases_relations.push_back(cte_relation_alias.first);
+    }
+    find_attributes_using_alias(this->root, cte_aliases_relations, attributes);
+    // CTE columns keep the attribute names, attributes of different outer relations with the same name use the same column
+    std::vector<Ra__Symbol> temp_select_attr_tracker;
+    for(auto attribute: attributes){
+        auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+        bool is_outer_attribute = attr->alias.empty() || std::find(cte_aliases.begin(),cte_aliases.end(),attr->alias)!=cte_aliases.end();
+        if(is_outer_attribute && std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),attr->name)==temp_select_attr_tracker.end()){
+            temp_select_attr_tracker.push_back(attr->name);
+            cte_projection->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias)));
+        }
+    }
+
+    // 5.5
+    std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>> rename_map;
+    for(const auto& cte_relation_alias: cte_relations_aliases){
+        // relation has alias
+        if(!cte_relation_alias.second.empty()){
+            rename_map[{cte_relation_alias.second,Ra__Symbol()}] = {cte_name,Ra__Symbol()};
+        }
+        // relation has no alias
+        else{
+            rename_map[{cte_relation_alias.first,Ra__Symbol()}] = {cte_name,Ra__Symbol()};
+        }
+    }
+    rename_attributes(root, rename_map);
+
+    return cte_name;
+}
+
+bool RaTree::add_magic_set_filter(Ra__Node* inner_parent, int child_index, Ra__Node__Join* original_dep_join, Ra__Node__Projection* d_projection, const std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& d_rename_map, bool cte_already_setup){
+    Ra__Node* inner = inner_parent->childNodes[child_index];
+
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> inner_relations_aliases;
+    get_relations_aliases(inner, inner_relations_aliases);
+    std::vector<Ra__Symbol> inner_aliases;
+    for(const auto& inner_relation_alias: inner_relations_aliases){
+        inner_aliases.push_back(inner_relation_alias.second.empty() ? inner_relation_alias.first : inner_relation_alias.second);
+    }
+
+    // correlation keys: D attributes and their equivalent attributes, if defined in the subquery input
+    std::vector<std::pair<Ra__Node*,Ra__Node*>> keys;
+    for(auto arg: d_projection->args){
+        auto d_attr = static_cast<Ra__Node__Attribute*>(arg);
+        auto rename = d_rename_map.find({symbol_d, d_attr->name});
+        if(rename==d_rename_map.end()){
+            continue;
+        }
+        auto inner_attr = arena->make<Ra__Node__Attribute>(rename->second.second, rename->second.first);
+        std::vector<Ra__Node*> inner_attributes;
+        find_attributes_using_alias(inner_attr, inner_aliases, inner_attributes);
+        if(!inner_attributes.empty()){
+            keys.push_back({d_attr, inner_attr});
+        }
+    }
+
+    auto magic_keys = select_magic_set_keys(inner, keys, original_dep_join->childNodes[0]);
+    if(magic_keys.empty()){
+        return false;
+    }
+
+    // the outer query is computed once and used by the magic set filters
+    Ra__Symbol cte_name = cte_already_setup ? static_cast<Ra__Node__Relation*>(original_dep_join->childNodes[0])->name
+        : materialize_outer_as_cte(original_dep_join, d_projection);
+
+    // σ(key_1 in Π(cte) and ... and key_n in Π(cte))(inner)
+    auto magic_selection = arena->make<Ra__Node__Selection>();
+    inner_parent->set_child(child_index, magic_selection);
+    Ra__Node* magic_input = inner;
+    for(auto i: magic_keys){
+        auto magic_projection = arena->make<Ra__Node__Projection>();
+        magic_projection->args.push_back(arena->make<Ra__Node__Attribute>(static_cast<Ra__Node__Attribute*>(keys[i].first)->name));
+        magic_projection->add_child(arena->make<Ra__Node__Relation>(cte_name));
+
+        auto magic_join = arena->make<Ra__Node__Join>(RA__JOIN__IN_LEFT, ++counter);
+        magic_join->predicate = arena->make<Ra__Node__Predicate>(keys[i].second);
+        magic_join->add_child(magic_input);
+        magic_join->add_child(magic_projection);
+        add_predicate_to_selection(magic_join->right_where_subquery_marker, magic_selection);
+        magic_input = magic_join;
+    }
+    magic_selection->add_child(magic_input);
+    return true;
+}
+
+void RaTree::find_attributes_using_alias(Ra__Node* it, const std::vector<Ra__Symbol>& aliases, std::vector<Ra__Node*>& attributes, Ra__Node* stop_node, bool incl_stop_node){
     if(it==stop_node && !incl_stop_node){
         return;
     }
     switch(it->node_case){
         case RA__NODE__ATTRIBUTE:{
-            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(it);
+            auto attr = static_cast<Ra__Node__Attribute*>(it);
             if(std::find(aliases.begin(),aliases.end(),attr->alias)!=aliases.end()){
                 attributes.push_back(it);
             }
-            else if(attr->alias==""){ 
+            else if(attr->alias.empty()){ 
                 for(const auto& alias: aliases){
-                    if(is_tpch_attribute(attr->name, alias)){
+                    if(is_catalog_attribute(attr->name, alias)){
                         attributes.push_back(it);
                         break;
                     }
@@ -779,74 +994,122 @@ void RaTree::find_attributes_using_alias(std::shared_ptr<Ra__Node> it, std::vect
             break;
         }
         case RA__NODE__FUNC_CALL:{
-            auto func_call = std::static_pointer_cast<Ra__Node__Func_Call>(it);
+            auto func_call = static_cast<Ra__Node__Func_Call*>(it);
             for(auto& arg: func_call->args){
                 find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
             }
+            for(auto& arg: func_call->window_partition){
+                find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
+            }
             break;
         }
         case RA__NODE__PROJECTION:{
-            auto p = std::static_pointer_cast<Ra__Node__Projection>(it);
+            auto p = static_cast<Ra__Node__Projection*>(it);
             for(auto& arg: p->args){
                 find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
             }
             break;
         }
         case RA__NODE__SELECTION:{
-            auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
+            auto sel = static_cast<Ra__Node__Selection*>(it);
             find_attributes_using_alias(sel->predicate, aliases, attributes, stop_node, incl_stop_node);
             break;
         }
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(it);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(it);
             for(auto& arg: bool_p->args){
                 find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
             }
             break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(it);
+            auto p = static_cast<Ra__Node__Predicate*>(it);
             find_attributes_using_alias(p->left, aliases, attributes, stop_node, incl_stop_node);
             find_attributes_using_alias(p->right, aliases, attributes, stop_node, incl_stop_node);
             break;
         }
         case RA__NODE__GROUP_BY:{
-            auto group_by = std::static_pointer_cast<Ra__Node__Group_By>(it);
+            auto group_by = static_cast<Ra__Node__Group_By*>(it);
             for(auto& arg: group_by->args){
                 find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
             }
             break;
         }
         case RA__NODE__JOIN:{
-            auto join = std::static_pointer_cast<Ra__Node__Join>(it);
+            auto join = static_cast<Ra__Node__Join*>(it);
             if(join->predicate!=nullptr){
                 find_attributes_using_alias(join->predicate, aliases, attributes, stop_node, incl_stop_node);
             }
             break;
         }
         case RA__NODE__SELECT_EXPRESSION:{
-            auto sel_expr = std::static_pointer_cast<Ra__Node__Select_Expression>(it);
+            auto sel_expr = static_cast<Ra__Node__Select_Expression*>(it);
             find_attributes_using_alias(sel_expr->expression, aliases, attributes, stop_node, incl_stop_node);
             break;
         }
         case RA__NODE__ORDER_BY:{
-            auto order_by = std::static_pointer_cast<Ra__Node__Order_By>(it);
+            auto order_by = static_cast<Ra__Node__Order_By*>(it);
             for(auto& arg: order_by->args){
                 find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
             }
             break;
         }
         case RA__NODE__EXPRESSION:{
-            auto expr = std::static_pointer_cast<Ra__Node__Expression>(it);
+            auto expr = static_cast<Ra__Node__Expression*>(it);
             find_attributes_using_alias(expr->l_arg, aliases, attributes, stop_node, incl_stop_node);
             find_attributes_using_alias(expr->r_arg, aliases, attributes, stop_node, incl_stop_node);
             break;
         }
         case RA__NODE__TYPE_CAST:{
-            auto type_cast = std::static_pointer_cast<Ra__Node__Type_Cast>(it);
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(it);
             find_attributes_using_alias(type_cast->expression, aliases, attributes, stop_node, incl_stop_node);
             break;
         }
+        case RA__NODE__NULL_TEST:{
+            auto null_test = static_cast<Ra__Node__Null_Test*>(it);
+            find_attributes_using_alias(null_test->arg, aliases, attributes, stop_node, incl_stop_node);
+            break;
+        }
+        case RA__NODE__LIST:{
+            auto list = static_cast<Ra__Node__List*>(it);
+            for(auto& arg: list->args){
+                find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
+            }
+            break;
+        }
+        case RA__NODE__IN_LIST:{
+            auto in_list = static_cast<Ra__Node__In_List*>(it);
+            for(auto& arg: in_list->args){
+                find_attributes_using_alias(arg, aliases, attributes, stop_node, incl_stop_node);
+            }
+            break;
+        }
+        case RA__NODE__CASE_EXPR:{
+            auto case_expr = static_cast<Ra__Node__Case_Expr*>(it);
+            for(auto case_when: case_expr->args){
+                find_attributes_using_alias(case_when->when, aliases, attributes, stop_node, incl_stop_node);
+                find_attributes_using_alias(case_when->then, aliases, attributes, stop_node, incl_stop_node);
+            }
+            if(case_expr->else_default!=nullptr){
+                find_attributes_using_alias(case_expr->else_default, aliases, attributes, stop_node, incl_stop_node);
+            }
+            break;
+        }
+        case RA__NODE__HAVING:{
+            auto having = static_cast<Ra__Node__Having*>(it);
+            find_attributes_using_alias(having->predicate, aliases, attributes, stop_node, incl_stop_node);
+            break;
+        }
+        case RA__NODE__LIMIT:{
+            auto limit = static_cast<Ra__Node__Limit*>(it);
+            if(limit->count!=nullptr){
+                find_attributes_using_alias(limit->count, aliases, attributes, stop_node, incl_stop_node);
+            }
+            if(limit->offset!=nullptr){
+                find_attributes_using_alias(limit->offset, aliases, attributes, stop_node, incl_stop_node);
+            }
+            break;
+        }
         default: {
             return;
         }
@@ -859,31 +1122,51 @@ void RaTree::find_attributes_using_alias(std::shared_ptr<Ra__Node> it, std::vect
     }
 }
 
-void RaTree::remove_redundant_predicates(std::shared_ptr<Ra__Node>& predicate, std::shared_ptr<Ra__Node>& predicate_parent){
+void RaTree::remove_duplicate_predicates(std::vector<Ra__Node*>& predicates){
+    invalidate_hashes();
+    std::unordered_map<size_t, std::vector<Ra__Node*>> kept_predicates;
+    predicates.erase(
+        std::remove_if(predicates.begin(), predicates.end(), [&](Ra__Node* predicate){
+            auto& same_hash = kept_predicates[hash_subtree(predicate)];
+            for(auto kept_predicate: same_hash){
+                if(is_same_subtree(kept_predicate, predicate)){
+                    return true;
+                }
+            }
+            same_hash.push_back(predicate);
+            return false;
+        }),
+        predicates.end()
+    );
+}
+
+void RaTree::remove_redundant_predicates(Ra__Node*& predicate, Ra__Node*& predicate_parent){
     switch(predicate->node_case){
         case RA__NODE__SELECTION:{
-            auto sel = std::static_pointer_cast<Ra__Node__Selection>(predicate);
+            auto sel = static_cast<Ra__Node__Selection*>(predicate);
             remove_redundant_predicates(sel->predicate, predicate);
             if(sel->predicate==nullptr){
-                std::shared_ptr<Ra__Node> sel_parent = root;
+                Ra__Node* sel_parent = root;
                 int child_index = -1;
                 assert(get_node_parent(sel_parent, sel, child_index));
-                sel_parent->childNodes[child_index] = sel->childNodes[0];
-                sel->childNodes.clear();
+                sel_parent->set_child(child_index, sel->childNodes[0]);
+                sel->clear_children();
             }
             break;
         }
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(predicate);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
             for(auto& arg: bool_p->args){
                 // sets predicates to nullptr
                 remove_redundant_predicates(arg, predicate);
             }
             // remove all nullptr predicates
             bool_p->args.erase(
-                std::remove_if(bool_p->args.begin(),bool_p->args.end(),[](std::shared_ptr<Ra__Node> const& p){return p==nullptr;}), 
+                std::remove_if(bool_p->args.begin(),bool_p->args.end(),[](Ra__Node* const& p){return p==nullptr;}), 
                 bool_p->args.end()
             );
+            // "and"/"or" of equal predicates is the predicate
+            remove_duplicate_predicates(bool_p->args);
             // if only 1 predicate left, turn into normal predicate
             if(bool_p->args.size()==1){
                 predicate_parent = bool_p->args[0];
@@ -895,10 +1178,10 @@ void RaTree::remove_redundant_predicates(std::shared_ptr<Ra__Node>& predicate, s
             break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(predicate);
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
             if(p->left->node_case==RA__NODE__ATTRIBUTE && p->right->node_case==RA__NODE__ATTRIBUTE){
-                auto attr_l = std::static_pointer_cast<Ra__Node__Attribute>(p->left);
-                auto attr_r = std::static_pointer_cast<Ra__Node__Attribute>(p->right);
+                auto attr_l = static_cast<Ra__Node__Attribute*>(p->left);
+                auto attr_r = static_cast<Ra__Node__Attribute*>(p->right);
                 if(attr_l->name==attr_r->name && attr_l->alias==attr_r->alias){
                     predicate = nullptr;
                 }
@@ -910,14 +1193,14 @@ void RaTree::remove_redundant_predicates(std::shared_ptr<Ra__Node>& predicate, s
 }
 
 // rename attributes in projection and selection
-void RaTree::rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>> rename_map, std::shared_ptr<Ra__Node> stop_node){
+void RaTree::rename_attributes(Ra__Node* it, const std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& rename_map, Ra__Node* stop_node){
     if(it==stop_node){
         return;
     }
     
     switch(it->node_case){
         case RA__NODE__ATTRIBUTE:{
-            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(it);
+            auto attr = static_cast<Ra__Node__Attribute*>(it);
             auto rename = rename_map.find({attr->alias,attr->name});
             if(rename!=rename_map.end()){
                 attr->alias = rename->second.first;
@@ -925,7 +1208,7 @@ void RaTree::rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<
             }
             else{
                 // rename alias of attribute
-                auto rename_all = rename_map.find({attr->alias,""});
+                auto rename_all = rename_map.find({attr->alias,Ra__Symbol()});
                 if(rename_all!=rename_map.end()){
                     attr->alias = rename_all->second.first;
                 }
@@ -933,14 +1216,17 @@ void RaTree::rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<
             break;
         }
         case RA__NODE__FUNC_CALL:{
-            auto func_call = std::static_pointer_cast<Ra__Node__Func_Call>(it);
+            auto func_call = static_cast<Ra__Node__Func_Call*>(it);
             for(auto& arg: func_call->args){
                 rename_attributes(arg, rename_map, stop_node);
             }
+            for(auto& arg: func_call->window_partition){
+                rename_attributes(arg, rename_map, stop_node);
+            }
             break;
         }
         case RA__NODE__PROJECTION:{
-            auto p = std::static_pointer_cast<Ra__Node__Projection>(it);
+            auto p = static_cast<Ra__Node__Projection*>(it);
             for(auto& arg: p->args){
                 rename_attributes(arg, rename_map, stop_node);
             }
@@ -948,26 +1234,26 @@ void RaTree::rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<
             break;
         }
         case RA__NODE__SELECTION:{
-            auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
+            auto sel = static_cast<Ra__Node__Selection*>(it);
             rename_attributes(sel->predicate, rename_map, stop_node);
             rename_attributes(sel->childNodes[0], rename_map, stop_node);
             break;
         }
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(it);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(it);
             for(auto& arg: bool_p->args){
                 rename_attributes(arg, rename_map, stop_node);
             }
             break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(it);
+            auto p = static_cast<Ra__Node__Predicate*>(it);
             rename_attributes(p->left, rename_map, stop_node);
             rename_attributes(p->right, rename_map, stop_node);
             break;
         }
         case RA__NODE__GROUP_BY:{
-            auto group_by = std::static_pointer_cast<Ra__Node__Group_By>(it);
+            auto group_by = static_cast<Ra__Node__Group_By*>(it);
             for(auto& arg: group_by->args){
                 rename_attributes(arg, rename_map, stop_node);
             }
@@ -975,7 +1261,7 @@ void RaTree::rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<
             break;
         }
         case RA__NODE__JOIN:{
-            auto join = std::static_pointer_cast<Ra__Node__Join>(it);
+            auto join = static_cast<Ra__Node__Join*>(it);
             if(join->predicate!=nullptr){
                 rename_attributes(join->predicate, rename_map, stop_node);
             }
@@ -984,57 +1270,117 @@ void RaTree::rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<
             break;
         }
         case RA__NODE__SELECT_EXPRESSION:{
-            auto sel_expr = std::static_pointer_cast<Ra__Node__Select_Expression>(it);
+            auto sel_expr = static_cast<Ra__Node__Select_Expression*>(it);
             rename_attributes(sel_expr->expression, rename_map, stop_node);
             break;
         }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(it);
+            if(expr->l_arg!=nullptr){
+                rename_attributes(expr->l_arg, rename_map, stop_node);
+            }
+            if(expr->r_arg!=nullptr){
+                rename_attributes(expr->r_arg, rename_map, stop_node);
+            }
+            break;
+        }
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(it);
+            rename_attributes(type_cast->expression, rename_map, stop_node);
+            break;
+        }
+        case RA__NODE__NULL_TEST:{
+            auto null_test = static_cast<Ra__Node__Null_Test*>(it);
+            rename_attributes(null_test->arg, rename_map, stop_node);
+            break;
+        }
+        case RA__NODE__LIST:{
+            auto list = static_cast<Ra__Node__List*>(it);
+            for(auto& arg: list->args){
+                rename_attributes(arg, rename_map, stop_node);
+            }
+            break;
+        }
+        case RA__NODE__IN_LIST:{
+            auto in_list = static_cast<Ra__Node__In_List*>(it);
+            for(auto& arg: in_list->args){
+                rename_attributes(arg, rename_map, stop_node);
+            }
+            break;
+        }
+        case RA__NODE__CASE_EXPR:{
+            auto case_expr = static_cast<Ra__Node__Case_Expr*>(it);
+            for(auto case_when: case_expr->args){
+                rename_attributes(case_when->when, rename_map, stop_node);
+                rename_attributes(case_when->then, rename_map, stop_node);
+            }
+            if(case_expr->else_default!=nullptr){
+                rename_attributes(case_expr->else_default, rename_map, stop_node);
+            }
+            break;
+        }
+        case RA__NODE__ORDER_BY:{
+            auto order_by = static_cast<Ra__Node__Order_By*>(it);
+            for(auto& arg: order_by->args){
+                rename_attributes(arg, rename_map, stop_node);
+            }
+            rename_attributes(order_by->childNodes[0], rename_map, stop_node);
+            break;
+        }
+        case RA__NODE__HAVING:{
+            auto having = static_cast<Ra__Node__Having*>(it);
+            rename_attributes(having->predicate, rename_map, stop_node);
+            rename_attributes(having->childNodes[0], rename_map, stop_node);
+            break;
+        }
+        case RA__NODE__LIMIT:{
+            auto limit = static_cast<Ra__Node__Limit*>(it);
+            if(limit->count!=nullptr){
+                rename_attributes(limit->count, rename_map, stop_node);
+            }
+            if(limit->offset!=nullptr){
+                rename_attributes(limit->offset, rename_map, stop_node);
+            }
+            rename_attributes(limit->childNodes[0], rename_map, stop_node);
+            break;
+        }
         default: return;
     }
 }
 
 // only has equivalent class if has an equi predicate in a top level "and" bool predicate
-bool RaTree::has_equivalent_attribute(std::shared_ptr<Ra__Node> attribute, std::shared_ptr<Ra__Node> predicate, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>>& d_rename_map){
+void RaTree::get_equivalent_attributes(Ra__Node* predicate, std::unordered_map<uint32_t, std::pair<Ra__Symbol,Ra__Symbol>>& equivalent_attributes){
     switch(predicate->node_case){
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(predicate);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
             if(bool_p->bool_operator==RA__BOOL_OPERATOR__AND){
-                bool found_equivalence_class = false;
                 for(const auto& arg: bool_p->args){
-                    if(!found_equivalence_class){
-                        found_equivalence_class = has_equivalent_attribute(attribute, arg, d_rename_map);
-                    }
+                    get_equivalent_attributes(arg, equivalent_attributes);
                 }
-                return found_equivalence_class;
-            }
-            else{
-                return false;
             }
+            break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(predicate);
-            auto attr_d = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
             if(p->binaryOperator=="=" && p->left->node_case==RA__NODE__ATTRIBUTE && p->right->node_case==RA__NODE__ATTRIBUTE){
-                auto attr_l = std::static_pointer_cast<Ra__Node__Attribute>(p->left);
-                auto attr_r = std::static_pointer_cast<Ra__Node__Attribute>(p->right);
-                if((attr_l->alias=="d" && attr_l->name==attr_d->name && attr_r->alias!="d")){
-                    d_rename_map[{"d",attr_d->name}] = {attr_r->alias,attr_r->name};
-                    return true;
+                auto attr_l = static_cast<Ra__Node__Attribute*>(p->left);
+                auto attr_r = static_cast<Ra__Node__Attribute*>(p->right);
+                if(attr_l->alias==symbol_d && attr_r->alias!=symbol_d){
+                    equivalent_attributes.insert({attr_l->name.id, {attr_r->alias,attr_r->name}});
                 }
-                else if((attr_r->alias=="d" && attr_r->name==attr_d->name && attr_l->alias!="d")){
-                    d_rename_map[{"d",attr_d->name}] = {attr_l->alias,attr_l->name};
-                    return true;
+                else if(attr_r->alias==symbol_d && attr_l->alias!=symbol_d){
+                    equivalent_attributes.insert({attr_r->name.id, {attr_l->alias,attr_l->name}});
                 }
             }
-            return false;
+            break;
         }
-        default: return false;
+        default: break;
     }
 }
 
-// // can only decouple if every "d" attribute has an equi predicate in a top level "and" bool predicate
 // // (can also have any <,> predicates additionally)
-// bool RaTree::can_decouple(std::shared_ptr<Ra__Node> selection, const std::vector<std::shared_ptr<Ra__Node>>& d_args, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>>& d_rename_map){
-//     auto sel = std::static_pointer_cast<Ra__Node__Selection>(selection);
+// bool RaTree::can_decouple(Ra__Node* selection, const std::vector<Ra__Node*>& d_args, std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& d_rename_map){
+//     auto sel = static_cast<Ra__Node__Selection*>(selection);
 //     // every attribute passed from "d" must have an equi predicate
 //     for(const auto& d_arg: d_args){
 //         if(!has_equivalent_attribute(d_arg, sel->predicate, d_rename_map)){
@@ -1044,67 +1390,66 @@ bool RaTree::has_equivalent_attribute(std::shared_ptr<Ra__Node> attribute, std::
 //     return true;
 // }
 
-bool RaTree::can_decouple(std::shared_ptr<Ra__Node__Join> dep_join, std::shared_ptr<Ra__Node> parent_projection, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>>& d_rename_map){
+bool RaTree::can_decouple(Ra__Node__Join* dep_join, Ra__Node* parent_projection, std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& d_rename_map){
     
     // get d_args from left side, each d_arg needs a "=" predicate
     // get predicates by cheking dep_join, and all parents up to the first projection
     // for each d_arg, check if matching "=" exists
-    auto d_projection = std::static_pointer_cast<Ra__Node__Projection>(dep_join->childNodes[0]);
-
-    std::vector<std::shared_ptr<Ra__Node>> nodes_with_predicates;
+    std::vector<Ra__Node*> nodes_with_predicates;
     nodes_with_predicates.push_back(dep_join);
 
-    std::shared_ptr<Ra__Node> parent_node = parent_projection;
-    std::shared_ptr<Ra__Node> find_parent_of = dep_join;
+    Ra__Node* parent_node = dep_join;
     int child_index;
-    while(get_node_parent(parent_node, find_parent_of, child_index)){
+    while((parent_node = get_parent(parent_node, parent_projection, child_index))!=nullptr){
         if(parent_node->node_case==RA__NODE__SELECTION || parent_node->node_case==RA__NODE__JOIN){
             nodes_with_predicates.push_back(parent_node);
         }
         else if(parent_node->node_case==RA__NODE__PROJECTION){
             break;
         }
-        find_parent_of = parent_node;
-        parent_node = parent_projection;
     }
 
-    std::vector<std::string> aliases_to_find = {"d"};
-    std::vector<std::shared_ptr<Ra__Node>> attributes_with_alias;
+    std::vector<Ra__Symbol> aliases_to_find = {symbol_d};
+    std::vector<Ra__Node*> attributes_with_alias;
     find_attributes_using_alias(parent_projection, aliases_to_find, attributes_with_alias, dep_join, false);
 
-    // every attribute passed from "d" must have an equi predicate
-    for(const auto& d_arg: attributes_with_alias){
-        bool found_equi_predicate = false;
-        for(auto node_with_predicates: nodes_with_predicates){
-            std::shared_ptr<Ra__Node> predicate;
-            switch(node_with_predicates->node_case){
-                case RA__NODE__SELECTION:{
-                    auto selection = std::static_pointer_cast<Ra__Node__Selection>(node_with_predicates);
-                    predicate = selection->predicate;
-                    break;
-                }
-                case RA__NODE__JOIN:{
-                    auto join = std::static_pointer_cast<Ra__Node__Join>(node_with_predicates);
-                    predicate = join->predicate;
-                    break;
-                }
+    // equi predicates of the closest nodes first
+    std::unordered_map<uint32_t, std::pair<Ra__Symbol,Ra__Symbol>> equivalent_attributes;
+    for(auto node_with_predicates: nodes_with_predicates){
+        Ra__Node* predicate = nullptr;
+        switch(node_with_predicates->node_case){
+            case RA__NODE__SELECTION:{
+                auto selection = static_cast<Ra__Node__Selection*>(node_with_predicates);
+                predicate = selection->predicate;
+                break;
             }
-            if(predicate!=nullptr && has_equivalent_attribute(d_arg, predicate, d_rename_map)){
-                found_equi_predicate = true;
+            case RA__NODE__JOIN:{
+                auto join = static_cast<Ra__Node__Join*>(node_with_predicates);
+                predicate = join->predicate;
                 break;
             }
         }
-        if(!found_equi_predicate){
-            std::cout << std::static_pointer_cast<Ra__Node__Attribute>(d_arg)->name << std::endl;
+        if(predicate!=nullptr){
+            get_equivalent_attributes(predicate, equivalent_attributes);
+        }
+    }
+
+    // every attribute passed from "d" must have an equi predicate
+    for(const auto& d_arg: attributes_with_alias){
+        auto attr_d = static_cast<Ra__Node__Attribute*>(d_arg);
+        auto equivalent_attribute = equivalent_attributes.find(attr_d->name.id);
+        if(equivalent_attribute==equivalent_attributes.end()){
+            std::cerr << attr_d->name.str() << std::endl;
             return false;
         }
+        d_rename_map[{symbol_d,attr_d->name}] = equivalent_attribute->second;
     }
     return true;
 }
 
-void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::shared_ptr<Ra__Node> original_right_projection, std::queue<std::shared_ptr<Ra__Node__Join>>& push_down_dep_joins_queue){
+void RaTree::push_down_dep_join(Ra__Node__Join* dep_join, Ra__Node* original_right_projection, std::queue<Ra__Node__Join*>& push_down_dep_joins_queue){
     
-    std::shared_ptr<Ra__Node> dep_join_parent = original_right_projection;
+    Ra__Node* dep_join_parent = original_right_projection;
     int dep_join_parent_child_id;
     assert(get_node_parent(dep_join_parent, dep_join, dep_join_parent_child_id));
     
@@ -1112,84 +1457,84 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
     // int dep_join_parent_child_id = -1;
     // for(int i=0; i<dep_join_parent->childNodes.size(); i++){
     //     if(dep_join_parent->childNodes[i]->node_case==RA__NODE__JOIN &&
-    //         std::static_pointer_cast<Ra__Node__Join>(dep_join_parent->childNodes[i])->type==RA__JOIN__DEPENDENT_INNER_LEFT){
+    //         static_cast<Ra__Node__Join*>(dep_join_parent->childNodes[i])->type==RA__JOIN__DEPENDENT_INNER_LEFT){
     //         dep_join_parent_child_id = i;
     //         break;
     //     }
     // }
     assert(dep_join_parent_child_id!=-1);
-    // std::shared_ptr<Ra__Node> dep_join = dep_join_parent->childNodes[dep_join_parent_child_id];
+    // Ra__Node* dep_join = dep_join_parent->childNodes[dep_join_parent_child_id];
 
     // switch dep join right child node case
     switch(dep_join->childNodes[1]->node_case){
         // single child cases
         case RA__NODE__PROJECTION:
         case RA__NODE__SELECTION:{
-            std::shared_ptr<Ra__Node> dep_join_right_child = dep_join->childNodes[1];
+            Ra__Node* dep_join_right_child = dep_join->childNodes[1];
 
-            dep_join->childNodes[1] = dep_join_right_child->childNodes[0];
-            dep_join_right_child->childNodes[0] = dep_join;
-            dep_join_parent->childNodes[dep_join_parent_child_id] = dep_join_right_child;
+            dep_join->set_child(1, dep_join_right_child->childNodes[0]);
+            dep_join_right_child->set_child(0, dep_join);
+            dep_join_parent->set_child(dep_join_parent_child_id, dep_join_right_child);
             break;
         }
         case RA__NODE__GROUP_BY:{
-            std::shared_ptr<Ra__Node> dep_join_right_child = dep_join->childNodes[1];
+            Ra__Node* dep_join_right_child = dep_join->childNodes[1];
 
             // get attributes produced by d
-            std::vector<std::string> d_attributes = std::static_pointer_cast<Ra__Node__Projection>(dep_join->childNodes[0])->subquery_columns;
+            std::vector<std::string> d_attributes = static_cast<Ra__Node__Projection*>(dep_join->childNodes[0])->subquery_columns;
             for(const auto& d_attr: d_attributes){
-                std::static_pointer_cast<Ra__Node__Group_By>(dep_join_right_child)->args.push_back(std::make_shared<Ra__Node__Attribute>(d_attr, "d"));
+                static_cast<Ra__Node__Group_By*>(dep_join_right_child)->args.push_back(arena->make<Ra__Node__Attribute>(symbols->intern(d_attr), symbol_d));
             }
-            std::static_pointer_cast<Ra__Node__Group_By>(dep_join_right_child)->implicit = false;
+            static_cast<Ra__Node__Group_By*>(dep_join_right_child)->implicit = false;
 
-            dep_join->childNodes[1] = dep_join_right_child->childNodes[0];
-            dep_join_right_child->childNodes[0] = dep_join;
-            dep_join_parent->childNodes[dep_join_parent_child_id] = dep_join_right_child;
+            dep_join->set_child(1, dep_join_right_child->childNodes[0]);
+            dep_join_right_child->set_child(0, dep_join);
+            dep_join_parent->set_child(dep_join_parent_child_id, dep_join_right_child);
             break;
         }
         case RA__NODE__JOIN:{
-            auto child_join = std::static_pointer_cast<Ra__Node__Join>(dep_join->childNodes[1]);
+            auto child_join = static_cast<Ra__Node__Join*>(dep_join->childNodes[1]);
             switch(child_join->type){
                 case RA__JOIN__CROSS_PRODUCT:
                 case RA__JOIN__INNER:{
                     if(intersect_correlated_attributes(dep_join->childNodes[0],dep_join->childNodes[1]->childNodes[1]).empty()){
-                        dep_join->childNodes[1] = child_join->childNodes[0];
-                        child_join->childNodes[0] = dep_join;
-                        dep_join_parent->childNodes[dep_join_parent_child_id] = child_join;
+                        dep_join->set_child(1, child_join->childNodes[0]);
+                        child_join->set_child(0, dep_join);
+                        dep_join_parent->set_child(dep_join_parent_child_id, child_join);
                     }
                     else if(intersect_correlated_attributes(dep_join->childNodes[0],dep_join->childNodes[1]->childNodes[0]).empty()){
-                        dep_join->childNodes[1] = child_join->childNodes[1];
-                        child_join->childNodes[1] = dep_join;
-                        dep_join_parent->childNodes[dep_join_parent_child_id] = child_join;
+                        dep_join->set_child(1, child_join->childNodes[1]);
+                        child_join->set_child(1, dep_join);
+                        dep_join_parent->set_child(dep_join_parent_child_id, child_join);
                     }
                     else{
                         // 1. add projection to left and right side, with aliases
-                        std::shared_ptr<Ra__Node__Projection> left_pr = std::make_shared<Ra__Node__Projection>();
-                        std::shared_ptr<Ra__Node__Projection> right_pr = std::make_shared<Ra__Node__Projection>();
-                        std::shared_ptr<Ra__Node__Join> dep_join_right = std::make_shared<Ra__Node__Join>(RA__JOIN__DEPENDENT_INNER_LEFT);
+                        Ra__Node__Projection* left_pr = arena->make<Ra__Node__Projection>();
+                        Ra__Node__Projection* right_pr = arena->make<Ra__Node__Projection>();
+                        Ra__Node__Join* dep_join_right = arena->make<Ra__Node__Join>(RA__JOIN__DEPENDENT_INNER_LEFT);
 
                         // push original dep join down left side 
-                        left_pr->subquery_alias = "temp_" + std::to_string(counter++);
-                        left_pr->childNodes.push_back(dep_join_parent->childNodes[dep_join_parent_child_id]);
-                        dep_join_parent->childNodes[dep_join_parent_child_id]->childNodes[1] = child_join->childNodes[0];
-                        dep_join_parent->childNodes[dep_join_parent_child_id] = child_join; // skip dep join
+                        left_pr->subquery_alias = symbols->intern("temp_" + std::to_string(counter++));
+                        left_pr->add_child(dep_join_parent->childNodes[dep_join_parent_child_id]);
+                        dep_join_parent->childNodes[dep_join_parent_child_id]->set_child(1, child_join->childNodes[0]);
+                        dep_join_parent->set_child(dep_join_parent_child_id, child_join); // skip dep join
 
                         
-                        right_pr->subquery_alias = "temp_" + std::to_string(counter++);
-                        right_pr->childNodes.push_back(dep_join_right);
-                        dep_join_right->childNodes.push_back(dep_join->childNodes[0]); // D
-                        dep_join_right->childNodes.push_back(child_join->childNodes[1]);
+                        right_pr->subquery_alias = symbols->intern("temp_" + std::to_string(counter++));
+                        right_pr->add_child(dep_join_right);
+                        dep_join_right->add_child(dep_join->childNodes[0]); // D
+                        dep_join_right->add_child(child_join->childNodes[1]);
                         
-                        child_join->childNodes[0] = left_pr;
-                        child_join->childNodes[1] = right_pr;
+                        child_join->set_child(0, left_pr);
+                        child_join->set_child(1, right_pr);
 
                         // add select expressions to left projection
-                        std::vector<std::pair<std::string,std::string>> left_relations_aliases;
+                        std::vector<std::pair<Ra__Symbol,Ra__Symbol>> left_relations_aliases;
                         get_relations_aliases(left_pr->childNodes[0], left_relations_aliases);
-                        std::vector<std::string> left_aliases;
+                        std::vector<Ra__Symbol> left_aliases;
                         for(const auto& relation_alias: left_relations_aliases){
                             // relation has alias
-                            if(relation_alias.second!=""){
+                            if(!relation_alias.second.empty()){
                                 left_aliases.push_back(relation_alias.second);
                             }
                             // relation has no alias
@@ -1197,40 +1542,40 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
                                 left_aliases.push_back(relation_alias.first);
                             }
                         }
-                        std::vector<std::shared_ptr<Ra__Node>> left_attributes;
+                        std::vector<Ra__Node*> left_attributes;
                         find_attributes_using_alias(original_right_projection, left_aliases, left_attributes, child_join, true);
-                        std::vector<std::string> temp_select_attr_tracker;
+                        std::vector<std::pair<Ra__Symbol,Ra__Symbol>> temp_select_attr_tracker;
                         for(auto attribute: left_attributes){
-                            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-                            if(attr->alias=="d"){
+                            auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+                            if(attr->alias==symbol_d){
                                 continue;
                             }
-                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),attr->alias+attr->name)==temp_select_attr_tracker.end()){
-                                temp_select_attr_tracker.push_back(attr->alias+attr->name);
-                                left_pr->args.push_back(std::make_shared<Ra__Node__Select_Expression>(std::make_shared<Ra__Node__Attribute>(attr->name, attr->alias)));
-                                left_pr->subquery_columns.push_back(attr->name);
+                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),std::pair<Ra__Symbol,Ra__Symbol>(attr->alias,attr->name))==temp_select_attr_tracker.end()){
+                                temp_select_attr_tracker.push_back({attr->alias,attr->name});
+                                left_pr->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias)));
+                                left_pr->subquery_columns.push_back(attr->name.str());
                             }
                         }
                         // add d_attributes separately
-                        std::vector<std::string> aliases_to_find = {"d"};
-                        std::vector<std::shared_ptr<Ra__Node>> left_attributes_with_alias;
+                        std::vector<Ra__Symbol> aliases_to_find = {symbol_d};
+                        std::vector<Ra__Node*> left_attributes_with_alias;
                         find_attributes_using_alias(dep_join->childNodes[1], aliases_to_find, left_attributes_with_alias);
                         for(auto attribute: left_attributes_with_alias){
-                            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),attr->alias+attr->name)==temp_select_attr_tracker.end()){
-                                temp_select_attr_tracker.push_back(attr->alias+attr->name);
-                                left_pr->args.push_back(std::make_shared<Ra__Node__Select_Expression>(std::make_shared<Ra__Node__Attribute>(attr->name, attr->alias)));
-                                left_pr->subquery_columns.push_back(attr->name);
+                            auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),std::pair<Ra__Symbol,Ra__Symbol>(attr->alias,attr->name))==temp_select_attr_tracker.end()){
+                                temp_select_attr_tracker.push_back({attr->alias,attr->name});
+                                left_pr->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias)));
+                                left_pr->subquery_columns.push_back(attr->name.str());
                             }
                         }
 
                         // add select expressions to right projection
-                        std::vector<std::pair<std::string,std::string>> right_relations_aliases;
+                        std::vector<std::pair<Ra__Symbol,Ra__Symbol>> right_relations_aliases;
                         get_relations_aliases(right_pr->childNodes[0], right_relations_aliases);
-                        std::vector<std::string> right_aliases;
+                        std::vector<Ra__Symbol> right_aliases;
                         for(const auto& relation_alias: right_relations_aliases){
                             // relation has alias
-                            if(relation_alias.second!=""){
+                            if(!relation_alias.second.empty()){
                                 right_aliases.push_back(relation_alias.second);
                             }
                             // relation has no alias
@@ -1238,44 +1583,44 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
                                 right_aliases.push_back(relation_alias.first);
                             }
                         }
-                        std::vector<std::shared_ptr<Ra__Node>> right_attributes;
+                        std::vector<Ra__Node*> right_attributes;
                         find_attributes_using_alias(original_right_projection, right_aliases, right_attributes, child_join, true);
                         temp_select_attr_tracker.clear();
                         for(auto attribute: right_attributes){
-                            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-                            if(attr->alias=="d"){
+                            auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+                            if(attr->alias==symbol_d){
                                 continue;
                             }
-                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),attr->alias+attr->name)==temp_select_attr_tracker.end()){
-                                temp_select_attr_tracker.push_back(attr->alias+attr->name);
-                                right_pr->args.push_back(std::make_shared<Ra__Node__Select_Expression>(std::make_shared<Ra__Node__Attribute>(attr->name, attr->alias)));
-                                right_pr->subquery_columns.push_back(attr->name);
+                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),std::pair<Ra__Symbol,Ra__Symbol>(attr->alias,attr->name))==temp_select_attr_tracker.end()){
+                                temp_select_attr_tracker.push_back({attr->alias,attr->name});
+                                right_pr->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias)));
+                                right_pr->subquery_columns.push_back(attr->name.str());
                             }
                         }
                         // add d_attributes separately
-                        std::vector<std::shared_ptr<Ra__Node>> right_attributes_with_alias;
+                        std::vector<Ra__Node*> right_attributes_with_alias;
                         find_attributes_using_alias(dep_join_right->childNodes[1], aliases_to_find, right_attributes_with_alias);
                         for(auto attribute: right_attributes_with_alias){
-                            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),attr->alias+attr->name)==temp_select_attr_tracker.end()){
-                                temp_select_attr_tracker.push_back(attr->alias+attr->name);
-                                right_pr->args.push_back(std::make_shared<Ra__Node__Select_Expression>(std::make_shared<Ra__Node__Attribute>(attr->name, attr->alias)));
-                                right_pr->subquery_columns.push_back(attr->name);
+                            auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+                            if(std::find(temp_select_attr_tracker.begin(),temp_select_attr_tracker.end(),std::pair<Ra__Symbol,Ra__Symbol>(attr->alias,attr->name))==temp_select_attr_tracker.end()){
+                                temp_select_attr_tracker.push_back({attr->alias,attr->name});
+                                right_pr->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias)));
+                                right_pr->subquery_columns.push_back(attr->name.str());
                             }
                         }
 
                         // 2. rename attributes in subquery to new aliases
                         // d -> either left or right alias
                         // rename relations defined in left/right side to their subquery alias
-                        std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>> rename_map;
+                        std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>> rename_map;
                         for(auto arg: left_pr->args){
-                            auto expression = std::static_pointer_cast<Ra__Node__Select_Expression>(arg)->expression;
+                            auto expression = static_cast<Ra__Node__Select_Expression*>(arg)->expression;
                             assert(expression->node_case==RA__NODE__ATTRIBUTE);
-                            auto attribute = std::static_pointer_cast<Ra__Node__Attribute>(expression);
-                            rename_map[{"d",attribute->name}] = {left_pr->subquery_alias,attribute->name};
+                            auto attribute = static_cast<Ra__Node__Attribute*>(expression);
+                            rename_map[{symbol_d,attribute->name}] = {left_pr->subquery_alias,attribute->name};
                             for(auto relation_alias: left_relations_aliases){
                                 // relation has alias
-                                if(relation_alias.second!=""){
+                                if(!relation_alias.second.empty()){
                                     rename_map[{relation_alias.second,attribute->name}] = {left_pr->subquery_alias,attribute->name};
                                 }
                                 // relation has no alias
@@ -1285,13 +1630,13 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
                             }
                         }
                         for(auto arg: right_pr->args){
-                            auto expression = std::static_pointer_cast<Ra__Node__Select_Expression>(arg)->expression;
+                            auto expression = static_cast<Ra__Node__Select_Expression*>(arg)->expression;
                             assert(expression->node_case==RA__NODE__ATTRIBUTE);
-                            auto attribute = std::static_pointer_cast<Ra__Node__Attribute>(expression);
-                            rename_map[{"d",attribute->name}] = {right_pr->subquery_alias,attribute->name};
+                            auto attribute = static_cast<Ra__Node__Attribute*>(expression);
+                            rename_map[{symbol_d,attribute->name}] = {right_pr->subquery_alias,attribute->name};
                             for(auto relation_alias: right_relations_aliases){
                                 // relation has alias
-                                if(relation_alias.second!=""){
+                                if(!relation_alias.second.empty()){
                                     rename_map[{relation_alias.second,attribute->name}] = {right_pr->subquery_alias,attribute->name};
                                 }
                                 // relation has no alias
@@ -1303,25 +1648,24 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
                         rename_attributes(original_right_projection, rename_map, child_join);
 
                         // 3. add natural join D predicates
-                        std::vector<std::shared_ptr<Ra__Node>> natural_join_D_predicates;
+                        std::vector<Ra__Node*> natural_join_D_predicates;
                         for(const auto& right_attribute: right_attributes_with_alias){
                             for(const auto& left_attribute: left_attributes_with_alias){
-                                auto r_attr = std::static_pointer_cast<Ra__Node__Attribute>(right_attribute);
-                                auto l_attr = std::static_pointer_cast<Ra__Node__Attribute>(left_attribute);
+                                auto r_attr = static_cast<Ra__Node__Attribute*>(right_attribute);
+                                auto l_attr = static_cast<Ra__Node__Attribute*>(left_attribute);
                                 if(r_attr->name==l_attr->name){
-                                    auto left = std::make_shared<Ra__Node__Attribute>(l_attr->name, left_pr->subquery_alias);
-                                    auto right = std::make_shared<Ra__Node__Attribute>(r_attr->name, right_pr->subquery_alias);
-                                    natural_join_D_predicates.push_back(std::make_shared<Ra__Node__Predicate>(left, right, "="));
+                                    auto left = arena->make<Ra__Node__Attribute>(l_attr->name, left_pr->subquery_alias);
+                                    auto right = arena->make<Ra__Node__Attribute>(r_attr->name, right_pr->subquery_alias);
+                                    natural_join_D_predicates.push_back(arena->make<Ra__Node__Predicate>(left, right, "="));
                                     break;
                                 }
                             }
                         }
-                        auto d_projection = std::static_pointer_cast<Ra__Node__Projection>(dep_join_right->childNodes[0]);
                         // assuming predicate is currently empty
                         assert(child_join->predicate==nullptr);
                         if(natural_join_D_predicates.size()>1){
                             child_join->type = RA__JOIN__INNER;
-                            auto bool_p = std::make_shared<Ra__Node__Bool_Predicate>();
+                            auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
                             bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
                             for(auto arg: natural_join_D_predicates){
                                 bool_p->args.push_back(arg);
@@ -1346,10 +1690,10 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
                 }
                 case RA__JOIN__LEFT:{
                     if(intersect_correlated_attributes(dep_join->childNodes[0],dep_join->childNodes[1]->childNodes[1]).empty()){
-                        std::shared_ptr<Ra__Node> child_join = dep_join->childNodes[1];
-                        dep_join->childNodes[1] = child_join->childNodes[0];
-                        child_join->childNodes[0] = dep_join;
-                        dep_join_parent->childNodes[dep_join_parent_child_id] = child_join;
+                        Ra__Node* child_join = dep_join->childNodes[1];
+                        dep_join->set_child(1, child_join->childNodes[0]);
+                        child_join->set_child(0, dep_join);
+                        dep_join_parent->set_child(dep_join_parent_child_id, child_join);
                     }
                     else{
 
@@ -1367,76 +1711,76 @@ void RaTree::push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::s
 }
 
 // compute intersect of attributes produced by left with free attributes of right
-std::vector<std::shared_ptr<Ra__Node>> RaTree::intersect_correlated_attributes(std::shared_ptr<Ra__Node> d_projection, std::shared_ptr<Ra__Node> comparsion_subtree){
-    std::vector<std::shared_ptr<Ra__Node>> intersect_result; 
+std::vector<Ra__Node*> RaTree::intersect_correlated_attributes(Ra__Node* d_projection, Ra__Node* comparsion_subtree){
+    std::vector<Ra__Node*> intersect_result; 
 
     // get relations of left side
-    std::vector<std::pair<std::string, std::string>> left_relations_aliases;
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> left_relations_aliases;
     // if D projection has already been initialized
-    auto left_projection = std::static_pointer_cast<Ra__Node__Projection>(d_projection);
+    auto left_projection = static_cast<Ra__Node__Projection*>(d_projection);
     if(left_projection->args.size()>0){
-        left_relations_aliases.push_back({"","d"});
+        left_relations_aliases.push_back({Ra__Symbol(),symbol_d});
     }
     else{
         get_relations_aliases(left_projection->childNodes[0], left_relations_aliases);
     }
 
     // get relations of right side
-    std::shared_ptr<Ra__Node> dep_right_child = comparsion_subtree;
-    std::vector<std::pair<std::string, std::string>> right_relations_aliases;
+    Ra__Node* dep_right_child = comparsion_subtree;
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> right_relations_aliases;
     get_relations_aliases(dep_right_child, right_relations_aliases);
 
     // get attributes of right side
-    std::vector<std::shared_ptr<Ra__Node>> right_attributes;
+    std::vector<Ra__Node*> right_attributes;
     get_subtree_attributes(dep_right_child, right_attributes);
 
-    // find attributes on right side which are not covered by relations on right side
-    std::vector<std::shared_ptr<Ra__Node>> right_attributes_correlated;
-    for(const auto& attribute: right_attributes){
-        auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-        bool found_relation = false;
-        for(const auto& relation: right_relations_aliases){
-            if(attr->alias.length()>0 && (attr->alias==relation.first || attr->alias==relation.second)){
-                found_relation = true;
-                break;
-            }
-            else if(attr->alias=="" && is_tpch_attribute(attr->name, relation.first)){
-                found_relation = true;
-                break;
+    // attribute aliases are looked up by symbol id, attributes without alias are checked against the catalog
+    auto defines_attribute = [&](Ra__Node__Attribute* attr, const std::unordered_set<uint32_t>& qualifiers, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases){
+        if(!attr->alias.empty()){
+            return qualifiers.count(attr->alias.id)>0;
+        }
+        for(const auto& relation: relations_aliases){
+            if(is_catalog_attribute(attr->name, relation.first)){
+                return true;
             }
         }
-        if(!found_relation){
-            right_attributes_correlated.push_back(attr);
+        return false;
+    };
+    auto get_qualifiers = [](const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases){
+        std::unordered_set<uint32_t> qualifiers;
+        for(const auto& relation: relations_aliases){
+            for(const auto& qualifier: {relation.first, relation.second}){
+                if(!qualifier.empty()){
+                    qualifiers.insert(qualifier.id);
+                }
+            }
         }
-    }
+        return qualifiers;
+    };
+    std::unordered_set<uint32_t> right_qualifiers = get_qualifiers(right_relations_aliases);
+    std::unordered_set<uint32_t> left_qualifiers = get_qualifiers(left_relations_aliases);
 
-    // for each right attribute, if it matches a left relation, return it
-    for(const auto& attribute: right_attributes_correlated){
-        auto attr = std::static_pointer_cast<Ra__Node__Attribute>(attribute);
-        for(const auto& relation: left_relations_aliases){
-            if(attr->alias.length()>0 && (attr->alias==relation.first || attr->alias==relation.second)){
-                intersect_result.push_back(attr);
-                break;
-            }
-            else if(attr->alias=="" && is_tpch_attribute(attr->name, relation.first)){
-                intersect_result.push_back(attr);
-                break;
-            }
+    // find attributes on right side which are not covered by relations on right side,
+    // for each of them, if it matches a left relation, return it
+    for(const auto& attribute: right_attributes){
+        auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+        if(!defines_attribute(attr, right_qualifiers, right_relations_aliases) && defines_attribute(attr, left_qualifiers, left_relations_aliases)){
+            intersect_result.push_back(attr);
         }
     }
 
     return intersect_result;
 }
 
-void RaTree::get_expression_attributes(std::shared_ptr<Ra__Node> expression, std::vector<std::shared_ptr<Ra__Node>>& attributes){
+void RaTree::get_expression_attributes(Ra__Node* expression, std::vector<Ra__Node*>& attributes){
     switch(expression->node_case){
         case RA__NODE__ATTRIBUTE:{
-            auto attr = std::static_pointer_cast<Ra__Node__Attribute>(expression);
+            auto attr = static_cast<Ra__Node__Attribute*>(expression);
             attributes.push_back(attr);
             break;
         }
         case RA__NODE__EXPRESSION:{
-            auto expr = std::static_pointer_cast<Ra__Node__Expression>(expression);
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
             if(expr->l_arg!=nullptr){
                 get_expression_attributes(expr->l_arg, attributes);
             }
@@ -1446,74 +1790,91 @@ void RaTree::get_expression_attributes(std::shared_ptr<Ra__Node> expression, std
             break;
         }
         case RA__NODE__FUNC_CALL:{
-            auto func_call = std::static_pointer_cast<Ra__Node__Func_Call>(expression);
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
             for(const auto& arg: func_call->args){
                 get_expression_attributes(arg, attributes);
             }
+            for(const auto& arg: func_call->window_partition){
+                get_expression_attributes(arg, attributes);
+            }
             break;
         }
         case RA__NODE__TYPE_CAST:{
-            auto type_cast = std::static_pointer_cast<Ra__Node__Type_Cast>(expression);
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
             get_expression_attributes(type_cast->expression, attributes);
             break;
         }
     }
 }
 
-void RaTree::get_predicate_attributes(std::shared_ptr<Ra__Node> predicate, std::vector<std::shared_ptr<Ra__Node>>& attributes){
+void RaTree::get_predicate_attributes(Ra__Node* predicate, std::vector<Ra__Node*>& attributes){
     switch(predicate->node_case){
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(predicate);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
             for(const auto& p: bool_p->args){
                 get_predicate_attributes(p, attributes);
             }
             break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(predicate);
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
             get_expression_attributes(p->left, attributes);
             get_expression_attributes(p->right, attributes);
             break;
         }
+        case RA__NODE__NULL_TEST:{
+            get_expression_attributes(static_cast<Ra__Node__Null_Test*>(predicate)->arg, attributes);
+            break;
+        }
         case RA__NODE__WHERE_SUBQUERY_MARKER:{
-            std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>> marker_join = {{predicate,nullptr}};
+            std::vector<std::pair<Ra__Node*, Ra__Node*>> marker_join = {{predicate,nullptr}};
             find_joins_by_markers(root, marker_join);
             get_subtree_attributes(marker_join[0].second, attributes);
             break;
         }
-        default: std::cout << "Node case should not be in predicate" << std::endl;
+        default: std::cerr << "Node case should not be in predicate" << std::endl;
     }
 }
 
 // get attributes used in selection
-void RaTree::get_subtree_attributes(std::shared_ptr<Ra__Node> it, std::vector<std::shared_ptr<Ra__Node>>& attributes){
+void RaTree::get_subtree_attributes(Ra__Node* it, std::vector<Ra__Node*>& attributes){
     switch(it->node_case){
         case RA__NODE__SELECTION:{
-            auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
+            auto sel = static_cast<Ra__Node__Selection*>(it);
             get_predicate_attributes(sel->predicate, attributes);
             break;
         }
         case RA__NODE__PROJECTION:{
-            auto proj = std::static_pointer_cast<Ra__Node__Projection>(it);
+            auto proj = static_cast<Ra__Node__Projection*>(it);
             for(const auto& arg: proj->args){
                 get_expression_attributes(arg, attributes);
             }
             break;
         }
         case RA__NODE__JOIN:{
-            auto join = std::static_pointer_cast<Ra__Node__Join>(it);
+            auto join = static_cast<Ra__Node__Join*>(it);
             if(join->predicate!=nullptr){
                 get_predicate_attributes(join->predicate, attributes);
             }
             break;
         }
         case RA__NODE__GROUP_BY:{
-            auto group_by = std::static_pointer_cast<Ra__Node__Group_By>(it);
+            auto group_by = static_cast<Ra__Node__Group_By*>(it);
             for(const auto& arg: group_by->args){
                 get_expression_attributes(arg, attributes);
             }
             break;
         }
+        case RA__NODE__LIMIT:{
+            auto limit = static_cast<Ra__Node__Limit*>(it);
+            if(limit->count!=nullptr){
+                get_expression_attributes(limit->count, attributes);
+            }
+            if(limit->offset!=nullptr){
+                get_expression_attributes(limit->offset, attributes);
+            }
+            break;
+        }
         // TODO: all other nodes...
     }
     
@@ -1533,7 +1894,7 @@ void RaTree::get_subtree_attributes(std::shared_ptr<Ra__Node> it, std::vector<st
     // change selection marker type from "exists" to "in"
 void RaTree::decorrelate_all_exists(){
     // find marker in selection
-    std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>> markers_joins; // markers, joins
+    std::vector<std::pair<Ra__Node*, Ra__Node*>> markers_joins; // markers, joins
     
     // 1.
     find_subquery_markers(root, markers_joins, {RA__JOIN__SEMI_LEFT_DEPENDENT,RA__JOIN__ANTI_LEFT_DEPENDENT});
@@ -1549,15 +1910,15 @@ void RaTree::decorrelate_all_exists(){
     };
 }
 
-void RaTree::find_subquery_markers(std::shared_ptr<Ra__Node> it, std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>>& markers_joins, std::vector<Ra__Join__JoinType> marker_types){
+void RaTree::find_subquery_markers(Ra__Node* it, std::vector<std::pair<Ra__Node*, Ra__Node*>>& markers_joins, std::vector<Ra__Join__JoinType> marker_types){
 
     if(it->node_case==RA__NODE__SELECTION){
-        auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
+        auto sel = static_cast<Ra__Node__Selection*>(it);
         find_subquery_markers(sel->predicate, markers_joins, marker_types);
     }
 
     else if(it->node_case==RA__NODE__BOOL_PREDICATE){
-        auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(it);
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(it);
         for(const auto& arg: bool_p->args){
             find_subquery_markers(arg, markers_joins, marker_types);
         }
@@ -1565,14 +1926,14 @@ void RaTree::find_subquery_markers(std::shared_ptr<Ra__Node> it, std::vector<std
     }
 
     else if(it->node_case==RA__NODE__PREDICATE){
-        auto p = std::static_pointer_cast<Ra__Node__Predicate>(it);
+        auto p = static_cast<Ra__Node__Predicate*>(it);
         find_subquery_markers(p->left, markers_joins, marker_types);
         find_subquery_markers(p->right, markers_joins, marker_types);
         return;
     }
 
     else if(it->node_case==RA__NODE__WHERE_SUBQUERY_MARKER){
-        auto marker_ = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(it);
+        auto marker_ = static_cast<Ra__Node__Where_Subquery_Marker*>(it);
         if(std::find(marker_types.begin(), marker_types.end(),marker_->type)!=marker_types.end()){
             // add to markers
             markers_joins.push_back({it,nullptr});
@@ -1585,16 +1946,16 @@ void RaTree::find_subquery_markers(std::shared_ptr<Ra__Node> it, std::vector<std
     return;
 }
 
-void RaTree::find_joins_by_markers(std::shared_ptr<Ra__Node> it, std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>>& markers_joins){
+void RaTree::find_joins_by_markers(Ra__Node* it, std::vector<std::pair<Ra__Node*, Ra__Node*>>& markers_joins){
 
     if(it->n_children==0){
         return;
     }
     
     if(it->node_case==RA__NODE__JOIN){
-        auto join = std::static_pointer_cast<Ra__Node__Join>(it);
+        auto join = static_cast<Ra__Node__Join*>(it);
         for(auto& pair: markers_joins){
-            auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(pair.first);
+            auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(pair.first);
             if(join->right_where_subquery_marker==marker){
                 assert(join->type==marker->type);
                 assert(pair.second==nullptr);
@@ -1610,17 +1971,17 @@ void RaTree::find_joins_by_markers(std::shared_ptr<Ra__Node> it, std::vector<std
     return;
 }
 
-void RaTree::get_relations_aliases(std::shared_ptr<Ra__Node> it, std::vector<std::pair<std::string,std::string>>& relations_aliases){
+void RaTree::get_relations_aliases(Ra__Node* it, std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases){
     if(it->node_case==RA__NODE__JOIN){
-        auto join = std::static_pointer_cast<Ra__Node__Join>(it);
+        auto join = static_cast<Ra__Node__Join*>(it);
 
         // join with rename, only join alias visible in namespace
-        if(join->alias.length()>0){
-            relations_aliases.push_back({"",join->alias});
+        if(!join->alias.empty()){
+            relations_aliases.push_back({Ra__Symbol(),join->alias});
         }
         // right side is selection subquery, only recurse on left
         else if(join->right_where_subquery_marker->marker!=0){
-            relations_aliases.push_back({"","marker_"+std::to_string(join->right_where_subquery_marker->marker)});
+            relations_aliases.push_back({Ra__Symbol(),symbols->intern("marker_"+std::to_string(join->right_where_subquery_marker->marker))});
             get_relations_aliases(it->childNodes[0], relations_aliases);
         }
         else{
@@ -1631,16 +1992,26 @@ void RaTree::get_relations_aliases(std::shared_ptr<Ra__Node> it, std::vector<std
     } 
 
     if(it->node_case==RA__NODE__RELATION){
-        auto rel = std::static_pointer_cast<Ra__Node__Relation>(it);
+        auto rel = static_cast<Ra__Node__Relation*>(it);
         relations_aliases.push_back({rel->name,rel->alias});
         return;
     }
 
+    if(it->node_case==RA__NODE__VALUES){
+        relations_aliases.push_back({Ra__Symbol(),symbols->intern(static_cast<Ra__Node__Values*>(it)->alias)});
+        return;
+    }
+
+    if(it->node_case==RA__NODE__UNION){
+        relations_aliases.push_back({Ra__Symbol(),static_cast<Ra__Node__Union*>(it)->alias});
+        return;
+    }
+
     // from subquery
     if(it->node_case==RA__NODE__PROJECTION){
-        auto pr = std::static_pointer_cast<Ra__Node__Projection>(it);
-        if(pr->subquery_alias!=""){
-            relations_aliases.push_back({"",pr->subquery_alias});
+        auto pr = static_cast<Ra__Node__Projection*>(it);
+        if(!pr->subquery_alias.empty()){
+            relations_aliases.push_back({Ra__Symbol(),pr->subquery_alias});
             return;
         }
     }
@@ -1651,8 +2022,59 @@ void RaTree::get_relations_aliases(std::shared_ptr<Ra__Node> it, std::vector<std
     return;
 }
 
-bool RaTree::get_node_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node> child_target, int& child_index){
-    auto childNodes = it->childNodes;
+bool RaTree::get_node_parent(Ra__Node*& it, Ra__Node* child_target, int& child_index){
+    // follow the parent links up to it, O(depth) instead of searching the subtree
+    int parent_child_index;
+    Ra__Node* parent = get_linked_parent(child_target, parent_child_index);
+    Ra__Node* ancestor = parent;
+    while(ancestor!=nullptr){
+        if(ancestor==it){
+            it = parent;
+            child_index = parent_child_index;
+            return true;
+        }
+        int ancestor_child_index;
+        Ra__Node* next = get_linked_parent(ancestor, ancestor_child_index);
+        // reached a root of the tree (main tree or CTE) without passing it: not in subtree
+        if(next==nullptr && ancestor->n_parents==0){
+            return false;
+        }
+        ancestor = next;
+    }
+    // node or one of its ancestors is shared by several parents
+    return find_node_parent(it, child_target, child_index);
+}
+
+Ra__Node* RaTree::get_linked_parent(Ra__Node* node, int& child_index){
+    if(node->n_parents!=1 || node->parent==nullptr){
+        return nullptr;
+    }
+    auto& childNodes = node->parent->childNodes;
+    for(size_t i=0; i<childNodes.size(); i++){
+        if(childNodes[i]==node){
+            child_index = i;
+            return node->parent;
+        }
+    }
+    return nullptr;
+}
+
+Ra__Node* RaTree::get_parent(Ra__Node* node, Ra__Node* subtree, int& child_index){
+    if(node==subtree){
+        return nullptr;
+    }
+    Ra__Node* parent = get_linked_parent(node, child_index);
+    if(parent==nullptr){
+        parent = subtree;
+        if(!find_node_parent(parent, node, child_index)){
+            return nullptr;
+        }
+    }
+    return parent;
+}
+
+bool RaTree::find_node_parent(Ra__Node*& it, Ra__Node* child_target, int& child_index){
+    auto& childNodes = it->childNodes;
     // for(const auto& child: childNodes){
     for(int i=0; i<childNodes.size(); i++){
         if(childNodes[i]==child_target){
@@ -1665,7 +2087,7 @@ bool RaTree::get_node_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__
     for(const auto& child: childNodes){
         if(!found){
             it = child;
-            found = get_node_parent(it, child_target, child_index);
+            found = find_node_parent(it, child_target, child_index);
         }
     }
     return found;
@@ -1689,7 +2111,7 @@ bool RaTree::get_node_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__
 //     return found;
 // }
 
-void RaTree::get_all_selections(std::shared_ptr<Ra__Node> it, std::vector<std::shared_ptr<Ra__Node>>& selections){
+void RaTree::get_all_selections(Ra__Node* it, std::vector<Ra__Node*>& selections){
 
     if(it->node_case==RA__NODE__SELECTION){
         selections.push_back(it);
@@ -1700,7 +2122,7 @@ void RaTree::get_all_selections(std::shared_ptr<Ra__Node> it, std::vector<std::s
     }
 }
 
-bool RaTree::get_first_selection(std::shared_ptr<Ra__Node>& it){
+bool RaTree::get_first_selection(Ra__Node*& it){
 
     if(it->node_case==RA__NODE__SELECTION){
         return true;
@@ -1717,26 +2139,19 @@ bool RaTree::get_first_selection(std::shared_ptr<Ra__Node>& it){
     return found;
 }
 
-bool RaTree::is_tpch_attribute(std::string attr_name, std::string relation){
-    std::string::size_type pos = attr_name.find('_');
-    std::string attr_prefix = attr_name.substr(0, pos);
-
-    if(attr_prefix=="p" && relation=="part"
-        || attr_prefix=="s" && relation=="supplier"
-        || attr_prefix=="ps" && relation=="partsupp"
-        || attr_prefix=="c" && relation=="customer"
-        || attr_prefix=="n" && relation=="nation"
-        || attr_prefix=="l" && relation=="lineitem"
-        || attr_prefix=="r" && relation=="region"
-        || attr_prefix=="o" && relation=="orders")
-    {
-        return true;
+bool RaTree::is_catalog_attribute(Ra__Symbol attr_name, Ra__Symbol relation){
+    uint64_t key = (static_cast<uint64_t>(relation.id) << 32) | attr_name.id;
+    auto cached = catalog_attributes.find(key);
+    if(cached!=catalog_attributes.end()){
+        return cached->second;
     }
-    return false;
+    bool is_attribute = catalog->has_column(relation.str(), attr_name.str());
+    catalog_attributes[key] = is_attribute;
+    return is_attribute;
 }
 
 // return {outer attr, inner attr, operator}
-std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string> RaTree::is_correlating_predicate(std::shared_ptr<Ra__Node__Predicate> p, const std::vector<std::pair<std::string,std::string>>& relations_aliases){
+std::tuple<Ra__Node*,Ra__Node*,std::string> RaTree::is_correlating_predicate(Ra__Node__Predicate* p, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases){
     if(p->left->node_case!=RA__NODE__ATTRIBUTE || p->right->node_case!=RA__NODE__ATTRIBUTE){
         // if either side is an const -> not correlated
         // only supporting simple correlated predicate (<attr><op><attr>), no expression with attribute
@@ -1745,30 +2160,30 @@ std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string> RaTr
 
     // check left and right to find out if is correlating predicate
     bool left_found_relation = false;
-    auto left_attr = std::static_pointer_cast<Ra__Node__Attribute>(p->left);
+    auto left_attr = static_cast<Ra__Node__Attribute*>(p->left);
     for(const auto& relation_alias: relations_aliases){
         // if alias exists, check if same as relation name or relation alias
-        if(left_attr->alias.length()>0 && (left_attr->alias==relation_alias.first || left_attr->alias==relation_alias.second)){
+        if(!left_attr->alias.empty() && (left_attr->alias==relation_alias.first || left_attr->alias==relation_alias.second)){
             left_found_relation = true;
             break;
         }
-        // attribute and relation no alias -> check if is tpch attribute of relation
-        else if(left_attr->alias.length()==0 && relation_alias.second.length()==0 && is_tpch_attribute(left_attr->name,relation_alias.first)){
+        // attribute and relation no alias -> check if is catalog attribute of relation
+        else if(left_attr->alias.empty() && relation_alias.second.empty() && is_catalog_attribute(left_attr->name,relation_alias.first)){
             left_found_relation = true;
             break;
         }
     }
 
     bool right_found_relation = false;
-    auto right_attr = std::static_pointer_cast<Ra__Node__Attribute>(p->right);
+    auto right_attr = static_cast<Ra__Node__Attribute*>(p->right);
     for(const auto& relation_alias: relations_aliases){
         // if alias exists, check if same as relation name or relation alias
-        if(right_attr->alias.length()>0 && (right_attr->alias==relation_alias.first || right_attr->alias==relation_alias.second)){
+        if(!right_attr->alias.empty() && (right_attr->alias==relation_alias.first || right_attr->alias==relation_alias.second)){
             right_found_relation = true;
             break;
         }
-        // attribute and relation no alias -> check if is tpch attribute of relation
-        else if(right_attr->alias.length()==0 && relation_alias.second.length()==0 && is_tpch_attribute(right_attr->name,relation_alias.first)){
+        // attribute and relation no alias -> check if is catalog attribute of relation
+        else if(right_attr->alias.empty() && relation_alias.second.empty() && is_catalog_attribute(right_attr->name,relation_alias.first)){
             right_found_relation = true;
             break;
         }
@@ -1780,7 +2195,7 @@ std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string> RaTr
     }
     // both side of predicate are correlating (outer) attributes, not supported
     else if(!right_found_relation && !left_found_relation){
-        std::cout << "predicates with both sides correlating is not supported" << std::endl;
+        std::cerr << "predicates with both sides correlating is not supported" << std::endl;
         return {nullptr, nullptr,""};
     }
     // return {correlating attr, non-correlating attr}
@@ -1792,22 +2207,22 @@ std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string> RaTr
     }
 }
 
-void RaTree::decorrelate_exists_trivial(bool is_boolean_predicate, std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t> correlating_predicate, std::shared_ptr<Ra__Node__Selection> sel, std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins){
+void RaTree::decorrelate_exists_trivial(bool is_boolean_predicate, std::tuple<Ra__Node*,Ra__Node*,std::string,size_t> correlating_predicate, Ra__Node__Selection* sel, std::pair<Ra__Node*, Ra__Node*> markers_joins){
 
     // 2. remove correlating predicate from subquery selection
     // if single predicate, remove selection node
     if(!is_boolean_predicate){
-        std::shared_ptr<Ra__Node> it = (markers_joins.second)->childNodes[1];
+        Ra__Node* it = (markers_joins.second)->childNodes[1];
         // get_selection_parent(&it);
         int child_index = -1;
         get_node_parent(it, sel, child_index);
         assert(it->n_children==1 && child_index==0); // parent should have single child
-        it->childNodes[child_index] = sel->childNodes[0];
-        sel->childNodes.pop_back();
+        it->set_child(child_index, sel->childNodes[0]);
+        sel->clear_children();
     }
     // if part of boolean predicate
     else{
-        auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(sel->predicate);
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(sel->predicate);
         assert(bool_p->args.size()>1);
         bool_p->args.erase(bool_p->args.begin() + std::get<3>(correlating_predicate));
         // if only 2 predicates, convert boolean to single normal predicate
@@ -1818,12 +2233,12 @@ void RaTree::decorrelate_exists_trivial(bool is_boolean_predicate, std::tuple<st
     }
 
     // 3. set subquery select target to inner predicate attribute
-    auto pr = std::static_pointer_cast<Ra__Node__Projection>((markers_joins.second)->childNodes[1]);
+    auto pr = static_cast<Ra__Node__Projection*>((markers_joins.second)->childNodes[1]);
     assert(pr->args.size()==1);
     pr->args[0] = std::get<1>(correlating_predicate);
 
     // check if "exists" or "not exists"
-    auto join = std::static_pointer_cast<Ra__Node__Join>(markers_joins.second);
+    auto join = static_cast<Ra__Node__Join*>(markers_joins.second);
     Ra__Join__JoinType newType;
     if(join->type==RA__JOIN__SEMI_LEFT_DEPENDENT){
         newType = RA__JOIN__IN_LEFT;
@@ -1832,35 +2247,40 @@ void RaTree::decorrelate_exists_trivial(bool is_boolean_predicate, std::tuple<st
         newType = RA__JOIN__ANTI_IN_LEFT;
     }
     else{
-        std::cout << "this should be unreachable :)" << std::endl;
+        std::cerr << "this should be unreachable :)" << std::endl;
         return;
     }
 
     // 4. change "exists"/"not exists" join to "in"/"not in" join
     join->type = newType;
     // set predicate attr to "in" probe (join->predicate->left)
-    auto p = std::make_shared<Ra__Node__Predicate>();
+    auto p = arena->make<Ra__Node__Predicate>();
     p->left = std::get<0>(correlating_predicate);
     join->predicate = p;
     
     // 5. change selection marker type from "exists" to "in"
-    auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(markers_joins.first);
+    auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(markers_joins.first);
     marker->type = newType;
 }
 
-void RaTree::get_correlating_predicates(std::shared_ptr<Ra__Node> predicate, std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>>& correlating_predicates, bool& is_boolean_predicate, std::vector<std::pair<std::string,std::string>> relations_aliases){
+void RaTree::get_correlating_predicates(Ra__Node* predicate, std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>>& correlating_predicates, bool& is_boolean_predicate, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases){
     switch(predicate->node_case){
         case RA__NODE__BOOL_PREDICATE:{
             is_boolean_predicate = true;
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(predicate);
-                for(const auto& p: bool_p->args){
-                    get_correlating_predicates(p, correlating_predicates, is_boolean_predicate, relations_aliases);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
+            for(size_t i=0; i<bool_p->args.size(); i++){
+                size_t n_found = correlating_predicates.size();
+                get_correlating_predicates(bool_p->args[i], correlating_predicates, is_boolean_predicate, relations_aliases);
+                // child index of the argument containing the correlating predicate
+                for(size_t j=n_found; j<correlating_predicates.size(); j++){
+                    std::get<3>(correlating_predicates[j]) = i;
                 }
+            }
             break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(predicate);
-            std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string> cor_predicate = is_correlating_predicate(p, relations_aliases);
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
+            std::tuple<Ra__Node*,Ra__Node*,std::string> cor_predicate = is_correlating_predicate(p, relations_aliases);
             if(std::get<0>(cor_predicate)!=nullptr){
                 correlating_predicates.push_back(std::make_tuple(std::get<0>(cor_predicate),std::get<1>(cor_predicate),std::get<2>(cor_predicate),0));
             }
@@ -1869,17 +2289,17 @@ void RaTree::get_correlating_predicates(std::shared_ptr<Ra__Node> predicate, std
         case RA__NODE__WHERE_SUBQUERY_MARKER:{
             break;
         }
-        default: std::cout << "This node case should not be in selection predicate" << std::endl;
+        default: std::cerr << "This node case should not be in selection predicate" << std::endl;
     }
 }
 
 // exists predicates must be simple <col> <operator> <col>
-void RaTree::decorrelate_exists_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins){
+void RaTree::decorrelate_exists_subquery(std::pair<Ra__Node*, Ra__Node*> markers_joins){
     // 1. check if subquery simply correlated
 
     // go through subquery tree, find relation aliases/names
-    std::vector<std::pair<std::string,std::string>> relations_aliases;
-    std::shared_ptr<Ra__Node> it = (markers_joins.second)->childNodes[1]->childNodes[0];
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> relations_aliases;
+    Ra__Node* it = (markers_joins.second)->childNodes[1]->childNodes[0];
     // start searching from child of subquery projection
     get_relations_aliases(it, relations_aliases);
 
@@ -1887,9 +2307,9 @@ void RaTree::decorrelate_exists_subquery(std::pair<std::shared_ptr<Ra__Node>, st
     it = (markers_joins.second)->childNodes[1]->childNodes[0];
     // correlated exists must have selection
     assert(get_first_selection(it));
-    auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
+    auto sel = static_cast<Ra__Node__Selection*>(it);
 
-    std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates;
+    std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates;
     bool is_boolean_predicate = false;
     get_correlating_predicates(sel->predicate, correlating_predicates, is_boolean_predicate, relations_aliases);
     
@@ -1903,49 +2323,35 @@ void RaTree::decorrelate_exists_subquery(std::pair<std::shared_ptr<Ra__Node>, st
     return;
 }
 
-// only supports refering to base tpch relations
-std::shared_ptr<Ra__Node> RaTree::build_tpch_relation(std::string alias, std::vector<std::shared_ptr<Ra__Node__Attribute>> attr){
-    
-    std::string tpch_relation_name = "";
+// only supports refering to base relations of the catalog
+Ra__Node* RaTree::build_catalog_relation(Ra__Symbol alias, std::vector<Ra__Node__Attribute*> attr){
 
-    std::string::size_type pos = attr[0]->name.find('_');
-    std::string attr_prefix = attr[0]->name.substr(0, pos);
-
-    if(attr_prefix=="p"){
-        tpch_relation_name = "part";
-    }
-    else if(attr_prefix=="s"){
-        tpch_relation_name = "supplier";
-    } 
-    else if(attr_prefix=="ps"){
-        tpch_relation_name = "partsupp";
-    }
-    else if(attr_prefix=="c"){
-        tpch_relation_name = "customer";
-    }
-    else if(attr_prefix=="n"){
-        tpch_relation_name = "nation";
-    }
-    else if(attr_prefix=="l"){
-        tpch_relation_name = "lineitem";
-    }
-    else if(attr_prefix=="r"){
-        tpch_relation_name = "region";
-    }
-    else if(attr_prefix=="o"){
-        tpch_relation_name = "orders";
+    // relation having all correlated attributes
+    const Ra__Catalog__Table* table = nullptr;
+    for(auto candidate: catalog->find_tables_of_column(attr[0]->name.str())){
+        bool has_attributes = true;
+        for(auto a: attr){
+            if(!catalog->has_column(candidate->name, a->name.str())){
+                has_attributes = false;
+                break;
+            }
+        }
+        if(has_attributes){
+            table = candidate;
+            break;
+        }
     }
-    else{
-        std::cout << "correlated attribute does not belong to tpch relation" << std::endl;
-        tpch_relation_name = "error";
+    if(table==nullptr){
+        std::cerr << "correlated attribute does not belong to a catalog relation" << std::endl;
     }
+    assert(table!=nullptr);
 
-    auto r = std::make_shared<Ra__Node__Relation>(tpch_relation_name, alias);
+    auto r = arena->make<Ra__Node__Relation>(symbols->intern(table->name), alias);
     
     return r;
 }
 
-bool RaTree::get_join_parent(std::shared_ptr<Ra__Node>& it){
+bool RaTree::get_join_parent(Ra__Node*& it){
     auto childNodes = it->childNodes;
     for(const auto& child: childNodes){
         if(child->node_case==RA__NODE__JOIN || child->node_case==RA__NODE__RELATION){
@@ -1963,40 +2369,21 @@ bool RaTree::get_join_parent(std::shared_ptr<Ra__Node>& it){
     return found;
 }
 
-bool RaTree::get_join_marker_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker, int& index){
-    auto childNodes = it->childNodes;
-    for(size_t i=0; i<it->n_children; i++){
-        if(childNodes[i]->node_case==RA__NODE__JOIN && std::static_pointer_cast<Ra__Node__Join>(childNodes[i])->right_where_subquery_marker==marker){
-            index = i;
-            return true;
-        }
-    }
-
-    bool found = false;
-    for(const auto& child: childNodes){
-        if(!found){
-            it = child;
-            found = get_join_marker_parent(it, marker, index);
-        }
-    }
-    return found;
-}
-
-bool RaTree::find_marker_in_predicate(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker, int& child_index){
+bool RaTree::find_marker_in_predicate(Ra__Node*& it, Ra__Node__Where_Subquery_Marker* marker, int& child_index){
 
     if(it->node_case==RA__NODE__BOOL_PREDICATE){
-        auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(it);
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(it);
         for(size_t i=0; i<bool_p->args.size(); i++){
-            if(bool_p->args[i]->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(bool_p->args[i])==marker){
+            if(bool_p->args[i]->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && static_cast<Ra__Node__Where_Subquery_Marker*>(bool_p->args[i])==marker){
                 child_index = i;
                 return true;
             }
             // if marker is part of boolean "not", then return grandparent of marker
             else if(bool_p->args[i]->node_case==RA__NODE__BOOL_PREDICATE){
-                auto bool_not_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(bool_p->args[i]);
+                auto bool_not_p = static_cast<Ra__Node__Bool_Predicate*>(bool_p->args[i]);
                 if(bool_not_p->bool_operator==RA__BOOL_OPERATOR__NOT){
                     for(size_t j=0; j<bool_not_p->args.size(); j++){
-                        if(bool_not_p->args[j]->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(bool_not_p->args[j])==marker){
+                        if(bool_not_p->args[j]->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && static_cast<Ra__Node__Where_Subquery_Marker*>(bool_not_p->args[j])==marker){
                             child_index = i;
                             return true;
                         }
@@ -2015,13 +2402,13 @@ bool RaTree::find_marker_in_predicate(std::shared_ptr<Ra__Node>& it, std::shared
     }
 
     else if(it->node_case==RA__NODE__PREDICATE){
-        auto p = std::static_pointer_cast<Ra__Node__Predicate>(it);
+        auto p = static_cast<Ra__Node__Predicate*>(it);
 
-        if(p->left->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(p->left)==marker){
+        if(p->left->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && static_cast<Ra__Node__Where_Subquery_Marker*>(p->left)==marker){
             child_index = 0;
             return true;
         }
-        else if(p->right->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(p->right)==marker){
+        else if(p->right->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && static_cast<Ra__Node__Where_Subquery_Marker*>(p->right)==marker){
             child_index = 1;
             return true;
         }
@@ -2044,26 +2431,26 @@ bool RaTree::find_marker_in_predicate(std::shared_ptr<Ra__Node>& it, std::shared
     return false;
 }
 
-bool RaTree::find_marker_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker, int& child_index){
+bool RaTree::find_marker_parent(Ra__Node*& it, Ra__Node__Where_Subquery_Marker* marker, int& child_index){
 
     if(it->node_case==RA__NODE__SELECTION){
-        auto sel = std::static_pointer_cast<Ra__Node__Selection>(it);
-        if(sel->predicate->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(sel->predicate)==marker){
+        auto sel = static_cast<Ra__Node__Selection*>(it);
+        if(sel->predicate->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && static_cast<Ra__Node__Where_Subquery_Marker*>(sel->predicate)==marker){
             return true;
         }
         // if marker is part of boolean "not", then return grandparent of marker
         else if(sel->predicate->node_case==RA__NODE__BOOL_PREDICATE){
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(it);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(it);
             if(bool_p->bool_operator==RA__BOOL_OPERATOR__NOT){
                 for(size_t i=0; i<bool_p->args.size(); i++){
-                    if(bool_p->args[i]->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(bool_p->args[i])==marker){
+                    if(bool_p->args[i]->node_case==RA__NODE__WHERE_SUBQUERY_MARKER && static_cast<Ra__Node__Where_Subquery_Marker*>(bool_p->args[i])==marker){
                         child_index = i;
                         return true;
                     }
                 }
             }
         }
-        std::shared_ptr<Ra__Node> temp_it = sel->predicate;
+        Ra__Node* temp_it = sel->predicate;
         if(find_marker_in_predicate(temp_it, marker, child_index)){
             it = temp_it;
             return true;
@@ -2081,8 +2468,8 @@ bool RaTree::find_marker_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<R
     return found;
 }
 
-bool RaTree::find_highest_node_with_only_required_relations_defined(std::shared_ptr<Ra__Node>& it, std::set<std::string> required_relations){
-    std::vector<std::pair<std::string,std::string>> defined_relations_aliases;
+bool RaTree::find_highest_node_with_only_required_relations_defined(Ra__Node*& it, const std::set<Ra__Symbol>& required_relations){
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> defined_relations_aliases;
     get_relations_aliases(it, defined_relations_aliases);
     if(defined_relations_aliases.size()==required_relations.size()){
         for(const auto& required_relation: required_relations){
@@ -2111,82 +2498,79 @@ bool RaTree::find_highest_node_with_only_required_relations_defined(std::shared_
     return found;
 }
 
-void RaTree::decorrelate_exists_complex(std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates, std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins){
+void RaTree::decorrelate_exists_complex(std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates, std::pair<Ra__Node*, Ra__Node*> markers_joins){
     // move subquery to cte, give alias and columns (correlating attributes)
-    auto exists_join = std::static_pointer_cast<Ra__Node__Join>(markers_joins.second);
-    auto cte_subquery = std::static_pointer_cast<Ra__Node__Projection>(exists_join->childNodes[1]);
-    std::string cte_name = "m" + std::to_string(counter++);
+    auto exists_join = static_cast<Ra__Node__Join*>(markers_joins.second);
+    auto cte_subquery = static_cast<Ra__Node__Projection*>(exists_join->childNodes[1]);
+    Ra__Symbol cte_name = symbols->intern("m" + std::to_string(counter++));
     cte_subquery->subquery_alias = cte_name;
 
     // select distinct correlating attributes
     cte_subquery->distinct = true;
     cte_subquery->args.clear();
     for(const auto& p: correlating_predicates){
-        auto attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(p));
-        cte_subquery->subquery_columns.push_back(attr->name);
+        auto attr = static_cast<Ra__Node__Attribute*>(std::get<0>(p));
+        cte_subquery->subquery_columns.push_back(attr->name.str());
         cte_subquery->args.push_back(attr);
     }
 
-    // list all correlating relations (using tpch name check of correlated attributes)
-    std::unordered_map<std::string, std::vector<std::shared_ptr<Ra__Node__Attribute>>> alias_attr_map; // map relation (identifier) to correlating attributes
+    // list all correlating relations (using catalog lookup of correlated attributes without alias)
+    std::map<Ra__Symbol, std::vector<Ra__Node__Attribute*>> alias_attr_map; // map relation (identifier) to correlating attributes
     for(const auto& p: correlating_predicates){
         // check correlating attribute
-        auto attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(p));
+        auto attr = static_cast<Ra__Node__Attribute*>(std::get<0>(p));
 
-        if(attr->alias.length()>0){
-            auto it = alias_attr_map.find(attr->alias);
-            if (it != alias_attr_map.end()){
-                alias_attr_map[attr->alias].push_back(attr);
-            }
-            else{
-                alias_attr_map[attr->alias] = {attr};
-            }
+        if(!attr->alias.empty()){
+            alias_attr_map[attr->alias].push_back(attr);
         }
-        // correlating attribute has no alias
+        // correlating attribute has no alias, relation is added without alias
         else{
-            std::string::size_type pos = attr->name.find('_');
-            std::string attr_prefix = attr->name.substr(0, pos);
-            auto it = alias_attr_map.find(attr_prefix);
-            if (it != alias_attr_map.end()){
-                alias_attr_map[attr_prefix].push_back(attr);
-            }
-            else{
-                alias_attr_map[attr_prefix] = {attr};
-            }
+            alias_attr_map[Ra__Symbol()].push_back(attr);
         }
     }
 
-    std::vector<std::shared_ptr<Ra__Node>> correlated_relations;
+    std::vector<Ra__Node*> correlated_relations;
     for(const auto& alias_attr: alias_attr_map){
-        correlated_relations.push_back(build_tpch_relation(alias_attr.first, alias_attr.second));
+        if(!alias_attr.first.empty()){
+            correlated_relations.push_back(build_catalog_relation(alias_attr.first, alias_attr.second));
+            continue;
+        }
+        // attributes without alias may belong to different relations
+        std::map<Ra__Symbol, std::vector<Ra__Node__Attribute*>> relation_attr_map;
+        for(auto attr: alias_attr.second){
+            relation_attr_map[get_catalog_relation_name(attr->name)].push_back(attr);
+        }
+        for(const auto& relation_attr: relation_attr_map){
+            correlated_relations.push_back(build_catalog_relation(Ra__Symbol(), relation_attr.second));
+        }
     }
 
     // cte subquery: add correlated relations
-    std::shared_ptr<Ra__Node> it = cte_subquery;
+    Ra__Node* it = cte_subquery;
     assert(get_join_parent(it));
     for(const auto& r: correlated_relations){
         assert(it->n_children==1);
-        auto cp = std::make_shared<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT);
-        cp->childNodes.push_back(it->childNodes[0]);
-        cp->childNodes.push_back(r);
-        it->childNodes[0] = cp;
+        auto cp = arena->make<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT);
+        cp->add_child(it->childNodes[0]);
+        cp->add_child(r);
+        it->set_child(0, cp);
     }
     
     ctes.push_back(cte_subquery);
 
     /**
      * find which relations are needed for left join
-     * - check correlating_predicates args alias (if no alias, check tpch name)
+     * - check correlating_predicates args alias (if no alias, check catalog)
      * find lowest child where needed relations are defined -> add left join there
      */
-    std::set<std::string> left_join_required_relations;
+    std::set<Ra__Symbol> left_join_required_relations;
     for(const auto& cor_predicate: correlating_predicates){
-        auto r_attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(cor_predicate));
-        if(r_attr->alias!=""){
+        auto r_attr = static_cast<Ra__Node__Attribute*>(std::get<0>(cor_predicate));
+        if(!r_attr->alias.empty()){
             left_join_required_relations.insert(r_attr->alias);
         }
         else{
-            left_join_required_relations.insert(get_tpch_relation_name(r_attr->name));
+            left_join_required_relations.insert(get_catalog_relation_name(r_attr->name));
         }
     }
     // only supporting left joining with one relation
@@ -2194,15 +2578,15 @@ void RaTree::decorrelate_exists_complex(std::vector<std::tuple<std::shared_ptr<R
     it = root;
     assert(find_highest_node_with_only_required_relations_defined(it, left_join_required_relations));
     // left join children: {it, cte}
-    std::shared_ptr<Ra__Node> insert_join_here = it;
+    Ra__Node* insert_join_here = it;
     it = root;
     int child_index = -1;
     assert(get_node_parent(it, insert_join_here, child_index));
-    auto left_join = std::make_shared<Ra__Node__Join>(RA__JOIN__LEFT); 
-    auto cte_relation = std::make_shared<Ra__Node__Relation>(cte_name); 
-    left_join->childNodes.push_back(it->childNodes[child_index]);
-    left_join->childNodes.push_back(cte_relation);
-    it->childNodes[child_index] = left_join;
+    auto left_join = arena->make<Ra__Node__Join>(RA__JOIN__LEFT); 
+    auto cte_relation = arena->make<Ra__Node__Relation>(cte_name); 
+    left_join->add_child(it->childNodes[child_index]);
+    left_join->add_child(cte_relation);
+    it->set_child(child_index, left_join);
 
 
     // main tree: left join cte on correlating attributes (equi join)
@@ -2213,25 +2597,25 @@ void RaTree::decorrelate_exists_complex(std::vector<std::tuple<std::shared_ptr<R
     // left_join->childNodes.push_back(it->childNodes[0]);
     // left_join->childNodes.push_back(cte_relation);
     if(correlating_predicates.size()==1){
-        auto join_p = std::make_shared<Ra__Node__Predicate>();
+        auto join_p = arena->make<Ra__Node__Predicate>();
         auto cor_predicate = correlating_predicates[0];
-        auto l_attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<1>(cor_predicate));
-        auto r_attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(cor_predicate));
+        auto l_attr = static_cast<Ra__Node__Attribute*>(std::get<1>(cor_predicate));
+        auto r_attr = static_cast<Ra__Node__Attribute*>(std::get<0>(cor_predicate));
         join_p->binaryOperator = "=";
-        join_p->left = std::make_shared<Ra__Node__Attribute>(l_attr->name, cte_name);
-        join_p->right = std::make_shared<Ra__Node__Attribute>(r_attr->name, r_attr->alias);
+        join_p->left = arena->make<Ra__Node__Attribute>(l_attr->name, cte_name);
+        join_p->right = arena->make<Ra__Node__Attribute>(r_attr->name, r_attr->alias);
         left_join->predicate = join_p;
     }
     else{
-        auto join_p = std::make_shared<Ra__Node__Bool_Predicate>();
+        auto join_p = arena->make<Ra__Node__Bool_Predicate>();
         join_p->bool_operator = RA__BOOL_OPERATOR__AND;
         for(const auto& cor_predicate: correlating_predicates){
-            auto p = std::make_shared<Ra__Node__Predicate>();
-            auto l_attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<1>(cor_predicate));
-            auto r_attr = std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(cor_predicate));
+            auto p = arena->make<Ra__Node__Predicate>();
+            auto l_attr = static_cast<Ra__Node__Attribute*>(std::get<1>(cor_predicate));
+            auto r_attr = static_cast<Ra__Node__Attribute*>(std::get<0>(cor_predicate));
             p->binaryOperator = "=";
-            p->left = std::make_shared<Ra__Node__Attribute>(l_attr->name, cte_name);
-            p->right = std::make_shared<Ra__Node__Attribute>(r_attr->name, r_attr->alias);
+            p->left = arena->make<Ra__Node__Attribute>(l_attr->name, cte_name);
+            p->right = arena->make<Ra__Node__Attribute>(r_attr->name, r_attr->alias);
             join_p->args.push_back(p);
         }
         left_join->predicate = join_p;
@@ -2241,16 +2625,15 @@ void RaTree::decorrelate_exists_complex(std::vector<std::tuple<std::shared_ptr<R
     // remove exists join
     it = root;
     int index = -1;
-    assert(get_join_marker_parent(it, exists_join->right_where_subquery_marker, index));
-    std::shared_ptr<Ra__Node> temp = it->childNodes[index];
-    it->childNodes[index] = it->childNodes[index]->childNodes[0];
-    temp->childNodes.clear();
+    assert(get_node_parent(it, exists_join, index));
+    it->set_child(index, exists_join->childNodes[0]);
+    exists_join->clear_children();
 
     // delete exists marker from main selection, replace with null check
     it = root;
-    auto marker = std::static_pointer_cast<Ra__Node__Where_Subquery_Marker>(markers_joins.first);
+    auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(markers_joins.first);
     assert(find_marker_parent(it, marker, index));
-    auto null_test = std::make_shared<Ra__Node__Null_Test>();
+    auto null_test = arena->make<Ra__Node__Null_Test>();
 
     switch(marker->type){
         case RA__JOIN__SEMI_LEFT_DEPENDENT:{
@@ -2261,29 +2644,29 @@ void RaTree::decorrelate_exists_complex(std::vector<std::tuple<std::shared_ptr<R
             null_test->type = RA__NULL_TEST__IS_NULL;
             break;
         }
-        default: std::cout << "this join type should not be found here" << std::endl;
+        default: std::cerr << "this join type should not be found here" << std::endl;
     }
 
     // can use any of the correlating predicates for null check
-    null_test->arg = std::make_shared<Ra__Node__Attribute>(std::static_pointer_cast<Ra__Node__Attribute>(std::get<0>(correlating_predicates[0]))->name, cte_name);;
+    null_test->arg = arena->make<Ra__Node__Attribute>(static_cast<Ra__Node__Attribute*>(std::get<0>(correlating_predicates[0]))->name, cte_name);;
     
     replace_subquery_marker(it, index, null_test);
 }
 
-void RaTree::replace_subquery_marker(std::shared_ptr<Ra__Node> marker_parent, int child_index, std::shared_ptr<Ra__Node> replacement){
+void RaTree::replace_subquery_marker(Ra__Node* marker_parent, int child_index, Ra__Node* replacement){
     switch(marker_parent->node_case){
         case RA__NODE__SELECTION:{
-            auto sel = std::static_pointer_cast<Ra__Node__Selection>(marker_parent);
+            auto sel = static_cast<Ra__Node__Selection*>(marker_parent);
             sel->predicate = replacement;
             break;
         }
         case RA__NODE__BOOL_PREDICATE:{
-            auto bool_p = std::static_pointer_cast<Ra__Node__Bool_Predicate>(marker_parent);
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(marker_parent);
             bool_p->args[child_index] = replacement;
             break;
         }
         case RA__NODE__PREDICATE:{
-            auto p = std::static_pointer_cast<Ra__Node__Predicate>(marker_parent);
+            auto p = static_cast<Ra__Node__Predicate*>(marker_parent);
             if(child_index==0){
                 p->left = replacement;
             }
@@ -2291,15 +2674,15 @@ void RaTree::replace_subquery_marker(std::shared_ptr<Ra__Node> marker_parent, in
                 p->right = replacement;
             }
             else{
-                std::cout << "This should be unreachable :)" << std::endl;
+                std::cerr << "This should be unreachable :)" << std::endl;
             }
             break;
         }
-        default: std::cout << "This node type should not be parent of marker" << std::endl;
+        default: std::cerr << "This node type should not be parent of marker" << std::endl;
     }
 }
 
-bool RaTree::is_trivially_correlated(std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates){
+bool RaTree::is_trivially_correlated(std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates){
     if(correlating_predicates.size()==1 && (std::get<2>(correlating_predicates[0])=="=" || std::get<2>(correlating_predicates[0])=="<>")){
         return true;
     }
@@ -2,44 +2,219 @@
 #define ra_tree
 
 #include "relational_algebra.h"
+#include "ra_arena.h"
+#include "ra_symbol_table.h"
+#include "ra_catalog.h"
 #include <set>
 #include <unordered_map>
 #include <map>
 #include <queue>
+#include <functional>
+
+typedef enum {
+    RA__DECOUPLE__COST_BASED = 0, // decouple dependent joins if cheaper than joining with D
+    RA__DECOUPLE__ALWAYS = 1, // decouple dependent joins whenever possible
+    RA__DECOUPLE__NEVER = 2 // always join with D
+} Ra__Decouple__Strategy;
+
+/// relation of a join graph: subtree below the cross products and selections of the graph
+struct Ra__Join_Graph__Relation {
+    Ra__Node* node = nullptr;
+    /// relation names and aliases defined by the subtree
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> relations_aliases;
+    /// estimated rows, after the predicates referencing only this relation
+    double rows = 1;
+};
+
+/// conjunct of the selections of a join graph
+struct Ra__Join_Graph__Predicate {
+    Ra__Node* predicate = nullptr;
+    /// bitset of the graph relations referenced, 0 if no relation of the graph is referenced (e.g. correlated)
+    uint64_t relations = 0;
+};
+
+/// inner join graph of a subtree of cross products and selections
+struct Ra__Join_Graph {
+    std::vector<Ra__Join_Graph__Relation> relations;
+    std::vector<Ra__Join_Graph__Predicate> predicates;
+    /// cross products and selections of the subtree, replaced when the joins are reordered
+    std::vector<Ra__Node*> operators;
+    /// bitsets of the relations connected to each relation by a predicate on two relations
+    std::vector<uint64_t> neighbors;
+    /// estimated rows of joined relations by bitset
+    std::unordered_map<uint64_t, double> join_rows;
+    /// conjunction of join predicates used for estimating the selectivity of a set of joins
+    Ra__Node__Bool_Predicate* conjunction = nullptr;
+};
+
+/// constant expression over plan cache template parameters, folded by the cache when the template is filled
+struct Ra__Template_Fold {
+    /// unfolded expression
+    Ra__Node* expression = nullptr;
+    /// see RaTree::fold_constant_expression
+    bool is_compared = false;
+};
+
+/// occurrence of a subtree in the tree or its CTEs, candidate for sharing as CTE
+struct Ra__Common_Subexpression {
+    Ra__Node* node = nullptr;
+    Ra__Node* parent = nullptr;
+    int child_index = -1;
+    /// closest projection above the subtree (query block)
+    Ra__Node* block = nullptr;
+    /// index of the CTE containing the subtree, -1 for the main tree
+    int tree = -1;
+};
 
 class RaTree {
     public:
-        RaTree(std::shared_ptr<Ra__Node> _root, std::vector<std::shared_ptr<Ra__Node>> _ctes, uint64_t _counter);
+        /**
+         * @param _root root node of main relational algebra tree
+         * @param _ctes relational algebra trees of Common Table Expressions
+         * @param _counter counter to continue generating unique ids from
+         * @param _arena arena holding all nodes of the tree, owned by the RaTree from now on
+         * @param _symbols symbol table of all identifiers in the tree, owned by the RaTree from now on
+         * @param _catalog schema of the relations used in the tree
+         */
+        RaTree(Ra__Node* _root, std::vector<Ra__Node*> _ctes, uint64_t _counter, std::unique_ptr<RaArena> _arena, std::unique_ptr<RaSymbolTable> _symbols, std::shared_ptr<const RaCatalog> _catalog);
 
         /// Root node of main relational algebra tree
-        std::shared_ptr<Ra__Node> root;
+        Ra__Node* root = nullptr;
 
         /// Relational algebra trees of Common Table Expressions
-        std::vector<std::shared_ptr<Ra__Node>> ctes;
+        std::vector<Ra__Node*> ctes;
+
+        /// join graphs with at most this many relations are ordered by dynamic programming, larger ones greedily
+        static constexpr size_t default_join_order_dp_threshold = 12;
 
         /**
          * optimizes the RaTree
+         * @param _decouple_strategy whether dependent joins are decoupled during unnesting
+         * @param _join_order_dp_threshold maximum number of relations of a join graph ordered by dynamic programming,
+         * larger join graphs are ordered greedily
+         */
+        void optimize(Ra__Decouple__Strategy _decouple_strategy=RA__DECOUPLE__COST_BASED, size_t _join_order_dp_threshold=default_join_order_dp_threshold);
+
+        /**
+         * Estimates the cost of evaluating the tree incl. its CTEs, 
+         * as the sum of the estimated intermediate result sizes (C_out)
+         * @return estimated cost
          */
-        void optimize();
+        double estimate_cost();
+
+        /**
+         * Estimates the tree incl. its CTEs and stores the estimated rows and row width on every operator node,
+         * shown by to_string for debugging
+         */
+        void annotate_estimates();
+
+        /**
+         * Set by the plan cache while optimizing a template, where the literals are placeholders:
+         * returns whether a constant is a placeholder and the value of the literal it stands for
+         */
+        std::function<bool(const Ra__Node__Constant*, std::string&)> template_literal;
+
+        /**
+         * Constant expressions over template placeholders which fold for the literals, they are not folded but
+         * replaced by the string constant template_fold_start index template_fold_end
+         */
+        std::vector<Ra__Template_Fold> template_folds;
+        static constexpr char template_fold_start = '\x03';
+        static constexpr char template_fold_end = '\x04';
+
+        /**
+         * Evaluates a constant expression the way fold_constants does
+         * @param arena arena of the new nodes
+         * @param expression constants, type casts and arithmetic expressions
+         * @param is_compared see fold_constant_expression
+         * @return constant or type cast of a constant, nullptr if the expression can not be evaluated
+         */
+        static Ra__Node* evaluate_constant_expression(RaArena& arena, Ra__Node* expression, bool is_compared);
 
     private:
         // to generate unique ids
         uint64_t counter;
 
+        /// Storage of all nodes of the tree, nodes are freed together with the RaTree
+        std::unique_ptr<RaArena> arena;
+
+        /// Interned identifiers (relation names, aliases, attribute names) of the tree
+        std::unique_ptr<RaSymbolTable> symbols;
+
+        /// alias of the "d" projection of dependent joins
+        Ra__Symbol symbol_d;
+
+        /// schema the query runs against, shared with the parser
+        std::shared_ptr<const RaCatalog> catalog;
+
+        /// catalog relation of attribute symbols, by symbol id of the attribute name
+        std::unordered_map<uint32_t, Ra__Symbol> catalog_relation_names;
+
+        /// whether an attribute is a column of a relation, by symbol ids (relation id << 32 | attribute id)
+        std::unordered_map<uint64_t, bool> catalog_attributes;
+
+        /// set when an attribute missing from the catalog was reported, it is reported once per statement
+        bool reported_missing_attribute = false;
+
+        /// relation names of relation aliases and names in the tree by symbol id, filled by index_cost_relations
+        std::unordered_map<uint32_t, Ra__Symbol> cost_relations;
+
+        /// CTE trees by CTE name symbol id, filled by index_cost_relations
+        std::unordered_map<uint32_t, Ra__Node*> cost_ctes;
+
+        /// while costing a decoupling decision: estimated rows of the D projection, 0 to cost the plan without D (decoupled),
+        /// -1 when costing the tree as it is
+        double cost_d_cardinality = -1;
+
+        /// estimated rows of the last D projection costed, bounds the values of "d" attributes in the subquery above it
+        double cost_d_rows = -1;
+
+        /// while costing a magic set filter: subquery input the filter is costed on, and the fraction of its rows the filter keeps
+        Ra__Node* cost_magic_set_input = nullptr;
+        double cost_magic_set_selectivity = 1;
+
+        /// selectivities of the markers of "in" subquery joins by marker, filled when the join is costed, below the selection evaluating the marker
+        std::unordered_map<uint64_t, double> cost_marker_selectivities;
+
+        /// epoch of the structural hashes cached on the nodes, see Ra__Node::structural_hash
+        uint64_t hash_epoch = 1;
+
+        /// set by annotate_estimates: estimate_cardinality stores its estimates on the nodes
+        bool annotating_estimates = false;
+
         // works: (false,true), (false,false), (true,true)
         const bool push_down_correlating_predicates = false;
-        const bool decouple = true;
+        Ra__Decouple__Strategy decouple_strategy = RA__DECOUPLE__COST_BASED;
         const bool convert_cp_to_join = false;
+        size_t join_order_dp_threshold = default_join_order_dp_threshold;
 
         void decorrelate_all_exists_in_subqueries();
 
-        void decorrelate_exists_in_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> marker_join);
+        void decorrelate_exists_in_subquery(std::pair<Ra__Node*, Ra__Node*> marker_join);
 
         /**
          * Find and decorrelate all correlated exists in tree.
          */
         void decorrelate_all_exists();
 
+        /**
+         * Converts all correlated aggregate subqueries over the same relations as their outer query to window functions
+         */
+        void convert_correlated_aggregates_to_windows();
+
+        /**
+         * Converts a correlated aggregate subquery to a window function if the outer query contains the subquery's relations
+         * and predicates, and the subquery is correlated by equality on keys of these relations: each outer row's partition
+         * by the keys then holds the subquery's rows, e.g. TPC-H Q17
+         *   l_quantity < (select 0.2*avg(l_quantity) from lineitem where l_partkey=p_partkey)
+         * becomes a single scan of the outer query with 0.2*avg(l_quantity) over (partition by l_partkey).
+         * min, max and avg do not change if other outer relations repeat all rows of a partition, sum and count are only
+         * converted if each other outer relation joins at most one row by a unique key.
+         * @param marker_join pair of subquery marker and corresponding dependent join
+         * @return true if the subquery was converted
+         */
+        bool convert_correlated_aggregate_to_window(std::pair<Ra__Node*, Ra__Node*> marker_join);
+
         /**
          * Decorrelates all basic subqueries (excl. exists, in)
          */
@@ -49,7 +224,28 @@ class RaTree {
          * Decorrelate a basic subquery
          * @param markers_joins pair with subquery marker and corresponding join node
          */
-        void decorrelate_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins);
+        void decorrelate_subquery(std::pair<Ra__Node*, Ra__Node*> markers_joins);
+
+        /**
+         * Materialize the left side of a decorrelated dependent join as CTE, used by the outer query and D
+         * @param original_dep_join original dependent join, left child is replaced by the CTE
+         * @param d_projection D projection, child is replaced by the CTE
+         * @return name of the CTE
+         */
+        Ra__Symbol materialize_outer_as_cte(Ra__Node__Join* original_dep_join, Ra__Node__Projection* d_projection);
+
+        /**
+         * Filter a decoupled subquery by semi joins on the distinct correlation values of the outer query (magic set),
+         * if the outer query is selective enough for the filter to be cheaper than evaluating the subquery for all values
+         * @param inner_parent parent of the decoupled subquery input
+         * @param child_index index of the decoupled subquery input in its parent
+         * @param original_dep_join original dependent join, its left child is the outer query
+         * @param d_projection D projection
+         * @param d_rename_map map "d" attributes to equivalent attributes in the decoupled subquery
+         * @param cte_already_setup true if outer is already materialized as CTE
+         * @return true if the subquery was filtered (outer is materialized as CTE)
+         */
+        bool add_magic_set_filter(Ra__Node* inner_parent, int child_index, Ra__Node__Join* original_dep_join, Ra__Node__Projection* d_projection, const std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& d_rename_map, bool cte_already_setup);
         
         /**
          * Transform trivially correlated exists subquery to uncorrelated in subquery
@@ -59,7 +255,7 @@ class RaTree {
          * @param sel selection in subquery containing correlating predicate
          * @param markers_joins pair of subquery marker and corresponding exists join node
          */
-        void decorrelate_exists_trivial(bool is_boolean_predicate, std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t> correlating_predicate, std::shared_ptr<Ra__Node__Selection> sel, std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins);
+        void decorrelate_exists_trivial(bool is_boolean_predicate, std::tuple<Ra__Node*,Ra__Node*,std::string,size_t> correlating_predicate, Ra__Node__Selection* sel, std::pair<Ra__Node*, Ra__Node*> markers_joins);
 
         /**
          * Transform complex correlated exists subquery to uncorrelated in subquery with left join and null check
@@ -67,21 +263,21 @@ class RaTree {
          * @param correlating_predicates vector of correlating predicates in subquery (left, right, operator, child_index)
          * @param markers_joins pair of subquery marker and corresponding exists join node
          */
-        void decorrelate_exists_complex(std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates, std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins);
+        void decorrelate_exists_complex(std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates, std::pair<Ra__Node*, Ra__Node*> markers_joins);
 
         /**
          * Check if subquery is trivially correlated
          * @param correlating_predicates vector with predicates (left, right, operator, child_index)
          * @return true if trivially correlated
          */
-        bool is_trivially_correlated(std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>> correlating_predicates);
+        bool is_trivially_correlated(std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>> correlating_predicates);
         
         /**
          * decorrelate an exists subquery
          * 
          * @param markers_joins pair containing subquery marker and corresponding join node of exists subquery
          */
-        void decorrelate_exists_subquery(std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>> markers_joins);
+        void decorrelate_exists_subquery(std::pair<Ra__Node*, Ra__Node*> markers_joins);
 
         /**
          * Recursively find all subquery markers within predicates in subtree
@@ -90,14 +286,14 @@ class RaTree {
          * @param markers vector which is filled with all found subquery markers (pair.second is filled with nullptr, will later be used for corresponding subquery nodes)
          * @param marker_type type of subquery markers to find
          */
-        void find_subquery_markers(std::shared_ptr<Ra__Node> it, std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>>& markers, std::vector<Ra__Join__JoinType> marker_types);
+        void find_subquery_markers(Ra__Node* it, std::vector<std::pair<Ra__Node*, Ra__Node*>>& markers, std::vector<Ra__Join__JoinType> marker_types);
 
         /**
          * Recursively find all join nodes corresponding to given subquery markers
          * @param it RaTree pointer as starting node of search
          * @param markers vector of subquery markers to find; pair.second is filled with pointers to found join nodes
          */
-        void find_joins_by_markers(std::shared_ptr<Ra__Node> it, std::vector<std::pair<std::shared_ptr<Ra__Node>, std::shared_ptr<Ra__Node>>>& markers);
+        void find_joins_by_markers(Ra__Node* it, std::vector<std::pair<Ra__Node*, Ra__Node*>>& markers);
 
         /**
          * Replace the subquery marker in a predicate with a new RaNode
@@ -105,7 +301,7 @@ class RaTree {
          * @param child_index index which subquery marker has in its parent
          * @param replacement RaNode to replace subquery marker with
          */
-        void replace_subquery_marker(std::shared_ptr<Ra__Node> marker_parent, int child_index, std::shared_ptr<Ra__Node> replacement);
+        void replace_subquery_marker(Ra__Node* marker_parent, int child_index, Ra__Node* replacement);
 
         /**
          * Checks whether a predicate is correlating
@@ -113,7 +309,7 @@ class RaTree {
          * @param relations_aliases relations and aliases which are defined in the current subquery
          * @return true if predicate is correlating
          */
-        std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string> is_correlating_predicate(std::shared_ptr<Ra__Node__Predicate> p, const std::vector<std::pair<std::string,std::string>>& relations_aliases);
+        std::tuple<Ra__Node*,Ra__Node*,std::string> is_correlating_predicate(Ra__Node__Predicate* p, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases);
 
         /**
          * Get correlating predicates in a predicate
@@ -122,7 +318,7 @@ class RaTree {
          * @param is_boolean_predicate true if correlating predicate is part of a boolean predicate
          * @param relations_aliases relation names and aliases defined (attribute correlated, if referencing relation outside of these)
          */
-        void get_correlating_predicates(std::shared_ptr<Ra__Node> it, std::vector<std::tuple<std::shared_ptr<Ra__Node>,std::shared_ptr<Ra__Node>,std::string,size_t>>& correlating_predicates, bool& is_boolean_predicate, std::vector<std::pair<std::string,std::string>> relations_aliases);
+        void get_correlating_predicates(Ra__Node* it, std::vector<std::tuple<Ra__Node*,Ra__Node*,std::string,size_t>>& correlating_predicates, bool& is_boolean_predicate, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases);
 
         /**
          * Push down a dependent join through its right child
@@ -130,7 +326,7 @@ class RaTree {
          * @param original_right_projection pointer to original subquery projection (dep join is in subtree of projection)
          * @param push_down_dep_joins_queue if new dependent joins are introduces through the push down, add them to this queue
          */
-        void push_down_dep_join(std::shared_ptr<Ra__Node__Join> dep_join, std::shared_ptr<Ra__Node> original_right_projection, std::queue<std::shared_ptr<Ra__Node__Join>>& push_down_dep_joins_queue);
+        void push_down_dep_join(Ra__Node__Join* dep_join, Ra__Node* original_right_projection, std::queue<Ra__Node__Join*>& push_down_dep_joins_queue);
 
         /**
          * Perform predicate push down on the entire RaTree
@@ -144,7 +340,7 @@ class RaTree {
          * @param comparsion_subtree pointer to subtree to compare
          * @return vector of attributes containing intersection result
          */
-        std::vector<std::shared_ptr<Ra__Node>> intersect_correlated_attributes(std::shared_ptr<Ra__Node> d_projection, std::shared_ptr<Ra__Node> comparsion_subtree);
+        std::vector<Ra__Node*> intersect_correlated_attributes(Ra__Node* d_projection, Ra__Node* comparsion_subtree);
 
         /**
          * Find subquery marker in a predicate 
@@ -153,7 +349,7 @@ class RaTree {
          * @param child_index child index which subquery marker has in parent node
          * @return true if found, else false
          */
-        bool find_marker_in_predicate(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker, int& child_index);
+        bool find_marker_in_predicate(Ra__Node*& it, Ra__Node__Where_Subquery_Marker* marker, int& child_index);
 
         /**
          * Find the parent node of a subquery marker
@@ -162,35 +358,351 @@ class RaTree {
          * @param child_index child index of subquery marker
          * @return true if parent is found, else false
          */
-        bool find_marker_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker, int& child_index);
+        bool find_marker_parent(Ra__Node*& it, Ra__Node__Where_Subquery_Marker* marker, int& child_index);
         
+        /**
+         * Evaluates arithmetic of int/numeric constants and date/interval arithmetic in all predicates and expressions
+         * of the tree and its CTEs, e.g. date '1993-07-01' + interval '3' month becomes date '1993-10-01'
+         */
+        void fold_constants();
+
+        /**
+         * Folds the constants in the predicates and expressions of a subtree
+         * @param it root of subtree
+         */
+        void fold_constants(Ra__Node* it);
+
+        /**
+         * Folds the constant operands of comparisons within a predicate, predicates are copied instead of modified
+         * @param predicate predicate, may be nullptr
+         * @return folded predicate, or predicate if nothing was folded
+         */
+        Ra__Node* fold_constant_predicate(Ra__Node* predicate);
+
+        /**
+         * Folds the constant subexpressions of an expression, expressions are copied instead of modified as they may be shared
+         * @param expression expression, may be nullptr
+         * @param is_compared whether the expression is an operand of a comparison, where date +/- interval (a timestamp at midnight)
+         * may be replaced by a date
+         * @return folded expression, or expression if nothing was folded
+         */
+        Ra__Node* fold_constant_expression(Ra__Node* expression, bool is_compared);
+
+        /**
+         * Replaces a constant expression over template placeholders by a placeholder of template_folds
+         * @param expression constant expression with folded operands
+         * @param is_compared see fold_constant_expression
+         * @return placeholder constant, nullptr if the expression does not fold for the literals
+         */
+        Ra__Node* defer_template_fold(Ra__Node__Expression* expression, bool is_compared);
+
+        /**
+         * @param expression expression with folded operands
+         * @param has_placeholder set to true if a template placeholder or a placeholder of template_folds is found
+         * @return whether the expression consists of constants, type casts and arithmetic only
+         */
+        bool is_template_constant(Ra__Node* expression, bool& has_placeholder);
+
+        /**
+         * @param expression constant expression, may contain placeholders of template_folds
+         * @param literals whether template placeholders are replaced by their literals
+         * @return copy with the placeholders of template_folds replaced by their unfolded expressions
+         */
+        Ra__Node* replace_template_placeholders(Ra__Node* expression, bool literals);
+
+        /**
+         * Splits the disjunctions of pairwise disjoint branches in the selections of the tree and its CTEs into
+         * a union all of the branches, if the indexable conjuncts of the branches are estimated to be cheaper than
+         * scanning for the disjunction (e.g. TPC-H Q19)
+         */
+        void split_disjunctions();
+
+        /**
+         * Replaces a selection over a join block by a union all with one branch per argument of a disjunction
+         * in the selection's predicate. Branches must be disjoint (an attribute restricted to different numbers),
+         * so that union all returns every row once; conjuncts of all branches are factored out of the disjunction
+         * @param selection selection
+         * @return true if the selection was split
+         */
+        bool split_disjunction(Ra__Node__Selection* selection);
+
+        /**
+         * @param p comparison of an attribute with constants
+         * @return true if the constants are numbers, which are equal exactly if their values are, and no template placeholders
+         */
+        bool has_only_number_constants(Ra__Node__Predicate* p);
+
+        /**
+         * @param a conjuncts of a conjunction
+         * @param b conjuncts of another conjunction
+         * @return true if a and b restrict an attribute by "=" or "in" to disjoint numbers, and can not both be true
+         */
+        bool are_disjoint_conjunctions(const std::vector<Ra__Node*>& a, const std::vector<Ra__Node*>& b);
+
+        /**
+         * Converts long in lists of constants on base relation columns in the selections of the tree and its CTEs
+         * into a join with a values relation, if looking up the values by an index is estimated to be cheaper
+         */
+        void convert_in_lists_to_values();
+
+        /**
+         * Converts "attr in (constants)" to "attr = values_N.value", the values relation is to be joined below the selection
+         * @param conjunct conjunct of a selection, replaced by the join predicate if converted
+         * @param input input of the selection, the attribute's relation must be defined in it
+         * @return values relation of the distinct constants, nullptr if the conjunct is not converted
+         */
+        Ra__Node* convert_in_list_to_values(Ra__Node*& conjunct, Ra__Node* input);
+
+        /**
+         * Converts the left and full outer joins of the tree and its CTEs to inner and left joins, where a predicate
+         * above the join rejects the null-extended rows of a nullable side (e.g. "where o.o_totalprice>100" above
+         * "customer c left join orders o"), outer joins above are simplified first
+         */
+        void simplify_outer_joins();
+
+        /**
+         * Converts a left join to an inner join if a predicate filtering its result rejects nulls of its right side,
+         * a full outer join to a left join (left side rejected) or inner join (both sides rejected).
+         * Predicates are collected from the selections and inner joins above the join, up to the query block
+         * @param join join
+         * @return true if the join type was changed
+         */
+        bool simplify_outer_join(Ra__Node__Join* join);
+
+        /**
+         * @param predicate predicate, may be nullptr
+         * @param nullable relations and aliases of the nullable side of an outer join
+         * @param preserved relations and aliases of the other side, unqualified attributes of relations defined on
+         * both sides are not assigned to the nullable side
+         * @return true if predicate is null or false for every row in which all attributes of the nullable side are null
+         */
+        bool is_null_rejecting(Ra__Node* predicate, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& nullable, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& preserved);
+
+        /**
+         * @param expression expression, may be nullptr
+         * @param nullable see is_null_rejecting
+         * @param preserved see is_null_rejecting
+         * @return true if expression is null whenever the attributes of the nullable side are null
+         * (an attribute of it, or arithmetic, casts and strict functions of one)
+         */
+        bool is_null_on_null_side(Ra__Node* expression, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& nullable, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& preserved);
+
+        /**
+         * Removes joins of the tree and its CTEs which do not change the result, by the keys of the catalog:
+         * inner joins to a relation whose only use is the equi join with a not null foreign key referencing it
+         * (uses of its key columns are replaced by the foreign key columns), and left joins to a relation by
+         * a unique key whose attributes are not used above the join
+         */
+        void eliminate_joins();
+
+        /**
+         * Removes the inner join of a relation joined by a not null foreign key referencing its primary or a unique key,
+         * if no other column than the referenced key is used (also by selections directly above the relation, moved above the join block)
+         * @param relation relation, its name and qualifier are defined once in the tree
+         * @param attributes all attributes of the tree and its CTEs
+         * @return true if the join was removed
+         */
+        bool eliminate_foreign_key_join(Ra__Node__Relation* relation, const std::vector<Ra__Node__Attribute*>& attributes);
+
+        /**
+         * Removes the left join of a relation if the join predicate equates a unique key of the relation
+         * (at most one match per row) and no attribute of the relation is used outside the join predicate
+         * @param relation relation, its name and qualifier are defined once in the tree
+         * @param attributes all attributes of the tree and its CTEs
+         * @return true if the join was removed
+         */
+        bool eliminate_unique_key_left_join(Ra__Node__Relation* relation, const std::vector<Ra__Node__Attribute*>& attributes);
+
+        /**
+         * @param attr attribute
+         * @param relation base relation with attached catalog table
+         * @return true if attr may refer to relation: qualified by its qualifier, or unqualified and a column of its table or "*"
+         */
+        bool is_relation_attribute(Ra__Node__Attribute* attr, Ra__Node__Relation* relation);
+
+        /**
+         * @param node root of a join block (selections, cross products and inner joins)
+         * @param conjuncts filled with the conjuncts of the predicates of the join block
+         */
+        void get_join_block_conjuncts(Ra__Node* node, std::vector<Ra__Node*>& conjuncts);
+
+        /**
+         * Drops the distinct of projections whose input is already unique on the projected columns
+         * (e.g. a domain projection of a primary key, or columns grouped by)
+         */
+        void remove_redundant_distincts();
+
+        /**
+         * Derives the keys of a subtree from the primary and unique keys of the catalog,
+         * through selections, joins, group bys and derived tables
+         * @param node root of the subtree
+         * @param keys filled with sets of (qualifier, column) whose values identify the rows of the subtree,
+         * an empty key if the subtree returns at most one row
+         */
+        void get_unique_keys(Ra__Node* node, std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& keys);
+
+        /**
+         * @param join join
+         * @param conjuncts predicates of the selection above the join, join predicates of a cross product
+         * @param keys filled with the keys of the join's result: the keys of both sides combined, and the keys of a side
+         * if the other side's key is equated to its columns
+         */
+        void get_join_unique_keys(Ra__Node__Join* join, const std::vector<Ra__Node*>& conjuncts, std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& keys);
+
+        /**
+         * @param conjuncts join predicates
+         * @param key key of one side of the join
+         * @param side subtree of that side
+         * @return whether each column of the key is equated to a column of the other side
+         */
+        bool is_equated_key(const std::vector<Ra__Node*>& conjuncts, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& key, Ra__Node* side);
+
+        /**
+         * Attaches the catalog table to a relation, relations named like a CTE refer to the CTE
+         * @param relation relation
+         * @return the catalog table, nullptr for CTEs and unknown tables
+         */
+        const Ra__Catalog__Table* attach_catalog_table(Ra__Node__Relation* relation);
+
+        /**
+         * @param node root of a subquery
+         * @return whether the subquery contains a limit, whose rows depend on correlated predicates
+         */
+        bool has_limit(Ra__Node* node);
+
+        /**
+         * Pushes the limit of ordered blocks (top-N) into derived tables, the branches of union alls of split disjunctions
+         * and the preserved side of left joins matching at most one row: the subquery returns the first count+offset rows
+         * in the order of the block, the limit above is kept. Repeated until no more limits are pushed
+         */
+        void push_down_limits();
+
+        /**
+         * @param limit limit below the projection of a block
+         * @return whether the limit was pushed below the block's from clause
+         */
+        bool push_down_limit(Ra__Node__Limit* limit);
+
+        /**
+         * @param attr attribute referencing a column of a derived table or union all
+         * @param alias alias of the derived table or union all
+         * @param columns output columns, empty for unnamed columns
+         * @param expressions expressions computing the output columns
+         * @return copy of the expression computing the referenced column, nullptr if not found
+         */
+        Ra__Node* get_subquery_column(Ra__Node__Attribute* attr, Ra__Symbol alias, const std::vector<std::string>& columns, const std::vector<Ra__Node*>& expressions);
+
+        /**
+         * Inserts a limit (and order by) directly below the projection of a subquery
+         * @param projection projection of the subquery
+         * @param count limit count
+         * @param order_by order by of the block above, nullptr if unordered
+         * @param column maps attributes of the order by to expressions of the subquery, nullptr if not computable
+         * @return false if the subquery is already limited or ordered, or the order by is not computable in the subquery
+         */
+        bool add_block_limit(Ra__Node__Projection* projection, Ra__Node* count, Ra__Node__Order_By* order_by, const std::function<Ra__Node*(Ra__Node__Attribute*)>& column);
+
+        /**
+         * Removes the columns of derived tables and CTEs which are not used above them (incl. their subquery_columns),
+         * "select *" of a derived table or CTE is expanded to the used columns of its from clause.
+         * Repeated until no more columns are removed, as removed columns may have been the only use of columns below
+         */
+        void prune_columns();
+
+        /**
+         * One round of prune_columns
+         * @return true if a column was removed
+         */
+        bool prune_unused_columns();
+
+        /**
+         * Collects the from items of a query block: relations, derived tables, values lists and unions,
+         * subqueries of subquery joins are not collected
+         * @param node input of the query block's projection
+         * @param items from items
+         */
+        void get_from_items(Ra__Node* node, std::vector<Ra__Node*>& items);
+
+        /**
+         * Replaces "select *" of a derived table or CTE by the used columns of its from items
+         * @param projection projection of the derived table or CTE, with "*" as only argument
+         * @param required names of the used columns
+         * @return false if a from item's columns are not known or several from items have a column of the same name
+         */
+        bool expand_star(Ra__Node__Projection* projection, const std::set<std::string>& required);
+
+        /**
+         * @param conjuncts predicates
+         * @return the predicate if there is one, else a boolean "and" of the predicates
+         */
+        Ra__Node* make_conjunction(const std::vector<Ra__Node*>& conjuncts);
+
+        /**
+         * Copies a predicate or expression, constants and subquery markers are not copied
+         * @param expression predicate or expression, may be nullptr
+         * @return copy
+         */
+        Ra__Node* copy_expression(Ra__Node* expression);
+
+        /**
+         * Copies a join block (see is_join_block) incl. its predicates
+         * @param node root of join block
+         * @return copy, linked to its children
+         */
+        Ra__Node* copy_join_block(Ra__Node* node);
+
+        /**
+         * Builds equivalence classes over the attributes joined by "=" in a conjunction of predicates, removes duplicate
+         * equi predicates (a=b, b=a) and derives the comparisons with constants implied for the other attributes of a class,
+         * e.g. l_orderkey<1000 from l_orderkey=o_orderkey and o_orderkey<1000
+         * @param conjuncts predicates of the conjunction, derived predicates are appended
+         * @param selection selection of the conjunction, predicates are only derived for relations defined below it
+         * @return true if conjuncts changed
+         */
+        bool infer_equivalent_predicates(std::vector<Ra__Node*>& conjuncts, Ra__Node* selection);
+
+        /**
+         * Key of an attribute in an equivalence class
+         * @param attr attribute
+         * @return (relation alias or catalog relation, attribute name), relation is empty if unknown
+         */
+        std::pair<Ra__Symbol,Ra__Symbol> get_attribute_key(Ra__Node__Attribute* attr);
+
+        /**
+         * Finds the representative of an attribute's equivalence class (union find with path compression)
+         * @param classes parent of each attribute, attributes not yet in a class are added as their own class
+         * @param attribute attribute key
+         * @return representative attribute key
+         */
+        std::pair<Ra__Symbol,Ra__Symbol> find_equivalence_class(std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& classes, const std::pair<Ra__Symbol,Ra__Symbol>& attribute);
+
         /**
          * Splits predicate into splittable subpredicates (split by "and")
          * @param predicate predicate split
          * @param predicates_relations vector of split subpredicates (pair.second is used to in get_predicate_relations)
          */
-        void split_selection_predicates(std::shared_ptr<Ra__Node> predicate, std::vector<std::pair<std::shared_ptr<Ra__Node>,std::vector<std::string>>>& predicates_relations);
+        void split_selection_predicates(Ra__Node* predicate, std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>>& predicates_relations);
 
         /**
          * add a predicate to a selecction predicate (with "and")
          * @param predicate predicate to add
          * @param selection selection to add predicate to
          */
-        void add_predicate_to_selection(std::shared_ptr<Ra__Node> predicate, std::shared_ptr<Ra__Node> selection);
+        void add_predicate_to_selection(Ra__Node* predicate, Ra__Node* selection);
 
         /**
          * add a predicate to a join predicate (with "and")
          * @param predicate predicate to add
          * @param join join to add predicate to
          */
-        void add_predicate_to_join(std::shared_ptr<Ra__Node> predicate, std::shared_ptr<Ra__Node> join);
+        void add_predicate_to_join(Ra__Node* predicate, Ra__Node* join);
 
         /**
          * Get all selection nodes in a subtree
          * @param it pointer to subtree
          * @param selections vector to be filled with all found selection nodes
          */
-        void get_all_selections(std::shared_ptr<Ra__Node> it, std::vector<std::shared_ptr<Ra__Node>>& selections);
+        void get_all_selections(Ra__Node* it, std::vector<Ra__Node*>& selections);
 
         /**
          * Find the lowest node where a predicate's referenced relations are defined, and insert the predicate in an selection over the node
@@ -199,7 +711,7 @@ class RaTree {
          * @param cp_to_join whether predicate should be added to join node instead of selection if possible
          * @return true if a child was found where referenced relations are defined
          */
-        bool find_lowest_child_insert_selection(const std::pair<std::shared_ptr<Ra__Node>,std::vector<std::string>>& predicate_relations, std::shared_ptr<Ra__Node> selection, bool cp_to_join);
+        bool find_lowest_child_insert_selection(const std::pair<Ra__Node*,std::vector<Ra__Symbol>>& predicate_relations, Ra__Node* selection, bool cp_to_join);
 
         /**
          * DFS find node in subtree where all given relations are defined
@@ -207,7 +719,7 @@ class RaTree {
          * @param relations vector of relations which need to be defined
          * @return true if a node was found, else false
          */
-        bool find_node_where_relations_defined(std::shared_ptr<Ra__Node>& it, const std::vector<std::string>& relations);
+        bool find_node_where_relations_defined(Ra__Node*& it, const std::vector<Ra__Symbol>& relations);
 
         /**
          * Checks whether all relations are defined in subtree of this node
@@ -215,87 +727,128 @@ class RaTree {
          * @param relations vector of relations which need to be defined
          * @return true if relations are defined, else false
          */
-        bool has_relations_defined(std::shared_ptr<Ra__Node> node, const std::vector<std::string>& relations);
+        bool has_relations_defined(Ra__Node* node, const std::vector<Ra__Symbol>& relations);
 
         /**
-         * Find the parent node of a node in a subtree
-         * @param it pointer to subtree 
+         * Find the parent node of a node in a subtree, follows the parent links (O(depth)),
+         * searches the subtree only if a node on the way is shared by several parents
+         * @param it pointer to subtree, will point to parent node if returned true
          * @param child_target child node, whose parent to find
          * @param child_index child index which node has in parent node
          * @return true if parent node was found
          */
-        bool get_node_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node> child_target, int& child_index);
+        bool get_node_parent(Ra__Node*& it, Ra__Node* child_target, int& child_index);
+
+        /**
+         * DFS find the parent node of a node in a subtree
+         * @param it pointer to subtree, will point to parent node if returned true
+         * @param child_target child node, whose parent to find
+         * @param child_index child index which node has in parent node
+         * @return true if parent node was found
+         */
+        bool find_node_parent(Ra__Node*& it, Ra__Node* child_target, int& child_index);
+
+        /**
+         * Parent of a node through its parent link, O(1)
+         * @param node node whose parent to find
+         * @param child_index child index which node has in parent node
+         * @return parent node, nullptr if node is a root, or is referenced by several parents
+         */
+        Ra__Node* get_linked_parent(Ra__Node* node, int& child_index);
+
+        /**
+         * Parent of a node which is known to be in a subtree, to climb up the subtree
+         * @param node node in subtree, whose parent to find
+         * @param subtree root of subtree
+         * @param child_index child index which node has in parent node
+         * @return parent node, nullptr if node is the root of the subtree
+         */
+        Ra__Node* get_parent(Ra__Node* node, Ra__Node* subtree, int& child_index);
+
+        /**
+         * Sets the parent links of all nodes in a subtree built by the parser
+         * @param it pointer to subtree
+         */
+        void link_parents(Ra__Node* it);
  
         /**
          * Get relations referenced in predicate
          * @param predicate predicate to check
          * @param relations vector to fill with referenced relations
          */
-        void get_predicate_relations(std::shared_ptr<Ra__Node> predicate, std::vector<std::string>& relations);
+        void get_predicate_relations(Ra__Node* predicate, std::vector<Ra__Symbol>& relations);
 
         /**
          * Get relations referenced in expression
          * @param expression expression to check
          * @param relations vector to fill with referenced relations
          */
-        void get_expression_relations(std::shared_ptr<Ra__Node> expression, std::vector<std::string>& relations);
+        void get_expression_relations(Ra__Node* expression, std::vector<Ra__Symbol>& relations);
 
         /**
          * Get relation referenced by attribute
          * @param attribute expression to check
          * @return relation name/alias
          */
-        std::string get_relation_from_attribute(std::shared_ptr<Ra__Node> attribute);
+        Ra__Symbol get_relation_from_attribute(Ra__Node* attribute);
 
         /**
          * gets relations and alias in top from clause layer of subtree
          * @param it pointer to subtree
          * @param relations_aliases vector to fill with relation name and alias defined in subtree (top layer)
          */
-        void get_relations_aliases(std::shared_ptr<Ra__Node> it, std::vector<std::pair<std::string,std::string>>& relations_aliases);
+        void get_relations_aliases(Ra__Node* it, std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases);
 
         /**
          * finds first selection in subtree
          * @param it pointer to subtree
          * @return true if selection found, else false
          */
-        bool get_first_selection(std::shared_ptr<Ra__Node>& it);
+        bool get_first_selection(Ra__Node*& it);
         
         /**
          * get all attributes used in subtree
          * @param it pointer to subtree
          * @param attributes vector to fill with found attribute nodes
          */
-        void get_subtree_attributes(std::shared_ptr<Ra__Node> it, std::vector<std::shared_ptr<Ra__Node>>& attributes);
+        void get_subtree_attributes(Ra__Node* it, std::vector<Ra__Node*>& attributes);
 
         /**
-         * Checks if an attribute name belongs to a tpch relation
+         * Checks if an attribute name is a column of a catalog relation, memoized per (relation, attribute)
          * @param attr_name attribute name
          * @param relation relation name
-         * @return true if attribute belongs to tpch relation
+         * @return true if attribute belongs to relation
          */
-        bool is_tpch_attribute(std::string attr_name, std::string relation);
+        bool is_catalog_attribute(Ra__Symbol attr_name, Ra__Symbol relation);
 
         /**
-         * Get tpch relation name of a tpch attribute
+         * Get catalog relation name of an attribute without alias, the first attribute missing from the catalog is reported
          * @param attr_name attribute name
-         * @return corresponding tpch relation name
+         * @return corresponding relation name
          */
-        std::string get_tpch_relation_name(std::string attr_name);
+        Ra__Symbol get_catalog_relation_name(Ra__Symbol attr_name);
+
+        /**
+         * Get catalog relation name of an attribute, memoized per attribute symbol
+         * @param attr_name attribute name
+         * @return corresponding relation name, empty symbol if no or more than one relation has such a column
+         * (the parser qualifies attributes of columns of several relations by the from items in their scope)
+         */
+        Ra__Symbol lookup_catalog_relation(Ra__Symbol attr_name);
 
         /**
          * Get attributes used in an expression
          * @param expression expression node
          * @param attributes vector to fill with attributes found
          */
-        void get_expression_attributes(std::shared_ptr<Ra__Node> expression, std::vector<std::shared_ptr<Ra__Node>>& attributes);
+        void get_expression_attributes(Ra__Node* expression, std::vector<Ra__Node*>& attributes);
 
         /**
          * Get attributes used in a predicate
          * @param predicate predicate node
          * @param attributes vector to fill with attributes found
          */
-        void get_predicate_attributes(std::shared_ptr<Ra__Node> predicate, std::vector<std::shared_ptr<Ra__Node>>& attributes);
+        void get_predicate_attributes(Ra__Node* predicate, std::vector<Ra__Node*>& attributes);
 
         /**
          * Check if a dependent join can be decoupled
@@ -304,7 +857,306 @@ class RaTree {
          * @param d_rename_map map "d" attributes to equivalent attributes in subtree
          * @return true if can be decoupled, else false
          */
-        bool can_decouple(std::shared_ptr<Ra__Node__Join> dep_join, std::shared_ptr<Ra__Node> parent_projection, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>>& d_rename_map);
+        bool can_decouple(Ra__Node__Join* dep_join, Ra__Node* parent_projection, std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& d_rename_map);
+
+        /**
+         * Cost based choice between decoupling a dependent join and joining the subquery with D (materialized as CTE),
+         * compares the estimated cost of the whole tree with and without D
+         * @param d_projection D projection
+         * @param outer left side of the original dependent join, which D is computed from
+         * @return true if the decoupled plan is estimated to be cheaper
+         */
+        bool is_decoupling_cheaper(Ra__Node* d_projection, Ra__Node* outer);
+
+        /**
+         * Cost based choice of the correlation keys by which a decoupled subquery is filtered (magic set)
+         * @param inner decoupled subquery input, which is filtered
+         * @param keys pairs of D attribute and equivalent attribute of the decoupled subquery
+         * @param outer left side of the original dependent join, which the filter values are computed from
+         * @return indexes of the keys to filter by, empty if filtering is not estimated to be cheaper
+         */
+        std::vector<size_t> select_magic_set_keys(Ra__Node* inner, const std::vector<std::pair<Ra__Node*,Ra__Node*>>& keys, Ra__Node* outer);
+
+        /**
+         * Cost based choice whether a subtree used several times is computed once and stored (materialized),
+         * instead of being computed for every use
+         * @param subtree shared subtree
+         * @param uses number of uses of the subtree
+         * @return true if materializing is estimated to be cheaper
+         */
+        bool is_materialization_cheaper(Ra__Node* subtree, size_t uses);
+
+        /**
+         * Estimates the rows read from the base relations of a join block, if the conjuncts on a single relation are
+         * answered by an index and all other relations are scanned
+         * @param join_block relations, selections and cross products/inner joins
+         * @return estimated rows read
+         */
+        double estimate_scan_rows(Ra__Node* join_block);
+
+        /**
+         * Cost based choice whether a disjunction is split into a union all of its branches, which can use indexes
+         * on the conjuncts of every branch instead of scanning for the disjunction
+         * @param selection selection with the disjunction over a join block
+         * @param union_node union all of the branches, not yet in the tree
+         * @return true if the union all is estimated to be cheaper
+         */
+        bool is_disjunction_split_cheaper(Ra__Node* selection, Ra__Node* union_node);
+
+        /**
+         * Cost based choice whether an in list is joined as values relation, looking up every value by an index,
+         * instead of comparing every row with the list
+         * @param in_predicate attribute in list of constants
+         * @param n_values number of distinct values of the list
+         * @return true if the join is estimated to be cheaper, false for short lists
+         */
+        bool is_values_join_cheaper(Ra__Node__Predicate* in_predicate, size_t n_values);
+
+        /**
+         * Collects relation names of all aliases and the CTE trees, used by the cardinality estimation
+         */
+        void index_cost_relations();
+
+        /**
+         * Estimates the number of rows produced by a subtree
+         * @param it subtree
+         * @param cost C_out cost of the subtree is added to cost
+         * @return estimated number of rows
+         */
+        double estimate_cardinality(Ra__Node* it, double& cost);
+
+        /**
+         * Estimates the fraction of rows satisfying a predicate
+         * @param predicate Ra__Node__Bool_Predicate/Ra__Node__Predicate/Ra__Node__Null_Test/Ra__Node__Where_Subquery_Marker
+         * @return estimated selectivity
+         */
+        double estimate_selectivity(Ra__Node* predicate);
+
+        /**
+         * Estimates the selectivity of a comparison
+         * @param p predicate
+         * @return estimated selectivity
+         */
+        double estimate_comparison_selectivity(Ra__Node__Predicate* p);
+
+        /**
+         * Estimates the selectivity of comparing a column with constants from the column statistics
+         * @param attr attribute
+         * @param op comparison operator, attribute is the left side
+         * @param values constants the attribute is compared with, two for between, all values of in lists
+         * @return estimated selectivity, -1 if the attribute has no statistics or the comparison is not supported
+         */
+        double estimate_stats_selectivity(Ra__Node__Attribute* attr, const std::string& op, const std::vector<std::string>& values);
+
+        /**
+         * Gets the attribute and constants of a comparison of an attribute with constants
+         * @param p predicate
+         * @param attr set to the compared attribute
+         * @param op set to the operator with the attribute as left side
+         * @param values set to the constants, two for between, all values of in lists
+         * @return false if the predicate does not compare an attribute with constants
+         */
+        bool get_constant_comparison(Ra__Node__Predicate* p, Ra__Node__Attribute*& attr, std::string& op, std::vector<std::string>& values);
+
+        /**
+         * @param attr attribute
+         * @return catalog column of attribute, nullptr if attribute refers to a subquery or unknown relation
+         */
+        const Ra__Catalog__Column* get_attribute_column(Ra__Node__Attribute* attr);
+
+        /**
+         * Estimates the average row width of a subtree, from the column statistics or the column types
+         * @param it subtree
+         * @return estimated width in bytes
+         */
+        double estimate_width(Ra__Node* it);
+
+        /**
+         * Estimates the average width of an expression
+         * @param expression expression
+         * @return estimated width in bytes
+         */
+        double estimate_expression_width(Ra__Node* expression);
+
+        /**
+         * Estimates the number of distinct value combinations of attributes, using catalog keys and row counts
+         * @param attributes attribute nodes
+         * @return estimated number of distinct values
+         */
+        double estimate_distinct_values(const std::vector<Ra__Node*>& attributes);
+
+        /**
+         * Reorders the cross products of the tree and its CTEs by estimated cost,
+         * predicates are placed on the lowest cross product defining all their relations
+         */
+        void reorder_joins();
+
+        /**
+         * Reorders the join graphs in the subtrees of the children of a node
+         * @param parent node whose child subtrees are reordered
+         */
+        void reorder_joins(Ra__Node* parent);
+
+        /**
+         * @param node node of a subtree
+         * @return true if node is a cross product or a selection without subquery, which can be part of a join graph
+         */
+        bool is_join_graph_operator(Ra__Node* node);
+
+        /**
+         * Collects the relations, predicates and operators of a join graph
+         * @param it join graph operator or relation of the join graph
+         * @param graph join graph to fill
+         * @param shared set to true if an operator is shared by several parents
+         */
+        void collect_join_graph(Ra__Node* it, Ra__Join_Graph& graph, bool& shared);
+
+        /**
+         * Finds the relations referenced by each predicate, the edges of the graph and the rows of each relation
+         * @param graph join graph with relations and predicates
+         */
+        void index_join_graph(Ra__Join_Graph& graph);
+
+        /**
+         * Estimates the rows of joining a set of relations of a join graph
+         * @param graph join graph
+         * @param relations bitset of relations
+         * @return estimated number of rows
+         */
+        double estimate_join_rows(Ra__Join_Graph& graph, uint64_t relations);
+
+        /**
+         * Estimates the C_out cost of joining the relations of a join graph left-deep in the given order
+         * @param graph join graph
+         * @param order relation indexes
+         * @return estimated cost
+         */
+        double estimate_join_order_cost(Ra__Join_Graph& graph, const std::vector<size_t>& order);
+
+        /**
+         * Finds the cheapest left-deep join order without cross products by dynamic programming over
+         * the connected subgraph/complement pairs of the join graph (DPccp),
+         * unconnected parts of the graph are joined by cross products in the order of their rows
+         * @param graph join graph
+         * @return relation indexes in join order
+         */
+        std::vector<size_t> order_joins_dp(Ra__Join_Graph& graph);
+
+        /**
+         * Orders the relations of a join graph greedily, starting with the relation with the fewest rows,
+         * adding the connected relation giving the fewest rows
+         * @param graph join graph
+         * @return relation indexes in join order
+         */
+        std::vector<size_t> order_joins_greedy(Ra__Join_Graph& graph);
+
+        /**
+         * Builds a left-deep tree of cross products and selections
+         * @param graph join graph
+         * @param order relation indexes in join order
+         * @return root of the new tree
+         */
+        Ra__Node* build_join_tree(const Ra__Join_Graph& graph, const std::vector<size_t>& order);
+
+        /**
+         * Pushes partial aggregations below the joins of all group by queries of the tree and its CTEs (eager aggregation),
+         * if they are estimated to reduce the rows joined
+         */
+        void push_down_aggregations();
+
+        /**
+         * Pushes a partial aggregation of sum, count, min, max and avg below selections, inner joins and the preserved side
+         * of left, semi and anti joins, to the input all aggregate arguments refer to. The input is grouped by its attributes
+         * used above, the aggregation of the query block combines the partial aggregates (count as sum, avg as sum/count)
+         * (Yan, Larson: Eager Aggregation and Lazy Aggregation)
+         * @param group_by group by of a query block
+         * @return true if the aggregation was pushed down
+         */
+        bool push_down_aggregation(Ra__Node__Group_By* group_by);
+
+        /**
+         * Shares subtrees occurring several times in the tree and its CTEs (common subexpressions) as CTEs:
+         * identical CTEs are merged, identical subqueries in from and identical blocks of selections and
+         * cross products/inner joins (e.g. TPC-H Q11) are replaced by a CTE if materializing is estimated to be cheaper.
+         * CTEs used several times are annotated materialized or not materialized by estimated cost.
+         */
+        void share_common_subexpressions();
+
+        /**
+         * @param node node of a subtree
+         * @return true if node is a block of relations, selections and cross products/inner joins without subqueries,
+         * which can be moved as it is
+         */
+        bool is_join_block(Ra__Node* node);
+
+        /**
+         * Shares one class of identical subtrees as CTE
+         * @param occurrences identical subtrees
+         * @return true if the subtrees were replaced by the CTE
+         */
+        bool share_common_subexpression(const std::vector<Ra__Common_Subexpression>& occurrences);
+
+        /**
+         * Collects all nodes of a subtree incl. expressions and predicates
+         * @param node root of subtree, may be nullptr
+         * @param nodes nodes of the subtree
+         */
+        void get_subtree_nodes(Ra__Node* node, std::vector<Ra__Node*>& nodes);
+
+        /**
+         * Collects the attributes outside of a subtree which refer to relations defined in it, as select expressions exporting them
+         * @param tree_nodes all nodes of the tree and its CTEs
+         * @param subtree_nodes nodes of the subtree (and other nodes to skip)
+         * @param qualifiers qualifiers of the relations defined in the subtree
+         * @param relation_names names of the relations in the subtree, unqualified attributes are assigned through the catalog
+         * @param exported_args select expressions exporting the used attributes, named by the attribute names
+         * @param qualified_uses qualified attributes using the subtree, to be renamed to the exporting subquery
+         * @return false if two used attributes have the same name
+         */
+        bool get_exported_attributes(const std::vector<Ra__Node*>& tree_nodes, const std::set<Ra__Node*>& subtree_nodes, const std::vector<Ra__Symbol>& qualifiers, const std::vector<Ra__Symbol>& relation_names, std::vector<Ra__Node*>& exported_args, std::vector<Ra__Node__Attribute*>& qualified_uses);
+
+        /**
+         * Name (or alias if renamed) by which attributes refer to a relation, subquery, values list or union
+         * @param node node
+         * @return qualifier, empty if node does not define one
+         */
+        Ra__Symbol get_relation_qualifier(Ra__Node* node);
+
+        /**
+         * Merges identical CTEs, references of the removed CTEs are renamed to the kept CTE
+         * @return true if a CTE was merged
+         */
+        bool merge_identical_ctes();
+
+        /**
+         * Structural hash of a subtree, equal for subtrees for which is_same_subtree is true.
+         * Cached on the nodes until invalidate_hashes is called
+         * @param node root of subtree, may be nullptr
+         * @param incl_alias false to ignore the subquery alias of node (not of its descendants)
+         * @return hash
+         */
+        size_t hash_subtree(Ra__Node* node, bool incl_alias=true);
+
+        /**
+         * Compares two subtrees by structure, operators, expressions and identifiers
+         * @param a root of first subtree, may be nullptr
+         * @param b root of second subtree, may be nullptr
+         * @param incl_alias false to ignore the subquery aliases of a and b (not of their descendants)
+         * @return true if the subtrees are identical
+         */
+        bool is_same_subtree(Ra__Node* a, Ra__Node* b, bool incl_alias=true);
+
+        /**
+         * Invalidates the structural hashes cached on the nodes, to be called before hashing nodes modified since they were hashed
+         */
+        void invalidate_hashes();
+
+        /**
+         * Get catalog table an attribute refers to
+         * @param attr attribute
+         * @return catalog table, nullptr if attribute refers to a subquery or unknown relation
+         */
+        const Ra__Catalog__Table* get_attribute_table(Ra__Node__Attribute* attr);
 
         /**
          * Check if a dependent join can be decoupled
@@ -312,23 +1164,28 @@ class RaTree {
          * @param rename_map map from old name to new name
          * @param stop_node node at which to stop renaming
          */
-        void rename_attributes(std::shared_ptr<Ra__Node> it, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>> rename_map, std::shared_ptr<Ra__Node> stop_node=nullptr);
+        void rename_attributes(Ra__Node* it, const std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& rename_map, Ra__Node* stop_node=nullptr);
 
         /**
-         * Remove any redundant predicates within a predicate (redunant: a=a)
+         * Remove any redundant predicates within a predicate (redunant: a=a, duplicate arguments of and/or)
          * @param predicate predicate in which to remove redundant sub-predicates
          * @param predicate_parent pointer to parent of predicate, needed in case entire predicate becomes rendundant
          */
-        void remove_redundant_predicates(std::shared_ptr<Ra__Node>& predicate, std::shared_ptr<Ra__Node>& predicate_parent);
+        void remove_redundant_predicates(Ra__Node*& predicate, Ra__Node*& predicate_parent);
+
+        /**
+         * Removes predicates structurally equal to a predicate before them, found by structural hash
+         * @param predicates predicates, e.g. arguments of a boolean predicate
+         */
+        void remove_duplicate_predicates(std::vector<Ra__Node*>& predicates);
 
         /**
-         * Checks if an attribute has an equi predicate to another attribute
-         * @param attribute attribute to check
-         * @param predicate predicate in which to check for equi predicate
-         * @param d_rename_map map in which original attribute is mapped to equivalent predicate
-         * @return true if attribute has an equivalent attribute, else false
+         * Indexes the equi predicates between a "d" attribute and another attribute in a top level "and" predicate
+         * @param predicate predicate in which to find equi predicates
+         * @param equivalent_attributes equivalent attribute (alias, name) by name id of the "d" attribute,
+         * "d" attributes already indexed keep their equivalent attribute
          */
-        bool has_equivalent_attribute(std::shared_ptr<Ra__Node> attribute, std::shared_ptr<Ra__Node> predicate, std::map<std::pair<std::string,std::string>, std::pair<std::string,std::string>>& d_rename_map);
+        void get_equivalent_attributes(Ra__Node* predicate, std::unordered_map<uint32_t, std::pair<Ra__Symbol,Ra__Symbol>>& equivalent_attributes);
 
         /**
          * finds highest node in subtree where only the required relations are defined
@@ -336,32 +1193,23 @@ class RaTree {
          * @param required_relations set of required relations
          * @return true if node is found
          */
-        bool find_highest_node_with_only_required_relations_defined(std::shared_ptr<Ra__Node>& it, std::set<std::string> required_relations);
+        bool find_highest_node_with_only_required_relations_defined(Ra__Node*& it, const std::set<Ra__Symbol>& required_relations);
 
         /**
-         * Creates a Ra Relation Node with tpch relation name corresponding to attribute name
-         * @param alias alias to give to created Ra Relation Node
-         * @param attr attribute for which to create corresponding tpch relation node
-         * @return tpch Ra relation node
+         * Creates a Ra Relation Node of the catalog relation having all given attributes
+         * @param alias alias to give to created Ra Relation Node, empty if attributes have no alias
+         * @param attr attributes for which to create corresponding relation node
+         * @return Ra relation node
          */
-        std::shared_ptr<Ra__Node> build_tpch_relation(std::string alias, std::vector<std::shared_ptr<Ra__Node__Attribute>> attr);
+        Ra__Node* build_catalog_relation(Ra__Symbol alias, std::vector<Ra__Node__Attribute*> attr);
 
         /**
          * Find the parent node of a join node in subtree
          * @param it pointer to subtree, will equal parent of seeked join node if returned true
          * @return true if parent node was found
          */
-        bool get_join_parent(std::shared_ptr<Ra__Node>& it);
+        bool get_join_parent(Ra__Node*& it);
 
-        /**
-         * Find the parent node of a join marker in subtree
-         * @param it pointer to subtree, will equal parent of seeked join marker if returned true
-         * @param marker join marker whose parent to find
-         * @param index will be set to child index which join marker has in parent node
-         * @return true if parent node was found
-         */
-        bool get_join_marker_parent(std::shared_ptr<Ra__Node>& it, std::shared_ptr<Ra__Node__Where_Subquery_Marker> marker, int& index);
-        
         /**
          * Get all attributes in subtree which use given aliases
          * @param it pointer to subtree
@@ -370,14 +1218,14 @@ class RaTree {
          * @param stop_node node at which to stop looking for attributes
          * @param incl_stop_node true, if the stop node should be included in the search
          */
-        void find_attributes_using_alias(std::shared_ptr<Ra__Node> it, std::vector<std::string>& aliases, std::vector<std::shared_ptr<Ra__Node>>& attributes, std::shared_ptr<Ra__Node> stop_node=nullptr, bool incl_stop_node=false);
+        void find_attributes_using_alias(Ra__Node* it, const std::vector<Ra__Symbol>& aliases, std::vector<Ra__Node*>& attributes, Ra__Node* stop_node=nullptr, bool incl_stop_node=false);
 
         /**
          * checks if a predicate contains a subquery
          * @param node predicate in which to look for subquery
          * @return true if contains subquery, else false
          */
-        bool predicate_contains_subquery(std::shared_ptr<Ra__Node> node);
+        bool predicate_contains_subquery(Ra__Node* node);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <functional>
+
+// name of the i-th column of a projection, empty if the column is unnamed (expression without rename)
+static std::string get_projection_column(Ra__Node__Projection* projection, size_t i){
+    if(!projection->subquery_columns.empty()){
+        return i<projection->subquery_columns.size() ? projection->subquery_columns[i] : "";
+    }
+    Ra__Node* arg = projection->args[i];
+    if(arg->node_case==RA__NODE__SELECT_EXPRESSION){
+        auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+        if(!sel_expr->rename.empty()){
+            return sel_expr->rename;
+        }
+        arg = sel_expr->expression;
+    }
+    return arg->node_case==RA__NODE__ATTRIBUTE ? static_cast<Ra__Node__Attribute*>(arg)->name.str() : "";
+}
+
+// "*" or "alias.*" as argument of a projection
+static Ra__Node__Attribute* get_star(Ra__Node* arg){
+    if(arg->node_case==RA__NODE__SELECT_EXPRESSION){
+        arg = static_cast<Ra__Node__Select_Expression*>(arg)->expression;
+    }
+    if(arg==nullptr || arg->node_case!=RA__NODE__ATTRIBUTE){
+        return nullptr;
+    }
+    auto attr = static_cast<Ra__Node__Attribute*>(arg);
+    return attr->name.str()=="*" ? attr : nullptr;
+}
+
+// an aggregation without group by returns one row, also if its aggregates are removed: such blocks are not pruned
+static bool has_implicit_group_by(Ra__Node__Projection* projection){
+    Ra__Node* it = projection->childNodes[0];
+    while(it->node_case==RA__NODE__SELECTION || it->node_case==RA__NODE__HAVING || it->node_case==RA__NODE__ORDER_BY || it->node_case==RA__NODE__GROUP_BY || it->node_case==RA__NODE__LIMIT){
+        if(it->node_case==RA__NODE__HAVING || (it->node_case==RA__NODE__GROUP_BY && static_cast<Ra__Node__Group_By*>(it)->implicit)){
+            return true;
+        }
+        it = it->childNodes[0];
+    }
+    return false;
+}
+
+void RaTree::prune_columns(){
+    bool changed = false;
+    while(prune_unused_columns()){
+        changed = true;
+    }
+    if(changed){
+        invalidate_hashes();
+    }
+}
+
+void RaTree::get_from_items(Ra__Node* node, std::vector<Ra__Node*>& items){
+    switch(node->node_case){
+        case RA__NODE__RELATION:
+        case RA__NODE__VALUES:
+        case RA__NODE__UNION:{
+            items.push_back(node);
+            return;
+        }
+        case RA__NODE__PROJECTION:{
+            // derived table, a projection without alias is a subquery of a subquery join
+            if(!static_cast<Ra__Node__Projection*>(node)->subquery_alias.empty()){
+                items.push_back(node);
+            }
+            return;
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(node);
+            get_from_items(join->childNodes[0], items);
+            if(join->right_where_subquery_marker->marker==0){
+                get_from_items(join->childNodes[1], items);
+            }
+            return;
+        }
+        default:{
+            for(auto child: node->childNodes){
+                get_from_items(child, items);
+            }
+        }
+    }
+}
+
+bool RaTree::prune_unused_columns(){
+    // 1. derived tables and CTEs, by the qualifiers referring to them
+    std::vector<Ra__Node*> nodes;
+    get_subtree_nodes(root, nodes);
+    for(auto cte: ctes){
+        get_subtree_nodes(cte, nodes);
+    }
+    std::map<Ra__Symbol, Ra__Node__Projection*> ctes_by_name;
+    for(auto cte: ctes){
+        auto cte_pr = static_cast<Ra__Node__Projection*>(cte);
+        ctes_by_name[cte_pr->subquery_alias] = cte_pr;
+    }
+    std::vector<Ra__Node__Projection*> producers;
+    std::map<Ra__Symbol, std::vector<Ra__Node__Projection*>> producers_by_qualifier;
+    std::set<Ra__Node__Projection*> all_required;
+    for(auto cte: ctes){
+        producers.push_back(static_cast<Ra__Node__Projection*>(cte));
+    }
+    for(auto node: nodes){
+        if(node->node_case==RA__NODE__PROJECTION){
+            auto pr = static_cast<Ra__Node__Projection*>(node);
+            if(!pr->subquery_alias.empty() && node!=root && std::find(ctes.begin(), ctes.end(), node)==ctes.end()){
+                producers.push_back(pr);
+                producers_by_qualifier[pr->subquery_alias].push_back(pr);
+            }
+        }
+        else if(node->node_case==RA__NODE__RELATION){
+            auto rel = static_cast<Ra__Node__Relation*>(node);
+            auto cte = ctes_by_name.find(rel->name);
+            if(cte!=ctes_by_name.end()){
+                producers_by_qualifier[get_relation_qualifier(rel)].push_back(cte->second);
+            }
+        }
+        // a renamed join's columns are the columns of its inputs by position
+        else if(node->node_case==RA__NODE__JOIN && !static_cast<Ra__Node__Join*>(node)->columns.empty()){
+            std::vector<Ra__Node*> items;
+            get_from_items(node, items);
+            for(auto item: items){
+                if(item->node_case==RA__NODE__PROJECTION){
+                    all_required.insert(static_cast<Ra__Node__Projection*>(item));
+                }
+                else if(item->node_case==RA__NODE__RELATION && ctes_by_name.count(static_cast<Ra__Node__Relation*>(item)->name)>0){
+                    all_required.insert(ctes_by_name[static_cast<Ra__Node__Relation*>(item)->name]);
+                }
+            }
+        }
+    }
+    if(producers.empty()){
+        return false;
+    }
+
+    // 2. attributes used by each derived table and CTE, attributes in its own subtree refer to relations below it
+    std::set<Ra__Node__Projection*> is_producer(producers.begin(), producers.end());
+    std::map<Ra__Node__Projection*, std::set<std::string>> required;
+    std::vector<Ra__Node__Projection*> enclosing;
+    std::function<void(Ra__Node*)> collect_used_columns = [&](Ra__Node* node){
+        if(node==nullptr){
+            return;
+        }
+        bool encloses = node->node_case==RA__NODE__PROJECTION && is_producer.count(static_cast<Ra__Node__Projection*>(node))>0;
+        if(encloses){
+            enclosing.push_back(static_cast<Ra__Node__Projection*>(node));
+        }
+        // stars as projection arguments are handled below, else count(*)
+        if(node->node_case==RA__NODE__ATTRIBUTE && static_cast<Ra__Node__Attribute*>(node)->name.str()!="*"){
+            auto attr = static_cast<Ra__Node__Attribute*>(node);
+            std::vector<Ra__Node__Projection*> referenced;
+            if(!attr->alias.empty()){
+                auto qualified = producers_by_qualifier.find(attr->alias);
+                if(qualified!=producers_by_qualifier.end()){
+                    referenced = qualified->second;
+                }
+            }
+            // without alias: any derived table or CTE may be referenced
+            else{
+                referenced = producers;
+            }
+            for(auto pr: referenced){
+                if(std::find(enclosing.begin(), enclosing.end(), pr)==enclosing.end()){
+                    required[pr].insert(attr->name.str());
+                }
+            }
+        }
+        std::string key;
+        std::vector<Ra__Node*> operands;
+        node->get_structure(key, operands, true);
+        // group by, having and order by may refer to the output columns of their own block (order by c)
+        bool is_clause = node->node_case==RA__NODE__GROUP_BY || node->node_case==RA__NODE__HAVING || node->node_case==RA__NODE__ORDER_BY;
+        for(auto operand: operands){
+            collect_used_columns(operand);
+            if(is_clause && !enclosing.empty()){
+                std::vector<Ra__Node*> operand_nodes;
+                get_subtree_nodes(operand, operand_nodes);
+                for(auto operand_node: operand_nodes){
+                    if(operand_node->node_case==RA__NODE__ATTRIBUTE){
+                        required[enclosing.back()].insert(static_cast<Ra__Node__Attribute*>(operand_node)->name.str());
+                    }
+                }
+            }
+        }
+        for(auto child: node->childNodes){
+            collect_used_columns(child);
+        }
+        if(encloses){
+            enclosing.pop_back();
+        }
+    };
+    collect_used_columns(root);
+    for(auto cte: ctes){
+        collect_used_columns(cte);
+    }
+    for(auto node: nodes){
+        if(node->node_case==RA__NODE__PROJECTION){
+            auto pr = static_cast<Ra__Node__Projection*>(node);
+            int child_index = -1;
+            Ra__Node* parent = get_linked_parent(pr, child_index);
+            // the columns of exists subqueries are not used
+            if(parent!=nullptr && parent->node_case==RA__NODE__JOIN && child_index==1){
+                auto type = static_cast<Ra__Node__Join*>(parent)->type;
+                if(type==RA__JOIN__SEMI_LEFT || type==RA__JOIN__SEMI_LEFT_DEPENDENT || type==RA__JOIN__ANTI_LEFT || type==RA__JOIN__ANTI_LEFT_DEPENDENT){
+                    continue;
+                }
+            }
+            for(auto arg: pr->args){
+                Ra__Node__Attribute* star = get_star(arg);
+                if(star==nullptr){
+                    continue;
+                }
+                if(!star->alias.empty()){
+                    auto qualified = producers_by_qualifier.find(star->alias);
+                    if(qualified!=producers_by_qualifier.end()){
+                        all_required.insert(qualified->second.begin(), qualified->second.end());
+                    }
+                    continue;
+                }
+                std::vector<Ra__Node*> items;
+                get_from_items(pr->childNodes[0], items);
+                for(auto item: items){
+                    if(item->node_case==RA__NODE__PROJECTION){
+                        all_required.insert(static_cast<Ra__Node__Projection*>(item));
+                    }
+                    else if(item->node_case==RA__NODE__RELATION && ctes_by_name.count(static_cast<Ra__Node__Relation*>(item)->name)>0){
+                        all_required.insert(ctes_by_name[static_cast<Ra__Node__Relation*>(item)->name]);
+                    }
+                }
+            }
+        }
+    }
+
+    // 3. remove the unused columns (distinct depends on all columns), keep at least one column
+    bool changed = false;
+    for(auto pr: producers){
+        if(all_required.count(pr)>0 || pr->distinct || pr->args.empty() || has_implicit_group_by(pr)){
+            continue;
+        }
+        if(pr->args.size()==1 && get_star(pr->args[0])!=nullptr && get_star(pr->args[0])->alias.empty() && pr->subquery_columns.empty()){
+            changed |= expand_star(pr, required[pr]);
+            continue;
+        }
+        if(std::any_of(pr->args.begin(), pr->args.end(), get_star) || (!pr->subquery_columns.empty() && pr->subquery_columns.size()!=pr->args.size())){
+            continue;
+        }
+        std::vector<size_t> kept;
+        for(size_t i=0; i<pr->args.size(); i++){
+            if(required[pr].count(get_projection_column(pr, i))>0){
+                kept.push_back(i);
+            }
+        }
+        if(kept.empty()){
+            kept.push_back(0);
+        }
+        if(kept.size()==pr->args.size()){
+            continue;
+        }
+        std::vector<Ra__Node*> args;
+        std::vector<std::string> subquery_columns;
+        for(auto i: kept){
+            args.push_back(pr->args[i]);
+            if(!pr->subquery_columns.empty()){
+                subquery_columns.push_back(pr->subquery_columns[i]);
+            }
+        }
+        pr->args = args;
+        pr->subquery_columns = subquery_columns;
+        changed = true;
+    }
+    return changed;
+}
+
+bool RaTree::expand_star(Ra__Node__Projection* projection, const std::set<std::string>& required){
+    std::vector<Ra__Node*> items;
+    get_from_items(projection->childNodes[0], items);
+
+    // 1. columns of the from items by qualifier (none for relations without alias), in the order of "*"
+    std::vector<std::pair<Ra__Symbol,std::string>> columns;
+    for(auto item: items){
+        Ra__Symbol qualifier = item->node_case==RA__NODE__RELATION ? static_cast<Ra__Node__Relation*>(item)->alias : get_relation_qualifier(item);
+        switch(item->node_case){
+            case RA__NODE__RELATION:{
+                auto rel = static_cast<Ra__Node__Relation*>(item);
+                auto cte = std::find_if(ctes.begin(), ctes.end(), [&](Ra__Node* cte){return static_cast<Ra__Node__Projection*>(cte)->subquery_alias==rel->name;});
+                if(cte!=ctes.end()){
+                    auto cte_pr = static_cast<Ra__Node__Projection*>(*cte);
+                    for(size_t i=0; i<cte_pr->args.size(); i++){
+                        if(get_star(cte_pr->args[i])!=nullptr){
+                            return false;
+                        }
+                        columns.push_back({qualifier, get_projection_column(cte_pr, i)});
+                    }
+                    break;
+                }
+                const Ra__Catalog__Table* table = catalog->find_table(rel->name.str());
+                if(table==nullptr){
+                    return false;
+                }
+                for(const auto& column: table->columns){
+                    columns.push_back({qualifier, column.name});
+                }
+                break;
+            }
+            case RA__NODE__PROJECTION:{
+                auto pr = static_cast<Ra__Node__Projection*>(item);
+                for(size_t i=0; i<pr->args.size(); i++){
+                    if(get_star(pr->args[i])!=nullptr){
+                        return false;
+                    }
+                    columns.push_back({qualifier, get_projection_column(pr, i)});
+                }
+                break;
+            }
+            case RA__NODE__VALUES:{
+                columns.push_back({qualifier, static_cast<Ra__Node__Values*>(item)->column});
+                break;
+            }
+            case RA__NODE__UNION:{
+                for(const auto& column: static_cast<Ra__Node__Union*>(item)->columns){
+                    columns.push_back({qualifier, column});
+                }
+                break;
+            }
+            default: return false;
+        }
+    }
+
+    // 2. columns are referenced by name above, which must be unique
+    std::set<std::string> names;
+    for(const auto& column: columns){
+        if(column.second.empty() || !names.insert(column.second).second){
+            return false;
+        }
+    }
+    std::vector<Ra__Node*> args;
+    for(const auto& column: columns){
+        if(required.count(column.second)>0){
+            args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(symbols->intern(column.second), column.first)));
+        }
+    }
+    if(args.empty() && !columns.empty()){
+        args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(symbols->intern(columns[0].second), columns[0].first)));
+    }
+    if(args.empty()){
+        return false;
+    }
+    projection->args = args;
+    return true;
+}
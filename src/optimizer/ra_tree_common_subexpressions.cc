@@ -0,0 +1,382 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <functional>
+
+void RaTree::get_subtree_nodes(Ra__Node* node, std::vector<Ra__Node*>& nodes){
+    if(node==nullptr){
+        return;
+    }
+    nodes.push_back(node);
+    std::string key;
+    std::vector<Ra__Node*> operands;
+    node->get_structure(key, operands, true);
+    operands.insert(operands.end(), node->childNodes.begin(), node->childNodes.end());
+    for(auto operand: operands){
+        get_subtree_nodes(operand, nodes);
+    }
+}
+
+Ra__Symbol RaTree::get_relation_qualifier(Ra__Node* node){
+    switch(node->node_case){
+        case RA__NODE__RELATION:{
+            auto rel = static_cast<Ra__Node__Relation*>(node);
+            return rel->alias.empty() ? rel->name : rel->alias;
+        }
+        case RA__NODE__PROJECTION: return static_cast<Ra__Node__Projection*>(node)->subquery_alias;
+        case RA__NODE__JOIN: return static_cast<Ra__Node__Join*>(node)->alias;
+        case RA__NODE__VALUES: return symbols->intern(static_cast<Ra__Node__Values*>(node)->alias);
+        case RA__NODE__UNION: return static_cast<Ra__Node__Union*>(node)->alias;
+        default: return Ra__Symbol();
+    }
+}
+
+size_t RaTree::hash_subtree(Ra__Node* node, bool incl_alias){
+    return node==nullptr ? 0 : node->structural_hash(hash_epoch, incl_alias);
+}
+
+bool RaTree::is_same_subtree(Ra__Node* a, Ra__Node* b, bool incl_alias){
+    return a==nullptr ? b==nullptr : a->is_structurally_equal(b, hash_epoch, incl_alias);
+}
+
+void RaTree::invalidate_hashes(){
+    hash_epoch++;
+}
+
+bool RaTree::is_join_block(Ra__Node* node){
+    switch(node->node_case){
+        case RA__NODE__RELATION: return true;
+        case RA__NODE__SELECTION:{
+            auto sel = static_cast<Ra__Node__Selection*>(node);
+            return sel->predicate!=nullptr && !predicate_contains_subquery(sel->predicate) && is_join_block(node->childNodes[0]);
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(node);
+            if((join->type!=RA__JOIN__CROSS_PRODUCT && join->type!=RA__JOIN__INNER) || join->right_where_subquery_marker->marker!=0 || !join->alias.empty()){
+                return false;
+            }
+            if(join->predicate!=nullptr && predicate_contains_subquery(join->predicate)){
+                return false;
+            }
+            return is_join_block(node->childNodes[0]) && is_join_block(node->childNodes[1]);
+        }
+        default: return false;
+    }
+}
+
+void RaTree::share_common_subexpressions(){
+    while(merge_identical_ctes()){}
+
+    // every sharing replaces subtrees, candidates are collected again until no class of identical subtrees is shared
+    bool shared = true;
+    while(shared){
+        shared = false;
+        invalidate_hashes();
+
+        // 1. subqueries in from and join blocks of the tree and its CTEs
+        std::vector<Ra__Common_Subexpression> candidates;
+        std::function<void(const Ra__Common_Subexpression&)> collect = [&](const Ra__Common_Subexpression& occurrence){
+            Ra__Node* node = occurrence.node;
+            if(occurrence.parent!=nullptr){
+                if(node->node_case==RA__NODE__PROJECTION){
+                    auto pr = static_cast<Ra__Node__Projection*>(node);
+                    if(!pr->subquery_alias.empty() && pr->subquery_alias!=symbol_d){
+                        candidates.push_back(occurrence);
+                    }
+                }
+                else if(node->node_case!=RA__NODE__RELATION && is_join_block(node)){
+                    candidates.push_back(occurrence);
+                }
+            }
+            Ra__Node* block = node->node_case==RA__NODE__PROJECTION ? node : occurrence.block;
+            for(size_t i=0; i<node->childNodes.size(); i++){
+                collect({node->childNodes[i], node, static_cast<int>(i), block, occurrence.tree});
+            }
+        };
+        collect({root, nullptr, -1, nullptr, -1});
+        for(size_t i=0; i<ctes.size(); i++){
+            collect({ctes[i], nullptr, -1, nullptr, static_cast<int>(i)});
+        }
+
+        // 2. classes of identical subtrees, subqueries are compared without their alias
+        std::unordered_map<size_t, std::vector<size_t>> buckets;
+        for(size_t i=0; i<candidates.size(); i++){
+            buckets[hash_subtree(candidates[i].node, false)].push_back(i);
+        }
+        std::vector<std::vector<Ra__Common_Subexpression>> classes;
+        for(const auto& bucket: buckets){
+            std::vector<std::vector<Ra__Common_Subexpression>> bucket_classes;
+            for(auto i: bucket.second){
+                auto found = std::find_if(bucket_classes.begin(), bucket_classes.end(), [&](const auto& subexpression_class){
+                    return is_same_subtree(subexpression_class[0].node, candidates[i].node, false);
+                });
+                if(found!=bucket_classes.end()){
+                    found->push_back(candidates[i]);
+                }
+                else{
+                    bucket_classes.push_back({candidates[i]});
+                }
+            }
+            for(auto& subexpression_class: bucket_classes){
+                if(subexpression_class.size()>1){
+                    classes.push_back(std::move(subexpression_class));
+                }
+            }
+        }
+
+        // 3. largest subtrees first, they contain the smaller ones; ties in tree order to stay deterministic
+        std::vector<std::pair<size_t,size_t>> sizes_first_candidates;
+        for(const auto& subexpression_class: classes){
+            std::vector<Ra__Node*> nodes;
+            get_subtree_nodes(subexpression_class[0].node, nodes);
+            size_t first_candidate = std::find_if(candidates.begin(), candidates.end(), [&](const auto& candidate){
+                return candidate.node==subexpression_class[0].node;
+            }) - candidates.begin();
+            sizes_first_candidates.push_back({nodes.size(), first_candidate});
+        }
+        std::vector<size_t> order(classes.size());
+        for(size_t i=0; i<order.size(); i++){
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b){
+            if(sizes_first_candidates[a].first!=sizes_first_candidates[b].first){
+                return sizes_first_candidates[a].first>sizes_first_candidates[b].first;
+            }
+            return sizes_first_candidates[a].second<sizes_first_candidates[b].second;
+        });
+        for(auto i: order){
+            if(share_common_subexpression(classes[i])){
+                shared = true;
+                break;
+            }
+        }
+    }
+}
+
+bool RaTree::share_common_subexpression(const std::vector<Ra__Common_Subexpression>& occurrences){
+    const Ra__Common_Subexpression& first = occurrences[0];
+    bool is_subquery = first.node->node_case==RA__NODE__PROJECTION;
+
+    // 1. subtree must not refer to attributes of relations outside of it (correlated)
+    std::vector<Ra__Node*> nodes;
+    get_subtree_nodes(first.node, nodes);
+    std::vector<Ra__Symbol> qualifiers;
+    std::vector<Ra__Symbol> relation_names;
+    std::vector<Ra__Symbol> column_names;
+    for(auto node: nodes){
+        Ra__Symbol qualifier = get_relation_qualifier(node);
+        if(!qualifier.empty()){
+            qualifiers.push_back(qualifier);
+        }
+        if(node->node_case==RA__NODE__RELATION){
+            auto rel = static_cast<Ra__Node__Relation*>(node);
+            relation_names.push_back(rel->name);
+            // columns of CTEs
+            for(auto cte: ctes){
+                auto cte_pr = static_cast<Ra__Node__Projection*>(cte);
+                if(cte_pr->subquery_alias!=rel->name){
+                    continue;
+                }
+                for(const auto& column: cte_pr->subquery_columns){
+                    column_names.push_back(symbols->intern(column));
+                }
+                for(auto arg: cte_pr->args){
+                    auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+                    if(!sel_expr->rename.empty()){
+                        column_names.push_back(symbols->intern(sel_expr->rename));
+                    }
+                    else if(sel_expr->expression->node_case==RA__NODE__ATTRIBUTE){
+                        column_names.push_back(static_cast<Ra__Node__Attribute*>(sel_expr->expression)->name);
+                    }
+                }
+            }
+        }
+        // columns of subqueries
+        else if(node->node_case==RA__NODE__PROJECTION){
+            auto pr = static_cast<Ra__Node__Projection*>(node);
+            for(const auto& column: pr->subquery_columns){
+                column_names.push_back(symbols->intern(column));
+            }
+        }
+        else if(node->node_case==RA__NODE__SELECT_EXPRESSION){
+            auto sel_expr = static_cast<Ra__Node__Select_Expression*>(node);
+            if(!sel_expr->rename.empty()){
+                column_names.push_back(symbols->intern(sel_expr->rename));
+            }
+        }
+    }
+    for(auto node: nodes){
+        if(node->node_case!=RA__NODE__ATTRIBUTE){
+            continue;
+        }
+        auto attr = static_cast<Ra__Node__Attribute*>(node);
+        if(!attr->alias.empty()){
+            if(std::find(qualifiers.begin(), qualifiers.end(), attr->alias)==qualifiers.end()){
+                return false;
+            }
+            continue;
+        }
+        bool found = std::find(column_names.begin(), column_names.end(), attr->name)!=column_names.end();
+        for(size_t i=0; i<relation_names.size() && !found; i++){
+            found = is_catalog_attribute(attr->name, relation_names[i]);
+        }
+        if(!found){
+            return false;
+        }
+    }
+
+    // 2. join blocks: the CTE exports the attributes used above the occurrences, references are renamed to the CTE.
+    // The relations must not be defined elsewhere and each occurrence must be in its own query block,
+    // otherwise attributes could not be assigned to a single occurrence
+    std::vector<Ra__Node*> cte_args;
+    std::vector<Ra__Node__Attribute*> qualified_uses;
+    if(!is_subquery){
+        std::set<Ra__Node*> blocks;
+        std::set<Ra__Node*> occurrence_nodes;
+        for(const auto& occurrence: occurrences){
+            blocks.insert(occurrence.block);
+            std::vector<Ra__Node*> subtree_nodes;
+            get_subtree_nodes(occurrence.node, subtree_nodes);
+            occurrence_nodes.insert(subtree_nodes.begin(), subtree_nodes.end());
+        }
+        if(blocks.size()!=occurrences.size()){
+            return false;
+        }
+
+        std::vector<Ra__Node*> tree_nodes;
+        get_subtree_nodes(root, tree_nodes);
+        for(auto cte: ctes){
+            get_subtree_nodes(cte, tree_nodes);
+        }
+        for(const auto& qualifier: qualifiers){
+            size_t n_defined = std::count_if(tree_nodes.begin(), tree_nodes.end(), [&](Ra__Node* node){
+                return get_relation_qualifier(node)==qualifier;
+            });
+            if(n_defined!=occurrences.size()){
+                return false;
+            }
+        }
+
+        if(!get_exported_attributes(tree_nodes, occurrence_nodes, qualifiers, relation_names, cte_args, qualified_uses) || cte_args.empty()){
+            return false;
+        }
+    }
+
+    // 3. shared only if computing the subtree once is cheaper than for every occurrence
+    if(!is_materialization_cheaper(first.node, occurrences.size())){
+        return false;
+    }
+
+    // 4. replace occurrences by references of the CTE
+    Ra__Symbol cte_name = symbols->intern("cte_" + std::to_string(counter++));
+    Ra__Node__Projection* cte_projection;
+    if(is_subquery){
+        // subqueries keep their alias as alias of the CTE reference, attributes above are unchanged
+        for(const auto& occurrence: occurrences){
+            auto pr = static_cast<Ra__Node__Projection*>(occurrence.node);
+            occurrence.parent->set_child(occurrence.child_index, arena->make<Ra__Node__Relation>(cte_name, pr->subquery_alias));
+        }
+        cte_projection = static_cast<Ra__Node__Projection*>(first.node);
+        cte_projection->subquery_alias = cte_name;
+    }
+    else{
+        for(const auto& occurrence: occurrences){
+            occurrence.parent->set_child(occurrence.child_index, arena->make<Ra__Node__Relation>(cte_name));
+        }
+        cte_projection = arena->make<Ra__Node__Projection>();
+        cte_projection->args = cte_args;
+        cte_projection->subquery_alias = cte_name;
+        cte_projection->add_child(first.node);
+        for(auto attr: qualified_uses){
+            attr->alias = cte_name;
+        }
+    }
+    cte_projection->cte_materialize = RA__CTE__MATERIALIZE_ALWAYS;
+
+    // 5. CTE is defined before the first CTE using it
+    int position = ctes.size();
+    for(const auto& occurrence: occurrences){
+        if(occurrence.tree>=0){
+            position = std::min(position, occurrence.tree);
+        }
+    }
+    ctes.insert(ctes.begin()+position, cte_projection);
+    return true;
+}
+
+bool RaTree::get_exported_attributes(const std::vector<Ra__Node*>& tree_nodes, const std::set<Ra__Node*>& subtree_nodes, const std::vector<Ra__Symbol>& qualifiers, const std::vector<Ra__Symbol>& relation_names, std::vector<Ra__Node*>& exported_args, std::vector<Ra__Node__Attribute*>& qualified_uses){
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> exported;
+    for(auto node: tree_nodes){
+        if(node->node_case!=RA__NODE__ATTRIBUTE || subtree_nodes.count(node)>0){
+            continue;
+        }
+        auto attr = static_cast<Ra__Node__Attribute*>(node);
+        bool uses_subtree = false;
+        if(!attr->alias.empty()){
+            uses_subtree = std::find(qualifiers.begin(), qualifiers.end(), attr->alias)!=qualifiers.end();
+        }
+        else{
+            for(size_t i=0; i<relation_names.size() && !uses_subtree; i++){
+                uses_subtree = is_catalog_attribute(attr->name, relation_names[i]);
+            }
+        }
+        if(!uses_subtree){
+            continue;
+        }
+        if(!attr->alias.empty()){
+            qualified_uses.push_back(attr);
+        }
+        if(std::find(exported.begin(), exported.end(), std::pair<Ra__Symbol,Ra__Symbol>(attr->alias, attr->name))!=exported.end()){
+            continue;
+        }
+        // columns are named by the attribute names, which must be unique
+        if(std::find_if(exported.begin(), exported.end(), [&](const auto& alias_name){return alias_name.second==attr->name;})!=exported.end()){
+            return false;
+        }
+        exported.push_back({attr->alias, attr->name});
+        exported_args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(attr->name, attr->alias)));
+    }
+    return true;
+}
+
+bool RaTree::merge_identical_ctes(){
+    invalidate_hashes();
+    for(size_t i=0; i<ctes.size(); i++){
+        for(size_t j=i+1; j<ctes.size(); j++){
+            if(!is_same_subtree(ctes[i], ctes[j], false)){
+                continue;
+            }
+            auto kept = static_cast<Ra__Node__Projection*>(ctes[i]);
+            Ra__Symbol removed = static_cast<Ra__Node__Projection*>(ctes[j])->subquery_alias;
+            ctes.erase(ctes.begin()+j);
+
+            // references of the removed CTE keep its name as alias, attributes referring to it are unchanged
+            size_t uses = 0;
+            std::vector<Ra__Node*> stack = {root};
+            stack.insert(stack.end(), ctes.begin(), ctes.end());
+            while(!stack.empty()){
+                Ra__Node* it = stack.back();
+                stack.pop_back();
+                if(it->node_case==RA__NODE__RELATION){
+                    auto rel = static_cast<Ra__Node__Relation*>(it);
+                    if(rel->name==removed){
+                        if(rel->alias.empty()){
+                            rel->alias = removed;
+                        }
+                        rel->name = kept->subquery_alias;
+                    }
+                    if(rel->name==kept->subquery_alias){
+                        uses++;
+                    }
+                }
+                for(auto child: it->childNodes){
+                    stack.push_back(child);
+                }
+            }
+            if(uses>1){
+                kept->cte_materialize = is_materialization_cheaper(kept, uses) ? RA__CTE__MATERIALIZE_ALWAYS : RA__CTE__MATERIALIZE_NEVER;
+            }
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,582 @@
+#include "ra_tree.h"
+#include <cstdint>
+#include <limits>
+
+// exact decimal number: mantissa*10^-scale, int and numeric constants are folded without rounding
+struct Ra__Decimal{
+    int64_t mantissa = 0;
+    int scale = 0;
+};
+
+static const int max_decimal_scale = 18;
+
+static bool parse_decimal(const std::string& data, Ra__Decimal& decimal){
+    size_t i = 0;
+    bool negative = false;
+    if(i<data.size() && (data[i]=='-' || data[i]=='+')){
+        negative = data[i]=='-';
+        i++;
+    }
+    bool has_digits = false;
+    bool has_point = false;
+    decimal = Ra__Decimal();
+    for(; i<data.size(); i++){
+        if(data[i]=='.' && !has_point){
+            has_point = true;
+            continue;
+        }
+        if(data[i]<'0' || data[i]>'9'){
+            return false;
+        }
+        if(__builtin_mul_overflow(decimal.mantissa, 10, &decimal.mantissa)
+            || __builtin_add_overflow(decimal.mantissa, data[i]-'0', &decimal.mantissa)){
+            return false;
+        }
+        if(has_point && ++decimal.scale>max_decimal_scale){
+            return false;
+        }
+        has_digits = true;
+    }
+    if(negative){
+        decimal.mantissa = -decimal.mantissa;
+    }
+    return has_digits;
+}
+
+static std::string decimal_to_string(const Ra__Decimal& decimal){
+    bool negative = decimal.mantissa<0;
+    // -(INT64_MIN) overflows, go through unsigned
+    uint64_t magnitude = negative ? 0-static_cast<uint64_t>(decimal.mantissa) : static_cast<uint64_t>(decimal.mantissa);
+    std::string digits = std::to_string(magnitude);
+    if(decimal.scale>0){
+        if(digits.size()<=static_cast<size_t>(decimal.scale)){
+            digits.insert(0, decimal.scale-digits.size()+1, '0');
+        }
+        digits.insert(digits.size()-decimal.scale, ".");
+    }
+    return negative ? "-"+digits : digits;
+}
+
+static bool rescale_decimal(Ra__Decimal& decimal, int scale){
+    for(; decimal.scale<scale; decimal.scale++){
+        if(__builtin_mul_overflow(decimal.mantissa, 10, &decimal.mantissa)){
+            return false;
+        }
+    }
+    return true;
+}
+
+// +, - and * keep the scale rules of numeric (max resp. sum of the scales),
+// / is only folded for ints without remainder (databases disagree whether 7/2 is 3 or 3.5)
+static bool evaluate_decimal(Ra__Decimal l, Ra__Decimal r, const std::string& op, bool is_int, Ra__Decimal& result){
+    result = Ra__Decimal();
+    if(op=="+" || op=="-"){
+        int scale = std::max(l.scale, r.scale);
+        if(!rescale_decimal(l, scale) || !rescale_decimal(r, scale)){
+            return false;
+        }
+        result.scale = scale;
+        return op=="+" ? !__builtin_add_overflow(l.mantissa, r.mantissa, &result.mantissa)
+            : !__builtin_sub_overflow(l.mantissa, r.mantissa, &result.mantissa);
+    }
+    if(op=="*"){
+        result.scale = l.scale+r.scale;
+        return result.scale<=max_decimal_scale && !__builtin_mul_overflow(l.mantissa, r.mantissa, &result.mantissa);
+    }
+    if(op=="/" && is_int && r.mantissa!=0 && !(l.mantissa==std::numeric_limits<int64_t>::min() && r.mantissa==-1)
+        && l.mantissa%r.mantissa==0){
+        result.mantissa = l.mantissa/r.mantissa;
+        return true;
+    }
+    return false;
+}
+
+static bool fits_int4(int64_t value){
+    return value>=std::numeric_limits<int32_t>::min() && value<=std::numeric_limits<int32_t>::max();
+}
+
+// days since 1970-01-01 of a proleptic gregorian date
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d){
+    y -= m<=2;
+    const int64_t era = (y>=0 ? y : y-399)/400;
+    const unsigned yoe = static_cast<unsigned>(y-era*400);
+    const unsigned doy = (153*(m>2 ? m-3 : m+9)+2)/5+d-1;
+    const unsigned doe = yoe*365+yoe/4-yoe/100+doy;
+    return era*146097+static_cast<int64_t>(doe)-719468;
+}
+
+static void civil_from_days(int64_t z, int64_t& y, unsigned& m, unsigned& d){
+    z += 719468;
+    const int64_t era = (z>=0 ? z : z-146096)/146097;
+    const unsigned doe = static_cast<unsigned>(z-era*146097);
+    const unsigned yoe = (doe-doe/1460+doe/36524-doe/146096)/365;
+    const unsigned doy = doe-(365*yoe+yoe/4-yoe/100);
+    const unsigned mp = (5*doy+2)/153;
+    d = doy-(153*mp+2)/5+1;
+    m = mp<10 ? mp+3 : mp-9;
+    y = static_cast<int64_t>(yoe)+era*400+(m<=2);
+}
+
+static unsigned days_in_month(int64_t y, unsigned m){
+    static const unsigned days[] = {31,28,31,30,31,30,31,31,30,31,30,31};
+    bool leap = (y%4==0 && y%100!=0) || y%400==0;
+    return m==2 && leap ? 29 : days[m-1];
+}
+
+// date 'YYYY-MM-DD'
+static bool parse_date(Ra__Node* expression, int64_t& y, unsigned& m, unsigned& d){
+    if(expression->node_case!=RA__NODE__TYPE_CAST){
+        return false;
+    }
+    auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+    if(type_cast->type!="date" || !type_cast->typ_mod.empty() || type_cast->expression==nullptr
+        || type_cast->expression->node_case!=RA__NODE__CONST){
+        return false;
+    }
+    const std::string& data = static_cast<Ra__Node__Constant*>(type_cast->expression)->data;
+    if(data.size()!=10 || data[4]!='-' || data[7]!='-'){
+        return false;
+    }
+    for(size_t i: {0,1,2,3,5,6,8,9}){
+        if(data[i]<'0' || data[i]>'9'){
+            return false;
+        }
+    }
+    y = std::stoll(data.substr(0,4));
+    m = std::stoul(data.substr(5,2));
+    d = std::stoul(data.substr(8,2));
+    return m>=1 && m<=12 && d>=1 && d<=days_in_month(y, m);
+}
+
+// interval 'N' year/month/day
+static bool parse_interval(Ra__Node* expression, std::string& unit, int64_t& n){
+    if(expression->node_case!=RA__NODE__TYPE_CAST){
+        return false;
+    }
+    auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+    if(type_cast->type!="interval" || type_cast->expression==nullptr || type_cast->expression->node_case!=RA__NODE__CONST
+        || (type_cast->typ_mod!="year" && type_cast->typ_mod!="month" && type_cast->typ_mod!="day")){
+        return false;
+    }
+    Ra__Decimal decimal;
+    if(!parse_decimal(static_cast<Ra__Node__Constant*>(type_cast->expression)->data, decimal) || decimal.scale!=0
+        || !fits_int4(decimal.mantissa)){
+        return false;
+    }
+    unit = type_cast->typ_mod;
+    n = decimal.mantissa;
+    return true;
+}
+
+static bool parse_int(Ra__Node* expression, int64_t& n){
+    Ra__Decimal decimal;
+    if(expression->node_case!=RA__NODE__CONST || static_cast<Ra__Node__Constant*>(expression)->dataType!=RA__CONST_DATATYPE__INT
+        || !parse_decimal(static_cast<Ra__Node__Constant*>(expression)->data, decimal) || !fits_int4(decimal.mantissa)){
+        return false;
+    }
+    n = decimal.mantissa;
+    return true;
+}
+
+// date 'YYYY-MM-DD' of days since 1970-01-01, nullptr if the year is out of range
+static Ra__Node* make_date_constant(RaArena& arena, int64_t days){
+    int64_t y;
+    unsigned m, d;
+    civil_from_days(days, y, m, d);
+    if(y<1 || y>9999){
+        return nullptr;
+    }
+    char data[11];
+    snprintf(data, sizeof(data), "%04d-%02u-%02u", static_cast<int>(y), m, d);
+    auto constant = arena.make<Ra__Node__Constant>(data, RA__CONST_DATATYPE__STRING);
+    return arena.make<Ra__Node__Type_Cast>("date", "", constant);
+}
+
+// date +/- int and date +/- interval 'N' year/month/day, nullptr if not evaluated
+static Ra__Node* evaluate_date_arithmetic(RaArena& arena, Ra__Node__Expression* expr, bool is_compared){
+    int64_t y;
+    unsigned m, d;
+    std::string unit;
+    int64_t n;
+    Ra__Node* date = expr->l_arg;
+    Ra__Node* offset = expr->r_arg;
+    if(expr->operator_=="+" && offset!=nullptr && parse_date(offset, y, m, d)){
+        std::swap(date, offset);
+    }
+    if(date==nullptr || offset==nullptr || (expr->operator_!="+" && expr->operator_!="-") || !parse_date(date, y, m, d)){
+        return nullptr;
+    }
+    int64_t sign = expr->operator_=="+" ? 1 : -1;
+    // date +/- integer is a date
+    if(parse_int(offset, n)){
+        return make_date_constant(arena, days_from_civil(y, m, d)+sign*n);
+    }
+    // date +/- interval is a timestamp at midnight, it is only replaced by the date where it is compared with a date
+    if(!is_compared || !parse_interval(offset, unit, n)){
+        return nullptr;
+    }
+    if(unit=="day"){
+        return make_date_constant(arena, days_from_civil(y, m, d)+sign*n);
+    }
+    // months are added to the month, the day is clamped to the end of the month (1995-01-31 + 1 month = 1995-02-28)
+    int64_t months = y*12+(m-1)+sign*(unit=="year" ? n*12 : n);
+    int64_t new_y = months>=0 ? months/12 : (months-11)/12;
+    unsigned new_m = static_cast<unsigned>(months-new_y*12)+1;
+    if(new_y<1 || new_y>9999){
+        return nullptr;
+    }
+    return make_date_constant(arena, days_from_civil(new_y, new_m, std::min(d, days_in_month(new_y, new_m))));
+}
+
+// +, -, * and / of two int/numeric constants or unary +/- of a constant,
+// nullptr if not evaluated (not constant, division of numerics or with remainder, overflow)
+static Ra__Node* evaluate_arithmetic(RaArena& arena, Ra__Node__Expression* expr){
+    Ra__Node* l_arg = expr->l_arg;
+    Ra__Node* r_arg = expr->r_arg;
+    // unary +/-, the parser rejects queries with untranslated operands, a missing left operand is a unary operator
+    if(l_arg==nullptr && r_arg!=nullptr && r_arg->node_case==RA__NODE__CONST && (expr->operator_=="-" || expr->operator_=="+")){
+        auto constant = static_cast<Ra__Node__Constant*>(r_arg);
+        Ra__Decimal decimal;
+        if(constant->dataType==RA__CONST_DATATYPE__STRING || !parse_decimal(constant->data, decimal)
+            || (expr->operator_=="-" && __builtin_sub_overflow(static_cast<int64_t>(0), decimal.mantissa, &decimal.mantissa))){
+            return nullptr;
+        }
+        return arena.make<Ra__Node__Constant>(decimal_to_string(decimal), constant->dataType);
+    }
+    if(l_arg==nullptr || r_arg==nullptr || l_arg->node_case!=RA__NODE__CONST || r_arg->node_case!=RA__NODE__CONST){
+        return nullptr;
+    }
+    auto l_const = static_cast<Ra__Node__Constant*>(l_arg);
+    auto r_const = static_cast<Ra__Node__Constant*>(r_arg);
+    Ra__Decimal l, r, result;
+    if(l_const->dataType==RA__CONST_DATATYPE__STRING || r_const->dataType==RA__CONST_DATATYPE__STRING
+        || !parse_decimal(l_const->data, l) || !parse_decimal(r_const->data, r)){
+        return nullptr;
+    }
+    bool is_int = l_const->dataType==RA__CONST_DATATYPE__INT && r_const->dataType==RA__CONST_DATATYPE__INT;
+    if(!evaluate_decimal(l, r, expr->operator_, is_int, result)){
+        return nullptr;
+    }
+    // int overflows are errors of the target database, they are not folded away
+    if(is_int && fits_int4(l.mantissa) && fits_int4(r.mantissa) && !fits_int4(result.mantissa)){
+        return nullptr;
+    }
+    return arena.make<Ra__Node__Constant>(decimal_to_string(result), is_int ? RA__CONST_DATATYPE__INT : RA__CONST_DATATYPE__FLOAT);
+}
+
+Ra__Node* RaTree::evaluate_constant_expression(RaArena& arena, Ra__Node* expression, bool is_compared){
+    switch(expression->node_case){
+        case RA__NODE__CONST: return expression;
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+            if(type_cast->expression==nullptr){
+                return nullptr;
+            }
+            auto evaluated = evaluate_constant_expression(arena, type_cast->expression, false);
+            if(evaluated==nullptr){
+                return nullptr;
+            }
+            return evaluated==type_cast->expression ? type_cast : arena.make<Ra__Node__Type_Cast>(type_cast->type, type_cast->typ_mod, evaluated);
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            auto evaluated_expr = arena.make<Ra__Node__Expression>();
+            evaluated_expr->operator_ = expr->operator_;
+            if(expr->l_arg!=nullptr && (evaluated_expr->l_arg = evaluate_constant_expression(arena, expr->l_arg, is_compared))==nullptr){
+                return nullptr;
+            }
+            if(expr->r_arg==nullptr || (evaluated_expr->r_arg = evaluate_constant_expression(arena, expr->r_arg, is_compared))==nullptr){
+                return nullptr;
+            }
+            Ra__Node* evaluated = evaluate_arithmetic(arena, evaluated_expr);
+            return evaluated!=nullptr ? evaluated : evaluate_date_arithmetic(arena, evaluated_expr, is_compared);
+        }
+        default: return nullptr;
+    }
+}
+
+bool RaTree::is_template_constant(Ra__Node* expression, bool& has_placeholder){
+    if(expression==nullptr){
+        return false;
+    }
+    switch(expression->node_case){
+        case RA__NODE__CONST:{
+            auto constant = static_cast<Ra__Node__Constant*>(expression);
+            std::string value;
+            if(template_literal(constant, value) || (!constant->data.empty() && constant->data[0]==template_fold_start)){
+                has_placeholder = true;
+            }
+            return true;
+        }
+        case RA__NODE__TYPE_CAST: return is_template_constant(static_cast<Ra__Node__Type_Cast*>(expression)->expression, has_placeholder);
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            return (expr->l_arg==nullptr || is_template_constant(expr->l_arg, has_placeholder)) && is_template_constant(expr->r_arg, has_placeholder);
+        }
+        default: return false;
+    }
+}
+
+Ra__Node* RaTree::replace_template_placeholders(Ra__Node* expression, bool literals){
+    if(expression==nullptr){
+        return nullptr;
+    }
+    switch(expression->node_case){
+        case RA__NODE__CONST:{
+            auto constant = static_cast<Ra__Node__Constant*>(expression);
+            std::string value;
+            if(literals && template_literal(constant, value)){
+                return arena->make<Ra__Node__Constant>(value, constant->dataType);
+            }
+            if(constant->data.size()<2 || constant->data[0]!=template_fold_start){
+                return constant;
+            }
+            auto fold = template_folds[std::stoul(constant->data.substr(1, constant->data.size()-2))].expression;
+            return literals ? replace_template_placeholders(fold, true) : fold;
+        }
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+            return arena->make<Ra__Node__Type_Cast>(type_cast->type, type_cast->typ_mod, replace_template_placeholders(type_cast->expression, literals));
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            auto replaced = arena->make<Ra__Node__Expression>();
+            replaced->l_arg = replace_template_placeholders(expr->l_arg, literals);
+            replaced->r_arg = replace_template_placeholders(expr->r_arg, literals);
+            replaced->operator_ = expr->operator_;
+            return replaced;
+        }
+        default: return expression;
+    }
+}
+
+Ra__Node* RaTree::defer_template_fold(Ra__Node__Expression* expression, bool is_compared){
+    // the template only keeps folds which this query's literals allow, the cache evaluates them again for other literals
+    if(evaluate_constant_expression(*arena, replace_template_placeholders(expression, true), is_compared)==nullptr){
+        return nullptr;
+    }
+    // placeholders of the operands are replaced by their expressions, the whole expression is folded at once
+    Ra__Template_Fold fold;
+    fold.expression = replace_template_placeholders(expression, false);
+    fold.is_compared = is_compared;
+    template_folds.push_back(fold);
+    std::string placeholder = template_fold_start+std::to_string(template_folds.size()-1)+template_fold_end;
+    return arena->make<Ra__Node__Constant>(placeholder, RA__CONST_DATATYPE__STRING);
+}
+
+Ra__Node* RaTree::fold_constant_expression(Ra__Node* expression, bool is_compared){
+    if(expression==nullptr){
+        return nullptr;
+    }
+    // expressions may be shared (hash consed constants, derived predicates), they are copied instead of modified
+    switch(expression->node_case){
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            auto l_arg = fold_constant_expression(expr->l_arg, is_compared);
+            auto r_arg = fold_constant_expression(expr->r_arg, is_compared);
+            if(l_arg!=expr->l_arg || r_arg!=expr->r_arg){
+                auto folded_expr = arena->make<Ra__Node__Expression>();
+                folded_expr->l_arg = l_arg;
+                folded_expr->r_arg = r_arg;
+                folded_expr->operator_ = expr->operator_;
+                expr = folded_expr;
+            }
+            // expressions over the literal placeholders of a plan cache template are folded when the template is filled
+            bool has_placeholder = false;
+            if(template_literal && is_template_constant(expr, has_placeholder) && has_placeholder){
+                Ra__Node* placeholder = defer_template_fold(expr, is_compared);
+                return placeholder!=nullptr ? placeholder : expr;
+            }
+            Ra__Node* folded = evaluate_arithmetic(*arena, expr);
+            if(folded==nullptr){
+                folded = evaluate_date_arithmetic(*arena, expr, is_compared);
+            }
+            return folded!=nullptr ? folded : expr;
+        }
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+            auto folded = fold_constant_expression(type_cast->expression, false);
+            if(folded==type_cast->expression){
+                return type_cast;
+            }
+            return arena->make<Ra__Node__Type_Cast>(type_cast->type, type_cast->typ_mod, folded);
+        }
+        case RA__NODE__LIST:{
+            auto list = static_cast<Ra__Node__List*>(expression);
+            std::vector<Ra__Node*> args;
+            for(auto arg: list->args){
+                args.push_back(fold_constant_expression(arg, is_compared));
+            }
+            if(args==list->args){
+                return list;
+            }
+            auto folded_list = arena->make<Ra__Node__List>();
+            folded_list->args = args;
+            return folded_list;
+        }
+        case RA__NODE__IN_LIST:{
+            auto in_list = static_cast<Ra__Node__In_List*>(expression);
+            std::vector<Ra__Node*> args;
+            for(auto arg: in_list->args){
+                args.push_back(fold_constant_expression(arg, is_compared));
+            }
+            if(args==in_list->args){
+                return in_list;
+            }
+            auto folded_in_list = arena->make<Ra__Node__In_List>();
+            folded_in_list->args = args;
+            return folded_in_list;
+        }
+        case RA__NODE__FUNC_CALL:{
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
+            std::vector<Ra__Node*> args;
+            for(auto arg: func_call->args){
+                args.push_back(fold_constant_expression(arg, false));
+            }
+            if(args==func_call->args){
+                return func_call;
+            }
+            auto folded_func_call = arena->make<Ra__Node__Func_Call>(func_call->func_name);
+            folded_func_call->args = args;
+            folded_func_call->is_aggregating = func_call->is_aggregating;
+            folded_func_call->agg_distinct = func_call->agg_distinct;
+            folded_func_call->is_window = func_call->is_window;
+            folded_func_call->window_partition = func_call->window_partition;
+            return folded_func_call;
+        }
+        case RA__NODE__CASE_EXPR:{
+            auto case_expr = static_cast<Ra__Node__Case_Expr*>(expression);
+            std::vector<Ra__Node__Case_When*> args;
+            bool folded = false;
+            for(auto case_when: case_expr->args){
+                auto when = fold_constant_predicate(case_when->when);
+                auto then = fold_constant_expression(case_when->then, false);
+                if(when!=case_when->when || then!=case_when->then){
+                    case_when = arena->make<Ra__Node__Case_When>(when, then);
+                    folded = true;
+                }
+                args.push_back(case_when);
+            }
+            auto else_default = fold_constant_expression(case_expr->else_default, false);
+            if(!folded && else_default==case_expr->else_default){
+                return case_expr;
+            }
+            auto folded_case_expr = arena->make<Ra__Node__Case_Expr>();
+            folded_case_expr->args = args;
+            folded_case_expr->else_default = else_default;
+            return folded_case_expr;
+        }
+        default: return expression; // const, attribute, marker
+    }
+}
+
+Ra__Node* RaTree::fold_constant_predicate(Ra__Node* predicate){
+    if(predicate==nullptr){
+        return nullptr;
+    }
+    switch(predicate->node_case){
+        case RA__NODE__BOOL_PREDICATE:{
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
+            std::vector<Ra__Node*> args;
+            for(auto arg: bool_p->args){
+                args.push_back(fold_constant_predicate(arg));
+            }
+            if(args==bool_p->args){
+                return bool_p;
+            }
+            auto folded_bool_p = arena->make<Ra__Node__Bool_Predicate>();
+            folded_bool_p->bool_operator = bool_p->bool_operator;
+            folded_bool_p->args = args;
+            return folded_bool_p;
+        }
+        case RA__NODE__PREDICATE:{
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
+            auto left = fold_constant_expression(p->left, true);
+            auto right = fold_constant_expression(p->right, true);
+            if(left==p->left && right==p->right){
+                return p;
+            }
+            return arena->make<Ra__Node__Predicate>(left, right, p->binaryOperator);
+        }
+        case RA__NODE__NULL_TEST:{
+            auto null_test = static_cast<Ra__Node__Null_Test*>(predicate);
+            auto arg = fold_constant_expression(null_test->arg, false);
+            if(arg==null_test->arg){
+                return null_test;
+            }
+            auto folded_null_test = arena->make<Ra__Node__Null_Test>();
+            folded_null_test->arg = arg;
+            folded_null_test->type = null_test->type;
+            return folded_null_test;
+        }
+        default: return predicate; // marker
+    }
+}
+
+void RaTree::fold_constants(Ra__Node* it){
+    switch(it->node_case){
+        case RA__NODE__SELECTION:{
+            auto selection = static_cast<Ra__Node__Selection*>(it);
+            selection->predicate = fold_constant_predicate(selection->predicate);
+            break;
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(it);
+            join->predicate = fold_constant_predicate(join->predicate);
+            break;
+        }
+        case RA__NODE__HAVING:{
+            auto having = static_cast<Ra__Node__Having*>(it);
+            having->predicate = fold_constant_predicate(having->predicate);
+            break;
+        }
+        case RA__NODE__PROJECTION:{
+            for(auto arg: static_cast<Ra__Node__Projection*>(it)->args){
+                auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+                sel_expr->expression = fold_constant_expression(sel_expr->expression, false);
+            }
+            break;
+        }
+        case RA__NODE__LIMIT:{
+            auto limit = static_cast<Ra__Node__Limit*>(it);
+            if(limit->count!=nullptr){
+                limit->count = fold_constant_expression(limit->count, false);
+            }
+            if(limit->offset!=nullptr){
+                limit->offset = fold_constant_expression(limit->offset, false);
+            }
+            break;
+        }
+        // constants in order by/group by are positions of select expressions, expressions are not folded to a constant
+        case RA__NODE__ORDER_BY:{
+            for(auto& arg: static_cast<Ra__Node__Order_By*>(it)->args){
+                auto folded = fold_constant_expression(arg, false);
+                if(folded->node_case!=RA__NODE__CONST){
+                    arg = folded;
+                }
+            }
+            break;
+        }
+        case RA__NODE__GROUP_BY:{
+            for(auto& arg: static_cast<Ra__Node__Group_By*>(it)->args){
+                auto folded = fold_constant_expression(arg, false);
+                if(folded->node_case!=RA__NODE__CONST){
+                    arg = folded;
+                }
+            }
+            break;
+        }
+        default: break;
+    }
+    for(auto child: it->childNodes){
+        fold_constants(child);
+    }
+}
+
+void RaTree::fold_constants(){
+    fold_constants(root);
+    for(auto cte: ctes){
+        fold_constants(cte);
+    }
+    invalidate_hashes();
+}
@@ -0,0 +1,954 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <cstdlib>
+
+// defaults without column statistics, as in PostgreSQL (utils/selfuncs.h),
+// equality selectivity is 1/default_num_distinct
+static const double default_ineq_selectivity = 1.0/3.0;
+static const double default_match_selectivity = 0.005;
+static const double default_unknown_selectivity = 0.005;
+static const double default_num_distinct = 200;
+
+// rows of relations without catalog row count
+static const double default_relation_rows = 1000;
+// fraction of rows kept by exists/in subqueries
+static const double default_semi_join_selectivity = 0.5;
+// magic set filters only by correlation keys keeping at most this fraction of the subquery's values
+static const double max_magic_set_key_selectivity = 0.5;
+// width of values of unknown or variable length type
+static const double default_column_width = 32;
+// shorter in lists are expanded to index lookups by the target databases themselves
+static const size_t min_values_join_in_list_size = 16;
+
+// parses numbers and dates (days since 1970-01-01), the values histograms can be interpolated on
+static bool get_scalar(const std::string& value, double& scalar){
+    if(value.empty()){
+        return false;
+    }
+    char* end;
+    scalar = std::strtod(value.c_str(), &end);
+    if(*end=='\0'){
+        return true;
+    }
+    int year, month, day;
+    if(value.size()<10 || sscanf(value.c_str(), "%4d-%2d-%2d", &year, &month, &day)!=3){
+        return false;
+    }
+    // days from civil date, proleptic gregorian calendar
+    year -= month<=2;
+    int era = (year>=0 ? year : year-399) / 400;
+    int year_of_era = year - era*400;
+    int day_of_year = (153*(month + (month>2 ? -3 : 9)) + 2)/5 + day-1;
+    int day_of_era = year_of_era*365 + year_of_era/4 - year_of_era/100 + day_of_year;
+    scalar = era*146097.0 + day_of_era - 719468;
+    return true;
+}
+
+// compares numbers and dates by value, anything else as strings
+static int compare_values(const std::string& a, const std::string& b){
+    double scalar_a, scalar_b;
+    if(get_scalar(a, scalar_a) && get_scalar(b, scalar_b)){
+        return scalar_a<scalar_b ? -1 : scalar_a>scalar_b ? 1 : 0;
+    }
+    return a.compare(b)<0 ? -1 : a.compare(b)>0 ? 1 : 0;
+}
+
+// distinct values of a column as in pg_stats.n_distinct, 0 if unknown
+static double get_stats_distinct(const Ra__Catalog__Column_Stats& stats, double rows){
+    return stats.n_distinct<0 ? -stats.n_distinct * rows : stats.n_distinct;
+}
+
+// fraction of all rows equal to value
+static double get_stats_fraction_equal(const Ra__Catalog__Column_Stats& stats, const std::string& value, double distinct){
+    double mcv_fraction = 0;
+    for(size_t i=0; i<stats.most_common_values.size(); i++){
+        if(compare_values(stats.most_common_values[i], value)==0){
+            return stats.most_common_freqs[i];
+        }
+        mcv_fraction += stats.most_common_freqs[i];
+    }
+    // remaining rows are spread evenly over the remaining values
+    double other_distinct = std::max(1.0, distinct - stats.most_common_values.size());
+    return std::max(0.0, 1 - stats.null_frac - mcv_fraction) / other_distinct;
+}
+
+// fraction of all rows less than (or equal to) value, -1 if there is neither a histogram nor most common values
+static double get_stats_fraction_less(const Ra__Catalog__Column_Stats& stats, const std::string& value, bool or_equal){
+    const auto& bounds = stats.histogram_bounds;
+    if(bounds.size()<2 && stats.most_common_values.empty()){
+        return -1;
+    }
+    double fraction = 0;
+    double mcv_fraction = 0;
+    for(size_t i=0; i<stats.most_common_values.size(); i++){
+        int compared = compare_values(stats.most_common_values[i], value);
+        if(compared<0 || (or_equal && compared==0)){
+            fraction += stats.most_common_freqs[i];
+        }
+        mcv_fraction += stats.most_common_freqs[i];
+    }
+    if(bounds.size()<2){
+        return fraction;
+    }
+
+    // histogram buckets hold the same number of rows, values are interpolated linearly within a bucket
+    double histogram_fraction;
+    if(compare_values(value, bounds.front())<0){
+        histogram_fraction = 0;
+    }
+    else if(compare_values(value, bounds.back())>=0){
+        histogram_fraction = 1;
+    }
+    else{
+        auto upper = std::upper_bound(bounds.begin(), bounds.end(), value, [](const std::string& v, const std::string& bound){
+            return compare_values(v, bound)<0;
+        });
+        size_t bucket = upper - bounds.begin() - 1;
+        double low, high, scalar;
+        double in_bucket = 0.5;
+        if(get_scalar(bounds[bucket], low) && get_scalar(bounds[bucket+1], high) && get_scalar(value, scalar) && high>low){
+            in_bucket = (scalar - low) / (high - low);
+        }
+        histogram_fraction = (bucket + in_bucket) / (bounds.size()-1);
+    }
+    return fraction + histogram_fraction * std::max(0.0, 1 - stats.null_frac - mcv_fraction);
+}
+
+// width of a value of a type as named in the catalog
+static double get_type_width(const std::string& type){
+    if(type=="bool" || type=="boolean"){
+        return 1;
+    }
+    if(type=="int2" || type=="smallint"){
+        return 2;
+    }
+    if(type=="int4" || type=="int" || type=="integer" || type=="date" || type=="float4" || type=="real"){
+        return 4;
+    }
+    if(type=="int8" || type=="bigint" || type=="float8" || type=="numeric" || type=="decimal" || type=="timestamp" || type=="interval"){
+        return 8;
+    }
+    return default_column_width;
+}
+
+// value of a constant, also of a constant cast to a type (date '1995-03-15')
+static bool get_constant_value(Ra__Node* expression, std::string& value){
+    if(expression->node_case==RA__NODE__TYPE_CAST){
+        expression = static_cast<Ra__Node__Type_Cast*>(expression)->expression;
+        if(expression==nullptr){
+            return false;
+        }
+    }
+    if(expression->node_case!=RA__NODE__CONST){
+        return false;
+    }
+    value = static_cast<Ra__Node__Constant*>(expression)->data;
+    return true;
+}
+
+double RaTree::estimate_cost(){
+    index_cost_relations();
+    double cost = 0;
+    estimate_cardinality(root, cost);
+    for(auto cte: ctes){
+        estimate_cardinality(cte, cost);
+    }
+    return cost;
+}
+
+bool RaTree::is_decoupling_cheaper(Ra__Node* d_projection, Ra__Node* outer){
+    index_cost_relations();
+
+    // D: distinct correlated attributes of the outer query
+    cost_d_cardinality = 0;
+    double outer_cost = 0;
+    double outer_rows = estimate_cardinality(outer, outer_cost);
+    double d_rows = std::min(outer_rows, estimate_distinct_values(static_cast<Ra__Node__Projection*>(d_projection)->args));
+
+    // both variants are costed on the whole tree like estimate_cost() of the final plans,
+    // the rows the subquery produces also change the cost of the joins with the outer query above it
+    // decoupled: subquery is evaluated for all values of the correlated attributes, D and its predicates are removed
+    double decoupled_cost = estimate_cost();
+
+    // not decoupled: outer is materialized as CTE and computed once like in place, D is computed from it and restricts the subquery
+    cost_d_cardinality = d_rows;
+    double dependent_cost = estimate_cost() + d_rows;
+    cost_d_cardinality = -1;
+
+    return decoupled_cost <= dependent_cost;
+}
+
+std::vector<size_t> RaTree::select_magic_set_keys(Ra__Node* inner, const std::vector<std::pair<Ra__Node*,Ra__Node*>>& keys, Ra__Node* outer){
+    index_cost_relations();
+
+    double outer_cost = 0;
+    double outer_rows = estimate_cardinality(outer, outer_cost);
+    double inner_cost = 0;
+    double inner_rows = estimate_cardinality(inner, inner_cost);
+
+    // a filter keeps the fraction of the subquery's key values which occur in the outer query
+    std::vector<size_t> magic_keys;
+    double selectivity = 1;
+    for(size_t i=0; i<keys.size(); i++){
+        double outer_values = std::min(outer_rows, estimate_distinct_values({keys[i].first}));
+        double inner_values = std::min(inner_rows, estimate_distinct_values({keys[i].second}));
+        double key_selectivity = std::min(1.0, outer_values/std::max(inner_values, 1.0));
+        if(key_selectivity<=max_magic_set_key_selectivity){
+            magic_keys.push_back(i);
+            selectivity *= key_selectivity;
+        }
+    }
+    if(magic_keys.empty()){
+        return magic_keys;
+    }
+
+    // filtering pays off if the whole tree is estimated cheaper with the filter, like estimate_cost() of the final plans:
+    // the filter evaluates every subquery row, the rows it removes also make the aggregations and joins above cheaper
+    double unfiltered_cost = estimate_cost();
+    cost_magic_set_input = inner;
+    cost_magic_set_selectivity = selectivity;
+    double filtered_cost = estimate_cost();
+    cost_magic_set_input = nullptr;
+    if(filtered_cost>=unfiltered_cost){
+        magic_keys.clear();
+    }
+    return magic_keys;
+}
+
+bool RaTree::is_materialization_cheaper(Ra__Node* subtree, size_t uses){
+    index_cost_relations();
+
+    double cost = 0;
+    double rows = estimate_cardinality(subtree, cost);
+
+    // materialized: computed once and stored, like the outer query of a decorrelated dependent join
+    // not materialized: computed for every use, but scans of base relations are free (C_out)
+    return uses*cost > cost + rows;
+}
+
+double RaTree::estimate_scan_rows(Ra__Node* join_block){
+    std::vector<Ra__Node*> relations;
+    std::vector<Ra__Node*> conjuncts;
+    std::vector<Ra__Node*> stack = {join_block};
+    while(!stack.empty()){
+        Ra__Node* it = stack.back();
+        stack.pop_back();
+        if(it->node_case==RA__NODE__RELATION){
+            relations.push_back(it);
+        }
+        else if(it->node_case==RA__NODE__SELECTION){
+            std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+            split_selection_predicates(static_cast<Ra__Node__Selection*>(it)->predicate, predicates_relations);
+            for(const auto& p_r: predicates_relations){
+                conjuncts.push_back(p_r.first);
+            }
+        }
+        stack.insert(stack.end(), it->childNodes.begin(), it->childNodes.end());
+    }
+
+    // conjuncts on a single relation are assumed to be answered by an index, other relations are scanned completely
+    double rows = 0;
+    for(auto relation: relations){
+        Ra__Symbol qualifier = get_relation_qualifier(relation);
+        auto restriction = arena->make<Ra__Node__Bool_Predicate>();
+        restriction->bool_operator = RA__BOOL_OPERATOR__AND;
+        for(auto conjunct: conjuncts){
+            std::vector<Ra__Symbol> conjunct_relations;
+            get_predicate_relations(conjunct, conjunct_relations);
+            if(!conjunct_relations.empty() && std::all_of(conjunct_relations.begin(), conjunct_relations.end(), [&](Ra__Symbol r){ return r==qualifier; })){
+                restriction->args.push_back(conjunct);
+            }
+        }
+        double relation_cost = 0;
+        rows += estimate_cardinality(relation, relation_cost) * estimate_selectivity(restriction);
+    }
+    return rows;
+}
+
+bool RaTree::is_disjunction_split_cheaper(Ra__Node* selection, Ra__Node* union_node){
+    index_cost_relations();
+
+    // C_out does not tell index lookups from scans, the rows read from the relations are added to both plans
+    double disjunction_cost = estimate_scan_rows(selection);
+    estimate_cardinality(selection, disjunction_cost);
+
+    double split_cost = 0;
+    for(auto branch: union_node->childNodes){
+        split_cost += estimate_scan_rows(branch);
+    }
+    estimate_cardinality(union_node, split_cost);
+    return split_cost < disjunction_cost;
+}
+
+bool RaTree::is_values_join_cheaper(Ra__Node__Predicate* in_predicate, size_t n_values){
+    if(n_values<min_values_join_in_list_size){
+        return false;
+    }
+    const Ra__Catalog__Table* table = get_attribute_table(static_cast<Ra__Node__Attribute*>(in_predicate->left));
+    double rows = table!=nullptr && table->row_count>0 ? table->row_count : default_relation_rows;
+
+    // in list: every row is scanned and compared with the list, values join: one index lookup per value
+    return n_values + rows * estimate_selectivity(in_predicate) < rows;
+}
+
+void RaTree::index_cost_relations(){
+    cost_relations.clear();
+    cost_ctes.clear();
+    cost_marker_selectivities.clear();
+    cost_d_rows = -1;
+
+    std::vector<Ra__Node*> stack = {root};
+    for(auto cte: ctes){
+        cost_ctes[static_cast<Ra__Node__Projection*>(cte)->subquery_alias.id] = cte;
+        stack.push_back(cte);
+    }
+    while(!stack.empty()){
+        Ra__Node* it = stack.back();
+        stack.pop_back();
+        if(it->node_case==RA__NODE__RELATION){
+            auto rel = static_cast<Ra__Node__Relation*>(it);
+            cost_relations[rel->name.id] = rel->name;
+            if(!rel->alias.empty()){
+                cost_relations[rel->alias.id] = rel->name;
+            }
+        }
+        for(auto child: it->childNodes){
+            stack.push_back(child);
+        }
+    }
+}
+
+const Ra__Catalog__Table* RaTree::get_attribute_table(Ra__Node__Attribute* attr){
+    Ra__Symbol relation;
+    // "d" attributes keep the names of the outer query attributes
+    if(attr->alias.empty() || attr->alias==symbol_d){
+        relation = lookup_catalog_relation(attr->name);
+    }
+    else{
+        auto found = cost_relations.find(attr->alias.id);
+        if(found==cost_relations.end()){
+            return nullptr;
+        }
+        relation = found->second;
+        // CTE columns keep the names of the catalog columns they select (cte_2.o_custkey)
+        if(cost_ctes.count(relation.id)!=0){
+            relation = lookup_catalog_relation(attr->name);
+        }
+    }
+    if(relation.empty()){
+        return nullptr;
+    }
+    return catalog->find_table(relation.str());
+}
+
+void RaTree::annotate_estimates(){
+    annotating_estimates = true;
+    estimate_cost();
+    annotating_estimates = false;
+}
+
+const Ra__Catalog__Column* RaTree::get_attribute_column(Ra__Node__Attribute* attr){
+    const Ra__Catalog__Table* table = get_attribute_table(attr);
+    int64_t index = table==nullptr ? -1 : table->column_index(attr->name.str());
+    return index<0 ? nullptr : &table->columns[index];
+}
+
+double RaTree::estimate_distinct_values(const std::vector<Ra__Node*>& attributes){
+    // columns grouped by table, keys of a table are not independent
+    std::vector<std::pair<const Ra__Catalog__Table*, std::vector<size_t>>> table_columns;
+    double distinct = 1;
+    bool only_d = !attributes.empty();
+    for(auto attribute: attributes){
+        auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+        only_d = only_d && attr->alias==symbol_d;
+        const Ra__Catalog__Table* table = get_attribute_table(attr);
+        int64_t index = table==nullptr ? -1 : table->column_index(attr->name.str());
+        if(index<0){
+            distinct *= default_num_distinct;
+            continue;
+        }
+        auto entry = std::find_if(table_columns.begin(), table_columns.end(), [&](const auto& t){ return t.first==table; });
+        if(entry==table_columns.end()){
+            table_columns.push_back({table, {}});
+            entry = table_columns.end()-1;
+        }
+        if(std::find(entry->second.begin(), entry->second.end(), index)==entry->second.end()){
+            entry->second.push_back(index);
+        }
+    }
+
+    for(auto& table_column: table_columns){
+        const Ra__Catalog__Table* table = table_column.first;
+        std::vector<size_t>& columns = table_column.second;
+        std::sort(columns.begin(), columns.end());
+        double rows = table->row_count>0 ? table->row_count : default_relation_rows;
+
+        // rows of the table referenced by a foreign key on exactly these columns
+        auto referenced_rows = [&](const std::vector<size_t>& fk_columns){
+            for(const auto& foreign_key: table->foreign_keys){
+                std::vector<size_t> key = foreign_key.columns;
+                std::sort(key.begin(), key.end());
+                const Ra__Catalog__Table* referenced = catalog->find_table(foreign_key.referenced_table);
+                if(key==fk_columns && referenced!=nullptr && referenced->row_count>0){
+                    return std::min(rows, static_cast<double>(referenced->row_count));
+                }
+            }
+            return 0.0;
+        };
+
+        // distinct values of a column, from its statistics or the table its foreign key references
+        auto column_distinct = [&](size_t column){
+            const Ra__Catalog__Column& catalog_column = table->columns[column];
+            double stats_distinct = catalog_column.has_stats ? get_stats_distinct(catalog_column.stats, rows) : 0;
+            if(stats_distinct>0){
+                return std::min(rows, stats_distinct);
+            }
+            double fk_rows = referenced_rows({column});
+            return fk_rows>0 ? fk_rows : std::min(rows, default_num_distinct);
+        };
+
+        double table_distinct;
+        bool covers_primary_key = !table->primary_key.empty() && std::all_of(table->primary_key.begin(), table->primary_key.end(), [&](size_t c){
+            return std::find(columns.begin(), columns.end(), c)!=columns.end();
+        });
+        if(covers_primary_key){
+            table_distinct = rows;
+        }
+        else if(double fk_rows = columns.size()>1 ? referenced_rows(columns) : 0; fk_rows>0){
+            table_distinct = fk_rows;
+        }
+        else{
+            table_distinct = 1;
+            for(auto column: columns){
+                table_distinct *= column_distinct(column);
+            }
+            table_distinct = std::min(rows, table_distinct);
+        }
+        distinct *= table_distinct;
+    }
+
+    // "d" attributes have at most as many values as D has rows
+    double d_rows = cost_d_cardinality>=0 ? cost_d_cardinality : cost_d_rows;
+    if(only_d && d_rows>0){
+        distinct = std::min(distinct, d_rows);
+    }
+    return distinct;
+}
+
+double RaTree::estimate_comparison_selectivity(Ra__Node__Predicate* p){
+    // right side of "in" subquery joins is the subquery
+    if(p->right==nullptr){
+        return default_semi_join_selectivity;
+    }
+
+    std::vector<Ra__Node*> left_attributes;
+    std::vector<Ra__Node*> right_attributes;
+    get_expression_attributes(p->left, left_attributes);
+    get_expression_attributes(p->right, right_attributes);
+
+    // predicates on "d" attributes are removed by decoupling
+    if(cost_d_cardinality==0){
+        for(const auto& attributes: {left_attributes, right_attributes}){
+            for(auto attribute: attributes){
+                if(static_cast<Ra__Node__Attribute*>(attribute)->alias==symbol_d){
+                    return 1;
+                }
+            }
+        }
+    }
+
+    const std::string& op = p->binaryOperator;
+
+    // attribute compared with constants: column statistics
+    Ra__Node__Attribute* attr;
+    std::string stats_op;
+    std::vector<std::string> values;
+    if(get_constant_comparison(p, attr, stats_op, values)){
+        double selectivity = estimate_stats_selectivity(attr, stats_op, values);
+        if(selectivity>=0){
+            return selectivity;
+        }
+    }
+
+    if(op==" like "){
+        return default_match_selectivity;
+    }
+    else if(op==" not like "){
+        return 1 - default_match_selectivity;
+    }
+    else if(op==" between "){
+        return default_ineq_selectivity * default_ineq_selectivity;
+    }
+    else if(op==" in " || op==" not in "){
+        double selectivity = default_semi_join_selectivity;
+        if(p->right->node_case==RA__NODE__IN_LIST){
+            double n_values = static_cast<Ra__Node__In_List*>(p->right)->args.size();
+            selectivity = std::min(1.0, n_values / estimate_distinct_values(left_attributes));
+        }
+        return op==" in " ? selectivity : 1 - selectivity;
+    }
+    else if(op=="=" || op=="<>"){
+        double selectivity = 1;
+        // attribute=attribute: join on the side with more distinct values
+        if(!left_attributes.empty() && !right_attributes.empty()){
+            selectivity = 1 / std::max(estimate_distinct_values(left_attributes), estimate_distinct_values(right_attributes));
+        }
+        else if(!left_attributes.empty()){
+            selectivity = 1 / estimate_distinct_values(left_attributes);
+        }
+        else if(!right_attributes.empty()){
+            selectivity = 1 / estimate_distinct_values(right_attributes);
+        }
+        return op=="=" ? selectivity : 1 - selectivity;
+    }
+    return default_ineq_selectivity;
+}
+
+bool RaTree::get_constant_comparison(Ra__Node__Predicate* p, Ra__Node__Attribute*& attr, std::string& op, std::vector<std::string>& values){
+    if(p->right==nullptr){
+        return false;
+    }
+    Ra__Node* constant_side;
+    op = p->binaryOperator;
+    if(p->left->node_case==RA__NODE__ATTRIBUTE){
+        attr = static_cast<Ra__Node__Attribute*>(p->left);
+        constant_side = p->right;
+    }
+    else if(p->right->node_case==RA__NODE__ATTRIBUTE){
+        attr = static_cast<Ra__Node__Attribute*>(p->right);
+        constant_side = p->left;
+        op = op=="<" ? ">" : op==">" ? "<" : op=="<=" ? ">=" : op==">=" ? "<=" : op;
+    }
+    else{
+        return false;
+    }
+
+    values.clear();
+    if(constant_side->node_case==RA__NODE__LIST || constant_side->node_case==RA__NODE__IN_LIST){
+        const auto& args = constant_side->node_case==RA__NODE__LIST ? static_cast<Ra__Node__List*>(constant_side)->args : static_cast<Ra__Node__In_List*>(constant_side)->args;
+        values.resize(args.size());
+        for(size_t i=0; i<args.size(); i++){
+            if(!get_constant_value(args[i], values[i])){
+                return false;
+            }
+        }
+        return true;
+    }
+    values.resize(1);
+    return get_constant_value(constant_side, values[0]);
+}
+
+double RaTree::estimate_stats_selectivity(Ra__Node__Attribute* attr, const std::string& op, const std::vector<std::string>& values){
+    const Ra__Catalog__Column* column = get_attribute_column(attr);
+    if(column==nullptr || !column->has_stats || values.empty()){
+        return -1;
+    }
+    const Ra__Catalog__Column_Stats& stats = column->stats;
+    const Ra__Catalog__Table* table = get_attribute_table(attr);
+    double rows = table->row_count>0 ? table->row_count : default_relation_rows;
+    double distinct = get_stats_distinct(stats, rows);
+    if(distinct<=0){
+        distinct = std::min(rows, default_num_distinct);
+    }
+    double not_null = 1 - stats.null_frac;
+
+    double selectivity = -1;
+    if(op=="=" || op=="<>" || op==" in " || op==" not in "){
+        double equal = 0;
+        for(const auto& value: values){
+            equal += get_stats_fraction_equal(stats, value, distinct);
+        }
+        equal = std::min(not_null, equal);
+        selectivity = op=="=" || op==" in " ? equal : not_null - equal;
+    }
+    else if(op=="<" || op=="<=" || op==">" || op==">="){
+        double less = get_stats_fraction_less(stats, values[0], op==">" || op=="<=");
+        if(less>=0){
+            selectivity = op=="<" || op=="<=" ? less : not_null - less;
+        }
+    }
+    else if(op==" between " && values.size()==2){
+        double less_high = get_stats_fraction_less(stats, values[1], true);
+        double less_low = get_stats_fraction_less(stats, values[0], false);
+        if(less_high>=0 && less_low>=0){
+            selectivity = less_high - less_low;
+        }
+    }
+    return selectivity<0 ? -1 : std::min(1.0, selectivity);
+}
+
+double RaTree::estimate_selectivity(Ra__Node* predicate){
+    switch(predicate->node_case){
+        case RA__NODE__BOOL_PREDICATE:{
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
+            switch(bool_p->bool_operator){
+                case RA__BOOL_OPERATOR__AND:{
+                    // equi join predicates between the same tables are estimated together,
+                    // since composite keys are not independent (l_partkey=ps_partkey and l_suppkey=ps_suppkey)
+                    std::map<std::pair<const Ra__Catalog__Table*,const Ra__Catalog__Table*>, std::pair<std::vector<Ra__Node*>,std::vector<Ra__Node*>>> equi_joins;
+                    // lower and upper bounds on the same column form a range, they are not independent (x>=a and x<b),
+                    // as in PostgreSQL (clauselist_selectivity): selectivity of both is lower + upper - not null
+                    std::map<const Ra__Catalog__Column*, std::pair<double,double>> ranges;
+                    double selectivity = 1;
+                    for(auto arg: bool_p->args){
+                        if(arg->node_case==RA__NODE__PREDICATE){
+                            auto p = static_cast<Ra__Node__Predicate*>(arg);
+                            Ra__Node__Attribute* attr;
+                            std::string op;
+                            std::vector<std::string> values;
+                            if(get_constant_comparison(p, attr, op, values) && (op=="<" || op=="<=" || op==">" || op==">=")
+                                && !(attr->alias==symbol_d && cost_d_cardinality==0)){
+                                double bound_selectivity = estimate_stats_selectivity(attr, op, values);
+                                if(bound_selectivity>=0){
+                                    auto& range = ranges.try_emplace(get_attribute_column(attr), -1, -1).first->second;
+                                    double& bound = op==">" || op==">=" ? range.first : range.second;
+                                    // of several bounds on the same side the tightest is kept
+                                    bound = bound<0 ? bound_selectivity : std::min(bound, bound_selectivity);
+                                    continue;
+                                }
+                            }
+                            if(p->binaryOperator=="=" && p->left->node_case==RA__NODE__ATTRIBUTE && p->right!=nullptr && p->right->node_case==RA__NODE__ATTRIBUTE){
+                                auto left_attr = static_cast<Ra__Node__Attribute*>(p->left);
+                                auto right_attr = static_cast<Ra__Node__Attribute*>(p->right);
+                                const Ra__Catalog__Table* left_table = get_attribute_table(left_attr);
+                                const Ra__Catalog__Table* right_table = get_attribute_table(right_attr);
+                                bool is_d = left_attr->alias==symbol_d || right_attr->alias==symbol_d;
+                                if(left_table!=nullptr && right_table!=nullptr && !(is_d && cost_d_cardinality==0)){
+                                    if(left_table>right_table){
+                                        std::swap(left_table, right_table);
+                                        std::swap(left_attr, right_attr);
+                                    }
+                                    auto& sides = equi_joins[{left_table,right_table}];
+                                    sides.first.push_back(left_attr);
+                                    sides.second.push_back(right_attr);
+                                    continue;
+                                }
+                            }
+                        }
+                        selectivity *= estimate_selectivity(arg);
+                    }
+                    for(const auto& equi_join: equi_joins){
+                        selectivity /= std::max(estimate_distinct_values(equi_join.second.first), estimate_distinct_values(equi_join.second.second));
+                    }
+                    for(const auto& range: ranges){
+                        double lower = range.second.first;
+                        double upper = range.second.second;
+                        if(lower>=0 && upper>=0){
+                            double not_null = 1 - range.first->stats.null_frac;
+                            // empty or inverted ranges are estimated as a single value
+                            selectivity *= std::max(lower + upper - not_null, not_null / std::max(1.0, range.first->stats.n_distinct>0 ? range.first->stats.n_distinct : default_num_distinct));
+                        }
+                        else{
+                            selectivity *= lower>=0 ? lower : upper;
+                        }
+                    }
+                    return selectivity;
+                }
+                case RA__BOOL_OPERATOR__OR:{
+                    double not_selected = 1;
+                    for(auto arg: bool_p->args){
+                        not_selected *= 1 - estimate_selectivity(arg);
+                    }
+                    return 1 - not_selected;
+                }
+                case RA__BOOL_OPERATOR__NOT:{
+                    return 1 - estimate_selectivity(bool_p->args[0]);
+                }
+            }
+            return default_ineq_selectivity;
+        }
+        case RA__NODE__PREDICATE:{
+            return estimate_comparison_selectivity(static_cast<Ra__Node__Predicate*>(predicate));
+        }
+        case RA__NODE__NULL_TEST:{
+            auto null_test = static_cast<Ra__Node__Null_Test*>(predicate);
+            double is_null = default_unknown_selectivity;
+            if(null_test->arg->node_case==RA__NODE__ATTRIBUTE){
+                const Ra__Catalog__Column* column = get_attribute_column(static_cast<Ra__Node__Attribute*>(null_test->arg));
+                if(column!=nullptr && !column->nullable){
+                    is_null = 0;
+                }
+                else if(column!=nullptr && column->has_stats){
+                    is_null = column->stats.null_frac;
+                }
+            }
+            return null_test->type==RA__NULL_TEST__IS_NULL ? is_null : 1 - is_null;
+        }
+        case RA__NODE__WHERE_SUBQUERY_MARKER:{
+            auto found = cost_marker_selectivities.find(static_cast<Ra__Node__Where_Subquery_Marker*>(predicate)->marker);
+            return found==cost_marker_selectivities.end() ? default_semi_join_selectivity : found->second;
+        }
+        default: return default_ineq_selectivity;
+    }
+}
+
+double RaTree::estimate_cardinality(Ra__Node* it, double& cost){
+    // subquery input of a magic set filter being costed, the filter selection is evaluated on all its rows
+    if(it==cost_magic_set_input){
+        cost_magic_set_input = nullptr;
+        double rows = std::max(1.0, estimate_cardinality(it, cost) * cost_magic_set_selectivity);
+        cost_magic_set_input = it;
+        cost += rows;
+        return rows;
+    }
+    double rows = 1;
+    switch(it->node_case){
+        case RA__NODE__RELATION:{
+            auto rel = static_cast<Ra__Node__Relation*>(it);
+            auto cte = cost_ctes.find(rel->name.id);
+            if(cte!=cost_ctes.end()){
+                // cost of CTE is counted once by estimate_cost
+                double cte_cost = 0;
+                rows = estimate_cardinality(cte->second, cte_cost);
+            }
+            else{
+                const Ra__Catalog__Table* table = catalog->find_table(rel->name.str());
+                rows = table!=nullptr && table->row_count>0 ? table->row_count : default_relation_rows;
+            }
+            break;
+        }
+        case RA__NODE__SELECTION:{
+            auto sel = static_cast<Ra__Node__Selection*>(it);
+            rows = estimate_cardinality(sel->childNodes[0], cost);
+            double selectivity = estimate_selectivity(sel->predicate);
+            rows = std::max(1.0, rows * selectivity);
+            // selection without remaining predicates is not evaluated
+            if(selectivity<1){
+                cost += rows;
+            }
+            break;
+        }
+        case RA__NODE__PROJECTION:{
+            auto pr = static_cast<Ra__Node__Projection*>(it);
+            // D is costed by is_decoupling_cheaper, without D the dependent join is just the right side
+            if(pr->subquery_alias==symbol_d && cost_d_cardinality>=0){
+                rows = cost_d_cardinality;
+                break;
+            }
+            rows = estimate_cardinality(pr->childNodes[0], cost);
+            if(pr->distinct){
+                std::vector<Ra__Node*> attributes;
+                for(auto arg: pr->args){
+                    get_expression_attributes(arg->node_case==RA__NODE__SELECT_EXPRESSION ? static_cast<Ra__Node__Select_Expression*>(arg)->expression : arg, attributes);
+                }
+                rows = std::min(rows, estimate_distinct_values(attributes));
+                cost += rows;
+            }
+            // D of a dependent join that is not decoupled, the subquery above it is estimated next
+            if(pr->subquery_alias==symbol_d){
+                cost_d_rows = rows;
+            }
+            break;
+        }
+        case RA__NODE__GROUP_BY:{
+            auto gb = static_cast<Ra__Node__Group_By*>(it);
+            rows = estimate_cardinality(gb->childNodes[0], cost);
+            if(gb->implicit){
+                rows = 1;
+            }
+            else{
+                std::vector<Ra__Node*> attributes;
+                for(auto arg: gb->args){
+                    get_expression_attributes(arg, attributes);
+                }
+                rows = std::min(rows, estimate_distinct_values(attributes));
+            }
+            cost += rows;
+            break;
+        }
+        case RA__NODE__HAVING:{
+            auto ha = static_cast<Ra__Node__Having*>(it);
+            rows = estimate_cardinality(ha->childNodes[0], cost) * estimate_selectivity(ha->predicate);
+            cost += rows;
+            break;
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(it);
+            double left_rows = estimate_cardinality(join->childNodes[0], cost);
+            // right side is a subquery used in a predicate above, it adds cost but no rows
+            if(join->right_where_subquery_marker->marker!=0){
+                double right_rows = estimate_cardinality(join->childNodes[1], cost);
+                rows = left_rows;
+                // "x in (select y ...)" keeps the fraction of x values the subquery produces, the selection above evaluates the marker
+                if(join->type==RA__JOIN__IN_LEFT && join->predicate!=nullptr && join->predicate->node_case==RA__NODE__PREDICATE
+                    && join->childNodes[1]->node_case==RA__NODE__PROJECTION){
+                    std::vector<Ra__Node*> left_attributes;
+                    std::vector<Ra__Node*> right_attributes;
+                    get_expression_attributes(static_cast<Ra__Node__Predicate*>(join->predicate)->left, left_attributes);
+                    for(auto arg: static_cast<Ra__Node__Projection*>(join->childNodes[1])->args){
+                        get_expression_attributes(arg->node_case==RA__NODE__SELECT_EXPRESSION ? static_cast<Ra__Node__Select_Expression*>(arg)->expression : arg, right_attributes);
+                    }
+                    if(!left_attributes.empty() && !right_attributes.empty()){
+                        double right_values = std::min(right_rows, estimate_distinct_values(right_attributes));
+                        cost_marker_selectivities[join->right_where_subquery_marker->marker] = std::min(1.0, right_values / estimate_distinct_values(left_attributes));
+                    }
+                }
+                break;
+            }
+            double right_rows = estimate_cardinality(join->childNodes[1], cost);
+            double selectivity = join->predicate==nullptr ? 1 : estimate_selectivity(join->predicate);
+            switch(join->type){
+                case RA__JOIN__SEMI_LEFT:
+                case RA__JOIN__SEMI_LEFT_DEPENDENT:
+                case RA__JOIN__IN_LEFT:
+                case RA__JOIN__IN_LEFT_DEPENDENT:
+                case RA__JOIN__ANTI_LEFT:
+                case RA__JOIN__ANTI_LEFT_DEPENDENT:
+                case RA__JOIN__ANTI_IN_LEFT:
+                case RA__JOIN__ANTI_IN_LEFT_DEPENDENT:{
+                    rows = left_rows * default_semi_join_selectivity;
+                    break;
+                }
+                case RA__JOIN__LEFT:{
+                    rows = std::max(left_rows, left_rows * right_rows * selectivity);
+                    break;
+                }
+                case RA__JOIN__FULL_OUTER:{
+                    rows = std::max(left_rows + right_rows, left_rows * right_rows * selectivity);
+                    break;
+                }
+                default:{
+                    rows = left_rows * right_rows * selectivity;
+                }
+            }
+            rows = std::max(1.0, rows);
+            // cross products are evaluated as joins with the predicates of the selections above
+            if(join->type!=RA__JOIN__CROSS_PRODUCT || join->predicate!=nullptr){
+                cost += rows;
+            }
+            break;
+        }
+        case RA__NODE__VALUES:{
+            rows = static_cast<Ra__Node__Values*>(it)->values.size();
+            break;
+        }
+        // the input is computed completely (sorted or aggregated before), a limit only reduces the rows above
+        case RA__NODE__LIMIT:{
+            auto limit = static_cast<Ra__Node__Limit*>(it);
+            rows = estimate_cardinality(limit->childNodes[0], cost);
+            if(limit->count!=nullptr && limit->count->node_case==RA__NODE__CONST && !limit->with_ties){
+                rows = std::min(rows, std::atof(static_cast<Ra__Node__Constant*>(limit->count)->data.c_str()));
+            }
+            break;
+        }
+        // union all concatenates its branches, it does not produce rows of its own
+        case RA__NODE__UNION:{
+            rows = 0;
+            for(auto branch: it->childNodes){
+                rows += estimate_cardinality(branch, cost);
+            }
+            break;
+        }
+        default:{
+            if(!it->childNodes.empty()){
+                rows = estimate_cardinality(it->childNodes[0], cost);
+            }
+        }
+    }
+    rows = std::max(1.0, rows);
+    if(annotating_estimates){
+        it->estimated_rows = rows;
+        it->estimated_width = estimate_width(it);
+    }
+    return rows;
+}
+
+double RaTree::estimate_width(Ra__Node* it){
+    switch(it->node_case){
+        case RA__NODE__RELATION:{
+            auto rel = static_cast<Ra__Node__Relation*>(it);
+            auto cte = cost_ctes.find(rel->name.id);
+            if(cte!=cost_ctes.end()){
+                return estimate_width(cte->second);
+            }
+            const Ra__Catalog__Table* table = catalog->find_table(rel->name.str());
+            if(table==nullptr){
+                return default_column_width;
+            }
+            double width = 0;
+            for(const auto& column: table->columns){
+                width += column.has_stats && column.stats.avg_width>0 ? column.stats.avg_width : get_type_width(column.type);
+            }
+            return width;
+        }
+        case RA__NODE__PROJECTION:{
+            double width = 0;
+            for(auto arg: static_cast<Ra__Node__Projection*>(it)->args){
+                width += estimate_expression_width(arg);
+            }
+            return width;
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(it);
+            double width = estimate_width(join->childNodes[0]);
+            switch(join->type){
+                case RA__JOIN__SEMI_LEFT:
+                case RA__JOIN__SEMI_LEFT_DEPENDENT:
+                case RA__JOIN__IN_LEFT:
+                case RA__JOIN__IN_LEFT_DEPENDENT:
+                case RA__JOIN__ANTI_LEFT:
+                case RA__JOIN__ANTI_LEFT_DEPENDENT:
+                case RA__JOIN__ANTI_IN_LEFT:
+                case RA__JOIN__ANTI_IN_LEFT_DEPENDENT: return width;
+                default: break;
+            }
+            // right side of a subquery marker join is only used in a predicate above
+            if(join->right_where_subquery_marker->marker!=0){
+                return width;
+            }
+            return width + estimate_width(join->childNodes[1]);
+        }
+        case RA__NODE__VALUES:{
+            auto values = static_cast<Ra__Node__Values*>(it);
+            double width = 0;
+            for(auto value: values->values){
+                width += estimate_expression_width(value);
+            }
+            return values->values.empty() ? default_column_width : width / values->values.size();
+        }
+        default:{
+            return it->childNodes.empty() ? 0 : estimate_width(it->childNodes[0]);
+        }
+    }
+}
+
+double RaTree::estimate_expression_width(Ra__Node* expression){
+    switch(expression->node_case){
+        case RA__NODE__SELECT_EXPRESSION:{
+            return estimate_expression_width(static_cast<Ra__Node__Select_Expression*>(expression)->expression);
+        }
+        case RA__NODE__ATTRIBUTE:{
+            const Ra__Catalog__Column* column = get_attribute_column(static_cast<Ra__Node__Attribute*>(expression));
+            if(column==nullptr){
+                return default_column_width;
+            }
+            return column->has_stats && column->stats.avg_width>0 ? column->stats.avg_width : get_type_width(column->type);
+        }
+        case RA__NODE__CONST:{
+            auto constant = static_cast<Ra__Node__Constant*>(expression);
+            return constant->dataType==RA__CONST_DATATYPE__STRING ? constant->data.size() : 8;
+        }
+        case RA__NODE__TYPE_CAST:{
+            return get_type_width(static_cast<Ra__Node__Type_Cast*>(expression)->type);
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            double width = 0;
+            for(auto arg: {expr->l_arg, expr->r_arg}){
+                if(arg!=nullptr){
+                    width = std::max(width, estimate_expression_width(arg));
+                }
+            }
+            return width;
+        }
+        case RA__NODE__FUNC_CALL:{
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
+            // min/max keep the width of their argument, other aggregates are numbers
+            if((func_call->func_name=="min" || func_call->func_name=="max") && !func_call->args.empty()){
+                return estimate_expression_width(func_call->args[0]);
+            }
+            return func_call->is_aggregating ? 8 : default_column_width;
+        }
+        default: return default_column_width;
+    }
+}
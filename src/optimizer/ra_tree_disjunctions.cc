@@ -0,0 +1,421 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <cstdlib>
+
+// numbers compared by value, a value which can not be parsed exactly is the same as any other (overlap is the safe answer)
+static bool is_same_constant_value(const std::string& a, const std::string& b){
+    char* end_a;
+    char* end_b;
+    double scalar_a = std::strtod(a.c_str(), &end_a);
+    double scalar_b = std::strtod(b.c_str(), &end_b);
+    if(a.empty() || b.empty() || *end_a!='\0' || *end_b!='\0'){
+        return true;
+    }
+    return scalar_a==scalar_b;
+}
+
+Ra__Node* RaTree::make_conjunction(const std::vector<Ra__Node*>& conjuncts){
+    if(conjuncts.size()==1){
+        return conjuncts[0];
+    }
+    auto conjunction = arena->make<Ra__Node__Bool_Predicate>();
+    conjunction->bool_operator = RA__BOOL_OPERATOR__AND;
+    conjunction->args = conjuncts;
+    return conjunction;
+}
+
+Ra__Node* RaTree::copy_expression(Ra__Node* expression){
+    if(expression==nullptr){
+        return nullptr;
+    }
+    switch(expression->node_case){
+        case RA__NODE__BOOL_PREDICATE:{
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(expression);
+            auto copy = arena->make<Ra__Node__Bool_Predicate>();
+            copy->bool_operator = bool_p->bool_operator;
+            for(auto arg: bool_p->args){
+                copy->args.push_back(copy_expression(arg));
+            }
+            return copy;
+        }
+        case RA__NODE__PREDICATE:{
+            auto p = static_cast<Ra__Node__Predicate*>(expression);
+            return arena->make<Ra__Node__Predicate>(copy_expression(p->left), copy_expression(p->right), p->binaryOperator);
+        }
+        case RA__NODE__NULL_TEST:{
+            auto null_test = static_cast<Ra__Node__Null_Test*>(expression);
+            auto copy = arena->make<Ra__Node__Null_Test>();
+            copy->arg = copy_expression(null_test->arg);
+            copy->type = null_test->type;
+            return copy;
+        }
+        case RA__NODE__SELECT_EXPRESSION:{
+            auto sel_expr = static_cast<Ra__Node__Select_Expression*>(expression);
+            auto copy = arena->make<Ra__Node__Select_Expression>(copy_expression(sel_expr->expression));
+            copy->rename = sel_expr->rename;
+            return copy;
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            auto copy = arena->make<Ra__Node__Expression>();
+            copy->l_arg = copy_expression(expr->l_arg);
+            copy->r_arg = copy_expression(expr->r_arg);
+            copy->operator_ = expr->operator_;
+            return copy;
+        }
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+            return arena->make<Ra__Node__Type_Cast>(type_cast->type, type_cast->typ_mod, copy_expression(type_cast->expression));
+        }
+        case RA__NODE__ATTRIBUTE:{
+            auto attr = static_cast<Ra__Node__Attribute*>(expression);
+            return arena->make<Ra__Node__Attribute>(attr->name, attr->alias);
+        }
+        case RA__NODE__FUNC_CALL:{
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
+            auto copy = arena->make<Ra__Node__Func_Call>(func_call->func_name);
+            for(auto arg: func_call->args){
+                copy->args.push_back(copy_expression(arg));
+            }
+            copy->is_aggregating = func_call->is_aggregating;
+            copy->agg_distinct = func_call->agg_distinct;
+            copy->is_window = func_call->is_window;
+            for(auto arg: func_call->window_partition){
+                copy->window_partition.push_back(copy_expression(arg));
+            }
+            return copy;
+        }
+        case RA__NODE__LIST:{
+            auto copy = arena->make<Ra__Node__List>();
+            for(auto arg: static_cast<Ra__Node__List*>(expression)->args){
+                copy->args.push_back(copy_expression(arg));
+            }
+            return copy;
+        }
+        case RA__NODE__IN_LIST:{
+            auto copy = arena->make<Ra__Node__In_List>();
+            for(auto arg: static_cast<Ra__Node__In_List*>(expression)->args){
+                copy->args.push_back(copy_expression(arg));
+            }
+            return copy;
+        }
+        case RA__NODE__CASE_EXPR:{
+            auto case_expr = static_cast<Ra__Node__Case_Expr*>(expression);
+            auto copy = arena->make<Ra__Node__Case_Expr>();
+            for(auto case_when: case_expr->args){
+                copy->args.push_back(arena->make<Ra__Node__Case_When>(copy_expression(case_when->when), copy_expression(case_when->then)));
+            }
+            copy->else_default = copy_expression(case_expr->else_default);
+            return copy;
+        }
+        // constants are never modified in place (hash consed), markers refer to their join
+        default: return expression;
+    }
+}
+
+Ra__Node* RaTree::copy_join_block(Ra__Node* node){
+    switch(node->node_case){
+        case RA__NODE__RELATION:{
+            auto rel = static_cast<Ra__Node__Relation*>(node);
+            return arena->make<Ra__Node__Relation>(rel->name, rel->alias);
+        }
+        case RA__NODE__SELECTION:{
+            auto copy = arena->make<Ra__Node__Selection>();
+            copy->predicate = copy_expression(static_cast<Ra__Node__Selection*>(node)->predicate);
+            copy->add_child(copy_join_block(node->childNodes[0]));
+            return copy;
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(node);
+            auto copy = arena->make<Ra__Node__Join>(join->type);
+            copy->predicate = copy_expression(join->predicate);
+            copy->add_child(copy_join_block(node->childNodes[0]));
+            copy->add_child(copy_join_block(node->childNodes[1]));
+            return copy;
+        }
+        default: assert(false); return nullptr;
+    }
+}
+
+bool RaTree::has_only_number_constants(Ra__Node__Predicate* p){
+    for(auto side: {p->left, p->right}){
+        if(side->node_case==RA__NODE__ATTRIBUTE){
+            continue;
+        }
+        std::vector<Ra__Node*> constants = {side};
+        if(side->node_case==RA__NODE__LIST || side->node_case==RA__NODE__IN_LIST){
+            constants = side->node_case==RA__NODE__LIST ? static_cast<Ra__Node__List*>(side)->args : static_cast<Ra__Node__In_List*>(side)->args;
+        }
+        for(auto constant: constants){
+            // strings compare by collation ('a' and 'A' may be equal), casts may map different numbers to the same value
+            if(constant->node_case!=RA__NODE__CONST || static_cast<Ra__Node__Constant*>(constant)->dataType==RA__CONST_DATATYPE__STRING){
+                return false;
+            }
+            // template placeholders stand for any literal, also for the same one twice
+            std::string value;
+            if(template_literal && template_literal(static_cast<Ra__Node__Constant*>(constant), value)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool RaTree::are_disjoint_conjunctions(const std::vector<Ra__Node*>& a, const std::vector<Ra__Node*>& b){
+    // values each attribute is restricted to by "=" or "in"
+    auto get_attribute_values = [&](const std::vector<Ra__Node*>& conjuncts){
+        std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::vector<std::string>> attribute_values;
+        for(auto conjunct: conjuncts){
+            Ra__Node__Attribute* attr;
+            std::string op;
+            std::vector<std::string> values;
+            if(conjunct->node_case==RA__NODE__PREDICATE && get_constant_comparison(static_cast<Ra__Node__Predicate*>(conjunct), attr, op, values)
+                && (op=="=" || op==" in ") && has_only_number_constants(static_cast<Ra__Node__Predicate*>(conjunct))){
+                auto key = get_attribute_key(attr);
+                if(!key.first.empty()){
+                    attribute_values[key] = values;
+                }
+            }
+        }
+        return attribute_values;
+    };
+    auto a_values = get_attribute_values(a);
+    auto b_values = get_attribute_values(b);
+    for(const auto& a_attribute: a_values){
+        auto b_attribute = b_values.find(a_attribute.first);
+        if(b_attribute==b_values.end()){
+            continue;
+        }
+        bool overlap = false;
+        for(const auto& a_value: a_attribute.second){
+            for(const auto& b_value: b_attribute->second){
+                overlap = overlap || is_same_constant_value(a_value, b_value);
+            }
+        }
+        if(!overlap){
+            return true;
+        }
+    }
+    return false;
+}
+
+void RaTree::split_disjunctions(){
+    invalidate_hashes();
+    std::vector<Ra__Node*> selections;
+    get_all_selections(root, selections);
+    for(auto cte: ctes){
+        get_all_selections(cte, selections);
+    }
+    // bottom up: a split selection's input is copied, selections below it are not visited afterwards
+    for(auto it=selections.rbegin(); it!=selections.rend(); it++){
+        split_disjunction(static_cast<Ra__Node__Selection*>(*it));
+    }
+}
+
+bool RaTree::split_disjunction(Ra__Node__Selection* selection){
+    int child_index = -1;
+    Ra__Node* parent = get_linked_parent(selection, child_index);
+    if(parent==nullptr || selection->predicate==nullptr || !is_join_block(selection)){
+        return false;
+    }
+
+    // 1. disjunction of pairwise disjoint branches, e.g. the branches restrict l_quantity to different numbers
+    std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+    split_selection_predicates(selection->predicate, predicates_relations);
+    std::vector<Ra__Node*> common;
+    std::vector<std::vector<Ra__Node*>> branches;
+    for(const auto& p_r: predicates_relations){
+        auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(p_r.first);
+        if(!branches.empty() || p_r.first->node_case!=RA__NODE__BOOL_PREDICATE || bool_p->bool_operator!=RA__BOOL_OPERATOR__OR){
+            common.push_back(p_r.first);
+            continue;
+        }
+        for(auto arg: bool_p->args){
+            std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> branch_predicates_relations;
+            split_selection_predicates(arg, branch_predicates_relations);
+            branches.push_back({});
+            for(const auto& branch_p_r: branch_predicates_relations){
+                branches.back().push_back(branch_p_r.first);
+            }
+        }
+        bool disjoint = true;
+        for(size_t i=0; i<branches.size() && disjoint; i++){
+            for(size_t j=i+1; j<branches.size() && disjoint; j++){
+                disjoint = are_disjoint_conjunctions(branches[i], branches[j]);
+            }
+        }
+        if(!disjoint){
+            branches.clear();
+            common.push_back(p_r.first);
+        }
+    }
+    if(branches.empty()){
+        return false;
+    }
+
+    // conjuncts of all branches are evaluated by every branch anyway
+    std::vector<Ra__Node*> factored;
+    for(auto conjunct: branches[0]){
+        bool in_all_branches = std::all_of(branches.begin()+1, branches.end(), [&](const auto& branch){
+            return std::any_of(branch.begin(), branch.end(), [&](Ra__Node* other){ return is_same_subtree(conjunct, other); });
+        });
+        if(in_all_branches){
+            factored.push_back(conjunct);
+        }
+    }
+    for(auto& branch: branches){
+        branch.erase(std::remove_if(branch.begin(), branch.end(), [&](Ra__Node* conjunct){
+            return std::any_of(factored.begin(), factored.end(), [&](Ra__Node* f){ return is_same_subtree(conjunct, f); });
+        }), branch.end());
+    }
+    common.insert(common.end(), factored.begin(), factored.end());
+
+    // 2. the union exports the attributes used above the selection, the relations must not be defined elsewhere
+    std::vector<Ra__Node*> input_nodes;
+    get_subtree_nodes(selection, input_nodes);
+    std::set<Ra__Node*> subtree_nodes(input_nodes.begin(), input_nodes.end());
+    std::vector<Ra__Symbol> qualifiers;
+    std::vector<Ra__Symbol> relation_names;
+    for(auto node: input_nodes){
+        if(node->node_case==RA__NODE__RELATION){
+            qualifiers.push_back(get_relation_qualifier(node));
+            relation_names.push_back(static_cast<Ra__Node__Relation*>(node)->name);
+        }
+    }
+    std::vector<Ra__Node*> tree_nodes;
+    get_subtree_nodes(root, tree_nodes);
+    for(auto cte: ctes){
+        get_subtree_nodes(cte, tree_nodes);
+    }
+    for(const auto& qualifier: qualifiers){
+        size_t n_defined = std::count_if(tree_nodes.begin(), tree_nodes.end(), [&](Ra__Node* node){
+            return get_relation_qualifier(node)==qualifier;
+        });
+        if(n_defined!=1){
+            return false;
+        }
+    }
+    std::vector<Ra__Node*> exported_args;
+    std::vector<Ra__Node__Attribute*> qualified_uses;
+    if(!get_exported_attributes(tree_nodes, subtree_nodes, qualifiers, relation_names, exported_args, qualified_uses) || exported_args.empty()){
+        return false;
+    }
+
+    // 3. union all of one projection per branch, over a copy of the input
+    auto union_node = arena->make<Ra__Node__Union>(branches.size());
+    for(auto arg: exported_args){
+        auto attr = static_cast<Ra__Node__Attribute*>(static_cast<Ra__Node__Select_Expression*>(arg)->expression);
+        union_node->columns.push_back(attr->name.str());
+    }
+    for(const auto& branch: branches){
+        std::vector<Ra__Node*> conjuncts;
+        for(auto conjunct: common){
+            conjuncts.push_back(copy_expression(conjunct));
+        }
+        for(auto conjunct: branch){
+            conjuncts.push_back(copy_expression(conjunct));
+        }
+        auto branch_selection = arena->make<Ra__Node__Selection>();
+        branch_selection->predicate = make_conjunction(conjuncts);
+        branch_selection->add_child(copy_join_block(selection->childNodes[0]));
+        auto branch_projection = arena->make<Ra__Node__Projection>();
+        for(auto arg: exported_args){
+            branch_projection->args.push_back(copy_expression(arg));
+        }
+        branch_projection->add_child(branch_selection);
+        union_node->add_child(branch_projection);
+    }
+
+    // 4. split only if the index lookups of the branches read less than the disjunction
+    if(!is_disjunction_split_cheaper(selection, union_node)){
+        return false;
+    }
+    union_node->alias = symbols->intern("union_" + std::to_string(counter++));
+    parent->set_child(child_index, union_node);
+    selection->clear_children();
+    for(auto attr: qualified_uses){
+        attr->alias = union_node->alias;
+    }
+    invalidate_hashes();
+    return true;
+}
+
+void RaTree::convert_in_lists_to_values(){
+    invalidate_hashes();
+    std::vector<Ra__Node*> selections;
+    get_all_selections(root, selections);
+    for(auto cte: ctes){
+        get_all_selections(cte, selections);
+    }
+    for(auto selection: selections){
+        auto sel = static_cast<Ra__Node__Selection*>(selection);
+        if(sel->predicate==nullptr || predicate_contains_subquery(sel->predicate)){
+            continue;
+        }
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+        split_selection_predicates(sel->predicate, predicates_relations);
+        std::vector<Ra__Node*> conjuncts;
+        std::vector<Ra__Node*> values_relations;
+        for(const auto& p_r: predicates_relations){
+            conjuncts.push_back(p_r.first);
+            Ra__Node* values = convert_in_list_to_values(conjuncts.back(), sel->childNodes[0]);
+            if(values!=nullptr){
+                values_relations.push_back(values);
+            }
+        }
+        if(values_relations.empty()){
+            continue;
+        }
+        sel->predicate = make_conjunction(conjuncts);
+        for(auto values: values_relations){
+            auto cross_product = arena->make<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT);
+            cross_product->add_child(sel->childNodes[0]);
+            cross_product->add_child(values);
+            sel->set_child(0, cross_product);
+        }
+    }
+    invalidate_hashes();
+}
+
+Ra__Node* RaTree::convert_in_list_to_values(Ra__Node*& conjunct, Ra__Node* input){
+    if(conjunct->node_case!=RA__NODE__PREDICATE){
+        return nullptr;
+    }
+    auto p = static_cast<Ra__Node__Predicate*>(conjunct);
+    if(p->binaryOperator!=" in " || p->left->node_case!=RA__NODE__ATTRIBUTE || p->right==nullptr || p->right->node_case!=RA__NODE__IN_LIST){
+        return nullptr;
+    }
+    Ra__Node__Attribute* attr;
+    std::string op;
+    std::vector<std::string> constants;
+    if(!get_constant_comparison(p, attr, op, constants)){
+        return nullptr;
+    }
+    // only columns of base relations of the input can be looked up by an index
+    index_cost_relations();
+    if(!has_relations_defined(input, {get_relation_from_attribute(attr)}) || get_attribute_column(attr)==nullptr){
+        return nullptr;
+    }
+
+    // a join would repeat the rows of duplicate values, equal values written differently are removed by the deparsed distinct
+    auto in_list = static_cast<Ra__Node__In_List*>(p->right);
+    std::unordered_map<size_t, std::vector<Ra__Node*>> buckets;
+    std::vector<Ra__Node*> distinct_values;
+    for(auto arg: in_list->args){
+        auto& bucket = buckets[hash_subtree(arg)];
+        if(std::none_of(bucket.begin(), bucket.end(), [&](Ra__Node* value){ return is_same_subtree(value, arg); })){
+            bucket.push_back(arg);
+            distinct_values.push_back(arg);
+        }
+    }
+    if(!is_values_join_cheaper(p, distinct_values.size())){
+        return nullptr;
+    }
+
+    auto values = arena->make<Ra__Node__Values>();
+    values->values = distinct_values;
+    values->alias = "values_" + std::to_string(counter++);
+    values->column = "value";
+    conjunct = arena->make<Ra__Node__Predicate>(attr, arena->make<Ra__Node__Attribute>(symbols->intern(values->column), symbols->intern(values->alias)), "=");
+    return values;
+}
@@ -0,0 +1,330 @@
+#include "ra_tree.h"
+#include <algorithm>
+
+// columns are (qualifier, name), an unqualified column matches the column of that name of any qualifier
+static bool is_same_column(const std::pair<Ra__Symbol,Ra__Symbol>& a, const std::pair<Ra__Symbol,Ra__Symbol>& b){
+    return a.second==b.second && (a.first==b.first || a.first.empty() || b.first.empty());
+}
+
+static bool contains_column(const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& columns, const std::pair<Ra__Symbol,Ra__Symbol>& column){
+    return std::any_of(columns.begin(), columns.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& c){return is_same_column(c, column);});
+}
+
+// the attribute of a projection argument or group by expression, nullptr for other expressions
+static Ra__Node__Attribute* get_attribute(Ra__Node* arg){
+    if(arg!=nullptr && arg->node_case==RA__NODE__SELECT_EXPRESSION){
+        arg = static_cast<Ra__Node__Select_Expression*>(arg)->expression;
+    }
+    return arg!=nullptr && arg->node_case==RA__NODE__ATTRIBUTE ? static_cast<Ra__Node__Attribute*>(arg) : nullptr;
+}
+
+// name of the i-th column of a projection, empty if the column is unnamed (expression without rename)
+static std::string get_output_column(Ra__Node__Projection* projection, size_t i){
+    if(!projection->subquery_columns.empty()){
+        return i<projection->subquery_columns.size() ? projection->subquery_columns[i] : "";
+    }
+    Ra__Node* arg = projection->args[i];
+    if(arg->node_case==RA__NODE__SELECT_EXPRESSION && !static_cast<Ra__Node__Select_Expression*>(arg)->rename.empty()){
+        return static_cast<Ra__Node__Select_Expression*>(arg)->rename;
+    }
+    Ra__Node__Attribute* attr = get_attribute(arg);
+    return attr!=nullptr ? attr->name.str() : "";
+}
+
+// the keys of both sides together identify the rows of a join
+static void combine_keys(const std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& left_keys, const std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& right_keys, std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& keys){
+    for(const auto& left_key: left_keys){
+        for(const auto& right_key: right_keys){
+            auto key = left_key;
+            key.insert(key.end(), right_key.begin(), right_key.end());
+            keys.push_back(key);
+        }
+    }
+}
+
+const Ra__Catalog__Table* RaTree::attach_catalog_table(Ra__Node__Relation* relation){
+    bool is_cte = std::any_of(ctes.begin(), ctes.end(), [&](Ra__Node* cte){
+        return static_cast<Ra__Node__Projection*>(cte)->subquery_alias==relation->name;
+    });
+    relation->table = is_cte ? nullptr : catalog->find_table(relation->name.str());
+    return relation->table;
+}
+
+void RaTree::remove_redundant_distincts(){
+    std::vector<Ra__Node*> nodes;
+    get_subtree_nodes(root, nodes);
+    for(auto cte: ctes){
+        get_subtree_nodes(cte, nodes);
+    }
+    bool changed = false;
+    for(auto node: nodes){
+        if(node->node_case!=RA__NODE__PROJECTION || !static_cast<Ra__Node__Projection*>(node)->distinct){
+            continue;
+        }
+        auto pr = static_cast<Ra__Node__Projection*>(node);
+
+        // 1. projected columns, "*" projects all columns (of a qualifier)
+        std::vector<std::pair<Ra__Symbol,Ra__Symbol>> columns;
+        std::vector<Ra__Symbol> star_qualifiers;
+        bool all_columns = false;
+        for(auto arg: pr->args){
+            Ra__Node__Attribute* attr = get_attribute(arg);
+            if(attr==nullptr){
+                continue;
+            }
+            if(attr->name.str()=="*"){
+                all_columns = all_columns || attr->alias.empty();
+                star_qualifiers.push_back(attr->alias);
+            }
+            else{
+                columns.push_back({attr->alias, attr->name});
+            }
+        }
+
+        // 2. distinct is redundant if a key of its input is projected
+        std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> keys;
+        get_unique_keys(pr->childNodes[0], keys);
+        bool is_unique = std::any_of(keys.begin(), keys.end(), [&](const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& key){
+            return all_columns || std::all_of(key.begin(), key.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& column){
+                return contains_column(columns, column) || std::find(star_qualifiers.begin(), star_qualifiers.end(), column.first)!=star_qualifiers.end();
+            });
+        });
+        if(is_unique){
+            pr->distinct = false;
+            changed = true;
+        }
+    }
+    if(changed){
+        invalidate_hashes();
+    }
+}
+
+void RaTree::get_unique_keys(Ra__Node* node, std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& keys){
+    switch(node->node_case){
+        case RA__NODE__RELATION:{
+            auto relation = static_cast<Ra__Node__Relation*>(node);
+            Ra__Symbol qualifier = get_relation_qualifier(relation);
+            const Ra__Catalog__Table* table = attach_catalog_table(relation);
+            if(table!=nullptr){
+                // unique constraints allow repeated nulls, distinct would remove them
+                std::vector<std::vector<size_t>> table_keys = table->unique_keys;
+                table_keys.push_back(table->primary_key);
+                for(const auto& table_key: table_keys){
+                    if(table_key.empty() || std::any_of(table_key.begin(), table_key.end(), [&](size_t column){
+                        return table->columns[column].nullable && table_key!=table->primary_key;
+                    })){
+                        continue;
+                    }
+                    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> key;
+                    for(size_t column: table_key){
+                        key.push_back({qualifier, symbols->intern(table->columns[column].name)});
+                    }
+                    keys.push_back(key);
+                }
+                return;
+            }
+            // reference of a CTE, its keys renamed to the qualifier
+            for(auto cte: ctes){
+                if(static_cast<Ra__Node__Projection*>(cte)->subquery_alias==relation->name){
+                    std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> cte_keys;
+                    get_unique_keys(cte, cte_keys);
+                    for(auto& key: cte_keys){
+                        for(auto& column: key){
+                            column.first = qualifier;
+                        }
+                        keys.push_back(key);
+                    }
+                }
+            }
+            return;
+        }
+        case RA__NODE__PROJECTION:{
+            // derived table or CTE: keys of its input which are projected, by the output columns
+            auto pr = static_cast<Ra__Node__Projection*>(node);
+            std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> input_keys;
+            get_unique_keys(pr->childNodes[0], input_keys);
+            std::vector<std::pair<Ra__Symbol,Ra__Symbol>> outputs;
+            bool all_named = true;
+            for(size_t i=0; i<pr->args.size(); i++){
+                std::string output = get_output_column(pr, i);
+                all_named = all_named && !output.empty();
+                outputs.push_back({pr->subquery_alias, symbols->intern(output)});
+            }
+            for(const auto& input_key: input_keys){
+                std::vector<std::pair<Ra__Symbol,Ra__Symbol>> key;
+                for(const auto& column: input_key){
+                    for(size_t i=0; i<pr->args.size(); i++){
+                        Ra__Node__Attribute* attr = get_attribute(pr->args[i]);
+                        if(attr!=nullptr && !outputs[i].second.empty() && is_same_column({attr->alias, attr->name}, column)){
+                            key.push_back(outputs[i]);
+                            break;
+                        }
+                    }
+                }
+                if(key.size()==input_key.size()){
+                    keys.push_back(key);
+                }
+            }
+            if(pr->distinct && all_named){
+                keys.push_back(outputs);
+            }
+            return;
+        }
+        case RA__NODE__SELECTION:{
+            auto sel = static_cast<Ra__Node__Selection*>(node);
+            std::vector<Ra__Node*> conjuncts;
+            if(sel->predicate!=nullptr){
+                std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+                split_selection_predicates(sel->predicate, predicates_relations);
+                for(const auto& p_r: predicates_relations){
+                    conjuncts.push_back(p_r.first);
+                }
+            }
+            // join predicates of a cross product are in the selection above it
+            if(node->childNodes[0]->node_case==RA__NODE__JOIN){
+                get_join_unique_keys(static_cast<Ra__Node__Join*>(node->childNodes[0]), conjuncts, keys);
+            }
+            else{
+                get_unique_keys(node->childNodes[0], keys);
+            }
+            // columns equal to a constant are the same in all rows
+            for(auto conjunct: conjuncts){
+                if(conjunct->node_case!=RA__NODE__PREDICATE || static_cast<Ra__Node__Predicate*>(conjunct)->binaryOperator!="="){
+                    continue;
+                }
+                auto p = static_cast<Ra__Node__Predicate*>(conjunct);
+                for(auto sides: {std::make_pair(p->left, p->right), std::make_pair(p->right, p->left)}){
+                    if(sides.first->node_case==RA__NODE__ATTRIBUTE && sides.second->node_case==RA__NODE__CONST){
+                        auto attr = static_cast<Ra__Node__Attribute*>(sides.first);
+                        for(auto& key: keys){
+                            key.erase(std::remove_if(key.begin(), key.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& column){
+                                return is_same_column({attr->alias, attr->name}, column);
+                            }), key.end());
+                        }
+                    }
+                }
+            }
+            return;
+        }
+        case RA__NODE__JOIN:{
+            get_join_unique_keys(static_cast<Ra__Node__Join*>(node), {}, keys);
+            return;
+        }
+        case RA__NODE__GROUP_BY:{
+            auto group_by = static_cast<Ra__Node__Group_By*>(node);
+            // aggregation without group by: a single row
+            if(group_by->implicit || group_by->args.empty()){
+                keys.push_back({});
+                return;
+            }
+            std::vector<std::pair<Ra__Symbol,Ra__Symbol>> group_columns;
+            for(auto arg: group_by->args){
+                Ra__Node__Attribute* attr = get_attribute(arg);
+                if(attr!=nullptr){
+                    group_columns.push_back({attr->alias, attr->name});
+                }
+            }
+            if(group_columns.size()==group_by->args.size()){
+                keys.push_back(group_columns);
+            }
+            // keys of the input within the group columns are keys of the groups
+            std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> input_keys;
+            get_unique_keys(node->childNodes[0], input_keys);
+            for(const auto& input_key: input_keys){
+                if(std::all_of(input_key.begin(), input_key.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& column){return contains_column(group_columns, column);})){
+                    keys.push_back(input_key);
+                }
+            }
+            return;
+        }
+        case RA__NODE__HAVING:
+        case RA__NODE__ORDER_BY:
+        case RA__NODE__LIMIT:{
+            get_unique_keys(node->childNodes[0], keys);
+            return;
+        }
+        default: return; // unions, values
+    }
+}
+
+void RaTree::get_join_unique_keys(Ra__Node__Join* join, const std::vector<Ra__Node*>& conjuncts, std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>>& keys){
+    std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> left_keys;
+    get_unique_keys(join->childNodes[0], left_keys);
+    switch(join->type){
+        case RA__JOIN__SEMI_LEFT:
+        case RA__JOIN__SEMI_LEFT_DEPENDENT:
+        case RA__JOIN__ANTI_LEFT:
+        case RA__JOIN__ANTI_LEFT_DEPENDENT:
+        case RA__JOIN__IN_LEFT:
+        case RA__JOIN__IN_LEFT_DEPENDENT:
+        case RA__JOIN__ANTI_IN_LEFT:
+        case RA__JOIN__ANTI_IN_LEFT_DEPENDENT:{
+            // filters the rows of the left side
+            keys.insert(keys.end(), left_keys.begin(), left_keys.end());
+            return;
+        }
+        case RA__JOIN__CROSS_PRODUCT:
+        case RA__JOIN__INNER:
+        case RA__JOIN__LEFT: break;
+        default: return; // dependent and full outer joins
+    }
+    if(!join->alias.empty() || join->right_where_subquery_marker->marker!=0){
+        return;
+    }
+    std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> right_keys;
+    get_unique_keys(join->childNodes[1], right_keys);
+    combine_keys(left_keys, right_keys, keys);
+
+    // 1. equi join predicates, of the join and for inner joins of the selection above
+    std::vector<Ra__Node*> join_conjuncts;
+    if(join->type!=RA__JOIN__LEFT){
+        join_conjuncts = conjuncts;
+    }
+    if(join->predicate!=nullptr){
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+        split_selection_predicates(join->predicate, predicates_relations);
+        for(const auto& p_r: predicates_relations){
+            join_conjuncts.push_back(p_r.first);
+        }
+    }
+
+    // 2. a side whose key is equated to columns of the other side matches at most one row per row of the other side
+    if(std::any_of(right_keys.begin(), right_keys.end(), [&](const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& key){return is_equated_key(join_conjuncts, key, join->childNodes[1]);})){
+        keys.insert(keys.end(), left_keys.begin(), left_keys.end());
+    }
+    if(join->type!=RA__JOIN__LEFT && std::any_of(left_keys.begin(), left_keys.end(), [&](const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& key){return is_equated_key(join_conjuncts, key, join->childNodes[0]);})){
+        keys.insert(keys.end(), right_keys.begin(), right_keys.end());
+    }
+}
+
+bool RaTree::is_equated_key(const std::vector<Ra__Node*>& conjuncts, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& key, Ra__Node* side){
+    std::vector<std::pair<Ra__Node__Attribute*,Ra__Node__Attribute*>> equalities;
+    for(auto conjunct: conjuncts){
+        if(conjunct->node_case!=RA__NODE__PREDICATE || static_cast<Ra__Node__Predicate*>(conjunct)->binaryOperator!="="){
+            continue;
+        }
+        auto p = static_cast<Ra__Node__Predicate*>(conjunct);
+        if(p->left->node_case==RA__NODE__ATTRIBUTE && p->right->node_case==RA__NODE__ATTRIBUTE){
+            equalities.push_back({static_cast<Ra__Node__Attribute*>(p->left), static_cast<Ra__Node__Attribute*>(p->right)});
+            equalities.push_back({static_cast<Ra__Node__Attribute*>(p->right), static_cast<Ra__Node__Attribute*>(p->left)});
+        }
+    }
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> relations_aliases;
+    get_relations_aliases(side, relations_aliases);
+    auto is_side_attribute = [&](Ra__Node__Attribute* attr){
+        Ra__Symbol relation = attr->alias.empty() ? lookup_catalog_relation(attr->name) : Ra__Symbol();
+        if(attr->alias.empty() && relation.empty()){
+            return true; // unknown
+        }
+        return std::any_of(relations_aliases.begin(), relations_aliases.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& relation_alias){
+            return attr->alias.empty() ? relation_alias.first==relation
+                : relation_alias.second==attr->alias || (relation_alias.second.empty() && relation_alias.first==attr->alias);
+        });
+    };
+    return std::all_of(key.begin(), key.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& column){
+        return std::any_of(equalities.begin(), equalities.end(), [&](const std::pair<Ra__Node__Attribute*,Ra__Node__Attribute*>& equality){
+            return is_same_column({equality.first->alias, equality.first->name}, column) && is_side_attribute(equality.first)
+                && !is_side_attribute(equality.second);
+        });
+    });
+}
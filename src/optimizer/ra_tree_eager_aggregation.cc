@@ -0,0 +1,443 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <functional>
+
+/**
+ * Attributes and aggregates used by the expressions of a query block above a pushed down aggregation
+ */
+struct Eager_Aggregation__Uses {
+    /// attributes outside of aggregates
+    std::vector<Ra__Node__Attribute*> attributes;
+    /// addresses of the expression slots holding aggregates, so they can be replaced
+    std::vector<Ra__Node**> aggregates;
+    /// subquery markers of predicates, their joins are not moved into the partial aggregation
+    std::vector<uint64_t> markers;
+};
+
+// collects the attributes, aggregates and subquery markers of an expression or predicate, false if an expression is not supported
+static bool collect_aggregation_uses(Ra__Node** slot, Eager_Aggregation__Uses& uses){
+    Ra__Node* it = *slot;
+    if(it==nullptr){
+        return true;
+    }
+    switch(it->node_case){
+        case RA__NODE__ATTRIBUTE:{
+            uses.attributes.push_back(static_cast<Ra__Node__Attribute*>(it));
+            return true;
+        }
+        case RA__NODE__CONST:
+        case RA__NODE__DUMMY: return true;
+        case RA__NODE__WHERE_SUBQUERY_MARKER:{
+            uses.markers.push_back(static_cast<Ra__Node__Where_Subquery_Marker*>(it)->marker);
+            return true;
+        }
+        case RA__NODE__SELECT_EXPRESSION:{
+            return collect_aggregation_uses(&static_cast<Ra__Node__Select_Expression*>(it)->expression, uses);
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(it);
+            return collect_aggregation_uses(&expr->l_arg, uses) && collect_aggregation_uses(&expr->r_arg, uses);
+        }
+        case RA__NODE__TYPE_CAST:{
+            return collect_aggregation_uses(&static_cast<Ra__Node__Type_Cast*>(it)->expression, uses);
+        }
+        case RA__NODE__FUNC_CALL:{
+            auto func_call = static_cast<Ra__Node__Func_Call*>(it);
+            // window functions are computed after the aggregation of the query block
+            if(func_call->is_window){
+                return false;
+            }
+            if(func_call->is_aggregating){
+                uses.aggregates.push_back(slot);
+                return true;
+            }
+            for(auto& arg: func_call->args){
+                if(!collect_aggregation_uses(&arg, uses)){
+                    return false;
+                }
+            }
+            return true;
+        }
+        case RA__NODE__CASE_EXPR:{
+            auto case_expr = static_cast<Ra__Node__Case_Expr*>(it);
+            for(auto case_when: case_expr->args){
+                if(!collect_aggregation_uses(&case_when->when, uses) || !collect_aggregation_uses(&case_when->then, uses)){
+                    return false;
+                }
+            }
+            return collect_aggregation_uses(&case_expr->else_default, uses);
+        }
+        case RA__NODE__PREDICATE:{
+            auto p = static_cast<Ra__Node__Predicate*>(it);
+            return collect_aggregation_uses(&p->left, uses) && collect_aggregation_uses(&p->right, uses);
+        }
+        case RA__NODE__BOOL_PREDICATE:{
+            for(auto& arg: static_cast<Ra__Node__Bool_Predicate*>(it)->args){
+                if(!collect_aggregation_uses(&arg, uses)){
+                    return false;
+                }
+            }
+            return true;
+        }
+        case RA__NODE__NULL_TEST:{
+            return collect_aggregation_uses(&static_cast<Ra__Node__Null_Test*>(it)->arg, uses);
+        }
+        case RA__NODE__LIST:{
+            for(auto& arg: static_cast<Ra__Node__List*>(it)->args){
+                if(!collect_aggregation_uses(&arg, uses)){
+                    return false;
+                }
+            }
+            return true;
+        }
+        case RA__NODE__IN_LIST:{
+            for(auto& arg: static_cast<Ra__Node__In_List*>(it)->args){
+                if(!collect_aggregation_uses(&arg, uses)){
+                    return false;
+                }
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+
+void RaTree::push_down_aggregations(){
+    std::vector<Ra__Node__Group_By*> group_bys;
+    std::vector<Ra__Node*> stack = {root};
+    stack.insert(stack.end(), ctes.begin(), ctes.end());
+    while(!stack.empty()){
+        Ra__Node* it = stack.back();
+        stack.pop_back();
+        if(it->node_case==RA__NODE__GROUP_BY){
+            group_bys.push_back(static_cast<Ra__Node__Group_By*>(it));
+        }
+        for(auto child: it->childNodes){
+            stack.push_back(child);
+        }
+    }
+
+    for(auto group_by: group_bys){
+        index_cost_relations();
+        push_down_aggregation(group_by);
+    }
+}
+
+bool RaTree::push_down_aggregation(Ra__Node__Group_By* group_by){
+    // without group by, an empty input has one result row, which the partial aggregation would not produce
+    if(group_by->implicit || group_by->args.empty() || group_by->n_parents!=1){
+        return false;
+    }
+
+    // aggregates are computed by the projection of the query block, used by having and order by
+    Ra__Node* it = group_by->parent;
+    Ra__Node__Having* having = nullptr;
+    Ra__Node__Order_By* order_by = nullptr;
+    while(it!=nullptr && it->n_parents<=1 && (it->node_case==RA__NODE__HAVING || it->node_case==RA__NODE__ORDER_BY || it->node_case==RA__NODE__LIMIT)){
+        if(it->node_case==RA__NODE__HAVING){
+            having = static_cast<Ra__Node__Having*>(it);
+        }
+        else if(it->node_case==RA__NODE__ORDER_BY){
+            order_by = static_cast<Ra__Node__Order_By*>(it);
+        }
+        it = it->parent;
+    }
+    if(it==nullptr || it->node_case!=RA__NODE__PROJECTION){
+        return false;
+    }
+    auto projection = static_cast<Ra__Node__Projection*>(it);
+
+    Eager_Aggregation__Uses block_uses;
+    bool supported = true;
+    for(auto& arg: projection->args){
+        supported = supported && collect_aggregation_uses(&arg, block_uses);
+    }
+    if(having!=nullptr){
+        supported = supported && collect_aggregation_uses(&having->predicate, block_uses);
+    }
+    // order by and group by may refer to renamed select expressions
+    Eager_Aggregation__Uses keys_uses;
+    if(order_by!=nullptr){
+        for(auto& arg: order_by->args){
+            supported = supported && collect_aggregation_uses(&arg, keys_uses);
+        }
+    }
+    for(auto& arg: group_by->args){
+        supported = supported && collect_aggregation_uses(&arg, keys_uses);
+    }
+    if(!supported || block_uses.aggregates.empty()){
+        return false;
+    }
+    for(auto attr: keys_uses.attributes){
+        bool renamed = attr->alias.empty() && std::any_of(projection->args.begin(), projection->args.end(), [&](Ra__Node* arg){
+            return arg->node_case==RA__NODE__SELECT_EXPRESSION && static_cast<Ra__Node__Select_Expression*>(arg)->rename==attr->name.str();
+        });
+        if(!renamed){
+            block_uses.attributes.push_back(attr);
+        }
+    }
+    block_uses.aggregates.insert(block_uses.aggregates.end(), keys_uses.aggregates.begin(), keys_uses.aggregates.end());
+
+    // attributes of the aggregate arguments, only decomposable aggregates can be computed in two steps
+    std::vector<Ra__Node__Attribute*> aggregate_attributes;
+    for(auto slot: block_uses.aggregates){
+        auto func_call = static_cast<Ra__Node__Func_Call*>(*slot);
+        bool duplicate_insensitive = func_call->func_name=="min" || func_call->func_name=="max";
+        if(func_call->agg_distinct && !duplicate_insensitive){
+            return false;
+        }
+        Eager_Aggregation__Uses arg_uses;
+        for(auto& arg: func_call->args){
+            if(!collect_aggregation_uses(&arg, arg_uses) || !arg_uses.aggregates.empty()){
+                return false;
+            }
+        }
+        for(auto attr: arg_uses.attributes){
+            // count(*)
+            if(attr->name.str()!="*"){
+                aggregate_attributes.push_back(attr);
+            }
+        }
+    }
+
+    // input of the partial aggregation with the least estimated cost
+    struct Candidate {
+        Ra__Node* parent = nullptr;
+        size_t index = 0;
+        std::vector<Ra__Node__Attribute*> keys;
+        Ra__Symbol alias;
+        double saving = 0;
+    };
+    Candidate best;
+
+    // 0: attribute of input, 1: of another relation, -1: unknown relation
+    auto attribute_of = [&](Ra__Node__Attribute* attr, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations_aliases){
+        Ra__Symbol relation = attr->alias.empty() ? lookup_catalog_relation(attr->name) : attr->alias;
+        if(relation.empty()){
+            return -1;
+        }
+        for(const auto& relation_alias: relations_aliases){
+            if(relation==relation_alias.first || relation==relation_alias.second){
+                return 0;
+            }
+        }
+        return 1;
+    };
+
+    // operators between the group by and the input, their predicates refer to the input by the partial aggregation keys
+    std::vector<Ra__Node*> path;
+    std::function<void(Ra__Node*, size_t)> evaluate_input = [&](Ra__Node* parent, size_t index){
+        Ra__Node* input = parent->childNodes[index];
+        if(input->n_parents>1){
+            return;
+        }
+        // below selections and semi joins only, the partial aggregation would compute the final groups
+        bool below_join = std::any_of(path.begin(), path.end(), [](Ra__Node* op){
+            if(op->node_case!=RA__NODE__JOIN){
+                return false;
+            }
+            auto join = static_cast<Ra__Node__Join*>(op);
+            return join->right_where_subquery_marker->marker==0
+                && (join->type==RA__JOIN__CROSS_PRODUCT || join->type==RA__JOIN__INNER || join->type==RA__JOIN__LEFT);
+        });
+        if(!below_join){
+            return;
+        }
+        std::vector<std::pair<Ra__Symbol,Ra__Symbol>> relations_aliases;
+        get_relations_aliases(input, relations_aliases);
+        for(auto attr: aggregate_attributes){
+            if(attribute_of(attr, relations_aliases)!=0){
+                return;
+            }
+        }
+
+        Eager_Aggregation__Uses path_uses;
+        for(auto op: path){
+            Ra__Node** predicate = op->node_case==RA__NODE__SELECTION ? &static_cast<Ra__Node__Selection*>(op)->predicate : &static_cast<Ra__Node__Join*>(op)->predicate;
+            if(!collect_aggregation_uses(predicate, path_uses)){
+                return;
+            }
+        }
+        path_uses.attributes.insert(path_uses.attributes.end(), block_uses.attributes.begin(), block_uses.attributes.end());
+        path_uses.markers.insert(path_uses.markers.end(), block_uses.markers.begin(), block_uses.markers.end());
+        for(auto marker: path_uses.markers){
+            bool on_path = std::any_of(path.begin(), path.end(), [&](Ra__Node* op){
+                return op->node_case==RA__NODE__JOIN && static_cast<Ra__Node__Join*>(op)->right_where_subquery_marker->marker==marker;
+            });
+            if(!on_path){
+                return;
+            }
+        }
+
+        // attributes of the input used above are the keys, they are output by the partial aggregation
+        Candidate candidate;
+        candidate.parent = parent;
+        candidate.index = index;
+        for(auto attr: path_uses.attributes){
+            int of = attribute_of(attr, relations_aliases);
+            if(of<0){
+                return;
+            }
+            if(of>0){
+                continue;
+            }
+            auto same_name = std::find_if(candidate.keys.begin(), candidate.keys.end(), [&](Ra__Node__Attribute* key){ return key->name==attr->name; });
+            if(same_name!=candidate.keys.end()){
+                // the partial aggregation has one column per name
+                if((*same_name)->alias!=attr->alias){
+                    return;
+                }
+                continue;
+            }
+            // attributes qualified by the alias of the input keep their alias as alias of the partial aggregation
+            if(!attr->alias.empty()){
+                if(!candidate.alias.empty() && candidate.alias!=attr->alias){
+                    return;
+                }
+                candidate.alias = attr->alias;
+            }
+            candidate.keys.push_back(attr);
+        }
+        if(candidate.keys.empty()){
+            return;
+        }
+
+        // the operators above the input process fewer rows, the partial aggregation costs its result rows
+        double cost = 0;
+        double input_rows = estimate_cardinality(input, cost);
+        std::vector<Ra__Node*> keys(candidate.keys.begin(), candidate.keys.end());
+        double groups = std::min(input_rows, estimate_distinct_values(keys));
+        double path_rows = 0;
+        for(auto op: path){
+            bool evaluated = op->node_case==RA__NODE__SELECTION ? estimate_selectivity(static_cast<Ra__Node__Selection*>(op)->predicate)<1
+                : static_cast<Ra__Node__Join*>(op)->type!=RA__JOIN__CROSS_PRODUCT || static_cast<Ra__Node__Join*>(op)->predicate!=nullptr;
+            if(evaluated){
+                path_rows += estimate_cardinality(op, cost);
+            }
+        }
+        candidate.saving = path_rows * (1 - groups/input_rows) - groups;
+        if(candidate.saving>best.saving){
+            best = std::move(candidate);
+        }
+    };
+
+    // aggregation is pushed below selections, inner joins and the preserved side of left, semi and anti joins
+    std::function<void(Ra__Node*)> find_inputs = [&](Ra__Node* op){
+        if(op->n_parents>1){
+            return;
+        }
+        std::vector<size_t> inputs;
+        if(op->node_case==RA__NODE__SELECTION){
+            if(static_cast<Ra__Node__Selection*>(op)->predicate!=nullptr){
+                inputs = {0};
+            }
+        }
+        else if(op->node_case==RA__NODE__JOIN){
+            auto join = static_cast<Ra__Node__Join*>(op);
+            // the right side of subquery joins is an uncorrelated subquery, used by a predicate above
+            bool subquery = join->right_where_subquery_marker->marker!=0;
+            if(join->alias.empty()){
+                switch(join->type){
+                    case RA__JOIN__CROSS_PRODUCT:
+                    case RA__JOIN__INNER: inputs = subquery ? std::vector<size_t>{0} : std::vector<size_t>{0, 1}; break;
+                    case RA__JOIN__LEFT:
+                    case RA__JOIN__SEMI_LEFT:
+                    case RA__JOIN__ANTI_LEFT:
+                    case RA__JOIN__IN_LEFT:
+                    case RA__JOIN__ANTI_IN_LEFT: inputs = {0}; break;
+                    default: break;
+                }
+            }
+        }
+        path.push_back(op);
+        for(auto index: inputs){
+            evaluate_input(op, index);
+            find_inputs(op->childNodes[index]);
+        }
+        path.pop_back();
+    };
+    find_inputs(group_by->childNodes[0]);
+    if(best.parent==nullptr){
+        return false;
+    }
+
+    // partial aggregation: Π_alias(Γ_keys(input)), the aggregation of the query block combines the partial aggregates
+    Ra__Node* input = best.parent->childNodes[best.index];
+    Ra__Symbol alias = best.alias.empty() ? symbols->intern("t" + std::to_string(counter++)) : best.alias;
+    auto partial_projection = arena->make<Ra__Node__Projection>();
+    partial_projection->subquery_alias = alias;
+    auto partial_group_by = arena->make<Ra__Node__Group_By>(false);
+    for(auto key: best.keys){
+        partial_projection->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(key->name, key->alias)));
+        partial_group_by->args.push_back(arena->make<Ra__Node__Attribute>(key->name, key->alias));
+    }
+    best.parent->set_child(best.index, partial_projection);
+    partial_projection->add_child(partial_group_by);
+    partial_group_by->add_child(input);
+
+    // adds a partial aggregate, returns the aggregate over the partial results
+    auto add_partial = [&](const std::string& partial_name, const std::vector<Ra__Node*>& args, const std::string& combine_name){
+        auto partial = arena->make<Ra__Node__Func_Call>(partial_name);
+        partial->is_aggregating = true;
+        partial->args = args;
+        auto sel_expr = arena->make<Ra__Node__Select_Expression>(partial);
+        sel_expr->rename = "eager_" + std::to_string(counter++);
+        partial_projection->args.push_back(sel_expr);
+        auto combine = arena->make<Ra__Node__Func_Call>(combine_name);
+        combine->is_aggregating = true;
+        combine->args.push_back(arena->make<Ra__Node__Attribute>(symbols->intern(sel_expr->rename), alias));
+        return combine;
+    };
+
+    // equal aggregates of several expressions (e.g. select and having) share their partial aggregates
+    invalidate_hashes();
+    std::vector<std::pair<Ra__Node__Func_Call*, Ra__Node*>> combined;
+    for(auto slot: block_uses.aggregates){
+        auto func_call = static_cast<Ra__Node__Func_Call*>(*slot);
+        auto found = std::find_if(combined.begin(), combined.end(), [&](const auto& func_combine){
+            return is_same_subtree(func_combine.first, func_call);
+        });
+        if(found!=combined.end()){
+            *slot = found->second;
+            continue;
+        }
+        Ra__Node* combine;
+        // distinct is dropped, min and max are the only aggregates pushed down with distinct
+        if(func_call->func_name=="avg"){
+            // avg(x) = sum(x)/count(x), multiplied by 1.0 to not divide integers
+            auto sum = add_partial("sum", func_call->args, "sum");
+            auto count = add_partial("count", func_call->args, "sum");
+            auto numeric_sum = arena->make<Ra__Node__Expression>();
+            numeric_sum->l_arg = sum;
+            numeric_sum->operator_ = "*";
+            numeric_sum->r_arg = arena->make<Ra__Node__Constant>("1.0", RA__CONST_DATATYPE__FLOAT);
+            auto division = arena->make<Ra__Node__Expression>();
+            division->l_arg = numeric_sum;
+            division->operator_ = "/";
+            division->r_arg = count;
+            combine = division;
+        }
+        else{
+            // count is the sum of the partial counts, sum, min and max combine with themselves
+            combine = add_partial(func_call->func_name, func_call->args, func_call->func_name=="count" ? "sum" : func_call->func_name);
+        }
+        combined.push_back({func_call, combine});
+        *slot = combine;
+    }
+
+    // select expressions named after the aggregate keep their name (count, avg)
+    for(auto arg: projection->args){
+        if(arg->node_case!=RA__NODE__SELECT_EXPRESSION){
+            continue;
+        }
+        auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+        for(const auto& func_combine: combined){
+            bool same_name = func_combine.second->node_case==RA__NODE__FUNC_CALL
+                && static_cast<Ra__Node__Func_Call*>(func_combine.second)->func_name==func_combine.first->func_name;
+            if(sel_expr->rename.empty() && sel_expr->expression==func_combine.second && !same_name){
+                sel_expr->rename = func_combine.first->func_name;
+            }
+        }
+    }
+    return true;
+}
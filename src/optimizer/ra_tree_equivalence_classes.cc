@@ -0,0 +1,138 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <map>
+#include <set>
+
+// constants, casts and arithmetic of constants, lists of constants (between, in)
+static bool is_constant_expression(Ra__Node* expression){
+    if(expression==nullptr){
+        return false;
+    }
+    switch(expression->node_case){
+        case RA__NODE__CONST: return true;
+        case RA__NODE__TYPE_CAST: return is_constant_expression(static_cast<Ra__Node__Type_Cast*>(expression)->expression);
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            return (expr->l_arg!=nullptr || expr->r_arg!=nullptr)
+                && (expr->l_arg==nullptr || is_constant_expression(expr->l_arg))
+                && (expr->r_arg==nullptr || is_constant_expression(expr->r_arg));
+        }
+        case RA__NODE__LIST:{
+            auto list = static_cast<Ra__Node__List*>(expression);
+            return !list->args.empty() && std::all_of(list->args.begin(), list->args.end(), is_constant_expression);
+        }
+        case RA__NODE__IN_LIST:{
+            auto in_list = static_cast<Ra__Node__In_List*>(expression);
+            return !in_list->args.empty() && std::all_of(in_list->args.begin(), in_list->args.end(), is_constant_expression);
+        }
+        default: return false;
+    }
+}
+
+// comparisons which hold for all attributes equal to the compared attribute
+static bool is_transferable_operator(const std::string& op){
+    static const std::set<std::string> operators = {"=", "<>", "!=", "<", ">", "<=", ">=", " between ", " in ", " not in "};
+    return operators.count(op)>0;
+}
+
+std::pair<Ra__Symbol,Ra__Symbol> RaTree::get_attribute_key(Ra__Node__Attribute* attr){
+    Ra__Symbol relation = attr->alias.empty() ? lookup_catalog_relation(attr->name) : attr->alias;
+    return {relation, attr->name};
+}
+
+std::pair<Ra__Symbol,Ra__Symbol> RaTree::find_equivalence_class(std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>>& classes, const std::pair<Ra__Symbol,Ra__Symbol>& attribute){
+    auto it = classes.find(attribute);
+    if(it==classes.end()){
+        classes[attribute] = attribute;
+        return attribute;
+    }
+    if(it->second==attribute){
+        return attribute;
+    }
+    auto representative = find_equivalence_class(classes, it->second);
+    classes[attribute] = representative;
+    return representative;
+}
+
+bool RaTree::infer_equivalent_predicates(std::vector<Ra__Node*>& conjuncts, Ra__Node* selection){
+    // 1. equivalence classes over attributes joined by "=", drop equi predicates already seen (a=b, b=a)
+    std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::pair<Ra__Symbol,Ra__Symbol>> classes;
+    std::map<std::pair<Ra__Symbol,Ra__Symbol>, Ra__Node__Attribute*> attributes; // first occurrence of each attribute
+    std::set<std::pair<std::pair<Ra__Symbol,Ra__Symbol>,std::pair<Ra__Symbol,Ra__Symbol>>> equi_predicates;
+    size_t n_conjuncts = conjuncts.size();
+    conjuncts.erase(
+        std::remove_if(conjuncts.begin(), conjuncts.end(), [&](Ra__Node* predicate){
+            if(predicate->node_case!=RA__NODE__PREDICATE){
+                return false;
+            }
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
+            if(p->binaryOperator!="=" || p->left==nullptr || p->right==nullptr
+                || p->left->node_case!=RA__NODE__ATTRIBUTE || p->right->node_case!=RA__NODE__ATTRIBUTE){
+                return false;
+            }
+            auto left = get_attribute_key(static_cast<Ra__Node__Attribute*>(p->left));
+            auto right = get_attribute_key(static_cast<Ra__Node__Attribute*>(p->right));
+            if(left.first.empty() || right.first.empty() || left==right){
+                return false;
+            }
+            if(!equi_predicates.insert({std::min(left, right), std::max(left, right)}).second){
+                return true;
+            }
+            attributes.insert({left, static_cast<Ra__Node__Attribute*>(p->left)});
+            attributes.insert({right, static_cast<Ra__Node__Attribute*>(p->right)});
+            auto left_class = find_equivalence_class(classes, left);
+            auto right_class = find_equivalence_class(classes, right);
+            if(left_class!=right_class){
+                classes[left_class] = right_class;
+            }
+            return false;
+        }),
+        conjuncts.end()
+    );
+    if(classes.empty()){
+        return conjuncts.size()<n_conjuncts;
+    }
+
+    std::map<std::pair<Ra__Symbol,Ra__Symbol>, std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> class_members;
+    for(const auto& attribute: attributes){
+        class_members[find_equivalence_class(classes, attribute.first)].push_back(attribute.first);
+    }
+
+    // 2. propagate comparisons of an attribute with a constant to all attributes of its class,
+    // as long as the attribute's relation is defined below the selection (not a correlated attribute)
+    std::vector<Ra__Node*> derived_predicates;
+    for(auto predicate: conjuncts){
+        if(predicate->node_case!=RA__NODE__PREDICATE){
+            continue;
+        }
+        auto p = static_cast<Ra__Node__Predicate*>(predicate);
+        if(!is_transferable_operator(p->binaryOperator) || p->left==nullptr || p->right==nullptr){
+            continue;
+        }
+        // attribute op constant, or constant op attribute
+        bool attribute_left = p->left->node_case==RA__NODE__ATTRIBUTE && is_constant_expression(p->right);
+        bool attribute_right = p->right->node_case==RA__NODE__ATTRIBUTE && is_constant_expression(p->left);
+        if(!attribute_left && !attribute_right){
+            continue;
+        }
+        auto attribute = get_attribute_key(static_cast<Ra__Node__Attribute*>(attribute_left ? p->left : p->right));
+        if(attribute.first.empty() || classes.find(attribute)==classes.end()){
+            continue;
+        }
+        for(const auto& member: class_members[find_equivalence_class(classes, attribute)]){
+            if(member==attribute || !has_relations_defined(selection->childNodes[0], {member.first})){
+                continue;
+            }
+            // constant operands are shared, they are never modified in place
+            auto member_attr = arena->make<Ra__Node__Attribute>(attributes[member]->name, attributes[member]->alias);
+            if(attribute_left){
+                derived_predicates.push_back(arena->make<Ra__Node__Predicate>(member_attr, p->right, p->binaryOperator));
+            }
+            else{
+                derived_predicates.push_back(arena->make<Ra__Node__Predicate>(p->left, member_attr, p->binaryOperator));
+            }
+        }
+    }
+    conjuncts.insert(conjuncts.end(), derived_predicates.begin(), derived_predicates.end());
+    return conjuncts.size()!=n_conjuncts || !derived_predicates.empty();
+}
@@ -0,0 +1,459 @@
+#include "ra_tree.h"
+#include <algorithm>
+
+// true if columns contain the primary key or a unique key of table
+static bool contains_unique_key(const Ra__Catalog__Table* table, const std::set<size_t>& columns){
+    auto contained = [&](const std::vector<size_t>& key){
+        return !key.empty() && std::all_of(key.begin(), key.end(), [&](size_t c){return columns.count(c)>0;});
+    };
+    return contained(table->primary_key) || std::any_of(table->unique_keys.begin(), table->unique_keys.end(), contained);
+}
+
+// cross product or inner join of a join block, not a subquery join or a renamed join
+static bool is_inner_join(Ra__Node* node){
+    if(node->node_case!=RA__NODE__JOIN){
+        return false;
+    }
+    auto join = static_cast<Ra__Node__Join*>(node);
+    return (join->type==RA__JOIN__CROSS_PRODUCT || join->type==RA__JOIN__INNER) && join->right_where_subquery_marker->marker==0 && join->alias.empty();
+}
+
+static void get_relations(Ra__Node* node, std::vector<Ra__Node__Relation*>& relations){
+    if(node->node_case==RA__NODE__RELATION){
+        relations.push_back(static_cast<Ra__Node__Relation*>(node));
+    }
+    for(auto child: node->childNodes){
+        get_relations(child, relations);
+    }
+}
+
+// relations of the query block of node, not of derived tables and subqueries in it
+static void get_block_relations(Ra__Node* node, std::vector<Ra__Node__Relation*>& relations){
+    if(node->node_case==RA__NODE__RELATION){
+        relations.push_back(static_cast<Ra__Node__Relation*>(node));
+    }
+    for(auto child: node->childNodes){
+        if(child->node_case!=RA__NODE__PROJECTION){
+            get_block_relations(child, relations);
+        }
+    }
+}
+
+// the remaining conjuncts of a selection or join predicate
+static std::vector<Ra__Node*> remaining_conjuncts(const std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>>& predicates_relations, const std::set<Ra__Node*>& removed){
+    std::vector<Ra__Node*> conjuncts;
+    for(const auto& p_r: predicates_relations){
+        if(removed.count(p_r.first)==0){
+            conjuncts.push_back(p_r.first);
+        }
+    }
+    return conjuncts;
+}
+
+void RaTree::get_join_block_conjuncts(Ra__Node* node, std::vector<Ra__Node*>& conjuncts){
+    Ra__Node* predicate = nullptr;
+    if(node->node_case==RA__NODE__SELECTION){
+        predicate = static_cast<Ra__Node__Selection*>(node)->predicate;
+    }
+    else if(is_inner_join(node)){
+        predicate = static_cast<Ra__Node__Join*>(node)->predicate;
+    }
+    else{
+        return;
+    }
+    if(predicate!=nullptr){
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+        split_selection_predicates(predicate, predicates_relations);
+        for(const auto& p_r: predicates_relations){
+            conjuncts.push_back(p_r.first);
+        }
+    }
+    for(auto child: node->childNodes){
+        get_join_block_conjuncts(child, conjuncts);
+    }
+}
+
+bool RaTree::is_relation_attribute(Ra__Node__Attribute* attr, Ra__Node__Relation* relation){
+    if(!attr->alias.empty()){
+        return attr->alias==get_relation_qualifier(relation);
+    }
+    if(attr->name.str()=="*"){
+        return true;
+    }
+    return relation->table->column_index(attr->name.str())>=0;
+}
+
+void RaTree::eliminate_joins(){
+    bool changed = false;
+    bool eliminated = true;
+    // removing a join may remove the last use of another relation (lineitem, orders, customer)
+    while(eliminated){
+        eliminated = false;
+        std::vector<Ra__Node__Relation*> relations;
+        get_relations(root, relations);
+        for(auto cte: ctes){
+            get_relations(cte, relations);
+        }
+        std::vector<Ra__Node__Attribute*> attributes;
+        std::vector<Ra__Node*> nodes;
+        get_subtree_nodes(root, nodes);
+        for(auto cte: ctes){
+            get_subtree_nodes(cte, nodes);
+        }
+        // "count(*)" counts rows, it does not use columns
+        std::set<Ra__Node*> counted_stars;
+        for(auto node: nodes){
+            if(node->node_case==RA__NODE__FUNC_CALL){
+                auto func_call = static_cast<Ra__Node__Func_Call*>(node);
+                counted_stars.insert(func_call->args.begin(), func_call->args.end());
+            }
+        }
+        for(auto node: nodes){
+            if(node->node_case==RA__NODE__ATTRIBUTE && !(counted_stars.count(node)>0 && static_cast<Ra__Node__Attribute*>(node)->name.str()=="*")){
+                attributes.push_back(static_cast<Ra__Node__Attribute*>(node));
+            }
+        }
+        // "*" uses the relations of its query block only, "exists (select * ...)" not those of the outer query
+        std::map<Ra__Node*, std::vector<Ra__Node__Relation*>> star_relations;
+        std::set<Ra__Symbol> derived_names;
+        for(auto node: nodes){
+            if(node->node_case==RA__NODE__PROJECTION){
+                auto pr = static_cast<Ra__Node__Projection*>(node);
+                derived_names.insert(pr->subquery_alias);
+                for(auto arg: pr->args){
+                    if(arg->node_case==RA__NODE__SELECT_EXPRESSION){
+                        arg = static_cast<Ra__Node__Select_Expression*>(arg)->expression;
+                    }
+                    if(arg!=nullptr && arg->node_case==RA__NODE__ATTRIBUTE && static_cast<Ra__Node__Attribute*>(arg)->name.str()=="*"){
+                        get_block_relations(pr, star_relations[arg]);
+                    }
+                }
+            }
+            else if(node->node_case==RA__NODE__JOIN){
+                derived_names.insert(static_cast<Ra__Node__Join*>(node)->alias);
+            }
+        }
+
+        for(auto relation: relations){
+            attach_catalog_table(relation);
+        }
+
+        for(auto relation: relations){
+            if(relation->table==nullptr){
+                continue;
+            }
+            // attributes are assigned to relations by name and qualifier, which must be unambiguous
+            size_t n_instances = std::count_if(relations.begin(), relations.end(), [&](Ra__Node__Relation* r){
+                return r->name==relation->name || get_relation_qualifier(r)==get_relation_qualifier(relation);
+            });
+            if(n_instances!=1 || derived_names.count(get_relation_qualifier(relation))>0){
+                continue;
+            }
+            std::vector<Ra__Node__Attribute*> relation_attributes;
+            for(auto attr: attributes){
+                auto stars = star_relations.find(attr);
+                if(stars==star_relations.end() || std::find(stars->second.begin(), stars->second.end(), relation)!=stars->second.end()){
+                    relation_attributes.push_back(attr);
+                }
+            }
+            if(eliminate_unique_key_left_join(relation, relation_attributes) || eliminate_foreign_key_join(relation, relation_attributes)){
+                eliminated = true;
+                changed = true;
+                break;
+            }
+        }
+    }
+    if(changed){
+        invalidate_hashes();
+    }
+}
+
+bool RaTree::eliminate_unique_key_left_join(Ra__Node__Relation* relation, const std::vector<Ra__Node__Attribute*>& attributes){
+    int child_index = -1;
+    Ra__Node* parent = get_linked_parent(relation, child_index);
+    if(parent==nullptr || parent->node_case!=RA__NODE__JOIN || child_index!=1){
+        return false;
+    }
+    auto join = static_cast<Ra__Node__Join*>(parent);
+    if(join->type!=RA__JOIN__LEFT || join->right_where_subquery_marker->marker!=0 || !join->alias.empty() || join->predicate==nullptr){
+        return false;
+    }
+    int join_child_index = -1;
+    Ra__Node* join_parent = get_linked_parent(join, join_child_index);
+    if(join_parent==nullptr){
+        return false;
+    }
+
+    // 1. key columns equated to expressions of the left side: each left row matches at most one row
+    std::set<Ra__Node*> predicate_nodes;
+    {
+        std::vector<Ra__Node*> nodes;
+        get_subtree_nodes(join->predicate, nodes);
+        predicate_nodes.insert(nodes.begin(), nodes.end());
+    }
+    std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+    split_selection_predicates(join->predicate, predicates_relations);
+    std::set<size_t> equated_columns;
+    for(const auto& p_r: predicates_relations){
+        if(p_r.first->node_case!=RA__NODE__PREDICATE || static_cast<Ra__Node__Predicate*>(p_r.first)->binaryOperator!="="){
+            continue;
+        }
+        auto p = static_cast<Ra__Node__Predicate*>(p_r.first);
+        for(auto sides: {std::make_pair(p->left, p->right), std::make_pair(p->right, p->left)}){
+            if(sides.first->node_case!=RA__NODE__ATTRIBUTE || !is_relation_attribute(static_cast<Ra__Node__Attribute*>(sides.first), relation)){
+                continue;
+            }
+            std::vector<Ra__Node*> other_nodes;
+            get_subtree_nodes(sides.second, other_nodes);
+            bool other_uses_relation = std::any_of(other_nodes.begin(), other_nodes.end(), [&](Ra__Node* node){
+                return node->node_case==RA__NODE__ATTRIBUTE && is_relation_attribute(static_cast<Ra__Node__Attribute*>(node), relation);
+            });
+            if(!other_uses_relation && sides.second->node_case!=RA__NODE__WHERE_SUBQUERY_MARKER){
+                equated_columns.insert(relation->table->column_index(static_cast<Ra__Node__Attribute*>(sides.first)->name.str()));
+            }
+        }
+    }
+    if(!contains_unique_key(relation->table, equated_columns)){
+        return false;
+    }
+
+    // 2. no attribute of the relation is used outside the join predicate
+    for(auto attr: attributes){
+        if(predicate_nodes.count(attr)==0 && is_relation_attribute(attr, relation)){
+            return false;
+        }
+    }
+
+    // 3. the left join returns the rows of its left side
+    join_parent->set_child(join_child_index, join->childNodes[0]);
+    join->clear_children();
+    return true;
+}
+
+bool RaTree::eliminate_foreign_key_join(Ra__Node__Relation* relation, const std::vector<Ra__Node__Attribute*>& attributes){
+    // selections on the relation alone may only use key columns, checked with the other uses
+    std::vector<Ra__Node__Selection*> relation_selections;
+    Ra__Node* relation_top = relation;
+    int child_index = -1;
+    Ra__Node* parent = get_linked_parent(relation_top, child_index);
+    while(parent!=nullptr && parent->node_case==RA__NODE__SELECTION){
+        relation_selections.push_back(static_cast<Ra__Node__Selection*>(parent));
+        relation_top = parent;
+        parent = get_linked_parent(relation_top, child_index);
+    }
+    if(parent==nullptr || !is_inner_join(parent)){
+        return false;
+    }
+    auto join = static_cast<Ra__Node__Join*>(parent);
+
+    // 1. predicates of the selections and inner joins above the relation's join, up to the join block's root
+    std::vector<Ra__Node*> holders;
+    Ra__Node* it = join;
+    int it_index = -1;
+    while(it!=nullptr){
+        if(it->node_case!=RA__NODE__SELECTION && !is_inner_join(it)){
+            break;
+        }
+        holders.push_back(it);
+        it = get_linked_parent(it, it_index);
+    }
+    if(it==nullptr){
+        return false;
+    }
+
+    // 2. equi join predicates "F.fk = relation.key" by the relation F of the foreign key column
+    std::vector<Ra__Node__Relation*> relations;
+    for(auto holder: holders){
+        get_block_relations(holder, relations);
+    }
+    std::sort(relations.begin(), relations.end());
+    relations.erase(std::unique(relations.begin(), relations.end()), relations.end());
+    struct Equi_Join {
+        Ra__Node* conjunct;
+        Ra__Node__Attribute* fk_attr;
+        size_t key_column;
+    };
+    std::map<Ra__Node__Relation*, std::vector<Equi_Join>> equi_joins;
+    for(auto holder: holders){
+        Ra__Node* predicate = holder->node_case==RA__NODE__SELECTION ? static_cast<Ra__Node__Selection*>(holder)->predicate : static_cast<Ra__Node__Join*>(holder)->predicate;
+        if(predicate==nullptr){
+            continue;
+        }
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+        split_selection_predicates(predicate, predicates_relations);
+        for(const auto& p_r: predicates_relations){
+            if(p_r.first->node_case!=RA__NODE__PREDICATE){
+                continue;
+            }
+            auto p = static_cast<Ra__Node__Predicate*>(p_r.first);
+            if(p->binaryOperator!="=" || p->left->node_case!=RA__NODE__ATTRIBUTE || p->right->node_case!=RA__NODE__ATTRIBUTE){
+                continue;
+            }
+            auto left = static_cast<Ra__Node__Attribute*>(p->left);
+            auto right = static_cast<Ra__Node__Attribute*>(p->right);
+            for(auto sides: {std::make_pair(left, right), std::make_pair(right, left)}){
+                if(!is_relation_attribute(sides.first, relation) || is_relation_attribute(sides.second, relation)){
+                    continue;
+                }
+                // relation of the other attribute, must be unambiguous
+                Ra__Node__Relation* fk_relation = nullptr;
+                size_t n_matches = 0;
+                for(auto r: relations){
+                    if(r!=relation && r->table!=nullptr && is_relation_attribute(sides.second, r)){
+                        fk_relation = r;
+                        n_matches++;
+                    }
+                }
+                if(n_matches==1){
+                    equi_joins[fk_relation].push_back({p_r.first, sides.second, static_cast<size_t>(relation->table->column_index(sides.first->name.str()))});
+                }
+            }
+        }
+    }
+
+    // 3. not null foreign key of F referencing a unique key of the relation, all columns equated
+    for(const auto& fk_relation_joins: equi_joins){
+        Ra__Node__Relation* fk_relation = fk_relation_joins.first;
+        for(const auto& foreign_key: fk_relation->table->foreign_keys){
+            if(foreign_key.referenced_table!=relation->name.str()){
+                continue;
+            }
+            std::set<size_t> key_columns;
+            std::map<size_t, size_t> fk_columns; // key column -> foreign key column
+            std::set<Ra__Node*> conjuncts;
+            bool valid = true;
+            for(size_t i=0; i<foreign_key.columns.size() && valid; i++){
+                int64_t key_column = relation->table->column_index(foreign_key.referenced_columns[i]);
+                const auto& fk_column = fk_relation->table->columns[foreign_key.columns[i]];
+                valid = key_column>=0 && !fk_column.nullable;
+                bool equated = false;
+                for(const auto& equi_join: fk_relation_joins.second){
+                    if(valid && equi_join.key_column==static_cast<size_t>(key_column) && equi_join.fk_attr->name.str()==fk_column.name){
+                        conjuncts.insert(equi_join.conjunct);
+                        equated = true;
+                    }
+                }
+                valid = valid && equated;
+                if(valid){
+                    key_columns.insert(key_column);
+                    fk_columns[key_column] = foreign_key.columns[i];
+                }
+            }
+            if(!valid || !contains_unique_key(relation->table, key_columns)){
+                continue;
+            }
+
+            // 4. other uses of the relation must be key columns, replaced by the foreign key columns
+            std::set<Ra__Node*> conjunct_nodes;
+            for(auto conjunct: conjuncts){
+                std::vector<Ra__Node*> nodes;
+                get_subtree_nodes(conjunct, nodes);
+                conjunct_nodes.insert(nodes.begin(), nodes.end());
+            }
+            std::vector<Ra__Node__Attribute*> key_uses;
+            for(auto attr: attributes){
+                if(conjunct_nodes.count(attr)>0 || !is_relation_attribute(attr, relation)){
+                    continue;
+                }
+                int64_t column = relation->table->column_index(attr->name.str());
+                if(column<0 || fk_columns.count(column)==0){
+                    valid = false;
+                    break;
+                }
+                key_uses.push_back(attr);
+            }
+            if(!valid){
+                continue;
+            }
+
+            // 5. replace the key columns, keeping the names of projected columns
+            std::set<Ra__Node*> key_use_nodes(key_uses.begin(), key_uses.end());
+            std::vector<Ra__Node*> nodes;
+            get_subtree_nodes(root, nodes);
+            for(auto cte: ctes){
+                get_subtree_nodes(cte, nodes);
+            }
+            for(auto node: nodes){
+                if(node->node_case!=RA__NODE__PROJECTION){
+                    continue;
+                }
+                auto pr = static_cast<Ra__Node__Projection*>(node);
+                for(auto& arg: pr->args){
+                    if(key_use_nodes.count(arg)>0 && pr->subquery_columns.empty()){
+                        auto sel_expr = arena->make<Ra__Node__Select_Expression>(arg);
+                        arg = sel_expr;
+                    }
+                    if(arg->node_case==RA__NODE__SELECT_EXPRESSION && pr->subquery_columns.empty()){
+                        auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+                        if(key_use_nodes.count(sel_expr->expression)>0 && sel_expr->rename.empty()){
+                            sel_expr->rename = static_cast<Ra__Node__Attribute*>(sel_expr->expression)->name.str();
+                        }
+                    }
+                }
+            }
+            for(auto attr: key_uses){
+                const std::string& fk_column = fk_relation->table->columns[fk_columns[relation->table->column_index(attr->name.str())]].name;
+                attr->name = symbols->intern(fk_column);
+                // qualified if the column name is ambiguous without
+                attr->alias = !fk_relation->alias.empty() ? fk_relation->alias
+                    : catalog->find_table_of_column(fk_column)==fk_relation->table ? Ra__Symbol() : fk_relation->name;
+            }
+
+            // 6. remove the join predicates, the join and the relation
+            std::vector<Ra__Node*> moved_predicates;
+            for(auto selection: relation_selections){
+                moved_predicates.push_back(selection->predicate);
+            }
+            std::vector<Ra__Node*> empty_selections;
+            for(auto holder: holders){
+                Ra__Node** predicate = holder->node_case==RA__NODE__SELECTION ? &static_cast<Ra__Node__Selection*>(holder)->predicate : &static_cast<Ra__Node__Join*>(holder)->predicate;
+                if(*predicate==nullptr){
+                    continue;
+                }
+                std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+                split_selection_predicates(*predicate, predicates_relations);
+                std::vector<Ra__Node*> remaining = remaining_conjuncts(predicates_relations, conjuncts);
+                if(holder==join){
+                    // now referring to the foreign key relation, which may be above the join
+                    moved_predicates.insert(moved_predicates.end(), remaining.begin(), remaining.end());
+                    continue;
+                }
+                if(remaining.size()==predicates_relations.size()){
+                    continue;
+                }
+                *predicate = remaining.empty() ? nullptr : make_conjunction(remaining);
+                if(holder->node_case==RA__NODE__SELECTION && remaining.empty()){
+                    empty_selections.push_back(holder);
+                }
+                else if(holder->node_case==RA__NODE__JOIN && remaining.empty()){
+                    static_cast<Ra__Node__Join*>(holder)->type = RA__JOIN__CROSS_PRODUCT;
+                }
+            }
+            int join_child_index = -1;
+            Ra__Node* join_parent = get_linked_parent(join, join_child_index);
+            join_parent->set_child(join_child_index, join->childNodes[1-child_index]);
+            join->clear_children();
+            for(auto selection: empty_selections){
+                int selection_index = -1;
+                Ra__Node* selection_parent = get_linked_parent(selection, selection_index);
+                selection_parent->set_child(selection_index, selection->childNodes[0]);
+                selection->clear_children();
+            }
+            // on top of the join block, pushed down again later (renamed predicates may repeat inferred ones)
+            std::vector<Ra__Node*> block_conjuncts;
+            get_join_block_conjuncts(it->childNodes[it_index], block_conjuncts);
+            size_t n_block_conjuncts = block_conjuncts.size();
+            block_conjuncts.insert(block_conjuncts.end(), moved_predicates.begin(), moved_predicates.end());
+            remove_duplicate_predicates(block_conjuncts);
+            moved_predicates.assign(block_conjuncts.begin()+std::min(n_block_conjuncts, block_conjuncts.size()), block_conjuncts.end());
+            if(!moved_predicates.empty()){
+                auto sel = arena->make<Ra__Node__Selection>();
+                sel->predicate = make_conjunction(moved_predicates);
+                sel->add_child(it->childNodes[it_index]);
+                it->set_child(it_index, sel);
+            }
+            return true;
+        }
+    }
+    return false;
+}
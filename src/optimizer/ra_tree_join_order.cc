@@ -0,0 +1,417 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+// join graph relations are bits of a uint64_t, graphs with more than 64 relations are not reordered
+static const size_t max_join_graph_relations = 64;
+
+static uint64_t relation_bit(size_t relation){
+    return uint64_t(1) << relation;
+}
+
+static size_t lowest_relation(uint64_t relations){
+    return __builtin_ctzll(relations);
+}
+
+static bool is_single_relation(uint64_t relations){
+    return relations!=0 && (relations & (relations-1))==0;
+}
+
+// relations with index <= relation
+static uint64_t relations_up_to(size_t relation){
+    return relation+1>=max_join_graph_relations ? ~uint64_t(0) : relation_bit(relation+1)-1;
+}
+
+/**
+ * Enumerates the pairs of connected subgraphs (csg) and connected complements (cmp) of a join graph,
+ * every pair of disjoint connected relation sets joined by an edge once, as in DPccp
+ * (Moerkotte, Neumann: Analysis of Two Existing and One New Dynamic Programming Algorithm for the Generation of Optimal Bushy Join Trees without Cross Products)
+ */
+class Ccp_Enumerator {
+    public:
+        /**
+         * @param _neighbors bitsets of the relations connected to each relation
+         * @param _emit called with every csg-cmp pair
+         */
+        Ccp_Enumerator(const std::vector<uint64_t>& _neighbors, std::function<void(uint64_t,uint64_t)> _emit):
+            neighbors(_neighbors), emit(std::move(_emit)){}
+
+        void enumerate(){
+            for(size_t i=neighbors.size(); i-->0;){
+                emit_csg(relation_bit(i));
+                enumerate_csg_rec(relation_bit(i), relations_up_to(i));
+            }
+        }
+
+    private:
+        const std::vector<uint64_t>& neighbors;
+        std::function<void(uint64_t,uint64_t)> emit;
+
+        uint64_t neighborhood(uint64_t relations, uint64_t excluded) const{
+            uint64_t result = 0;
+            for(uint64_t it=relations; it!=0; it&=it-1){
+                result |= neighbors[lowest_relation(it)];
+            }
+            return result & ~relations & ~excluded;
+        }
+
+        // all connected supersets of csg, extended by relations not in excluded
+        void enumerate_csg_rec(uint64_t csg, uint64_t excluded){
+            uint64_t n = neighborhood(csg, excluded);
+            for(uint64_t subset=n; subset!=0; subset=(subset-1)&n){
+                emit_csg(csg | subset);
+            }
+            for(uint64_t subset=n; subset!=0; subset=(subset-1)&n){
+                enumerate_csg_rec(csg | subset, excluded | n);
+            }
+        }
+
+        // all complements of csg, their lowest relation is larger than the lowest of csg
+        void emit_csg(uint64_t csg){
+            uint64_t excluded = csg | relations_up_to(lowest_relation(csg));
+            uint64_t n = neighborhood(csg, excluded);
+            for(size_t i=max_join_graph_relations; i-->0;){
+                if((n & relation_bit(i))==0){
+                    continue;
+                }
+                emit(csg, relation_bit(i));
+                enumerate_cmp_rec(csg, relation_bit(i), excluded | (relations_up_to(i) & n));
+            }
+        }
+
+        void enumerate_cmp_rec(uint64_t csg, uint64_t cmp, uint64_t excluded){
+            uint64_t n = neighborhood(cmp, excluded);
+            // cmp contains a neighbor of csg, so every extension of cmp is connected to csg
+            for(uint64_t subset=n; subset!=0; subset=(subset-1)&n){
+                emit(csg, cmp | subset);
+            }
+            for(uint64_t subset=n; subset!=0; subset=(subset-1)&n){
+                enumerate_cmp_rec(csg, cmp | subset, excluded | n);
+            }
+        }
+};
+
+void RaTree::reorder_joins(){
+    index_cost_relations();
+    reorder_joins(root);
+    for(auto cte: ctes){
+        reorder_joins(cte);
+    }
+}
+
+void RaTree::reorder_joins(Ra__Node* parent){
+    for(size_t i=0; i<parent->childNodes.size(); i++){
+        Ra__Node* child = parent->childNodes[i];
+        if(!is_join_graph_operator(child)){
+            reorder_joins(child);
+            continue;
+        }
+
+        Ra__Join_Graph graph;
+        bool shared = false;
+        collect_join_graph(child, graph, shared);
+
+        // the order of two relations does not change the cost
+        if(!shared && graph.relations.size()>2 && graph.relations.size()<=max_join_graph_relations){
+            graph.conjunction = arena->make<Ra__Node__Bool_Predicate>();
+            graph.conjunction->bool_operator = RA__BOOL_OPERATOR__AND;
+            index_join_graph(graph);
+
+            std::vector<size_t> order = graph.relations.size()<=join_order_dp_threshold ? order_joins_dp(graph) : order_joins_greedy(graph);
+            std::vector<size_t> query_order(graph.relations.size());
+            std::iota(query_order.begin(), query_order.end(), 0);
+            if(estimate_join_order_cost(graph, order) < estimate_join_order_cost(graph, query_order)){
+                for(auto op: graph.operators){
+                    op->clear_children();
+                }
+                parent->set_child(i, build_join_tree(graph, order));
+            }
+        }
+
+        for(const auto& relation: graph.relations){
+            reorder_joins(relation.node);
+        }
+    }
+}
+
+bool RaTree::is_join_graph_operator(Ra__Node* node){
+    switch(node->node_case){
+        case RA__NODE__SELECTION:{
+            auto sel = static_cast<Ra__Node__Selection*>(node);
+            // subquery markers refer to joins in the subtree, they are kept in place
+            return sel->predicate!=nullptr && !predicate_contains_subquery(sel->predicate);
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(node);
+            return join->type==RA__JOIN__CROSS_PRODUCT && join->predicate==nullptr && join->right_where_subquery_marker->marker==0
+                && join->alias.empty() && join->columns.empty();
+        }
+        default: return false;
+    }
+}
+
+void RaTree::collect_join_graph(Ra__Node* it, Ra__Join_Graph& graph, bool& shared){
+    if(!is_join_graph_operator(it)){
+        Ra__Join_Graph__Relation relation;
+        relation.node = it;
+        graph.relations.push_back(relation);
+        return;
+    }
+
+    shared = shared || it->n_parents>1;
+    graph.operators.push_back(it);
+    if(it->node_case==RA__NODE__SELECTION){
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+        split_selection_predicates(static_cast<Ra__Node__Selection*>(it)->predicate, predicates_relations);
+        for(const auto& p_r: predicates_relations){
+            Ra__Join_Graph__Predicate predicate;
+            predicate.predicate = p_r.first;
+            graph.predicates.push_back(predicate);
+        }
+    }
+    for(auto child: it->childNodes){
+        collect_join_graph(child, graph, shared);
+    }
+}
+
+void RaTree::index_join_graph(Ra__Join_Graph& graph){
+    size_t n_relations = graph.relations.size();
+    uint64_t all_relations = relations_up_to(n_relations-1);
+    for(auto& relation: graph.relations){
+        get_relations_aliases(relation.node, relation.relations_aliases);
+    }
+
+    graph.neighbors.assign(n_relations, 0);
+    for(auto& predicate: graph.predicates){
+        std::vector<Ra__Node*> attributes;
+        get_predicate_attributes(predicate.predicate, attributes);
+        for(auto attribute: attributes){
+            auto attr = static_cast<Ra__Node__Attribute*>(attribute);
+            Ra__Symbol relation = attr->alias.empty() ? lookup_catalog_relation(attr->name) : attr->alias;
+            // unknown relation, e.g. subquery column without alias: keep predicate above all relations
+            if(relation.empty()){
+                predicate.relations = all_relations;
+                break;
+            }
+            // attributes of other relations are correlated, defined outside of the graph
+            for(size_t i=0; i<n_relations; i++){
+                for(const auto& relation_alias: graph.relations[i].relations_aliases){
+                    if(relation==relation_alias.first || relation==relation_alias.second){
+                        predicate.relations |= relation_bit(i);
+                        break;
+                    }
+                }
+            }
+        }
+        if(!is_single_relation(predicate.relations) && is_single_relation(predicate.relations & (predicate.relations-1))){
+            size_t left = lowest_relation(predicate.relations);
+            size_t right = lowest_relation(predicate.relations & ~relation_bit(left));
+            graph.neighbors[left] |= relation_bit(right);
+            graph.neighbors[right] |= relation_bit(left);
+        }
+    }
+
+    for(size_t i=0; i<n_relations; i++){
+        double cost = 0;
+        double rows = estimate_cardinality(graph.relations[i].node, cost);
+        for(const auto& predicate: graph.predicates){
+            if(predicate.relations==relation_bit(i)){
+                rows *= estimate_selectivity(predicate.predicate);
+            }
+        }
+        graph.relations[i].rows = std::max(1.0, rows);
+    }
+}
+
+double RaTree::estimate_join_rows(Ra__Join_Graph& graph, uint64_t relations){
+    auto cached = graph.join_rows.find(relations);
+    if(cached!=graph.join_rows.end()){
+        return cached->second;
+    }
+
+    double rows = 1;
+    for(uint64_t it=relations; it!=0; it&=it-1){
+        rows *= graph.relations[lowest_relation(it)].rows;
+    }
+    // predicates on a single relation are part of its rows, join predicates are estimated together (composite keys)
+    graph.conjunction->args.clear();
+    for(const auto& predicate: graph.predicates){
+        if(predicate.relations!=0 && !is_single_relation(predicate.relations) && (predicate.relations & ~relations)==0){
+            graph.conjunction->args.push_back(predicate.predicate);
+        }
+    }
+    if(!graph.conjunction->args.empty()){
+        rows *= estimate_selectivity(graph.conjunction);
+    }
+    rows = std::max(1.0, rows);
+    graph.join_rows[relations] = rows;
+    return rows;
+}
+
+double RaTree::estimate_join_order_cost(Ra__Join_Graph& graph, const std::vector<size_t>& order){
+    double cost = 0;
+    uint64_t joined = relation_bit(order[0]);
+    for(size_t i=1; i<order.size(); i++){
+        joined |= relation_bit(order[i]);
+        cost += estimate_join_rows(graph, joined);
+    }
+    return cost;
+}
+
+std::vector<size_t> RaTree::order_joins_dp(Ra__Join_Graph& graph){
+    // cheapest left-deep plan of a relation set: plan of left, joined with relation last
+    struct Plan {
+        double cost;
+        uint64_t left;
+        size_t last;
+    };
+
+    std::vector<std::pair<uint64_t,uint64_t>> pairs;
+    Ccp_Enumerator(graph.neighbors, [&](uint64_t csg, uint64_t cmp){
+        pairs.push_back({csg, cmp});
+    }).enumerate();
+    // plans of smaller sets are complete before they are extended
+    std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b){
+        return __builtin_popcountll(a.first|a.second) < __builtin_popcountll(b.first|b.second);
+    });
+
+    std::unordered_map<uint64_t, Plan> plans;
+    for(size_t i=0; i<graph.relations.size(); i++){
+        plans[relation_bit(i)] = {0, 0, i};
+    }
+    for(auto pair: pairs){
+        // bushy plans are not considered, a from clause is joined left to right
+        if(!is_single_relation(pair.first) && !is_single_relation(pair.second)){
+            continue;
+        }
+        // of two relations, the one with fewer rows comes first
+        if(is_single_relation(pair.first) && is_single_relation(pair.second)
+            && graph.relations[lowest_relation(pair.second)].rows < graph.relations[lowest_relation(pair.first)].rows){
+            std::swap(pair.first, pair.second);
+        }
+        uint64_t relations = pair.first | pair.second;
+        double rows = estimate_join_rows(graph, relations);
+        for(const auto& left_right: {pair, std::make_pair(pair.second, pair.first)}){
+            if(!is_single_relation(left_right.second)){
+                continue;
+            }
+            double cost = plans.at(left_right.first).cost + rows;
+            auto plan = plans.find(relations);
+            if(plan==plans.end() || cost<plan->second.cost){
+                plans[relations] = {cost, left_right.first, lowest_relation(left_right.second)};
+            }
+        }
+    }
+
+    // connected components are joined by cross products, fewest rows first
+    std::vector<std::pair<double,uint64_t>> components;
+    uint64_t remaining = relations_up_to(graph.relations.size()-1);
+    while(remaining!=0){
+        uint64_t component = relation_bit(lowest_relation(remaining));
+        uint64_t previous = 0;
+        while(component!=previous){
+            previous = component;
+            for(uint64_t it=previous; it!=0; it&=it-1){
+                component |= graph.neighbors[lowest_relation(it)];
+            }
+        }
+        components.push_back({estimate_join_rows(graph, component), component});
+        remaining &= ~component;
+    }
+    std::stable_sort(components.begin(), components.end(), [](const auto& a, const auto& b){
+        return a.first < b.first;
+    });
+
+    std::vector<size_t> order;
+    for(const auto& component: components){
+        size_t start = order.size();
+        for(uint64_t it=component.second; it!=0; it=plans.at(it).left){
+            order.push_back(plans.at(it).last);
+        }
+        std::reverse(order.begin()+start, order.end());
+    }
+    return order;
+}
+
+std::vector<size_t> RaTree::order_joins_greedy(Ra__Join_Graph& graph){
+    std::vector<size_t> order;
+    uint64_t joined = 0;
+    while(order.size()<graph.relations.size()){
+        // relations connected to the joined ones are preferred, cross products only if there are none
+        uint64_t connected = 0;
+        for(uint64_t it=joined; it!=0; it&=it-1){
+            connected |= graph.neighbors[lowest_relation(it)];
+        }
+        connected &= ~joined;
+
+        size_t next = 0;
+        double next_rows = -1;
+        for(size_t i=0; i<graph.relations.size(); i++){
+            if((joined & relation_bit(i))!=0 || (connected!=0 && (connected & relation_bit(i))==0)){
+                continue;
+            }
+            double rows = joined==0 ? graph.relations[i].rows : estimate_join_rows(graph, joined | relation_bit(i));
+            if(next_rows<0 || rows<next_rows){
+                next = i;
+                next_rows = rows;
+            }
+        }
+        order.push_back(next);
+        joined |= relation_bit(next);
+    }
+    return order;
+}
+
+Ra__Node* RaTree::build_join_tree(const Ra__Join_Graph& graph, const std::vector<size_t>& order){
+    // adds a selection with the predicates on the given relations above child
+    auto add_selection = [&](Ra__Node* child, const std::function<bool(uint64_t)>& selects){
+        std::vector<Ra__Node*> predicates;
+        for(const auto& predicate: graph.predicates){
+            if(selects(predicate.relations)){
+                predicates.push_back(predicate.predicate);
+            }
+        }
+        if(predicates.empty()){
+            return child;
+        }
+        auto sel = arena->make<Ra__Node__Selection>();
+        if(predicates.size()==1){
+            sel->predicate = predicates[0];
+        }
+        else{
+            auto bool_p = arena->make<Ra__Node__Bool_Predicate>();
+            bool_p->bool_operator = RA__BOOL_OPERATOR__AND;
+            bool_p->args = predicates;
+            sel->predicate = bool_p;
+        }
+        sel->add_child(child);
+        return static_cast<Ra__Node*>(sel);
+    };
+
+    Ra__Node* tree = nullptr;
+    uint64_t joined = 0;
+    for(size_t relation: order){
+        uint64_t bit = relation_bit(relation);
+        Ra__Node* right = add_selection(graph.relations[relation].node, [&](uint64_t relations){
+            return relations==bit;
+        });
+        if(tree==nullptr){
+            tree = right;
+        }
+        else{
+            auto join = arena->make<Ra__Node__Join>(RA__JOIN__CROSS_PRODUCT);
+            join->add_child(tree);
+            join->add_child(right);
+            // join predicates are evaluated as soon as all their relations are joined
+            tree = add_selection(join, [&](uint64_t relations){
+                return !is_single_relation(relations) && (relations & bit)!=0 && (relations & ~(joined | bit))==0;
+            });
+        }
+        joined |= bit;
+    }
+    // predicates referencing no relation of the graph
+    return add_selection(tree, [](uint64_t relations){
+        return relations==0;
+    });
+}
@@ -0,0 +1,298 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+// name of the i-th column of a projection, empty if the column is unnamed (expression without rename)
+static std::string get_block_column(Ra__Node__Projection* projection, size_t i){
+    if(!projection->subquery_columns.empty()){
+        return i<projection->subquery_columns.size() ? projection->subquery_columns[i] : "";
+    }
+    Ra__Node* arg = projection->args[i];
+    if(arg->node_case==RA__NODE__SELECT_EXPRESSION){
+        auto sel_expr = static_cast<Ra__Node__Select_Expression*>(arg);
+        if(!sel_expr->rename.empty()){
+            return sel_expr->rename;
+        }
+        arg = sel_expr->expression;
+    }
+    return arg->node_case==RA__NODE__ATTRIBUTE ? static_cast<Ra__Node__Attribute*>(arg)->name.str() : "";
+}
+
+static Ra__Node* get_arg_expression(Ra__Node* arg){
+    return arg->node_case==RA__NODE__SELECT_EXPRESSION ? static_cast<Ra__Node__Select_Expression*>(arg)->expression : arg;
+}
+
+// copy of an expression with its attributes replaced by column(attribute), nullptr if column returns nullptr for an attribute
+// or the expression contains aggregates, window functions or subqueries
+static Ra__Node* substitute_columns(Ra__Node* expression, const std::function<Ra__Node*(Ra__Node__Attribute*)>& column, RaArena* arena){
+    switch(expression->node_case){
+        case RA__NODE__ATTRIBUTE: return column(static_cast<Ra__Node__Attribute*>(expression));
+        case RA__NODE__CONST: return expression;
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            auto copy = arena->make<Ra__Node__Expression>();
+            copy->operator_ = expr->operator_;
+            if(expr->l_arg!=nullptr && (copy->l_arg = substitute_columns(expr->l_arg, column, arena))==nullptr){
+                return nullptr;
+            }
+            if(expr->r_arg!=nullptr && (copy->r_arg = substitute_columns(expr->r_arg, column, arena))==nullptr){
+                return nullptr;
+            }
+            return copy;
+        }
+        case RA__NODE__TYPE_CAST:{
+            auto type_cast = static_cast<Ra__Node__Type_Cast*>(expression);
+            Ra__Node* arg = substitute_columns(type_cast->expression, column, arena);
+            return arg!=nullptr ? arena->make<Ra__Node__Type_Cast>(type_cast->type, type_cast->typ_mod, arg) : nullptr;
+        }
+        case RA__NODE__FUNC_CALL:{
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
+            if(func_call->is_aggregating || func_call->is_window){
+                return nullptr;
+            }
+            auto copy = arena->make<Ra__Node__Func_Call>(func_call->func_name);
+            copy->is_aggregating = false;
+            copy->agg_distinct = false;
+            copy->is_window = false;
+            for(auto arg: func_call->args){
+                Ra__Node* arg_copy = substitute_columns(arg, column, arena);
+                if(arg_copy==nullptr){
+                    return nullptr;
+                }
+                copy->args.push_back(arg_copy);
+            }
+            return copy;
+        }
+        default: return nullptr;
+    }
+}
+
+bool RaTree::has_limit(Ra__Node* node){
+    std::vector<Ra__Node*> nodes;
+    get_subtree_nodes(node, nodes);
+    return std::any_of(nodes.begin(), nodes.end(), [](Ra__Node* n){return n->node_case==RA__NODE__LIMIT;});
+}
+
+void RaTree::push_down_limits(){
+    bool changed = false;
+    bool pushed = true;
+    // limits pushed into a subquery may be pushed further down
+    while(pushed){
+        pushed = false;
+        std::vector<Ra__Node*> nodes;
+        get_subtree_nodes(root, nodes);
+        for(auto cte: ctes){
+            get_subtree_nodes(cte, nodes);
+        }
+        for(auto node: nodes){
+            if(node->node_case==RA__NODE__LIMIT && push_down_limit(static_cast<Ra__Node__Limit*>(node))){
+                pushed = true;
+                changed = true;
+            }
+        }
+    }
+    if(changed){
+        invalidate_hashes();
+    }
+}
+
+bool RaTree::push_down_limit(Ra__Node__Limit* limit){
+    // 1. the first rows of the block, not of its distinct rows or of rows aggregated by window functions
+    if(limit->count==nullptr || limit->with_ties){
+        return false;
+    }
+    int child_index = -1;
+    Ra__Node* parent = get_linked_parent(limit, child_index);
+    if(parent==nullptr || parent->node_case!=RA__NODE__PROJECTION || static_cast<Ra__Node__Projection*>(parent)->distinct){
+        return false;
+    }
+    for(auto arg: static_cast<Ra__Node__Projection*>(parent)->args){
+        std::vector<Ra__Node*> arg_nodes;
+        get_subtree_nodes(arg, arg_nodes);
+        if(std::any_of(arg_nodes.begin(), arg_nodes.end(), [](Ra__Node* n){
+            return n->node_case==RA__NODE__FUNC_CALL && static_cast<Ra__Node__Func_Call*>(n)->is_window;
+        })){
+            return false;
+        }
+    }
+    Ra__Node__Order_By* order_by = nullptr;
+    Ra__Node* it = limit->childNodes[0];
+    if(it->node_case==RA__NODE__ORDER_BY){
+        // positions and names of select expressions are resolved to the expressions
+        auto projection = static_cast<Ra__Node__Projection*>(parent);
+        auto block_order_by = static_cast<Ra__Node__Order_By*>(it);
+        order_by = arena->make<Ra__Node__Order_By>();
+        for(size_t i=0; i<block_order_by->args.size(); i++){
+            Ra__Node* arg = block_order_by->args[i];
+            if(arg->node_case==RA__NODE__CONST){
+                size_t position = std::atoi(static_cast<Ra__Node__Constant*>(arg)->data.c_str());
+                if(position<1 || position>projection->args.size()){
+                    return false;
+                }
+                arg = copy_expression(get_arg_expression(projection->args[position-1]));
+            }
+            else{
+                arg = substitute_columns(arg, [&](Ra__Node__Attribute* attr){
+                    for(auto projection_arg: projection->args){
+                        if(attr->alias.empty() && projection_arg->node_case==RA__NODE__SELECT_EXPRESSION
+                            && static_cast<Ra__Node__Select_Expression*>(projection_arg)->rename==attr->name.str()){
+                            return copy_expression(get_arg_expression(projection_arg));
+                        }
+                    }
+                    return copy_expression(attr);
+                }, arena.get());
+            }
+            if(arg==nullptr){
+                return false;
+            }
+            order_by->args.push_back(arg);
+            order_by->directions.push_back(block_order_by->directions[i]);
+        }
+        it = it->childNodes[0];
+    }
+
+    // 2. the subquery returns the first count+offset rows, the offset is skipped above
+    auto no_columns = [](Ra__Node__Attribute*){return static_cast<Ra__Node*>(nullptr);};
+    Ra__Node* count = substitute_columns(limit->count, no_columns, arena.get());
+    if(count==nullptr){
+        return false;
+    }
+    if(limit->offset!=nullptr){
+        auto sum = arena->make<Ra__Node__Expression>();
+        sum->operator_ = "+";
+        sum->l_arg = count;
+        sum->r_arg = substitute_columns(limit->offset, no_columns, arena.get());
+        if(sum->r_arg==nullptr){
+            return false;
+        }
+        count = fold_constant_expression(sum, false);
+    }
+
+    // 3. left joins matching at most one row keep the rows of their left side and their order
+    bool below_join = false;
+    while(it->n_parents==1 && it->node_case==RA__NODE__JOIN){
+        auto join = static_cast<Ra__Node__Join*>(it);
+        if(join->type!=RA__JOIN__LEFT || !join->alias.empty() || join->right_where_subquery_marker->marker!=0 || join->predicate==nullptr){
+            break;
+        }
+        std::vector<Ra__Node*> conjuncts;
+        std::vector<std::pair<Ra__Node*,std::vector<Ra__Symbol>>> predicates_relations;
+        split_selection_predicates(join->predicate, predicates_relations);
+        for(const auto& p_r: predicates_relations){
+            conjuncts.push_back(p_r.first);
+        }
+        std::vector<std::vector<std::pair<Ra__Symbol,Ra__Symbol>>> right_keys;
+        get_unique_keys(join->childNodes[1], right_keys);
+        if(!std::any_of(right_keys.begin(), right_keys.end(), [&](const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& key){
+            return is_equated_key(conjuncts, key, join->childNodes[1]);
+        })){
+            break;
+        }
+        it = join->childNodes[0];
+        below_join = true;
+    }
+    if(it->n_parents!=1){
+        return false;
+    }
+
+    // 4. limit the subquery, the order by expressions computed from its columns
+    switch(it->node_case){
+        case RA__NODE__PROJECTION:{
+            auto subquery = static_cast<Ra__Node__Projection*>(it);
+            std::vector<std::string> columns;
+            std::vector<Ra__Node*> expressions;
+            for(size_t i=0; i<subquery->args.size(); i++){
+                columns.push_back(get_block_column(subquery, i));
+                expressions.push_back(get_arg_expression(subquery->args[i]));
+            }
+            return add_block_limit(subquery, count, order_by, [&](Ra__Node__Attribute* attr){
+                return get_subquery_column(attr, subquery->subquery_alias, columns, expressions);
+            });
+        }
+        case RA__NODE__UNION:{
+            auto union_node = static_cast<Ra__Node__Union*>(it);
+            bool pushed = false;
+            for(auto branch: union_node->childNodes){
+                auto projection = static_cast<Ra__Node__Projection*>(branch);
+                std::vector<Ra__Node*> expressions;
+                for(auto arg: projection->args){
+                    expressions.push_back(get_arg_expression(arg));
+                }
+                pushed = add_block_limit(projection, count, order_by, [&](Ra__Node__Attribute* attr){
+                    return get_subquery_column(attr, union_node->alias, union_node->columns, expressions);
+                }) || pushed;
+            }
+            return pushed;
+        }
+        case RA__NODE__SELECTION:
+        case RA__NODE__RELATION:{
+            // the preserved side of the joins as derived table "(select * from relation ...) qualifier"
+            Ra__Node* relation = it;
+            while(relation->node_case==RA__NODE__SELECTION){
+                relation = relation->childNodes[0];
+            }
+            if(!below_join || relation->node_case!=RA__NODE__RELATION || attach_catalog_table(static_cast<Ra__Node__Relation*>(relation))==nullptr){
+                return false;
+            }
+            int it_index = -1;
+            Ra__Node* it_parent = get_linked_parent(it, it_index);
+            if(it_parent==nullptr){
+                return false;
+            }
+            auto subquery = arena->make<Ra__Node__Projection>();
+            subquery->subquery_alias = get_relation_qualifier(relation);
+            subquery->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(symbols->intern("*"), Ra__Symbol())));
+            subquery->add_child(it);
+            if(!add_block_limit(subquery, count, order_by, [&](Ra__Node__Attribute* attr){
+                return is_relation_attribute(attr, static_cast<Ra__Node__Relation*>(relation)) && attr->name.str()!="*" ? copy_expression(attr) : nullptr;
+            })){
+                subquery->clear_children();
+                return false;
+            }
+            it_parent->set_child(it_index, subquery);
+            return true;
+        }
+        default: return false;
+    }
+}
+
+Ra__Node* RaTree::get_subquery_column(Ra__Node__Attribute* attr, Ra__Symbol alias, const std::vector<std::string>& columns, const std::vector<Ra__Node*>& expressions){
+    if(!attr->alias.empty() && attr->alias!=alias){
+        return nullptr;
+    }
+    for(size_t i=0; i<columns.size() && i<expressions.size(); i++){
+        if(!columns[i].empty() && columns[i]==attr->name.str()){
+            return copy_expression(expressions[i]);
+        }
+    }
+    return nullptr;
+}
+
+bool RaTree::add_block_limit(Ra__Node__Projection* projection, Ra__Node* count, Ra__Node__Order_By* order_by, const std::function<Ra__Node*(Ra__Node__Attribute*)>& column){
+    // a subquery with its own limit or, if the rows are ordered above, its own order
+    Ra__Node* below = projection->childNodes[0];
+    if(projection->n_parents>1 || below->node_case==RA__NODE__LIMIT || (order_by!=nullptr && below->node_case==RA__NODE__ORDER_BY)){
+        return false;
+    }
+    auto limit = arena->make<Ra__Node__Limit>();
+    limit->count = copy_expression(count);
+    if(order_by!=nullptr){
+        auto subquery_order_by = arena->make<Ra__Node__Order_By>();
+        for(size_t i=0; i<order_by->args.size(); i++){
+            Ra__Node* arg = substitute_columns(order_by->args[i], column, arena.get());
+            if(arg==nullptr){
+                return false;
+            }
+            subquery_order_by->args.push_back(arg);
+            subquery_order_by->directions.push_back(order_by->directions[i]);
+        }
+        subquery_order_by->add_child(below);
+        limit->add_child(subquery_order_by);
+    }
+    else{
+        limit->add_child(below);
+    }
+    projection->set_child(0, limit);
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "ra_tree.h"
+#include <set>
+
+// comparisons which are null if an operand is null (only the left operand of lists, "x in (1, null)" may be true)
+static bool is_strict_comparison(const std::string& op){
+    static const std::set<std::string> operators = {"=", "<>", "!=", "<", ">", "<=", ">=", " like ", " not like ", " between ", " in ", " not in "};
+    return operators.count(op)>0;
+}
+
+// scalar functions which are null if an argument is null (not e.g. coalesce, nullif, concat)
+static bool is_strict_function(const std::string& func_name){
+    static const std::set<std::string> functions = {"extract", "substring", "substr", "upper", "lower", "abs", "round", "trim", "length", "char_length"};
+    return functions.count(func_name)>0;
+}
+
+static bool is_outer_join(Ra__Node* node){
+    if(node->node_case!=RA__NODE__JOIN){
+        return false;
+    }
+    auto join = static_cast<Ra__Node__Join*>(node);
+    return (join->type==RA__JOIN__LEFT || join->type==RA__JOIN__FULL_OUTER) && join->right_where_subquery_marker->marker==0;
+}
+
+// outer joins of a subtree in preorder (joins above before joins below)
+static void get_outer_joins(Ra__Node* node, std::vector<Ra__Node__Join*>& joins){
+    if(is_outer_join(node)){
+        joins.push_back(static_cast<Ra__Node__Join*>(node));
+    }
+    for(auto child: node->childNodes){
+        get_outer_joins(child, joins);
+    }
+}
+
+void RaTree::simplify_outer_joins(){
+    std::vector<Ra__Node__Join*> joins;
+    get_outer_joins(root, joins);
+    for(auto cte: ctes){
+        get_outer_joins(cte, joins);
+    }
+    bool changed = false;
+    for(auto join: joins){
+        changed |= simplify_outer_join(join);
+    }
+    if(changed){
+        invalidate_hashes();
+    }
+}
+
+bool RaTree::simplify_outer_join(Ra__Node__Join* join){
+    // a renamed join only exports its renamed columns
+    if(!join->alias.empty()){
+        return false;
+    }
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> left_relations_aliases;
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> right_relations_aliases;
+    get_relations_aliases(join->childNodes[0], left_relations_aliases);
+    get_relations_aliases(join->childNodes[1], right_relations_aliases);
+
+    // 1. climb up the query block, collecting the predicates which filter the join's rows
+    bool rejects_left = false;
+    bool rejects_right = false;
+    Ra__Node* node = join;
+    int child_index = -1;
+    Ra__Node* parent;
+    while((parent = get_linked_parent(node, child_index))!=nullptr){
+        Ra__Node* filter = nullptr;
+        bool climb = true;
+        if(parent->node_case==RA__NODE__SELECTION){
+            filter = static_cast<Ra__Node__Selection*>(parent)->predicate;
+        }
+        else if(parent->node_case==RA__NODE__JOIN){
+            auto parent_join = static_cast<Ra__Node__Join*>(parent);
+            if(!parent_join->alias.empty()){
+                break;
+            }
+            if(parent_join->right_where_subquery_marker->marker!=0){
+                // subquery join, its selection above filters the left side
+                climb = child_index==0;
+            }
+            else if(parent_join->type==RA__JOIN__CROSS_PRODUCT || parent_join->type==RA__JOIN__INNER){
+                filter = parent_join->predicate;
+            }
+            else if(parent_join->type==RA__JOIN__LEFT){
+                // on the right side, rows rejected by the join predicate are not matched either way (left side rows are kept)
+                if(child_index==1){
+                    filter = parent_join->predicate;
+                    climb = false;
+                }
+            }
+            else{
+                break;
+            }
+        }
+        else if(parent->node_case!=RA__NODE__ORDER_BY){
+            break;
+        }
+        if(filter!=nullptr){
+            rejects_right = rejects_right || is_null_rejecting(filter, right_relations_aliases, left_relations_aliases);
+            rejects_left = rejects_left || (join->type==RA__JOIN__FULL_OUTER && is_null_rejecting(filter, left_relations_aliases, right_relations_aliases));
+        }
+        if(!climb){
+            break;
+        }
+        node = parent;
+    }
+
+    // 2. rows with a null-extended side are filtered anyway (a full join rejecting only the right side would be a right join)
+    if(join->type==RA__JOIN__LEFT && rejects_right){
+        join->type = RA__JOIN__INNER;
+        return true;
+    }
+    if(join->type==RA__JOIN__FULL_OUTER && rejects_left){
+        join->type = rejects_right ? RA__JOIN__INNER : RA__JOIN__LEFT;
+        return true;
+    }
+    return false;
+}
+
+bool RaTree::is_null_rejecting(Ra__Node* predicate, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& nullable, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& preserved){
+    if(predicate==nullptr){
+        return false;
+    }
+    switch(predicate->node_case){
+        case RA__NODE__PREDICATE:{
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
+            if(!is_strict_comparison(p->binaryOperator) || predicate_contains_subquery(p)){
+                return false;
+            }
+            return is_null_on_null_side(p->left, nullable, preserved) || is_null_on_null_side(p->right, nullable, preserved);
+        }
+        case RA__NODE__NULL_TEST:{
+            auto null_test = static_cast<Ra__Node__Null_Test*>(predicate);
+            return null_test->type==RA__NULL_TEST__IS_NOT_NULL && is_null_on_null_side(null_test->arg, nullable, preserved);
+        }
+        case RA__NODE__BOOL_PREDICATE:{
+            auto bool_p = static_cast<Ra__Node__Bool_Predicate*>(predicate);
+            switch(bool_p->bool_operator){
+                case RA__BOOL_OPERATOR__AND:{
+                    for(auto arg: bool_p->args){
+                        if(is_null_rejecting(arg, nullable, preserved)){
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+                case RA__BOOL_OPERATOR__OR:{
+                    for(auto arg: bool_p->args){
+                        if(!is_null_rejecting(arg, nullable, preserved)){
+                            return false;
+                        }
+                    }
+                    return !bool_p->args.empty();
+                }
+                case RA__BOOL_OPERATOR__NOT:{
+                    // not of null is null, not of false is true: only strict comparisons stay rejecting
+                    return bool_p->args.size()==1 && bool_p->args[0]->node_case==RA__NODE__PREDICATE
+                        && is_null_rejecting(bool_p->args[0], nullable, preserved);
+                }
+                default: return false;
+            }
+        }
+        default: return false; // subquery markers
+    }
+}
+
+bool RaTree::is_null_on_null_side(Ra__Node* expression, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& nullable, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& preserved){
+    if(expression==nullptr){
+        return false;
+    }
+    switch(expression->node_case){
+        case RA__NODE__ATTRIBUTE:{
+            auto attr = static_cast<Ra__Node__Attribute*>(expression);
+            if(!attr->alias.empty()){
+                for(const auto& relation_alias: nullable){
+                    if(relation_alias.second==attr->alias || (relation_alias.second.empty() && relation_alias.first==attr->alias)){
+                        return true;
+                    }
+                }
+                return false;
+            }
+            Ra__Symbol relation = lookup_catalog_relation(attr->name);
+            if(relation.empty()){
+                return false;
+            }
+            for(const auto& relation_alias: preserved){
+                if(relation_alias.first==relation){
+                    return false;
+                }
+            }
+            for(const auto& relation_alias: nullable){
+                if(relation_alias.first==relation){
+                    return true;
+                }
+            }
+            return false;
+        }
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(expression);
+            return is_null_on_null_side(expr->l_arg, nullable, preserved) || is_null_on_null_side(expr->r_arg, nullable, preserved);
+        }
+        case RA__NODE__TYPE_CAST:{
+            return is_null_on_null_side(static_cast<Ra__Node__Type_Cast*>(expression)->expression, nullable, preserved);
+        }
+        case RA__NODE__FUNC_CALL:{
+            auto func_call = static_cast<Ra__Node__Func_Call*>(expression);
+            if(func_call->is_aggregating || func_call->is_window || !is_strict_function(func_call->func_name)){
+                return false;
+            }
+            for(auto arg: func_call->args){
+                if(is_null_on_null_side(arg, nullable, preserved)){
+                    return true;
+                }
+            }
+            return false;
+        }
+        default: return false; // constants, case, lists
+    }
+}
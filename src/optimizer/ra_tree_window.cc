@@ -0,0 +1,579 @@
+#include "ra_tree.h"
+#include <algorithm>
+#include <functional>
+
+/**
+ * Base relations and and-split predicates of a subtree of selections, cross products and inner joins
+ */
+struct Window__Block {
+    /// relation names and aliases
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> relations;
+    std::vector<Ra__Node*> predicates;
+};
+
+static void split_conjuncts(Ra__Node* predicate, std::vector<Ra__Node*>& conjuncts){
+    if(predicate->node_case==RA__NODE__BOOL_PREDICATE && static_cast<Ra__Node__Bool_Predicate*>(predicate)->bool_operator==RA__BOOL_OPERATOR__AND){
+        for(auto arg: static_cast<Ra__Node__Bool_Predicate*>(predicate)->args){
+            split_conjuncts(arg, conjuncts);
+        }
+        return;
+    }
+    conjuncts.push_back(predicate);
+}
+
+// false if the subtree contains other operators
+static bool collect_window_block(Ra__Node* it, Window__Block& block){
+    switch(it->node_case){
+        case RA__NODE__RELATION:{
+            auto rel = static_cast<Ra__Node__Relation*>(it);
+            block.relations.push_back({rel->name, rel->alias});
+            return true;
+        }
+        case RA__NODE__SELECTION:{
+            auto sel = static_cast<Ra__Node__Selection*>(it);
+            if(sel->predicate!=nullptr){
+                split_conjuncts(sel->predicate, block.predicates);
+            }
+            return collect_window_block(it->childNodes[0], block);
+        }
+        case RA__NODE__JOIN:{
+            auto join = static_cast<Ra__Node__Join*>(it);
+            if(join->right_where_subquery_marker->marker!=0 || !join->alias.empty()
+                || (join->type!=RA__JOIN__CROSS_PRODUCT && join->type!=RA__JOIN__INNER)){
+                return false;
+            }
+            if(join->predicate!=nullptr){
+                split_conjuncts(join->predicate, block.predicates);
+            }
+            return collect_window_block(it->childNodes[0], block) && collect_window_block(it->childNodes[1], block);
+        }
+        default: return false;
+    }
+}
+
+// attributes of a predicate or expression, false if it contains subqueries or unsupported expressions
+static bool collect_predicate_attributes(Ra__Node* it, std::vector<Ra__Node__Attribute*>& attributes){
+    if(it==nullptr){
+        return true;
+    }
+    switch(it->node_case){
+        case RA__NODE__ATTRIBUTE:{
+            attributes.push_back(static_cast<Ra__Node__Attribute*>(it));
+            return true;
+        }
+        case RA__NODE__CONST: return true;
+        case RA__NODE__EXPRESSION:{
+            auto expr = static_cast<Ra__Node__Expression*>(it);
+            return collect_predicate_attributes(expr->l_arg, attributes) && collect_predicate_attributes(expr->r_arg, attributes);
+        }
+        case RA__NODE__TYPE_CAST:{
+            return collect_predicate_attributes(static_cast<Ra__Node__Type_Cast*>(it)->expression, attributes);
+        }
+        case RA__NODE__PREDICATE:{
+            auto p = static_cast<Ra__Node__Predicate*>(it);
+            return collect_predicate_attributes(p->left, attributes) && collect_predicate_attributes(p->right, attributes);
+        }
+        case RA__NODE__NULL_TEST:{
+            return collect_predicate_attributes(static_cast<Ra__Node__Null_Test*>(it)->arg, attributes);
+        }
+        case RA__NODE__FUNC_CALL:
+        case RA__NODE__BOOL_PREDICATE:
+        case RA__NODE__LIST:
+        case RA__NODE__IN_LIST:{
+            std::vector<Ra__Node*> args;
+            switch(it->node_case){
+                case RA__NODE__FUNC_CALL:{
+                    auto func_call = static_cast<Ra__Node__Func_Call*>(it);
+                    if(func_call->is_aggregating || func_call->is_window){
+                        return false;
+                    }
+                    args = func_call->args;
+                    break;
+                }
+                case RA__NODE__BOOL_PREDICATE: args = static_cast<Ra__Node__Bool_Predicate*>(it)->args; break;
+                case RA__NODE__LIST: args = static_cast<Ra__Node__List*>(it)->args; break;
+                default: args = static_cast<Ra__Node__In_List*>(it)->args; break;
+            }
+            for(auto arg: args){
+                if(!collect_predicate_attributes(arg, attributes)){
+                    return false;
+                }
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+
+void RaTree::convert_correlated_aggregates_to_windows(){
+    std::vector<std::pair<Ra__Node*, Ra__Node*>> markers_joins;
+    find_subquery_markers(root, markers_joins, {RA__JOIN__DEPENDENT_INNER_LEFT});
+    find_joins_by_markers(root, markers_joins);
+
+    // most nested subqueries first
+    for(int i=markers_joins.size()-1; i>=0; i--){
+        assert(markers_joins[i].second!=nullptr);
+        convert_correlated_aggregate_to_window(markers_joins[i]);
+    }
+}
+
+bool RaTree::convert_correlated_aggregate_to_window(std::pair<Ra__Node*, Ra__Node*> marker_join){
+    auto marker = static_cast<Ra__Node__Where_Subquery_Marker*>(marker_join.first);
+    auto dep_join = static_cast<Ra__Node__Join*>(marker_join.second);
+
+    // subquery: Π(aggregate expression)(Γ()(inner block))
+    if(dep_join->childNodes[1]->node_case!=RA__NODE__PROJECTION){
+        return false;
+    }
+    auto subquery = static_cast<Ra__Node__Projection*>(dep_join->childNodes[1]);
+    if(subquery->args.size()!=1 || subquery->args[0]->node_case!=RA__NODE__SELECT_EXPRESSION
+        || subquery->childNodes[0]->node_case!=RA__NODE__GROUP_BY){
+        return false;
+    }
+    auto group_by = static_cast<Ra__Node__Group_By*>(subquery->childNodes[0]);
+    if(!group_by->args.empty()){
+        return false;
+    }
+    Window__Block inner;
+    Window__Block outer;
+    if(!collect_window_block(group_by->childNodes[0], inner) || !collect_window_block(dep_join->childNodes[0], outer)){
+        return false;
+    }
+
+    // index of the relation an attribute refers to, -1 if it is not one of the relations
+    auto resolve = [&](Ra__Node__Attribute* attr, const std::vector<std::pair<Ra__Symbol,Ra__Symbol>>& relations){
+        int found = -1;
+        for(size_t i=0; i<relations.size(); i++){
+            bool refers = attr->alias.empty() ? is_catalog_attribute(attr->name, relations[i].first)
+                : (relations[i].second.empty() ? relations[i].first==attr->alias : relations[i].second==attr->alias);
+            if(refers){
+                // unqualified attribute of several relations is ambiguous
+                if(found>=0){
+                    return -1;
+                }
+                found = i;
+            }
+        }
+        return found;
+    };
+
+    // every inner relation is the image of the only outer relation of the same table
+    std::vector<int> image(inner.relations.size(), -1);
+    for(size_t i=0; i<inner.relations.size(); i++){
+        for(size_t j=0; j<outer.relations.size(); j++){
+            if(outer.relations[j].first==inner.relations[i].first){
+                if(image[i]>=0){
+                    return false;
+                }
+                image[i] = j;
+            }
+        }
+        if(image[i]<0 || std::count(image.begin(), image.begin()+i, image[i])>0){
+            return false;
+        }
+    }
+    auto is_image = [&](int outer_relation){
+        return outer_relation>=0 && std::find(image.begin(), image.end(), outer_relation)!=image.end();
+    };
+
+    // structural equality of an outer and an inner predicate, inner attributes are compared by their image
+    std::function<bool(Ra__Node*, Ra__Node*)> is_image_predicate = [&](Ra__Node* o, Ra__Node* i){
+        if(o==nullptr || i==nullptr){
+            return o==i;
+        }
+        if(o->node_case!=i->node_case){
+            return false;
+        }
+        auto same_args = [&](const std::vector<Ra__Node*>& o_args, const std::vector<Ra__Node*>& i_args){
+            if(o_args.size()!=i_args.size()){
+                return false;
+            }
+            for(size_t k=0; k<o_args.size(); k++){
+                if(!is_image_predicate(o_args[k], i_args[k])){
+                    return false;
+                }
+            }
+            return true;
+        };
+        switch(o->node_case){
+            case RA__NODE__ATTRIBUTE:{
+                auto o_attr = static_cast<Ra__Node__Attribute*>(o);
+                auto i_attr = static_cast<Ra__Node__Attribute*>(i);
+                int i_relation = resolve(i_attr, inner.relations);
+                return o_attr->name==i_attr->name && i_relation>=0 && resolve(o_attr, outer.relations)==image[i_relation];
+            }
+            case RA__NODE__CONST:{
+                auto o_const = static_cast<Ra__Node__Constant*>(o);
+                auto i_const = static_cast<Ra__Node__Constant*>(i);
+                return o_const->data==i_const->data && o_const->dataType==i_const->dataType;
+            }
+            case RA__NODE__EXPRESSION:{
+                auto o_expr = static_cast<Ra__Node__Expression*>(o);
+                auto i_expr = static_cast<Ra__Node__Expression*>(i);
+                return o_expr->operator_==i_expr->operator_ && is_image_predicate(o_expr->l_arg, i_expr->l_arg) && is_image_predicate(o_expr->r_arg, i_expr->r_arg);
+            }
+            case RA__NODE__TYPE_CAST:{
+                auto o_cast = static_cast<Ra__Node__Type_Cast*>(o);
+                auto i_cast = static_cast<Ra__Node__Type_Cast*>(i);
+                return o_cast->type==i_cast->type && o_cast->typ_mod==i_cast->typ_mod && is_image_predicate(o_cast->expression, i_cast->expression);
+            }
+            case RA__NODE__PREDICATE:{
+                auto o_p = static_cast<Ra__Node__Predicate*>(o);
+                auto i_p = static_cast<Ra__Node__Predicate*>(i);
+                if(o_p->binaryOperator!=i_p->binaryOperator){
+                    return false;
+                }
+                return (is_image_predicate(o_p->left, i_p->left) && is_image_predicate(o_p->right, i_p->right))
+                    || (o_p->binaryOperator=="=" && is_image_predicate(o_p->left, i_p->right) && is_image_predicate(o_p->right, i_p->left));
+            }
+            case RA__NODE__NULL_TEST:{
+                auto o_test = static_cast<Ra__Node__Null_Test*>(o);
+                auto i_test = static_cast<Ra__Node__Null_Test*>(i);
+                return o_test->type==i_test->type && is_image_predicate(o_test->arg, i_test->arg);
+            }
+            case RA__NODE__FUNC_CALL:{
+                auto o_func = static_cast<Ra__Node__Func_Call*>(o);
+                auto i_func = static_cast<Ra__Node__Func_Call*>(i);
+                return o_func->func_name==i_func->func_name && !o_func->is_aggregating && !i_func->is_aggregating && same_args(o_func->args, i_func->args);
+            }
+            case RA__NODE__BOOL_PREDICATE:{
+                auto o_bool = static_cast<Ra__Node__Bool_Predicate*>(o);
+                auto i_bool = static_cast<Ra__Node__Bool_Predicate*>(i);
+                return o_bool->bool_operator==i_bool->bool_operator && same_args(o_bool->args, i_bool->args);
+            }
+            case RA__NODE__LIST: return same_args(static_cast<Ra__Node__List*>(o)->args, static_cast<Ra__Node__List*>(i)->args);
+            case RA__NODE__IN_LIST: return same_args(static_cast<Ra__Node__In_List*>(o)->args, static_cast<Ra__Node__In_List*>(i)->args);
+            default: return false;
+        }
+    };
+
+    // inner predicates are correlating (inner attribute = outer attribute) or have an image in the outer block
+    std::vector<Ra__Node__Attribute*> keys;
+    std::vector<Ra__Node__Attribute*> key_bindings;
+    std::vector<Ra__Node*> image_predicates;
+    for(auto predicate: inner.predicates){
+        std::vector<Ra__Node__Attribute*> attributes;
+        if(!collect_predicate_attributes(predicate, attributes)){
+            return false;
+        }
+        bool correlating = std::any_of(attributes.begin(), attributes.end(), [&](Ra__Node__Attribute* attr){
+            return resolve(attr, inner.relations)<0;
+        });
+        if(!correlating){
+            auto found = std::find_if(outer.predicates.begin(), outer.predicates.end(), [&](Ra__Node* outer_predicate){
+                return is_image_predicate(outer_predicate, predicate);
+            });
+            if(found==outer.predicates.end()){
+                return false;
+            }
+            image_predicates.push_back(*found);
+            continue;
+        }
+        auto p = static_cast<Ra__Node__Predicate*>(predicate);
+        if(predicate->node_case!=RA__NODE__PREDICATE || p->binaryOperator!="="
+            || p->left->node_case!=RA__NODE__ATTRIBUTE || p->right->node_case!=RA__NODE__ATTRIBUTE){
+            return false;
+        }
+        auto left = static_cast<Ra__Node__Attribute*>(p->left);
+        auto right = static_cast<Ra__Node__Attribute*>(p->right);
+        bool left_inner = resolve(left, inner.relations)>=0;
+        auto key = left_inner ? left : right;
+        auto binding = left_inner ? right : left;
+        if(resolve(key, inner.relations)<0 || resolve(binding, outer.relations)<0){
+            return false;
+        }
+        keys.push_back(key);
+        key_bindings.push_back(binding);
+    }
+    if(keys.empty()){
+        return false;
+    }
+
+    // image of a key in the outer block: (relation, name)
+    auto key_image = [&](Ra__Node__Attribute* key){
+        return std::pair<int,Ra__Symbol>(image[resolve(key, inner.relations)], key->name);
+    };
+    auto is_key_image = [&](Ra__Node__Attribute* attr){
+        auto attr_image = std::pair<int,Ra__Symbol>(resolve(attr, outer.relations), attr->name);
+        return std::any_of(keys.begin(), keys.end(), [&](Ra__Node__Attribute* key){ return key_image(key)==attr_image; });
+    };
+
+    // the outer attribute a key is bound to equals the key's image, so each outer row's partition holds the subquery's rows
+    for(size_t k=0; k<keys.size(); k++){
+        auto binding = std::pair<int,Ra__Symbol>(resolve(key_bindings[k], outer.relations), key_bindings[k]->name);
+        if(binding==key_image(keys[k])){
+            continue;
+        }
+        bool bound = std::any_of(outer.predicates.begin(), outer.predicates.end(), [&](Ra__Node* predicate){
+            auto p = static_cast<Ra__Node__Predicate*>(predicate);
+            if(predicate->node_case!=RA__NODE__PREDICATE || p->binaryOperator!="="
+                || p->left->node_case!=RA__NODE__ATTRIBUTE || p->right->node_case!=RA__NODE__ATTRIBUTE){
+                return false;
+            }
+            auto left = static_cast<Ra__Node__Attribute*>(p->left);
+            auto right = static_cast<Ra__Node__Attribute*>(p->right);
+            auto left_ref = std::pair<int,Ra__Symbol>(resolve(left, outer.relations), left->name);
+            auto right_ref = std::pair<int,Ra__Symbol>(resolve(right, outer.relations), right->name);
+            return (left_ref==binding && right_ref==key_image(keys[k])) || (right_ref==binding && left_ref==key_image(keys[k]));
+        });
+        if(!bound){
+            return false;
+        }
+    }
+
+    // other outer predicates filter the image relations by their keys only, they remove whole partitions
+    for(auto predicate: outer.predicates){
+        if(std::find(image_predicates.begin(), image_predicates.end(), predicate)!=image_predicates.end()){
+            continue;
+        }
+        std::vector<Ra__Node__Attribute*> attributes;
+        if(!collect_predicate_attributes(predicate, attributes)){
+            return false;
+        }
+        for(auto attr: attributes){
+            int relation = resolve(attr, outer.relations);
+            if(is_image(relation) && !is_key_image(attr)){
+                return false;
+            }
+            if(relation<0 && attr->alias.empty()){
+                for(size_t i=0; i<image.size(); i++){
+                    if(is_catalog_attribute(attr->name, outer.relations[image[i]].first)){
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    // aggregates over the rows of a partition, attributes are only used as aggregate arguments
+    std::vector<Ra__Node__Func_Call*> aggregates;
+    std::vector<Ra__Node__Attribute*> aggregate_attributes;
+    std::function<bool(Ra__Node*, bool)> check_expression = [&](Ra__Node* it, bool in_aggregate){
+        if(it==nullptr){
+            return true;
+        }
+        switch(it->node_case){
+            case RA__NODE__ATTRIBUTE:{
+                auto attr = static_cast<Ra__Node__Attribute*>(it);
+                if(in_aggregate && attr->name.str()=="*"){
+                    return true;
+                }
+                if(!in_aggregate || resolve(attr, inner.relations)<0){
+                    return false;
+                }
+                aggregate_attributes.push_back(attr);
+                return true;
+            }
+            case RA__NODE__CONST: return true;
+            case RA__NODE__EXPRESSION:{
+                auto expr = static_cast<Ra__Node__Expression*>(it);
+                return check_expression(expr->l_arg, in_aggregate) && check_expression(expr->r_arg, in_aggregate);
+            }
+            case RA__NODE__TYPE_CAST: return check_expression(static_cast<Ra__Node__Type_Cast*>(it)->expression, in_aggregate);
+            case RA__NODE__FUNC_CALL:{
+                auto func_call = static_cast<Ra__Node__Func_Call*>(it);
+                if(func_call->is_window){
+                    return false;
+                }
+                if(func_call->is_aggregating){
+                    if(in_aggregate || func_call->agg_distinct
+                        || (func_call->func_name!="min" && func_call->func_name!="max" && func_call->func_name!="avg"
+                            && func_call->func_name!="sum" && func_call->func_name!="count")){
+                        return false;
+                    }
+                    aggregates.push_back(func_call);
+                }
+                for(auto arg: func_call->args){
+                    if(!check_expression(arg, in_aggregate || func_call->is_aggregating)){
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default: return false;
+        }
+    };
+    auto sel_expr = static_cast<Ra__Node__Select_Expression*>(subquery->args[0]);
+    if(!check_expression(sel_expr->expression, false) || aggregates.empty()){
+        return false;
+    }
+
+    // min, max and avg do not change if the other outer relations repeat every row of a partition the same number of times,
+    // sum and count do: each other relation has to join at most one row, its unique key is equated to constants,
+    // to keys of the image relations or to attributes of other relations joining one row
+    bool counts_rows = std::any_of(aggregates.begin(), aggregates.end(), [](Ra__Node__Func_Call* aggregate){
+        return aggregate->func_name=="sum" || aggregate->func_name=="count";
+    });
+    if(counts_rows){
+        std::vector<bool> joins_one_row(outer.relations.size());
+        for(size_t j=0; j<outer.relations.size(); j++){
+            joins_one_row[j] = is_image(j);
+        }
+        auto is_fixed = [&](Ra__Node* arg){
+            if(arg->node_case==RA__NODE__CONST){
+                return true;
+            }
+            if(arg->node_case!=RA__NODE__ATTRIBUTE){
+                return false;
+            }
+            int relation = resolve(static_cast<Ra__Node__Attribute*>(arg), outer.relations);
+            return relation>=0 && joins_one_row[relation];
+        };
+        bool changed = true;
+        while(changed){
+            changed = false;
+            for(size_t j=0; j<outer.relations.size(); j++){
+                if(joins_one_row[j]){
+                    continue;
+                }
+                bool is_cte = std::any_of(ctes.begin(), ctes.end(), [&](Ra__Node* cte){
+                    return static_cast<Ra__Node__Projection*>(cte)->subquery_alias==outer.relations[j].first;
+                });
+                const Ra__Catalog__Table* table = is_cte ? nullptr : catalog->find_table(outer.relations[j].first.str());
+                if(table==nullptr){
+                    continue;
+                }
+                std::set<size_t> equated_columns;
+                for(auto predicate: outer.predicates){
+                    auto p = static_cast<Ra__Node__Predicate*>(predicate);
+                    if(predicate->node_case!=RA__NODE__PREDICATE || p->binaryOperator!="="){
+                        continue;
+                    }
+                    for(auto [column, other]: {std::make_pair(p->left, p->right), std::make_pair(p->right, p->left)}){
+                        if(column->node_case==RA__NODE__ATTRIBUTE && resolve(static_cast<Ra__Node__Attribute*>(column), outer.relations)==(int) j && is_fixed(other)){
+                            int64_t index = table->column_index(static_cast<Ra__Node__Attribute*>(column)->name.str());
+                            if(index>=0){
+                                equated_columns.insert(index);
+                            }
+                        }
+                    }
+                }
+                auto is_equated = [&](const std::vector<size_t>& key){
+                    return !key.empty() && std::all_of(key.begin(), key.end(), [&](size_t c){ return equated_columns.count(c)>0; });
+                };
+                if(is_equated(table->primary_key) || std::any_of(table->unique_keys.begin(), table->unique_keys.end(), is_equated)){
+                    joins_one_row[j] = true;
+                    changed = true;
+                }
+            }
+        }
+        if(std::find(joins_one_row.begin(), joins_one_row.end(), false)!=joins_one_row.end()){
+            return false;
+        }
+    }
+
+    // query block of the dependent join: nodes up to the first projection
+    std::vector<std::pair<Ra__Node*,int>> ancestors;
+    Ra__Node* child = dep_join;
+    while(true){
+        Ra__Node* parent = root;
+        int child_index = -1;
+        if(child==root || !get_node_parent(parent, child, child_index)){
+            return false;
+        }
+        ancestors.push_back({parent, child_index});
+        if(parent->node_case==RA__NODE__PROJECTION){
+            break;
+        }
+        child = parent;
+    }
+    Ra__Node* block = ancestors.back().first;
+
+    // other subqueries of the block and relations with the same names would see the renamed attributes
+    std::vector<std::pair<Ra__Symbol,Ra__Symbol>> block_relations;
+    get_relations_aliases(block->childNodes[0], block_relations);
+    for(const auto& relation: outer.relations){
+        Ra__Symbol qualifier = relation.second.empty() ? relation.first : relation.second;
+        if(std::count_if(block_relations.begin(), block_relations.end(), [&](const std::pair<Ra__Symbol,Ra__Symbol>& block_relation){
+            return (block_relation.second.empty() ? block_relation.first : block_relation.second)==qualifier;
+        })!=1){
+            return false;
+        }
+    }
+    std::function<bool(Ra__Node*)> has_other_subquery = [&](Ra__Node* it){
+        if(it==dep_join){
+            return false;
+        }
+        if(it->node_case==RA__NODE__JOIN && static_cast<Ra__Node__Join*>(it)->right_where_subquery_marker->marker!=0){
+            return true;
+        }
+        return std::any_of(it->childNodes.begin(), it->childNodes.end(), has_other_subquery);
+    };
+    if(has_other_subquery(block->childNodes[0])){
+        return false;
+    }
+
+    // attributes of the outer relations used above the dependent join are output by the window projection
+    std::vector<Ra__Symbol> qualifiers;
+    for(const auto& relation: outer.relations){
+        qualifiers.push_back(relation.first);
+        if(!relation.second.empty()){
+            qualifiers.push_back(relation.second);
+        }
+    }
+    std::vector<Ra__Node*> exported;
+    find_attributes_using_alias(block, qualifiers, exported, dep_join, false);
+    std::vector<Ra__Node__Attribute*> columns;
+    for(auto node: exported){
+        auto attr = static_cast<Ra__Node__Attribute*>(node);
+        int relation = resolve(attr, outer.relations);
+        if(relation<0){
+            return false;
+        }
+        auto same_name = std::find_if(columns.begin(), columns.end(), [&](Ra__Node__Attribute* column){ return column->name==attr->name; });
+        if(same_name==columns.end()){
+            columns.push_back(attr);
+        }
+        // the window projection has one column per name
+        else if(resolve(*same_name, outer.relations)!=relation){
+            return false;
+        }
+    }
+
+    // outer attribute for an attribute of the subquery: qualified by the image relation if it was qualified
+    // or if its name is ambiguous in the outer block
+    auto outer_attribute = [&](Ra__Node__Attribute* attr){
+        auto relation = outer.relations[image[resolve(attr, inner.relations)]];
+        auto outer_attr = arena->make<Ra__Node__Attribute>(attr->name);
+        if(!attr->alias.empty() || resolve(outer_attr, outer.relations)<0){
+            outer_attr->alias = relation.second.empty() ? relation.first : relation.second;
+        }
+        return outer_attr;
+    };
+
+    // Π_{columns, aggregate over (partition by keys) as m}(outer)
+    Ra__Symbol window_alias = symbols->intern("t" + std::to_string(counter++));
+    auto window_projection = arena->make<Ra__Node__Projection>();
+    window_projection->subquery_alias = window_alias;
+    for(auto column: columns){
+        window_projection->args.push_back(arena->make<Ra__Node__Select_Expression>(arena->make<Ra__Node__Attribute>(column->name, column->alias)));
+    }
+    for(auto attr: aggregate_attributes){
+        auto outer_attr = outer_attribute(attr);
+        attr->alias = outer_attr->alias;
+    }
+    for(auto aggregate: aggregates){
+        aggregate->is_window = true;
+        for(auto key: keys){
+            aggregate->window_partition.push_back(outer_attribute(key));
+        }
+    }
+    auto window_expression = arena->make<Ra__Node__Select_Expression>(sel_expr->expression);
+    window_expression->rename = "m";
+    window_projection->args.push_back(window_expression);
+
+    Ra__Node* outer_root = dep_join->childNodes[0];
+    ancestors.front().first->set_child(ancestors.front().second, window_projection);
+    window_projection->add_child(outer_root);
+    dep_join->clear_children();
+
+    for(auto node: exported){
+        static_cast<Ra__Node__Attribute*>(node)->alias = window_alias;
+    }
+    Ra__Node* marker_parent = root;
+    int child_index = -1;
+    bool found_marker = find_marker_parent(marker_parent, marker, child_index);
+    assert(found_marker);
+    replace_subquery_marker(marker_parent, child_index, arena->make<Ra__Node__Attribute>(symbols->intern("m"), window_alias));
+    return true;
+}
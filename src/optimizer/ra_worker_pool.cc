@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include "ra_worker_pool.h"
+
+RaWorkerPool::RaWorkerPool(size_t n_threads, RaPlanCache& _cache, std::function<void(Ra__Worker_Pool__Result&)> _deliver, size_t _max_pending):
+    cache(_cache), deliver(std::move(_deliver)), max_pending(_max_pending>0 ? _max_pending : 64*std::max<size_t>(n_threads, 1))
+{
+    for(size_t i=0; i<std::max<size_t>(n_threads, 1); i++){
+        workers.emplace_back(&RaWorkerPool::run_worker, this);
+    }
+}
+
+RaWorkerPool::~RaWorkerPool(){
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    statement_submitted.notify_all();
+    for(auto& worker: workers){
+        worker.join();
+    }
+}
+
+void RaWorkerPool::submit(std::string statement){
+    std::unique_lock<std::mutex> lock(mutex);
+    results_delivered.wait(lock, [&](){ return slots.size()<max_pending; });
+    Slot slot;
+    slot.statement = std::move(statement);
+    slot.result.sequence = n_submitted++;
+    slots.push_back(std::move(slot));
+    lock.unlock();
+    statement_submitted.notify_one();
+}
+
+void RaWorkerPool::wait(){
+    std::unique_lock<std::mutex> lock(mutex);
+    results_delivered.wait(lock, [&](){ return slots.empty() && !delivering; });
+}
+
+void RaWorkerPool::run_worker(){
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;){
+        statement_submitted.wait(lock, [&](){ return stopping || next_statement<n_submitted; });
+        if(next_statement==n_submitted){
+            break;
+        }
+        uint64_t sequence = next_statement++;
+        std::string statement = std::move(slots[sequence-first_pending].statement);
+        lock.unlock();
+
+        Ra__Worker_Pool__Result result;
+        result.sequence = sequence;
+        auto start = std::chrono::steady_clock::now();
+        result.optimized = cache.optimize(statement.c_str(), result.sql, &result.cached);
+        auto end = std::chrono::steady_clock::now();
+        result.optimize_us = std::chrono::duration<double, std::micro>(end-start).count();
+        if(!result.optimized){
+            result.sql = std::move(statement);
+        }
+
+        lock.lock();
+        // slots before sequence are only removed once delivered, the slot of sequence is still there
+        Slot& slot = slots[sequence-first_pending];
+        slot.result = std::move(result);
+        slot.done = true;
+        if(sequence==first_pending && !delivering){
+            deliver_done(lock);
+        }
+    }
+    // the pg_query memory contexts of this thread are freed by pg_query on thread exit
+}
+
+void RaWorkerPool::deliver_done(std::unique_lock<std::mutex>& lock){
+    delivering = true;
+    while(!slots.empty() && slots.front().done){
+        Ra__Worker_Pool__Result result = std::move(slots.front().result);
+        slots.pop_front();
+        first_pending++;
+        lock.unlock();
+        deliver(result);
+        lock.lock();
+    }
+    delivering = false;
+    results_delivered.notify_all();
+}
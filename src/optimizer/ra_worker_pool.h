@@ -0,0 +1,106 @@
+#ifndef ra_worker_pool
+#define ra_worker_pool
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "ra_plan_cache.h"
+
+struct Ra__Worker_Pool__Result {
+    /// position of the statement in submission order, starting at 0
+    uint64_t sequence = 0;
+    /// optimized SQL, the statement itself if it could not be optimized
+    std::string sql;
+    bool optimized = false;
+    /// true if sql was filled from a cached template
+    bool cached = false;
+    double optimize_us = 0;
+};
+
+/**
+ * Optimizes statements on a fixed number of threads.
+ * Every worker runs its own SQLtoRA/RaTree/RAtoSQL pipeline (through the shared, thread-safe plan cache),
+ * the only shared state besides the cache is the queue of statements.
+ * Results are delivered in submission order to a callback, called by one worker at a time.
+ * At most max_pending statements are queued or waiting for delivery, submit blocks while the limit is reached.
+ */
+class RaWorkerPool {
+    public:
+        /**
+         * @param n_threads number of worker threads
+         * @param _cache plan cache used by all workers, capacity 0 to optimize every statement
+         * @param _deliver called with every result in submission order, never concurrently
+         * @param _max_pending maximum number of submitted but not yet delivered statements, 0 for 64 per thread
+         */
+        RaWorkerPool(size_t n_threads, RaPlanCache& _cache, std::function<void(Ra__Worker_Pool__Result&)> _deliver, size_t _max_pending=0);
+
+        RaWorkerPool(const RaWorkerPool&) = delete;
+        RaWorkerPool& operator=(const RaWorkerPool&) = delete;
+
+        /**
+         * Waits for all submitted statements to be delivered and stops the workers
+         */
+        ~RaWorkerPool();
+
+        /**
+         * Queues a statement for optimization, blocks while max_pending statements are pending
+         *
+         * @param statement SQL statement
+         */
+        void submit(std::string statement);
+
+        /**
+         * Blocks until all submitted statements are delivered
+         */
+        void wait();
+
+    private:
+        struct Slot {
+            std::string statement;
+            Ra__Worker_Pool__Result result;
+            bool done = false;
+        };
+
+        RaPlanCache& cache;
+        std::function<void(Ra__Worker_Pool__Result&)> deliver;
+        size_t max_pending;
+
+        /// guards all members below
+        std::mutex mutex;
+        /// signaled when a statement is submitted or the pool stops
+        std::condition_variable statement_submitted;
+        /// signaled when results are delivered
+        std::condition_variable results_delivered;
+
+        /// submitted, not yet delivered statements, slots[i] has sequence first_pending+i
+        std::deque<Slot> slots;
+        uint64_t first_pending = 0;
+        /// sequence of the next statement to be taken by a worker
+        uint64_t next_statement = 0;
+        uint64_t n_submitted = 0;
+        /// true while a worker delivers results, keeps the callback calls ordered and sequential
+        bool delivering = false;
+        bool stopping = false;
+
+        std::vector<std::thread> workers;
+
+        /**
+         * Takes statements from the queue until the pool stops
+         */
+        void run_worker();
+
+        /**
+         * Delivers all results at the front of slots which are done, called with mutex locked
+         *
+         * @param lock lock of mutex, released while calling the callback
+         */
+        void deliver_done(std::unique_lock<std::mutex>& lock);
+};
+
+#endif
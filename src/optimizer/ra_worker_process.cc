@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include "ra_worker_process.h"
+
+// messages from the child: a header followed by length bytes, the SQL of a result or the cache counters
+struct Ra__Worker_Process__Header {
+    char kind;
+    bool optimized;
+    bool cached;
+    double optimize_us;
+    uint64_t length;
+};
+
+static const char result_message = 'R';
+static const char stats_message = 'S';
+
+static bool write_all(int fd, const char* data, size_t size){
+    while(size>0){
+        ssize_t written = write(fd, data, size);
+        if(written<0){
+            if(errno==EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static void append_bytes(std::string& message, const void* data, size_t size){
+    message.append(static_cast<const char*>(data), size);
+}
+
+RaWorkerProcess::RaWorkerProcess(size_t _n_threads, RaPlanCache& _cache, std::function<void(Ra__Worker_Pool__Result&)> _deliver, size_t _max_pending):
+    n_threads(std::max<size_t>(_n_threads, 1)), cache(_cache), deliver(std::move(_deliver)),
+    max_pending(_max_pending>0 ? _max_pending : 64*std::max<size_t>(_n_threads, 1))
+{
+    // a dead child must not end the parent when it writes the next statement
+    signal(SIGPIPE, SIG_IGN);
+    start_child();
+}
+
+RaWorkerProcess::~RaWorkerProcess(){
+    stop();
+}
+
+void RaWorkerProcess::stop(){
+    wait();
+    if(child>0){
+        stop_child();
+    }
+}
+
+const Ra__Plan_Cache__Stats& RaWorkerProcess::cache_stats() const{
+    return stats;
+}
+
+bool RaWorkerProcess::start_child(){
+    int statements[2];
+    int results[2];
+    if(pipe(statements)!=0){
+        std::cerr << "could not start the optimizer process: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if(pipe(results)!=0){
+        std::cerr << "could not start the optimizer process: " << strerror(errno) << std::endl;
+        close(statements[0]);
+        close(statements[1]);
+        return false;
+    }
+    // buffered output would be written twice otherwise
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if(pid<0){
+        std::cerr << "could not start the optimizer process: " << strerror(errno) << std::endl;
+        for(int fd: {statements[0], statements[1], results[0], results[1]}){
+            close(fd);
+        }
+        return false;
+    }
+    if(pid==0){
+        close(statements[1]);
+        close(results[0]);
+        run_child(statements[0], results[1]);
+    }
+    close(statements[0]);
+    close(results[1]);
+    child = pid;
+    to_child = statements[1];
+    from_child = results[0];
+    received.clear();
+    return true;
+}
+
+void RaWorkerProcess::run_child(int input, int output){
+    {
+        RaWorkerPool pool(n_threads, cache, [&](Ra__Worker_Pool__Result& result){
+            Ra__Worker_Process__Header header = {result_message, result.optimized, result.cached, result.optimize_us, result.sql.size()};
+            std::string message;
+            append_bytes(message, &header, sizeof(header));
+            message += result.sql;
+            write_all(output, message.data(), message.size());
+        }, max_pending);
+
+        // statements are a length followed by the SQL
+        std::string buffer;
+        char chunk[65536];
+        for(;;){
+            ssize_t n = read(input, chunk, sizeof(chunk));
+            if(n<0 && errno==EINTR){
+                continue;
+            }
+            if(n<=0){
+                break;
+            }
+            buffer.append(chunk, n);
+            size_t offset = 0;
+            uint64_t length;
+            while(buffer.size()-offset>=sizeof(length)){
+                memcpy(&length, buffer.data()+offset, sizeof(length));
+                if(buffer.size()-offset-sizeof(length)<length){
+                    break;
+                }
+                pool.submit(buffer.substr(offset+sizeof(length), length));
+                offset += sizeof(length)+length;
+            }
+            buffer.erase(0, offset);
+        }
+    }
+    Ra__Plan_Cache__Stats cache_stats = cache.stats();
+    Ra__Worker_Process__Header header = {stats_message, false, false, 0, sizeof(cache_stats)};
+    std::string message;
+    append_bytes(message, &header, sizeof(header));
+    append_bytes(message, &cache_stats, sizeof(cache_stats));
+    write_all(output, message.data(), message.size());
+    // exit without running destructors and atexit handlers of the parent's state
+    _exit(0);
+}
+
+int RaWorkerProcess::stop_child(){
+    close(to_child);
+    // the cache counters arrive once the child has read all statements
+    while(receive()){
+    }
+    close(from_child);
+    int status = 0;
+    while(waitpid(child, &status, 0)<0 && errno==EINTR){
+    }
+    child = -1;
+    to_child = -1;
+    from_child = -1;
+    return status;
+}
+
+void RaWorkerProcess::submit(std::string statement){
+    pending.push_back({n_submitted++, std::move(statement)});
+    if(child<0 || !send(pending.back())){
+        recover();
+        return;
+    }
+    while(pending.size()>=max_pending){
+        if(!receive()){
+            recover();
+        }
+    }
+}
+
+void RaWorkerProcess::wait(){
+    while(!pending.empty()){
+        if(child<0 || !receive()){
+            recover();
+        }
+    }
+}
+
+bool RaWorkerProcess::send(const Pending& statement){
+    std::string message;
+    uint64_t length = statement.statement.size();
+    append_bytes(message, &length, sizeof(length));
+    message += statement.statement;
+
+    // the child blocks on writing results if they are not read, so results are read while writing
+    size_t offset = 0;
+    while(offset<message.size()){
+        struct pollfd fds[2] = {{to_child, POLLOUT, 0}, {from_child, POLLIN, 0}};
+        if(poll(fds, 2, -1)<0){
+            if(errno==EINTR){
+                continue;
+            }
+            return false;
+        }
+        if(fds[1].revents!=0 && !receive()){
+            return false;
+        }
+        if(fds[0].revents & (POLLERR | POLLHUP)){
+            return false;
+        }
+        if(fds[0].revents & POLLOUT){
+            ssize_t written = write(to_child, message.data()+offset, message.size()-offset);
+            if(written<0){
+                if(errno==EINTR || errno==EAGAIN){
+                    continue;
+                }
+                return false;
+            }
+            offset += written;
+        }
+    }
+    return true;
+}
+
+bool RaWorkerProcess::receive(){
+    char chunk[65536];
+    ssize_t n;
+    do{
+        n = read(from_child, chunk, sizeof(chunk));
+    } while(n<0 && errno==EINTR);
+    if(n<=0){
+        return false;
+    }
+    received.append(chunk, n);
+
+    size_t offset = 0;
+    Ra__Worker_Process__Header header;
+    while(received.size()-offset>=sizeof(header)){
+        memcpy(&header, received.data()+offset, sizeof(header));
+        if(received.size()-offset-sizeof(header)<header.length){
+            break;
+        }
+        const char* payload = received.data()+offset+sizeof(header);
+        if(header.kind==stats_message){
+            Ra__Plan_Cache__Stats cache_stats;
+            memcpy(&cache_stats, payload, sizeof(cache_stats));
+            stats.hits += cache_stats.hits;
+            stats.misses += cache_stats.misses;
+            stats.uncacheable += cache_stats.uncacheable;
+            stats.evictions += cache_stats.evictions;
+            stats.entries = cache_stats.entries;
+        }
+        else if(!pending.empty()){
+            Ra__Worker_Pool__Result result;
+            result.sequence = pending.front().sequence;
+            result.sql.assign(payload, header.length);
+            result.optimized = header.optimized;
+            result.cached = header.cached;
+            result.optimize_us = header.optimize_us;
+            pending.pop_front();
+            deliver(result);
+        }
+        offset += sizeof(header)+header.length;
+    }
+    received.erase(0, offset);
+    return true;
+}
+
+void RaWorkerProcess::recover(){
+    if(child>0){
+        stop_child();
+    }
+    // the statement the child died on is one of the unanswered ones, each of them gets its own child now
+    std::deque<Pending> retry;
+    retry.swap(pending);
+    for(auto& statement: retry){
+        pending.push_back(std::move(statement));
+        bool answered = (child>0 || start_child()) && send(pending.back());
+        while(answered && !pending.empty()){
+            answered = receive();
+        }
+        if(answered){
+            continue;
+        }
+
+        int status = child>0 ? stop_child() : 0;
+        if(pending.empty()){
+            // the result arrived after all
+            continue;
+        }
+        Ra__Worker_Pool__Result result;
+        result.sequence = pending.front().sequence;
+        result.sql = std::move(pending.front().statement);
+        pending.clear();
+        std::cerr << "statement " << result.sequence+1 << " stopped the optimizer";
+        if(WIFSIGNALED(status)){
+            std::cerr << " (" << strsignal(WTERMSIG(status)) << ")";
+        }
+        std::cerr << ", written unchanged" << std::endl;
+        deliver(result);
+    }
+    if(child<0){
+        start_child();
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef ra_worker_process
+#define ra_worker_process
+
+#include <string>
+#include <deque>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+#include "ra_plan_cache.h"
+#include "ra_worker_pool.h"
+
+/**
+ * Runs a RaWorkerPool in a child process, so that a statement which crashes the optimizer (assertion, segfault)
+ * does not end the whole batch.
+ * Statements are sent to the child through a pipe, results come back in submission order through another pipe.
+ * If the child dies, the statements it had not answered yet are optimized again one at a time, each in a new child,
+ * the statement the child dies on is delivered unchanged and the remaining ones are optimized normally.
+ * The plan cache lives in the child and starts empty again after a crash.
+ * Same interface as RaWorkerPool, must be created while the process has no other threads (fork).
+ */
+class RaWorkerProcess {
+    public:
+        /**
+         * @param _n_threads number of worker threads in the child
+         * @param _cache plan cache, copied into every child, the object itself stays unused
+         * @param _deliver called with every result in submission order
+         * @param _max_pending maximum number of submitted but not yet delivered statements, 0 for 64 per thread
+         */
+        RaWorkerProcess(size_t _n_threads, RaPlanCache& _cache, std::function<void(Ra__Worker_Pool__Result&)> _deliver, size_t _max_pending=0);
+
+        RaWorkerProcess(const RaWorkerProcess&) = delete;
+        RaWorkerProcess& operator=(const RaWorkerProcess&) = delete;
+
+        /**
+         * Waits for all submitted statements to be delivered and stops the child
+         */
+        ~RaWorkerProcess();
+
+        /**
+         * Sends a statement to the child, blocks while max_pending statements are pending
+         *
+         * @param statement SQL statement
+         */
+        void submit(std::string statement);
+
+        /**
+         * Blocks until all submitted statements are delivered
+         */
+        void wait();
+
+        /**
+         * Waits for all submitted statements to be delivered and ends the child, nothing can be submitted afterwards
+         */
+        void stop();
+
+        /**
+         * @return cache counters summed over all children which ended normally, complete after stop
+         */
+        const Ra__Plan_Cache__Stats& cache_stats() const;
+
+    private:
+        struct Pending {
+            uint64_t sequence;
+            std::string statement;
+        };
+
+        size_t n_threads;
+        RaPlanCache& cache;
+        std::function<void(Ra__Worker_Pool__Result&)> deliver;
+        size_t max_pending;
+
+        pid_t child = -1;
+        /// write end of the statement pipe, read end of the result pipe
+        int to_child = -1;
+        int from_child = -1;
+        /// bytes received from the child which do not form a complete message yet
+        std::string received;
+
+        /// statements sent to the child and not yet answered, in submission order
+        std::deque<Pending> pending;
+        uint64_t n_submitted = 0;
+        Ra__Plan_Cache__Stats stats;
+
+        /**
+         * Forks a new child, writes an error and returns false if that fails
+         */
+        bool start_child();
+
+        /**
+         * Optimizes the statements read from input and writes the results to output, runs in the child
+         */
+        [[noreturn]] void run_child(int input, int output);
+
+        /**
+         * Closes the pipes and reaps the child
+         *
+         * @return wait status of the child
+         */
+        int stop_child();
+
+        /**
+         * Writes a statement to the child, delivers results received meanwhile
+         *
+         * @return false if the child died
+         */
+        bool send(const Pending& statement);
+
+        /**
+         * Blocks until bytes from the child arrive and delivers the complete results
+         *
+         * @return false if the child died
+         */
+        bool receive();
+
+        /**
+         * Optimizes the pending statements one at a time after the child died
+         */
+        void recover();
+};
+
+#endif
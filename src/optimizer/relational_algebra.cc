@@ -1,15 +1,50 @@
 #include "relational_algebra.h"
+#include <functional>
 
 std::string Ra__Node::to_string() {
     return "";
 }
 
+std::string Ra__Node::estimates_to_string(){
+    if(estimated_rows<0){
+        return "";
+    }
+    char estimates[64];
+    snprintf(estimates, sizeof(estimates), "[rows=%.0f width=%.0f]", estimated_rows, estimated_width);
+    return estimates;
+}
+
 bool Ra__Node::is_full(){
     return n_children == childNodes.size();
 }
 
+void Ra__Node::set_child(size_t index, Ra__Node* child){
+    Ra__Node* old_child = childNodes[index];
+    if(old_child!=nullptr){
+        old_child->n_parents--;
+    }
+    childNodes[index] = child;
+    child->parent = this;
+    child->n_parents++;
+}
+
+void Ra__Node::add_child(Ra__Node* child){
+    childNodes.push_back(child);
+    child->parent = this;
+    child->n_parents++;
+}
+
+void Ra__Node::clear_children(){
+    for(auto child: childNodes){
+        if(child!=nullptr){
+            child->n_parents--;
+        }
+    }
+    childNodes.clear();
+}
+
 Ra__Node__Join::Ra__Node__Join(Ra__Join__JoinType _type, uint64_t r_marker)
-: type(_type),right_where_subquery_marker(new Ra__Node__Where_Subquery_Marker(r_marker,_type))
+: type(_type),right_where_subquery_marker(&where_subquery_marker),where_subquery_marker(r_marker,_type)
 {
     node_case = Ra__Node__NodeCase::RA__NODE__JOIN;
     n_children = 2;
@@ -23,6 +58,7 @@ std::string Ra__Node__Join::to_string(){
         case RA__JOIN__CROSS_PRODUCT: op = "X"; break;
         case RA__JOIN__INNER: op = "J"; break;
         case RA__JOIN__LEFT: op = "LJ"; break;
+        case RA__JOIN__FULL_OUTER: op = "FJ"; break;
         case RA__JOIN__DEPENDENT_INNER_LEFT: op = "LDJ"; break;
         case RA__JOIN__SEMI_LEFT: op = "SLJ"; break;
         case RA__JOIN__SEMI_LEFT_DEPENDENT: op = "SLDJ"; break;
@@ -34,7 +70,7 @@ std::string Ra__Node__Join::to_string(){
         case RA__JOIN__ANTI_IN_LEFT_DEPENDENT: op = "AILDJ"; break;
         default: op = "join op not supported";
     }
-    return "(" + childNodes[0]->to_string() + ")"+op+"(" + childNodes[1]->to_string() + ")";
+    return "(" + childNodes[0]->to_string() + ")"+op+estimates_to_string()+"(" + childNodes[1]->to_string() + ")";
 }
 
 std::string Ra__Node__Join::join_name(){
@@ -42,6 +78,7 @@ std::string Ra__Node__Join::join_name(){
         case RA__JOIN__DEPENDENT_INNER_LEFT:
         case RA__JOIN__INNER: return " join ";
         case RA__JOIN__LEFT: return " left join ";
+        case RA__JOIN__FULL_OUTER: return " full join ";
         default: return " join op not supported ";
     }
 }
@@ -50,11 +87,12 @@ Ra__Node__Projection::Ra__Node__Projection(){
     node_case = Ra__Node__NodeCase::RA__NODE__PROJECTION;
     n_children = 1;
     distinct = false;
+    cte_materialize = RA__CTE__MATERIALIZE_DEFAULT;
 }
 
 std::string Ra__Node__Projection::to_string(){
     assert(childNodes.size()==1);
-    return "\u03A0(" + childNodes[0]->to_string() + ")";
+    return "\u03A0" + estimates_to_string() + "(" + childNodes[0]->to_string() + ")";
 }
 
 Ra__Node__Selection::Ra__Node__Selection(){
@@ -65,10 +103,10 @@ Ra__Node__Selection::Ra__Node__Selection(){
 
 std::string Ra__Node__Selection::to_string(){
     assert(childNodes.size()==1);
-    return "\u03C3(" + childNodes[0]->to_string() + ")";
+    return "\u03C3" + estimates_to_string() + "(" + childNodes[0]->to_string() + ")";
 }
 
-Ra__Node__Relation::Ra__Node__Relation(std::string _name, std::string _alias)
+Ra__Node__Relation::Ra__Node__Relation(Ra__Symbol _name, Ra__Symbol _alias)
 :name(_name),alias(_alias){
     node_case = Ra__Node__NodeCase::RA__NODE__RELATION;
     n_children = 0;
@@ -76,7 +114,7 @@ Ra__Node__Relation::Ra__Node__Relation(std::string _name, std::string _alias)
 
 std::string Ra__Node__Relation::to_string(){
     assert(childNodes.size()==0);
-    return alias.length()==0 ? name : name + " " + alias;
+    return (alias.empty() ? name.str() : name.str() + " " + alias.str()) + estimates_to_string();
 }
 
 Ra__Node__Order_By::Ra__Node__Order_By(){
@@ -86,7 +124,7 @@ Ra__Node__Order_By::Ra__Node__Order_By(){
 
 std::string Ra__Node__Order_By::to_string(){
     assert(childNodes.size()==1);
-    return "OB(" + childNodes[0]->to_string() + ")";
+    return "OB" + estimates_to_string() + "(" + childNodes[0]->to_string() + ")";
 }
 
 Ra__Node__Group_By::Ra__Node__Group_By(bool _implicit)
@@ -97,7 +135,7 @@ Ra__Node__Group_By::Ra__Node__Group_By(bool _implicit)
 
 std::string Ra__Node__Group_By::to_string(){
     assert(childNodes.size()==1);
-    return "\u0393(" + childNodes[0]->to_string() + ")";
+    return "\u0393" + estimates_to_string() + "(" + childNodes[0]->to_string() + ")";
 }
 
 Ra__Node__Having::Ra__Node__Having(){
@@ -108,7 +146,17 @@ Ra__Node__Having::Ra__Node__Having(){
 
 std::string Ra__Node__Having::to_string(){
     assert(childNodes.size()==1);
-    return "H(" + childNodes[0]->to_string() + ")";
+    return "H" + estimates_to_string() + "(" + childNodes[0]->to_string() + ")";
+}
+
+Ra__Node__Limit::Ra__Node__Limit(){
+    node_case = Ra__Node__NodeCase::RA__NODE__LIMIT;
+    n_children = 1;
+}
+
+std::string Ra__Node__Limit::to_string(){
+    assert(childNodes.size()==1);
+    return "L" + estimates_to_string() + "(" + childNodes[0]->to_string() + ")";
 }
 
 Ra__Node__Bool_Predicate::Ra__Node__Bool_Predicate(){
@@ -117,19 +165,18 @@ Ra__Node__Bool_Predicate::Ra__Node__Bool_Predicate(){
 }
 
 
-Ra__Node__Predicate::Ra__Node__Predicate(std::shared_ptr<Ra__Node> left_, std::shared_ptr<Ra__Node> right_, std::string bin_operator)
+Ra__Node__Predicate::Ra__Node__Predicate(Ra__Node* left_, Ra__Node* right_, std::string bin_operator)
 : left(left_), right(right_), binaryOperator(bin_operator)
 {
     node_case = Ra__Node__NodeCase::RA__NODE__PREDICATE;
     n_children = 0;
 }
 
-Ra__Node__Select_Expression::Ra__Node__Select_Expression(std::shared_ptr<Ra__Node> expr)
+Ra__Node__Select_Expression::Ra__Node__Select_Expression(Ra__Node* expr)
 : expression(expr)
 {
     node_case = Ra__Node__NodeCase::RA__NODE__SELECT_EXPRESSION;
     n_children = 0;
-    // expression = std::make_shared<Ra__Node__Expression>();
 }
 
 Ra__Node__Expression::Ra__Node__Expression(){
@@ -139,13 +186,13 @@ Ra__Node__Expression::Ra__Node__Expression(){
     l_arg = nullptr;
 }
 
-void Ra__Node__Expression::add_arg(std::shared_ptr<Ra__Node> arg){
+void Ra__Node__Expression::add_arg(Ra__Node* arg){
     if(r_arg==nullptr) r_arg=arg;
     else if(l_arg==nullptr) l_arg=arg;
-    else std::cout << "error in expression add arg, already full" << std::endl;
+    else std::cerr << "error in expression add arg, already full" << std::endl;
 }
 
-Ra__Node__Type_Cast::Ra__Node__Type_Cast(std::string _type, std::string _typ_mod, std::shared_ptr<Ra__Node> _expression)
+Ra__Node__Type_Cast::Ra__Node__Type_Cast(std::string _type, std::string _typ_mod, Ra__Node* _expression)
 :type(_type),typ_mod(_typ_mod),expression(_expression){
     node_case = Ra__Node__NodeCase::RA__NODE__TYPE_CAST;
     n_children = 0;
@@ -155,14 +202,14 @@ std::string Ra__Node__Type_Cast::to_string(){
     return "";
 }
 
-Ra__Node__Attribute::Ra__Node__Attribute(std::string _name, std::string _alias)
+Ra__Node__Attribute::Ra__Node__Attribute(Ra__Symbol _name, Ra__Symbol _alias)
 :name(_name), alias(_alias){
     node_case = Ra__Node__NodeCase::RA__NODE__ATTRIBUTE;
     n_children = 0;
 }
 
 std::string Ra__Node__Attribute::to_string(){
-    return alias.length()>0 ? alias+"."+name : name;
+    return !alias.empty() ? alias.str()+"."+name.str() : name.str();
 }
 
 Ra__Node__Constant::Ra__Node__Constant(std::string _data, Ra__Const_DataType__DataType _dataType)
@@ -186,6 +233,7 @@ Ra__Node__Func_Call::Ra__Node__Func_Call(std::string _func_name)
     n_children = 0;
     is_aggregating = false;
     agg_distinct = false;
+    is_window = false;
 }
 
 Ra__Node__List::Ra__Node__List(){
@@ -204,7 +252,7 @@ Ra__Node__Case_Expr::Ra__Node__Case_Expr(){
     else_default = nullptr;
 }
 
-Ra__Node__Case_When::Ra__Node__Case_When(std::shared_ptr<Ra__Node> _when, std::shared_ptr<Ra__Node> _then)
+Ra__Node__Case_When::Ra__Node__Case_When(Ra__Node* _when, Ra__Node* _then)
 :when(_when), then(_then){
     node_case = Ra__Node__NodeCase::RA__NODE__CASE_WHEN;
     n_children = 0;
@@ -216,7 +264,24 @@ Ra__Node__Values::Ra__Node__Values(){
 }
 
 std::string Ra__Node__Values::to_string(){
-    return alias;
+    return alias + estimates_to_string();
+}
+
+Ra__Node__Union::Ra__Node__Union(size_t n_branches){
+    node_case = Ra__Node__NodeCase::RA__NODE__UNION;
+    n_children = n_branches;
+}
+
+std::string Ra__Node__Union::to_string(){
+    assert(this->is_full());
+    std::string branches;
+    for(size_t i=0; i<childNodes.size(); i++){
+        if(i>0){
+            branches += "\u222A";
+        }
+        branches += "(" + childNodes[i]->to_string() + ")";
+    }
+    return branches + estimates_to_string();
 }
 
 Ra__Node__Null_Test::Ra__Node__Null_Test(){
@@ -238,4 +303,217 @@ std::string Ra__Node__Where_Subquery_Marker::to_string()
 Ra__Node__Dummy::Ra__Node__Dummy(){
     node_case = Ra__Node__NodeCase::RA__NODE__DUMMY;
     n_children = 0;
-}
\ No newline at end of file
+}
+static void hash_combine(size_t& seed, size_t value){
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+static void append_key(std::string& key, uint64_t value){
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void append_key(std::string& key, Ra__Symbol symbol){
+    append_key(key, static_cast<uint64_t>(symbol.id));
+}
+
+static void append_key(std::string& key, const std::string& value){
+    append_key(key, static_cast<uint64_t>(value.size()));
+    key.append(value);
+}
+
+template<typename T>
+static void append_operands(std::string& key, std::vector<Ra__Node*>& operands, const std::vector<T*>& nodes){
+    append_key(key, static_cast<uint64_t>(nodes.size()));
+    operands.insert(operands.end(), nodes.begin(), nodes.end());
+}
+
+// structure of node incl. node case and children
+static void get_node_structure(Ra__Node* node, std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias){
+    append_key(key, static_cast<uint64_t>(node->node_case));
+    node->get_structure(key, operands, incl_alias);
+    append_operands(key, operands, node->childNodes);
+}
+
+void Ra__Node::get_structure(std::string&, std::vector<Ra__Node*>&, bool){}
+
+size_t Ra__Node::structural_hash(uint64_t epoch, bool incl_alias){
+    bool cacheable = incl_alias || node_case!=RA__NODE__PROJECTION;
+    if(cacheable && hash_epoch==epoch && epoch!=0){
+        return hash;
+    }
+    std::string key;
+    std::vector<Ra__Node*> operands;
+    get_node_structure(this, key, operands, incl_alias);
+    size_t subtree_hash = std::hash<std::string>()(key);
+    for(auto operand: operands){
+        hash_combine(subtree_hash, operand==nullptr ? 0 : operand->structural_hash(epoch));
+    }
+    if(cacheable){
+        hash = subtree_hash;
+        hash_epoch = epoch;
+    }
+    return subtree_hash;
+}
+
+bool Ra__Node::is_structurally_equal(Ra__Node* other, uint64_t epoch, bool incl_alias){
+    if(this==other){
+        return true;
+    }
+    if(other==nullptr || node_case!=other->node_case || structural_hash(epoch, incl_alias)!=other->structural_hash(epoch, incl_alias)){
+        return false;
+    }
+    std::string key, other_key;
+    std::vector<Ra__Node*> operands, other_operands;
+    get_node_structure(this, key, operands, incl_alias);
+    get_node_structure(other, other_key, other_operands, incl_alias);
+    if(key!=other_key || operands.size()!=other_operands.size()){
+        return false;
+    }
+    for(size_t i=0; i<operands.size(); i++){
+        if(operands[i]==nullptr ? other_operands[i]!=nullptr : !operands[i]->is_structurally_equal(other_operands[i], epoch)){
+            return false;
+        }
+    }
+    return true;
+}
+
+void Ra__Node__Where_Subquery_Marker::get_structure(std::string& key, std::vector<Ra__Node*>&, bool){
+    append_key(key, marker);
+    append_key(key, static_cast<uint64_t>(type));
+}
+
+void Ra__Node__Join::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, static_cast<uint64_t>(type));
+    append_key(key, alias);
+    append_key(key, static_cast<uint64_t>(columns.size()));
+    for(const auto& column: columns){
+        append_key(key, column);
+    }
+    append_key(key, right_where_subquery_marker->marker);
+    operands.push_back(predicate);
+}
+
+void Ra__Node__Projection::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias){
+    append_key(key, static_cast<uint64_t>(distinct));
+    append_key(key, incl_alias ? subquery_alias : Ra__Symbol());
+    append_key(key, static_cast<uint64_t>(subquery_columns.size()));
+    for(const auto& column: subquery_columns){
+        append_key(key, column);
+    }
+    append_operands(key, operands, args);
+}
+
+void Ra__Node__Selection::get_structure(std::string&, std::vector<Ra__Node*>& operands, bool){
+    operands.push_back(predicate);
+}
+
+void Ra__Node__Relation::get_structure(std::string& key, std::vector<Ra__Node*>&, bool){
+    append_key(key, name);
+    append_key(key, alias);
+}
+
+void Ra__Node__Order_By::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    for(auto direction: directions){
+        append_key(key, static_cast<uint64_t>(direction));
+    }
+    append_operands(key, operands, args);
+}
+
+void Ra__Node__Group_By::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, static_cast<uint64_t>(implicit));
+    append_operands(key, operands, args);
+}
+
+void Ra__Node__Having::get_structure(std::string&, std::vector<Ra__Node*>& operands, bool){
+    operands.push_back(predicate);
+}
+
+void Ra__Node__Limit::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, static_cast<uint64_t>(with_ties));
+    operands.push_back(count);
+    operands.push_back(offset);
+}
+
+void Ra__Node__Bool_Predicate::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, static_cast<uint64_t>(bool_operator));
+    append_operands(key, operands, args);
+}
+
+void Ra__Node__Predicate::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, binaryOperator);
+    operands.push_back(left);
+    operands.push_back(right);
+}
+
+void Ra__Node__Select_Expression::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, rename);
+    operands.push_back(expression);
+}
+
+void Ra__Node__Expression::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, operator_);
+    operands.push_back(l_arg);
+    operands.push_back(r_arg);
+}
+
+void Ra__Node__Type_Cast::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, type);
+    append_key(key, typ_mod);
+    operands.push_back(expression);
+}
+
+void Ra__Node__Attribute::get_structure(std::string& key, std::vector<Ra__Node*>&, bool){
+    append_key(key, name);
+    append_key(key, alias);
+}
+
+void Ra__Node__Constant::get_structure(std::string& key, std::vector<Ra__Node*>&, bool){
+    append_key(key, static_cast<uint64_t>(dataType));
+    append_key(key, data);
+}
+
+void Ra__Node__Func_Call::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, func_name);
+    append_key(key, static_cast<uint64_t>(is_aggregating));
+    append_key(key, static_cast<uint64_t>(agg_distinct));
+    append_key(key, static_cast<uint64_t>(is_window));
+    append_operands(key, operands, args);
+    append_operands(key, operands, window_partition);
+}
+
+void Ra__Node__List::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_operands(key, operands, args);
+}
+
+void Ra__Node__In_List::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_operands(key, operands, args);
+}
+
+void Ra__Node__Case_Expr::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_operands(key, operands, args);
+    operands.push_back(else_default);
+}
+
+void Ra__Node__Case_When::get_structure(std::string&, std::vector<Ra__Node*>& operands, bool){
+    operands.push_back(when);
+    operands.push_back(then);
+}
+
+void Ra__Node__Values::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, alias);
+    append_key(key, column);
+    append_operands(key, operands, values);
+}
+
+void Ra__Node__Union::get_structure(std::string& key, std::vector<Ra__Node*>&, bool incl_alias){
+    append_key(key, incl_alias ? alias : Ra__Symbol());
+    append_key(key, static_cast<uint64_t>(columns.size()));
+    for(const auto& column: columns){
+        append_key(key, column);
+    }
+}
+
+void Ra__Node__Null_Test::get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool){
+    append_key(key, static_cast<uint64_t>(type));
+    operands.push_back(arg);
+}
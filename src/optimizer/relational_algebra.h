@@ -7,6 +7,7 @@
 #include <string>
 #include <cassert>
 #include <iostream>
+#include "ra_symbol_table.h"
 
 typedef enum {
     RA__NODE__ROOT = 0,
@@ -33,7 +34,9 @@ typedef enum {
     RA__NODE__VALUES = 22,
     RA__NODE__NULL_TEST = 23,
     RA__NODE__IN_LIST = 24,
-    RA__NODE__WHERE_SUBQUERY_MARKER = 25
+    RA__NODE__WHERE_SUBQUERY_MARKER = 25,
+    RA__NODE__UNION = 26,
+    RA__NODE__LIMIT = 27
 } Ra__Node__NodeCase;
 
 typedef enum {
@@ -86,6 +89,12 @@ typedef enum {
     RA__ORDER_BY__DESC = 2,
 } Ra__Order_By__SortDirection;
 
+typedef enum {
+    RA__CTE__MATERIALIZE_DEFAULT = 0,
+    RA__CTE__MATERIALIZE_ALWAYS = 1, // as materialized
+    RA__CTE__MATERIALIZE_NEVER = 2, // as not materialized
+} Ra__Cte__Materialize;
+
 typedef enum {
     RA__NULL_TEST__IS_NULL = 0,
     RA__NULL_TEST__IS_NOT_NULL = 1,
@@ -108,6 +117,7 @@ class Ra__Node__Projection;
 class Ra__Node__Join;
 class Ra__Node__Selection;
 class Ra__Node__Relation;
+struct Ra__Catalog__Table;
 class Ra__Node__Rename;
 class Ra__Node__Bool_Predicate;
 class Ra__Node__Predicate;
@@ -117,6 +127,7 @@ class Ra__Node__Constant;
 class Ra__Node__Group_By;
 class Ra__Node__Order_By;
 class Ra__Node__Having;
+class Ra__Node__Limit;
 class Ra__Node__Select_Expression;
 class Ra__Node__Case_When;
 class Ra__Node__Case_Expr;
@@ -124,31 +135,82 @@ class Ra__Node__Where_Subquery_Marker;
 
 class Ra__Node{
     public:
+        virtual ~Ra__Node() = default;
         virtual std::string to_string();
         bool is_full();
 
+        /**
+         * Replaces a child and keeps the parent links of old and new child up to date
+         * @param index child index to replace
+         * @param child new child node
+         */
+        void set_child(size_t index, Ra__Node* child);
+
+        /**
+         * Appends a child and links it to this node
+         * @param child new child node
+         */
+        void add_child(Ra__Node* child);
+
+        /**
+         * Removes all children and unlinks them from this node
+         */
+        void clear_children();
+
         Ra__Node__NodeCase node_case;
-        std::vector<std::shared_ptr<Ra__Node>> childNodes;
+        std::vector<Ra__Node*> childNodes;
         size_t n_children;
-};
-
-class Ra__Node__Join: public Ra__Node{
-    public:
-        Ra__Node__Join(Ra__Join__JoinType _type, uint64_t r_marker=0);
-        std::string to_string();
-        std::string join_name();
-        
-        std::shared_ptr<Ra__Node> predicate; // Ra__Node__Bool_Predicate/Ra__Node__Predicate/Selection_Marker
-        Ra__Join__JoinType type;
-        std::string alias;
-        std::vector<std::string> columns;
 
-        std::shared_ptr<Ra__Node__Where_Subquery_Marker> right_where_subquery_marker;
+        /// last node which linked this node as child (via set_child/add_child), nullptr for roots
+        Ra__Node* parent = nullptr;
+        /// number of child slots referencing this node, >1 if the node is shared by several parents
+        uint32_t n_parents = 0;
+
+        /// estimated rows and average row width in bytes, set by RaTree::annotate_estimates, -1 if not estimated
+        double estimated_rows = -1;
+        double estimated_width = -1;
+
+        /**
+         * @return estimates as "[rows=N width=W]" for to_string, empty if the node was not estimated
+         */
+        std::string estimates_to_string();
+
+        /**
+         * Appends the fields defining the node (excl. children) for structural hashing and comparison:
+         * scalar fields are serialized into key, expressions and predicates are appended to operands (nullptr if missing)
+         * @param key serialized scalar fields
+         * @param operands expression and predicate nodes
+         * @param incl_alias false to leave out the subquery alias of a projection
+         */
+        virtual void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias);
+
+        /**
+         * Structural hash of the subtree incl. expressions and predicates, computed bottom-up and cached on the nodes
+         * @param epoch hashes cached with another epoch are recomputed, the owner of the nodes changes the epoch after modifying them
+         * @param incl_alias false to ignore the subquery alias of this node (not of its descendants), not cached
+         * @return hash, equal for structurally equal subtrees
+         */
+        size_t structural_hash(uint64_t epoch, bool incl_alias=true);
+
+        /**
+         * Compares two subtrees by structure, operators, expressions and identifiers,
+         * subtrees with different cached hashes are unequal without walking them
+         * @param other root of other subtree, may be nullptr
+         * @param epoch epoch of the cached hashes, see structural_hash
+         * @param incl_alias false to ignore the subquery aliases of both roots (not of their descendants)
+         * @return true if the subtrees are structurally equal
+         */
+        bool is_structurally_equal(Ra__Node* other, uint64_t epoch, bool incl_alias=true);
+
+        /// structural_hash of the subtree cached with hash_epoch, 0 is never a valid epoch
+        size_t hash = 0;
+        uint64_t hash_epoch = 0;
 };
 
 class Ra__Node__Where_Subquery_Marker: public Ra__Node {
     public:
         Ra__Node__Where_Subquery_Marker(uint64_t _marker, Ra__Join__JoinType _type);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
         uint64_t marker;
         Ra__Join__JoinType type;
@@ -157,37 +219,64 @@ class Ra__Node__Where_Subquery_Marker: public Ra__Node {
         }
 };
 
+class Ra__Node__Join: public Ra__Node{
+    public:
+        Ra__Node__Join(Ra__Join__JoinType _type, uint64_t r_marker=0);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::string to_string();
+        std::string join_name();
+        
+        Ra__Node* predicate = nullptr; // Ra__Node__Bool_Predicate/Ra__Node__Predicate/Selection_Marker
+        Ra__Join__JoinType type;
+        Ra__Symbol alias;
+        std::vector<std::string> columns;
+
+        Ra__Node__Where_Subquery_Marker* right_where_subquery_marker;
+
+    private:
+        // storage of right_where_subquery_marker, allocated together with the join node
+        Ra__Node__Where_Subquery_Marker where_subquery_marker;
+};
+
 class Ra__Node__Projection: public Ra__Node {
     public:
         Ra__Node__Projection();
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
-        std::vector<std::shared_ptr<Ra__Node>> args; // Ra__Node__Select_Expression
-        std::string subquery_alias;
+        std::vector<Ra__Node*> args; // Ra__Node__Select_Expression
+        Ra__Symbol subquery_alias;
         std::vector<std::string> subquery_columns;
         bool distinct;
+        // only CTEs: whether the CTE is computed once or inlined into its references
+        Ra__Cte__Materialize cte_materialize;
 };
 
 class Ra__Node__Selection: public Ra__Node {
     public:
         Ra__Node__Selection();
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
-        std::shared_ptr<Ra__Node> predicate; // Ra__Node__Bool_Predicate/Ra__Node__Predicate/Ra__Node__Where_Subquery_Marker
+        Ra__Node* predicate = nullptr; // Ra__Node__Bool_Predicate/Ra__Node__Predicate/Ra__Node__Where_Subquery_Marker
 };
 
 class Ra__Node__Relation: public Ra__Node {
     public:
-        Ra__Node__Relation(std::string _name, std::string _alias="");
+        Ra__Node__Relation(Ra__Symbol _name, Ra__Symbol _alias=Ra__Symbol());
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
-        std::string name;
-        std::string alias;
-        std::vector<std::shared_ptr<Ra__Node__Attribute>> attributes;
+        Ra__Symbol name;
+        Ra__Symbol alias;
+        std::vector<Ra__Node__Attribute*> attributes;
+        // catalog table of a base relation with its keys and nullability, nullptr for CTEs and until attached by the RaTree
+        const Ra__Catalog__Table* table = nullptr;
 };
 
 // sort operator
 class Ra__Node__Order_By: public Ra__Node {
     public:
         Ra__Node__Order_By();
-        std::vector<std::shared_ptr<Ra__Node>> args; // expressions/attr/const/case
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node*> args; // expressions/attr/const/case
         std::vector<Ra__Order_By__SortDirection> directions;
         std::string to_string();
 };
@@ -195,7 +284,8 @@ class Ra__Node__Order_By: public Ra__Node {
 class Ra__Node__Group_By: public Ra__Node {
     public:
         Ra__Node__Group_By(bool _implicit=false);
-        std::vector<std::shared_ptr<Ra__Node>> args; // expressions/attr/const/case
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node*> args; // expressions/attr/const/case
         bool implicit;
         std::string to_string();
 };
@@ -203,62 +293,81 @@ class Ra__Node__Group_By: public Ra__Node {
 class Ra__Node__Having: public Ra__Node {
     public:
         Ra__Node__Having();
-        std::shared_ptr<Ra__Node> predicate; // Ra__Node__Bool_Predicate or Ra__Node__Predicate
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        Ra__Node* predicate = nullptr; // Ra__Node__Bool_Predicate or Ra__Node__Predicate
+        std::string to_string();
+};
+
+// limit/offset of a query block, below its projection and above its order by (applied to the projected rows)
+class Ra__Node__Limit: public Ra__Node {
+    public:
+        Ra__Node__Limit();
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        Ra__Node* count = nullptr; // expression, nullptr for "limit all"
+        Ra__Node* offset = nullptr; // expression, nullptr without offset
+        bool with_ties = false; // "fetch first n rows with ties", rows equal to the last one in the order by are kept
         std::string to_string();
 };
 
 class Ra__Node__Bool_Predicate: public Ra__Node {
     public:
         Ra__Node__Bool_Predicate();
-        std::vector<std::shared_ptr<Ra__Node>> args;
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node*> args;
         Ra__Bool_Operator__OperatorCase bool_operator;
 };
 
 class Ra__Node__Predicate: public Ra__Node {
     public:
-        Ra__Node__Predicate(std::shared_ptr<Ra__Node> left_=nullptr, std::shared_ptr<Ra__Node> right_=nullptr, std::string bin_operator="");
-        std::shared_ptr<Ra__Node> left;
-        std::shared_ptr<Ra__Node> right;
+        Ra__Node__Predicate(Ra__Node* left_=nullptr, Ra__Node* right_=nullptr, std::string bin_operator="");
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        Ra__Node* left = nullptr;
+        Ra__Node* right = nullptr;
         // Ra__Binary_Operator binaryOperator;
         std::string binaryOperator;
 };
 
 class Ra__Node__Select_Expression: public Ra__Node {
     public:
-        Ra__Node__Select_Expression(std::shared_ptr<Ra__Node> expr=nullptr);
-        std::shared_ptr<Ra__Node> expression;
+        Ra__Node__Select_Expression(Ra__Node* expr=nullptr);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        Ra__Node* expression = nullptr;
         std::string rename;
 };
 
 class Ra__Node__Expression: public Ra__Node {
     public:
         Ra__Node__Expression();
-        void add_arg(std::shared_ptr<Ra__Node> arg);
-        std::shared_ptr<Ra__Node> r_arg;
-        std::shared_ptr<Ra__Node> l_arg; //const, attributes, func calls, type cast
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        void add_arg(Ra__Node* arg);
+        Ra__Node* r_arg = nullptr;
+        Ra__Node* l_arg = nullptr; //const, attributes, func calls, type cast
         std::string operator_;
 };
 
 class Ra__Node__Type_Cast: public Ra__Node {
     public:
-        Ra__Node__Type_Cast(std::string _type, std::string _typ_mod="", std::shared_ptr<Ra__Node> _expression = std::make_shared<Ra__Node__Expression>());
+        Ra__Node__Type_Cast(std::string _type, std::string _typ_mod="", Ra__Node* _expression=nullptr);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
-        std::shared_ptr<Ra__Node> expression;
+        Ra__Node* expression = nullptr;
         std::string type;
         std::string typ_mod; // interval '2' month
 };
 
 class Ra__Node__Attribute: public Ra__Node {
     public:
-        Ra__Node__Attribute(std::string _name, std::string _alias="");
+        Ra__Node__Attribute(Ra__Symbol _name, Ra__Symbol _alias=Ra__Symbol());
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
-        std::string name;
-        std::string alias;
+        Ra__Symbol name;
+        Ra__Symbol alias;
 };
 
 class Ra__Node__Constant: public Ra__Node  {
     public:
         Ra__Node__Constant(std::string _data, Ra__Const_DataType__DataType _dataType);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
 
         std::string data;
@@ -268,51 +377,71 @@ class Ra__Node__Constant: public Ra__Node  {
 class Ra__Node__Func_Call: public Ra__Node {
     public:
         Ra__Node__Func_Call(std::string _func_name);
-        std::vector<std::shared_ptr<Ra__Node>> args;
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node*> args;
         std::string func_name;
         bool is_aggregating;
         bool agg_distinct;
+        // window function "over (partition by window_partition)": aggregates each row's partition, rows are not grouped
+        bool is_window;
+        std::vector<Ra__Node*> window_partition;
 };
 
 class Ra__Node__List: public Ra__Node {
     public:
         Ra__Node__List();
-        std::vector<std::shared_ptr<Ra__Node>> args;
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node*> args;
 };
 
 class Ra__Node__In_List: public Ra__Node {
     public:
         Ra__Node__In_List();
-        std::vector<std::shared_ptr<Ra__Node>> args;
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node*> args;
 };
 
 class Ra__Node__Case_Expr: public Ra__Node {
     public:
         Ra__Node__Case_Expr();
-        std::vector<std::shared_ptr<Ra__Node__Case_When>> args;
-        std::shared_ptr<Ra__Node> else_default;
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::vector<Ra__Node__Case_When*> args;
+        Ra__Node* else_default = nullptr;
 };
 
 class Ra__Node__Case_When: public Ra__Node {
     public:
-        Ra__Node__Case_When(std::shared_ptr<Ra__Node> _when, std::shared_ptr<Ra__Node> _then);
-        std::shared_ptr<Ra__Node> when; // predicate
-        std::shared_ptr<Ra__Node> then; // expression
+        Ra__Node__Case_When(Ra__Node* _when, Ra__Node* _then);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        Ra__Node* when = nullptr; // predicate
+        Ra__Node* then = nullptr; // expression
 };
 
 class Ra__Node__Values: public Ra__Node {
     public:
         Ra__Node__Values();
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
         std::string to_string();
-        std::vector<std::shared_ptr<Ra__Node>> values; // constants
+        std::vector<Ra__Node*> values; // constants, a relation of their distinct values
         std::string alias;
         std::string column;
 };
 
+// union all of subqueries (children: Ra__Node__Projection with the same number of columns), used as from subquery
+class Ra__Node__Union: public Ra__Node {
+    public:
+        Ra__Node__Union(size_t n_branches);
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        std::string to_string();
+        Ra__Symbol alias;
+        std::vector<std::string> columns;
+};
+
 class Ra__Node__Null_Test: public Ra__Node {
     public:
         Ra__Node__Null_Test();
-        std::shared_ptr<Ra__Node> arg;
+        void get_structure(std::string& key, std::vector<Ra__Node*>& operands, bool incl_alias) override;
+        Ra__Node* arg = nullptr;
         Ra__Null_Test__Type type;
 };
 
@@ -0,0 +1,42 @@
+-- Unused columns of derived tables and CTEs pruned (prune_columns).
+
+-- derived table
+-- reject: o_custkey|o_comment
+select t.o_orderkey
+from (select o_orderkey, o_custkey, o_totalprice, o_comment from orders where o_orderstatus = 'F') as t
+where t.o_totalprice > 1000;
+
+-- CTE
+-- reject: c_custkey|c_address
+with c as (select c_custkey, c_name, c_address, c_acctbal from customer)
+select c.c_name from c where c.c_acctbal > 0;
+
+-- unused aggregate of a group by
+-- reject: sum\(
+select t.o_custkey
+from (select o_custkey, count(*) as n, sum(o_totalprice) as s from orders group by o_custkey) as t
+where t.n > 5;
+
+-- select * expanded to the used columns
+-- reject: \*
+select t.o_orderkey from (select * from orders) as t where t.o_totalprice > 300000;
+
+-- column list of the derived table
+-- reject: o_custkey
+select t.a from (select o_orderkey as a, o_custkey as b from orders) as t(a, b) where t.a < 10;
+
+-- column used by the order by of the derived table
+-- expect: o_totalprice as y
+select x from (select o_orderkey as x, o_totalprice as y from orders order by y desc limit 5) as t;
+
+-- the columns of a distinct projection determine its rows
+-- expect: distinct o_custkey, o_orderstatus
+select t.o_custkey from (select distinct o_custkey, o_orderstatus from orders) as t;
+
+-- aggregation without group by is kept as is
+-- expect: sum\(o_totalprice\)
+select t.n from (select count(*) as n, sum(o_totalprice) as s from orders) as t;
+
+-- read by select *
+-- expect: o_orderkey, o_custkey
+select * from (select o_orderkey, o_custkey from orders where o_totalprice > 300000) as t;
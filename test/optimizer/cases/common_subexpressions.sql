@@ -0,0 +1,45 @@
+-- Subtrees used several times shared as CTEs (share_common_subexpressions).
+
+-- identical subqueries in from
+-- expect: with cte_\d+ as materialized
+-- expect: cte_\d+ t2, cte_\d+ t1
+select t1.o_custkey, t2.o_custkey
+from (select o_custkey, o_orderkey from orders, customer
+        where o_custkey = c_custkey and c_mktsegment = 'BUILDING' and o_orderdate < date '1995-03-15') as t1,
+    (select o_custkey, o_orderkey from orders, customer
+        where o_custkey = c_custkey and c_mktsegment = 'BUILDING' and o_orderdate < date '1995-03-15') as t2
+where t1.o_orderkey = t2.o_orderkey + 1;
+
+-- identical CTEs are merged, the reference to the removed CTE keeps its name as alias
+-- expect: from a b, a
+select count(*) from (
+with a as (select o_custkey, sum(o_totalprice) as s from orders group by o_custkey),
+    b as (select o_custkey, sum(o_totalprice) as s from orders group by o_custkey)
+select a.o_custkey from a, b where a.o_custkey = b.o_custkey and a.s > 1000 and b.s < 100000
+) as t;
+
+-- join block of TPC-H Q11 in the query and the having subquery
+-- expect: with cte_\d+ as materialized
+select ps_partkey, sum(ps_supplycost * ps_availqty) as value
+from partsupp, supplier, nation
+where ps_suppkey = s_suppkey and s_nationkey = n_nationkey and n_name = 'GERMANY'
+group by ps_partkey
+having sum(ps_supplycost * ps_availqty) > (
+    select sum(ps_supplycost * ps_availqty) * 0.0001
+    from partsupp, supplier, nation
+    where ps_suppkey = s_suppkey and s_nationkey = n_nationkey and n_name = 'GERMANY')
+order by value desc;
+
+-- the subqueries differ in a constant
+-- reject: with cte_
+select t1.o_custkey
+from (select o_custkey, count(*) as c from orders where o_orderstatus = 'F' group by o_custkey) as t1,
+    (select o_custkey, count(*) as c from orders where o_orderstatus = 'O' group by o_custkey) as t2
+where t1.o_custkey = t2.o_custkey and t1.c > t2.c;
+
+-- a selection of a small relation is cheaper to compute twice than to store
+-- reject: with cte_
+select t1.n_name, t2.n_name
+from (select n_name, n_nationkey from nation where n_regionkey = 1) as t1,
+    (select n_name, n_nationkey from nation where n_regionkey = 1) as t2
+where t1.n_nationkey < t2.n_nationkey;
@@ -0,0 +1,43 @@
+-- Constant folding of arithmetic and date/interval expressions (fold_constants).
+
+-- date - interval in a comparison (TPC-H Q1)
+-- expect: l_shipdate<=date '1998-09-02'
+select l_returnflag, l_linestatus, count(*)
+from lineitem
+where l_shipdate <= date '1998-12-01' - interval '90' day
+group by l_returnflag, l_linestatus;
+
+-- months are clamped to the end of the month
+-- expect: o_orderdate<date '1995-02-28'
+select o_orderkey from orders where o_orderdate >= date '1995-01-01' and o_orderdate < date '1995-01-31' + interval '1' month;
+
+-- numeric arithmetic keeps the scale (TPC-H Q6)
+-- expect: between 0\.05 and 0\.07
+select sum(l_extendedprice * l_discount) from lineitem where l_discount between 0.06 - 0.01 and 0.06 + 0.01 and l_quantity < 24;
+
+-- integer division without remainder
+-- expect: l_quantity<4\b
+select l_orderkey, l_linenumber from lineitem where l_quantity < 8 / 2;
+
+-- unary minus
+-- expect: l_quantity>2\b
+select l_orderkey, l_linenumber from lineitem where l_quantity > -(-2) and l_quantity < 5;
+
+-- date + int
+-- expect: o_orderdate<date '1992-02-01'
+select o_orderkey from orders where o_orderdate < date '1992-01-01' + 31;
+
+-- division with remainder is not folded, databases disagree on 7/2
+-- reject: l_quantity<3\b
+select l_orderkey, l_linenumber from lineitem where l_quantity < 7 / 2;
+
+-- reject: l_quantity<6\b
+select l_orderkey, l_linenumber from lineitem where l_quantity < 7 / 2 * 2;
+
+-- a subquery is no operand of a unary +, the statement is not optimized
+-- expect: \+ ?100
+select c_custkey from customer where c_acctbal > (select min(o_totalprice) from orders) + 100;
+
+-- date + interval is a timestamp, it is only replaced by a date in comparisons with dates
+-- reject: date '1995-02-01'
+select r_name, date '1995-01-01' + interval '1' month from region;
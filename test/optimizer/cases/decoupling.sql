@@ -0,0 +1,31 @@
+-- Unnesting of correlated subqueries: decoupled (subquery evaluated for all correlation values)
+-- or not decoupled (outer query materialized as CTE, the subquery joined with its distinct correlation values)
+
+-- cost based choice
+select o_orderkey from orders o where o.o_orderstatus='F' and o.o_totalprice > (select avg(o2.o_totalprice) from orders o2 where o2.o_custkey=o.o_custkey);
+
+-- not decoupled: unqualified attributes of an aliased outer relation are columns of the CTE
+-- options: --decouple never
+-- expect: with cte_\d+ as
+select o_orderkey from orders o where o.o_orderstatus='F' and o.o_totalprice > (select avg(o2.o_totalprice) from orders o2 where o2.o_custkey=o.o_custkey);
+
+-- decoupled
+-- options: --decouple always
+-- reject: with cte_
+select o_orderkey from orders o where o.o_orderstatus='F' and o.o_totalprice > (select avg(o2.o_totalprice) from orders o2 where o2.o_custkey=o.o_custkey);
+
+-- not decoupled: unqualified attributes of several outer relations
+-- options: --decouple never
+-- expect: with cte_\d+ as
+select l_orderkey, l_linenumber from lineitem l1, orders where o_orderkey=l1.l_orderkey and o_orderstatus='F' and l1.l_quantity < (select avg(l2.l_quantity) from lineitem l2 where l2.l_partkey=l1.l_partkey);
+
+-- cost based choice, may filter the decoupled subquery by the CTE (magic set)
+select l_orderkey, l_linenumber from lineitem l1, orders where o_orderkey=l1.l_orderkey and o_orderstatus='F' and l1.l_quantity < (select avg(l2.l_quantity) from lineitem l2 where l2.l_partkey=l1.l_partkey);
+
+-- correlated exists and not exists
+select c_custkey, c_name from customer where exists (select * from orders where o_custkey=c_custkey and o_orderpriority='1-URGENT');
+select c_custkey from customer where not exists (select * from orders where o_custkey=c_custkey);
+
+-- correlated subquery with a non-equality correlation predicate
+-- options: --decouple never
+select p_partkey from part where p_retailprice > (select avg(ps_supplycost)*2 from partsupp where ps_partkey=p_partkey and ps_availqty<p_size*100);
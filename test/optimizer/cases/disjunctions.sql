@@ -0,0 +1,58 @@
+-- Disjunctions split into union all (split_disjunctions) and long in lists joined as values (convert_in_lists_to_values).
+
+-- branches restrict p_size to different numbers
+-- expect: union all.*union all
+select sum(l_extendedprice)
+from part, lineitem
+where p_partkey = l_partkey
+    and ((p_size = 1 and l_quantity >= 1 and l_quantity <= 11)
+        or (p_size = 5 and l_quantity >= 10 and l_quantity <= 20)
+        or (p_size in (7, 9) and l_quantity >= 20 and l_quantity <= 30));
+
+-- 1 and 1.0 are the same number, the branches overlap
+-- reject: union all
+select sum(l_extendedprice)
+from part, lineitem
+where p_partkey = l_partkey
+    and ((p_size = 1 and l_quantity >= 1 and l_quantity <= 11)
+        or (p_size = 1.0 and l_quantity >= 10 and l_quantity <= 20));
+
+-- the in lists share a value
+-- reject: union all
+select sum(l_extendedprice)
+from part, lineitem
+where p_partkey = l_partkey
+    and ((p_size in (1, 3) and l_quantity >= 1 and l_quantity <= 11)
+        or (p_size in (3, 5) and l_quantity >= 10 and l_quantity <= 20));
+
+-- strings may be equal under a collation ('Brand#12' and 'BRAND#12'), they do not prove disjointness (TPC-H Q19)
+-- reject: union all
+select sum(l_extendedprice)
+from part, lineitem
+where p_partkey = l_partkey
+    and ((p_brand = 'Brand#12' and l_quantity >= 1 and l_quantity <= 11)
+        or (p_brand = 'BRAND#12' and l_quantity >= 10 and l_quantity <= 20));
+
+-- a branch without a restriction of the attribute overlaps with the others
+-- reject: union all
+select sum(l_extendedprice)
+from part, lineitem
+where p_partkey = l_partkey
+    and ((p_size = 1 and l_quantity >= 1 and l_quantity <= 11)
+        or (l_quantity >= 10 and l_quantity <= 20));
+
+-- long in list on a key
+-- expect: \(values
+select o_orderkey, o_totalprice
+from orders
+where o_orderkey in (1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25);
+
+-- duplicates and equal numbers written differently must not repeat the rows
+-- expect: \(values
+select o_orderkey, o_totalprice
+from orders
+where o_orderkey in (1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 1, 1.0, 2.00, 20);
+
+-- short in list
+-- reject: \(values
+select o_orderkey, o_totalprice from orders where o_orderkey in (1, 2, 3);
@@ -0,0 +1,39 @@
+-- Distinct removed from projections of inputs unique on the projected columns (remove_redundant_distincts).
+
+-- primary key
+-- reject: distinct
+select distinct o_orderkey, o_custkey from orders where o_totalprice > 300000;
+
+-- composite primary key with a column equal to a constant
+-- reject: distinct
+select distinct l_linenumber, l_quantity from lineitem where l_orderkey = 7;
+
+-- composite primary key of partsupp
+-- reject: distinct
+select distinct ps_partkey from partsupp where ps_suppkey = 3;
+
+-- join through a foreign key, the key of the joined side stays unique
+-- reject: distinct
+select distinct c_custkey, c_name, o_orderkey from customer, orders where c_custkey = o_custkey and o_totalprice > 300000;
+
+-- grouped derived table
+-- reject: distinct
+select distinct o_custkey, n from (select o_custkey, count(*) as n from orders group by o_custkey) as t;
+
+-- left joins
+-- reject: distinct
+select distinct c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where c_acctbal > 9000;
+-- reject: distinct
+select distinct o_orderkey, c_nationkey from orders left join customer on c_custkey = o_custkey where o_totalprice > 300000;
+
+-- not a key
+-- expect: distinct
+select distinct o_custkey from orders;
+
+-- key of the side whose rows repeat in the join
+-- expect: distinct
+select distinct c_custkey, c_name from customer, orders where c_custkey = o_custkey and o_totalprice > 300000;
+
+-- the constant is on a column outside the key
+-- expect: distinct
+select distinct l_linenumber from lineitem where l_quantity = 7;
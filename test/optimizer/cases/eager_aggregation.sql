@@ -0,0 +1,59 @@
+-- Partial aggregation below joins (push_down_aggregations).
+
+-- every decomposable aggregate, avg as sum/count
+-- expect: group by l_orderkey
+select c_custkey, c_name, sum(l_quantity), count(*), avg(l_extendedprice), min(l_discount), max(l_tax)
+from customer, orders, lineitem
+where c_custkey = o_custkey and o_orderkey = l_orderkey
+group by c_custkey, c_name;
+
+-- having and order by use the combined aggregates
+-- expect: group by l_orderkey
+select c_custkey, c_name, sum(l_quantity)
+from customer, orders, lineitem
+where c_custkey = o_custkey and o_orderkey = l_orderkey
+group by c_custkey, c_name
+having sum(l_quantity) > 100
+order by c_custkey;
+
+-- count(*) is renamed, the combining sum keeps the name
+-- expect: as count\b
+select o_orderpriority, count(*), sum(l_quantity)
+from orders, lineitem
+where o_orderkey = l_orderkey
+group by o_orderpriority;
+
+-- TPC-H Q18
+-- expect: eager_
+select c_name, c_custkey, o_orderkey, o_orderdate, o_totalprice, sum(l_quantity)
+from customer, orders, lineitem
+where o_orderkey in (select l_orderkey from lineitem group by l_orderkey having sum(l_quantity) > 300)
+    and c_custkey = o_custkey and o_orderkey = l_orderkey
+group by c_name, c_custkey, o_orderkey, o_orderdate, o_totalprice
+order by o_totalprice desc, o_orderdate;
+
+-- without group by an empty join still returns one row
+-- reject: eager_
+select sum(l_quantity), count(*)
+from orders, lineitem
+where o_orderkey = l_orderkey and o_orderdate < date '1994-01-01';
+
+-- distinct counts are not decomposable
+-- reject: eager_
+select o_orderpriority, count(distinct l_partkey)
+from orders, lineitem
+where o_orderkey = l_orderkey
+group by o_orderpriority;
+
+-- aggregate arguments of both join inputs
+-- reject: eager_
+select o_orderpriority, sum(l_quantity * o_totalprice)
+from orders, lineitem
+where o_orderkey = l_orderkey
+group by o_orderpriority;
+
+-- null-supplying side of a left join, unmatched customers must count 0
+-- reject: eager_
+select c_custkey, count(o_orderkey), count(*)
+from customer left join orders on c_custkey = o_custkey
+group by c_custkey;
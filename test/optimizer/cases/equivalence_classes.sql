@@ -0,0 +1,24 @@
+-- Constant predicates derived over equivalence classes of equi-joined attributes (push_down_predicates).
+
+-- l_orderkey<100 from o_orderkey=l_orderkey and o_orderkey<100
+-- expect: l_orderkey<100
+select o_orderkey, o_orderdate, l_linenumber from orders, lineitem where o_orderkey = l_orderkey and o_orderkey < 100;
+
+-- in and between along a chain of joins
+-- expect: c_custkey in \(1,2,4\)
+-- expect: o_orderkey between 1 and 500
+select c_name, o_orderkey, l_linenumber
+from customer, orders, lineitem
+where c_custkey = o_custkey and o_orderkey = l_orderkey and o_custkey in (1, 2, 4) and l_orderkey between 1 and 500;
+
+-- <>
+-- expect: c_nationkey<>3
+select s_suppkey, c_custkey from supplier, customer where s_nationkey = c_nationkey and s_nationkey <> 3 and c_custkey < 20;
+
+-- a join predicate of a left join does not filter the preserved side
+-- reject: c_custkey<10
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey and o_custkey < 10;
+
+-- a predicate of a correlated subquery does not filter the outer query
+-- reject: c_custkey<50
+select c_custkey, c_name from customer where exists (select * from orders where o_custkey = c_custkey and o_custkey < 50);
@@ -0,0 +1,38 @@
+-- Joins removed by foreign and unique keys (eliminate_joins).
+
+-- foreign key, the referenced key is replaced by the foreign key
+-- expect: l_orderkey as o_orderkey
+-- reject: orders
+select l_orderkey, l_linenumber, o_orderkey from lineitem, orders where l_orderkey = o_orderkey and l_quantity > 49;
+
+-- composite foreign key
+-- reject: partsupp
+select l_orderkey, l_linenumber from lineitem, partsupp where l_partkey = ps_partkey and l_suppkey = ps_suppkey and l_quantity > 49;
+
+-- foreign key chain
+-- reject: region
+select n_name from nation, region where n_regionkey = r_regionkey;
+
+-- left join to a unique key whose attributes are not used
+-- reject: customer
+select o_orderkey, o_totalprice from orders left join customer on c_custkey = o_custkey where o_totalprice > 300000;
+
+-- a predicate on the referenced relation removes rows
+-- expect: from orders, lineitem
+select l_orderkey, l_linenumber from lineitem, orders where l_orderkey = o_orderkey and o_orderstatus = 'F' and l_quantity > 49;
+
+-- another attribute of the referenced relation is used
+-- expect: from orders, lineitem
+select l_orderkey, l_linenumber, o_orderdate from lineitem, orders where l_orderkey = o_orderkey and l_quantity > 49;
+
+-- the join covers only a part of the composite primary key of partsupp, lineitems repeat
+-- expect: partsupp
+select l_orderkey, l_linenumber from lineitem, partsupp where l_partkey = ps_partkey and l_quantity > 49;
+
+-- left join whose attributes are used
+-- expect: left join customer
+select o_orderkey, c_name from orders left join customer on c_custkey = o_custkey where o_totalprice > 300000;
+
+-- left join to a relation which is not unique on the join attributes
+-- expect: left join orders
+select c_custkey, c_name from customer left join orders on c_custkey = o_custkey where c_acctbal > 9000;
@@ -0,0 +1,96 @@
+-- Limit/offset and top-N pushdown (push_down_limits).
+
+-- limit and offset are kept
+-- expect: limit 5\s+offset 3
+select o_orderkey, o_totalprice from orders order by o_totalprice desc, o_orderkey limit 5 offset 3;
+
+-- into a derived table, count+offset rows
+-- expect: o_orderkey\s+limit 7\s+\) as t
+select t.o_orderkey, t.o_totalprice
+from (select o_orderkey, o_totalprice from orders where o_orderstatus = 'F') as t
+order by t.o_totalprice desc, t.o_orderkey
+limit 5 offset 2;
+
+-- into a grouped derived table, ordered by the aggregate
+-- expect: order by count\(\*\) desc, o_custkey\s+limit 5\s+\) as t
+select t.o_custkey, t.n
+from (select o_custkey, count(*) as n from orders group by o_custkey) as t
+order by t.n desc, t.o_custkey
+limit 5;
+
+-- into the preserved side of a left join to a unique key
+-- expect: limit 5\s+\) as orders left join customer
+select o_orderkey, o_totalprice, c_name
+from orders left join customer on c_custkey = o_custkey
+order by o_totalprice desc, o_orderkey
+limit 5;
+
+-- into the branches of a split disjunction
+-- expect: limit 3\s+\)\s+union all
+select l_orderkey, l_linenumber, l_extendedprice
+from part, lineitem
+where p_partkey = l_partkey and ((p_size = 1 and l_quantity >= 1) or (p_size = 5 and l_quantity >= 10))
+order by l_extendedprice desc, l_orderkey, l_linenumber
+limit 3;
+
+-- a written set operation is not parsed, the statement is unchanged
+-- expect: union all select l_orderkey from lineitem where l_quantity > 49 order by 1 limit 5
+select o_orderkey from orders where o_orderstatus = 'F' union all select l_orderkey from lineitem where l_quantity > 49 order by 1 limit 5;
+
+-- a derived table with its own limit keeps it, the outer limit is not pushed over another order
+-- expect: order by o_totalprice desc\s+limit 10\s+\) as t
+select t.o_orderkey
+from (select o_orderkey, o_totalprice from orders order by o_totalprice desc limit 10) as t
+order by t.o_orderkey
+limit 3;
+
+-- a customer repeats with every order, the left join's right side is not unique
+-- reject: limit 5\s+\)
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey order by c_custkey, o_orderkey limit 5;
+
+-- distinct projection
+-- reject: limit 5\s+\)
+select distinct t.o_custkey from (select o_custkey, o_orderkey from orders) as t order by t.o_custkey limit 5;
+
+-- a correlated subquery with a limit is not decorrelated
+-- expect: limit 1\s+\)\s+order by c_custkey
+select c_custkey
+from customer
+where c_acctbal > (select o_totalprice / 100 from orders where o_custkey = c_custkey order by o_totalprice desc limit 1)
+order by c_custkey;
+
+-- over a correlated aggregate converted to a window function, the outer attributes are output by the window projection
+-- expect: o_totalprice, avg\(o1\.o_totalprice\) over
+select o_orderkey, o_custkey
+from orders o1
+where o_totalprice > (select avg(o2.o_totalprice) from orders o2 where o2.o_custkey = o1.o_custkey)
+order by o_orderkey
+limit 5;
+
+-- over a window conversion without order by (TPC-H Q17)
+-- expect: over \(partition by
+select sum(l_extendedprice) / 7.0 as avg_yearly
+from lineitem, part
+where p_partkey = l_partkey and p_brand = 'Brand#23' and l_quantity < (select 0.2 * avg(l_quantity) from lineitem where l_partkey = p_partkey)
+limit 1;
+
+-- over a decorrelated subquery whose outer query is a CTE, the attributes below the limit are renamed
+-- options: --decouple never
+-- expect: c_acctbal\s+from customer c
+select c.c_custkey, c.c_name
+from customer c
+where c.c_acctbal > (select sum(o_totalprice) / 100 from orders where o_custkey = c.c_custkey and o_orderstatus = 'F')
+order by c.c_custkey
+limit 5;
+
+-- over a decoupled subquery
+-- options: --decouple always
+-- expect: group by o_custkey
+select c_custkey, c_name
+from customer
+where c_acctbal > (select sum(o_totalprice) / 100 from orders where o_custkey = c_custkey and o_orderstatus = 'F')
+order by c_custkey
+limit 5;
+
+-- limit without order by, only the row count is checked
+select o_orderkey from orders where o_orderstatus = 'F' limit 10;
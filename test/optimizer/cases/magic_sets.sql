@@ -0,0 +1,36 @@
+-- Decoupled subqueries filtered by the correlation values of the outer query (magic set, add_magic_set_filter),
+-- and the distinct D of correlation values a subquery is joined with when it is not decoupled.
+
+-- outer values repeat (several lineitems of a part), D must be distinct or the subquery's rows are aggregated twice
+-- options: --decouple never
+-- expect: select distinct l_partkey
+select l_orderkey, l_linenumber
+from lineitem l1, orders
+where o_orderkey = l1.l_orderkey and o_orderstatus = 'F'
+    and l1.l_quantity < (select avg(l2.l_quantity) from lineitem l2 where l2.l_partkey = l1.l_partkey);
+
+-- sum over a join with an outer query whose correlation values repeat (partsupp rows of a part)
+-- options: --decouple never
+-- expect: select distinct p_partkey
+select p_partkey, count(*)
+from part, partsupp
+where p_partkey = ps_partkey
+    and p_retailprice < (select sum(l_extendedprice) / 100 from lineitem where l_partkey = p_partkey)
+group by p_partkey;
+
+-- the outer query keeps most parts, filtering the decoupled subquery by them costs more than it saves
+-- reject: in \(select
+select p_partkey from part
+where p_size < 30 and p_retailprice < (select sum(ps_supplycost) from partsupp where ps_partkey = p_partkey);
+
+-- a selective outer query is not decoupled, the subquery is joined with its distinct correlation values instead
+-- expect: with cte_\d+ as
+-- reject: in \(select
+select p_partkey, p_name from part
+where p_brand = 'Brand#23' and p_retailprice > (select 0.2 * avg(l_extendedprice) from lineitem where l_partkey = p_partkey);
+
+-- forced decoupling does not add the filter
+-- options: --decouple always
+-- reject: in \(select|with cte_
+select p_partkey, p_name from part
+where p_brand = 'Brand#23' and p_retailprice > (select 0.2 * avg(l_extendedprice) from lineitem where l_partkey = p_partkey);
@@ -0,0 +1,41 @@
+-- Outer joins below null-rejecting predicates simplified to inner or left joins (simplify_outer_joins).
+
+-- comparison of the nullable side
+-- reject: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where o_totalprice > 100000;
+
+-- is not null
+-- reject: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where o_orderkey is not null and c_custkey < 20;
+
+-- arithmetic of the nullable side, and
+-- reject: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where o_totalprice * 2 > 300000 and o_orderstatus = 'F';
+
+-- not over a comparison
+-- reject: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where not (o_orderstatus = 'F');
+
+-- full join rejecting both sides
+-- expect: customer join orders
+select c_custkey, o_orderkey from customer full join orders on c_custkey = o_custkey where c_acctbal > 0 and o_totalprice > 0;
+
+-- full join rejecting its left side
+-- expect: customer left join orders
+select c_custkey, o_orderkey from customer full join orders on c_custkey = o_custkey where c_acctbal > 0;
+
+-- full join rejecting only its right side would need a right join
+-- expect: full join
+select c_custkey, o_orderkey from customer full join orders on c_custkey = o_custkey where o_totalprice > 0;
+
+-- is null keeps the customers without orders
+-- expect: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where o_orderkey is null;
+
+-- or with an argument which does not reject nulls
+-- expect: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where o_totalprice > 100000 or c_custkey < 10;
+
+-- or with is null
+-- expect: left join
+select c_custkey, o_orderkey from customer left join orders on c_custkey = o_custkey where o_orderkey is null or o_totalprice > 300000;
@@ -0,0 +1,42 @@
+-- data: shared_columns_data.sql
+-- Attributes without alias whose name is a column of several tables, resolved by the from items in scope.
+
+-- in subquery selecting a column of the subquery which the outer relation has too
+-- expect: a\.name in \(select cte_\d+\.name
+select a_id from a where name in (select name from b where a_ref = a_id);
+
+-- not in, c.name is nullable
+-- expect: c\.name not in
+select c_id from c where name not in (select name from b where qty = c.qty);
+
+-- exists
+-- expect: b\.name='x'
+select a_id from a where exists (select * from b where a_ref = a_id and name = 'x');
+
+-- correlated aggregate
+-- expect: sum\(b\.qty\)
+select a_id, name from a where score > (select sum(qty) from b where a_ref = a_id and name <> 'q');
+
+-- the subquery sees the outer relation's column which it does not have itself
+-- expect: b\.qty
+select b_id from b where exists (select * from a where a_id = a_ref and score > qty * 5 and name = 'x');
+
+-- column of a derived table
+-- expect: t\.name
+select a_id from a where name in (select name from (select name, qty from b where qty > 2) as t);
+
+-- order by an output column of the select list
+-- expect: order by name
+select a.name as name, b_id from a, b where a_id = a_ref order by name, b_id;
+
+-- a derived table selecting * might have the column, the statement is not optimized
+-- expect: \(select \* from a\) as t
+select t.a_id from (select * from a) as t, b where t.a_id = b.a_ref and qty > 3;
+
+-- the correlating predicate is not the first conjunct of the subquery
+-- expect: b\.name='x'
+select a_id from a where exists (select * from b where name = 'x' and a_ref = a_id);
+
+-- another predicate of the subquery refers to the outer query, the subquery stays correlated
+-- reject: with
+select a_id from a where exists (select * from b where a_ref = a_id and qty * 10 > score);
@@ -0,0 +1,38 @@
+-- Statements the parser does not translate are written unchanged. A statement which still crashes
+-- the optimizer only stops its worker process instead of ending the whole run.
+
+-- set operation under order by/limit
+select o_orderkey from orders union all select l_orderkey from lineitem order by 1 limit 5;
+
+-- set operation
+select o_orderkey from orders union select l_orderkey from lineitem;
+
+-- correlated scalar subquery in the select list
+select o_orderkey, (select max(l_quantity) from lineitem where l_orderkey=o_orderkey) from orders;
+
+-- uncorrelated scalar subquery in the select list
+select o_orderkey, (select max(l_quantity) from lineitem) from orders;
+
+-- grouping sets
+select count(*) from orders group by rollup(o_custkey);
+
+-- all sublink
+select o_orderkey from orders where o_orderkey > all(select l_orderkey from lineitem where l_quantity > 49);
+
+-- values in from
+select * from (values (1),(2)) v(a);
+
+-- lateral subquery
+select lateral_x from orders, lateral (select o_custkey as lateral_x) t;
+
+-- right join
+select o_orderkey from orders right join customer on o_custkey=c_custkey;
+
+-- two correlated scalar subqueries in where, stops the worker process
+select o_orderkey from orders o
+where (select count(*) from lineitem where l_orderkey=o.o_orderkey) > 2
+  and (select count(*) from lineitem where l_partkey=o.o_custkey) > 1;
+
+-- function call compared to a constant
+select o_orderkey from orders where coalesce(o_custkey, 1) = 1;
+
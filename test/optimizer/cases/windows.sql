@@ -0,0 +1,62 @@
+-- Correlated aggregate subqueries over the relations of the outer query as window functions
+-- (convert_correlated_aggregates_to_windows).
+
+-- TPC-H Q17
+-- expect: avg\(l_quantity\) over \(partition by l_partkey\)
+select sum(l_extendedprice) / 7.0 as avg_yearly
+from lineitem, part
+where p_partkey = l_partkey and p_brand = 'Brand#23' and p_container = 'MED BOX'
+    and l_quantity < (select 0.2 * avg(l_quantity) from lineitem where l_partkey = p_partkey);
+
+-- largest lineitem of every order
+-- expect: max\(l1\.l_quantity\) over \(partition by l1\.l_orderkey\)
+select l_orderkey, l_linenumber
+from lineitem l1
+where l1.l_quantity = (select max(l2.l_quantity) from lineitem l2 where l2.l_orderkey = l1.l_orderkey);
+
+-- TPC-H Q2 without the region, subquery over two relations
+-- expect: min\(ps_supplycost\) over \(partition by ps_partkey\)
+select s_name, p_partkey
+from part, supplier, partsupp
+where p_partkey = ps_partkey and s_suppkey = ps_suppkey and p_size = 15
+    and ps_supplycost = (select min(ps_supplycost) from partsupp, supplier where p_partkey = ps_partkey and s_suppkey = ps_suppkey);
+
+-- an outer predicate on another column than the key removes rows of a partition the subquery aggregates
+-- reject: over \(
+select l_orderkey, l_linenumber
+from lineitem l1
+where l1.l_shipmode = 'AIR'
+    and l1.l_quantity = (select max(l2.l_quantity) from lineitem l2 where l2.l_orderkey = l1.l_orderkey);
+
+-- subquery predicate missing in the outer query
+-- reject: over \(
+select l_orderkey, l_linenumber
+from lineitem l1
+where l1.l_quantity = (select max(l2.l_quantity) from lineitem l2 where l2.l_orderkey = l1.l_orderkey and l2.l_shipmode = 'AIR');
+
+-- sum over the only outer relation
+-- expect: sum\(l1\.l_quantity\) over \(partition by l1\.l_orderkey\)
+select l_orderkey, l_linenumber
+from lineitem l1
+where l1.l_quantity > (select sum(l2.l_quantity) / 4 from lineitem l2 where l2.l_orderkey = l1.l_orderkey);
+
+-- count, the other outer relation joins one row by its primary key
+-- expect: count\(\*\) over \(partition by orders\.o_custkey\)
+select o_orderkey, c_name
+from orders, customer
+where c_custkey = o_custkey and c_acctbal > 9900
+    and 10 < (select count(*) from orders o2 where o2.o_custkey = c_custkey);
+
+-- sum, the other outer relation joins several rows of a partition
+-- reject: over \(
+select l_orderkey, l_linenumber
+from lineitem l1, partsupp
+where ps_partkey = l1.l_partkey
+    and l1.l_quantity > (select sum(l2.l_quantity) / 4 from lineitem l2 where l2.l_orderkey = l1.l_orderkey);
+
+-- the outer query joins another relation of the subquery's table, the relations do not map one to one
+-- reject: over \(
+select l1.l_orderkey, l1.l_linenumber
+from lineitem l1, lineitem l3
+where l1.l_orderkey = l3.l_orderkey and l3.l_linenumber = 1
+    and l1.l_quantity = (select max(l2.l_quantity) from lineitem l2 where l2.l_orderkey = l1.l_orderkey);
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+# Result equivalence tests of the optimizer rewrites.
+#
+# Usage: equivalence.py <sqlOptimizer binary> <case file> ...
+#
+# Every statement of a case file is optimized by sqlOptimizer, then the original and the optimized
+# statement run on a small TPC-H instance in DuckDB (tpch_data.sql) and must return the same rows.
+# Comment lines directly above a statement check the optimized SQL:
+#   -- expect: <regex>    the optimized statement must match, e.g. to check that a rewrite was applied
+#   -- reject: <regex>    the optimized statement must not match, e.g. to check that a rewrite was refused
+#   -- options: <args>    additional sqlOptimizer options, e.g. --decouple never
+# A "-- data: <file>" line before the first case replaces the TPC-H instance by a SQL file of test/optimizer,
+# which is also the catalog of sqlOptimizer (it ignores the inserts). Other comment lines describe the case. Rows are compared as multisets unless the statement has an
+# order by, numbers are compared with a relative tolerance (partial aggregates are summed in a different order).
+
+import math
+import os
+import re
+import subprocess
+import sys
+
+import duckdb
+
+DATA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tpch_data.sql")
+
+
+def read_data(path):
+    with open(path) as f:
+        for line in f:
+            stripped = line.strip()
+            if stripped and not stripped.startswith("--"):
+                break
+            if stripped[2:].strip().startswith("data:"):
+                return os.path.join(os.path.dirname(DATA), stripped[2:].strip()[len("data:"):].strip())
+    return DATA
+
+
+def read_cases(path):
+    cases = []
+    comments = []
+    lines = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            stripped = line.strip()
+            if not lines and (stripped.startswith("--") or not stripped):
+                if stripped:
+                    comments.append(stripped[2:].strip())
+                continue
+            if not lines:
+                first_line = number
+            lines.append(line.rstrip("\n"))
+            if stripped.endswith(";"):
+                cases.append({
+                    "location": "%s:%d" % (os.path.basename(path), first_line),
+                    "sql": "\n".join(lines),
+                    "expect": [c[len("expect:"):].strip() for c in comments if c.startswith("expect:")],
+                    "reject": [c[len("reject:"):].strip() for c in comments if c.startswith("reject:")],
+                    "options": [o for c in comments if c.startswith("options:") for o in c[len("options:"):].split()],
+                })
+                comments = []
+                lines = []
+    return cases
+
+
+def optimize(optimizer, sql, options):
+    result = subprocess.run([optimizer, "--cache-size", "0"] + options, input=sql, capture_output=True, text=True, timeout=60)
+    if result.returncode != 0:
+        raise RuntimeError("sqlOptimizer exited with %d\n%s" % (result.returncode, result.stderr))
+    return result.stdout.strip()
+
+
+def normalize_value(value):
+    if isinstance(value, bool) or value is None:
+        return value
+    if isinstance(value, (int, float)) or type(value).__name__ == "Decimal":
+        return float(value)
+    if isinstance(value, str):
+        return value.rstrip(" ")
+    return value
+
+
+def normalize_rows(rows, ordered):
+    rows = [tuple(normalize_value(v) for v in row) for row in rows]
+    return rows if ordered else sorted(rows, key=lambda row: [(v is None, str(type(v)), v if v is not None else 0) for v in row])
+
+
+def same_value(a, b):
+    if isinstance(a, float) and isinstance(b, float):
+        return math.isclose(a, b, rel_tol=1e-9, abs_tol=1e-9)
+    return a == b
+
+
+def same_rows(a, b):
+    return len(a) == len(b) and all(len(x) == len(y) and all(same_value(v, w) for v, w in zip(x, y)) for x, y in zip(a, b))
+
+
+def run_case(connection, optimizer, case):
+    optimized = optimize(optimizer, case["sql"], case["options"])
+    for pattern in case["expect"]:
+        if not re.search(pattern, optimized, re.IGNORECASE | re.DOTALL):
+            return "optimized SQL does not match '%s'" % pattern, optimized
+    for pattern in case["reject"]:
+        if re.search(pattern, optimized, re.IGNORECASE | re.DOTALL):
+            return "optimized SQL matches '%s'" % pattern, optimized
+
+    # order by of the outermost query, a limit without order by is only checked by its row count
+    ordered = re.search(r"order\s+by[^()]*$", case["sql"], re.IGNORECASE | re.DOTALL) is not None
+    expected = normalize_rows(connection.execute(case["sql"].rstrip(";")).fetchall(), ordered)
+    try:
+        actual = normalize_rows(connection.execute(optimized.rstrip(";")).fetchall(), ordered)
+    except duckdb.Error as e:
+        return "optimized SQL fails: %s" % e, optimized
+    if re.search(r"\blimit\b[^()]*$", case["sql"], re.IGNORECASE | re.DOTALL) and not ordered:
+        return (None if len(actual) == len(expected) else "%d rows instead of %d" % (len(actual), len(expected))), optimized
+    if not same_rows(expected, actual):
+        return "results differ: %d rows expected, %d rows returned\nexpected: %s\nreturned: %s" % (
+            len(expected), len(actual), expected[:5], actual[:5]), optimized
+    return None, optimized
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("usage: equivalence.py <sqlOptimizer binary> <case file> ...")
+        return 2
+    optimizer = sys.argv[1]
+    connections = {}
+
+    failures = 0
+    total = 0
+    for path in sys.argv[2:]:
+        data = read_data(path)
+        if data not in connections:
+            connections[data] = duckdb.connect()
+            with open(data) as f:
+                connections[data].execute(f.read())
+        connection = connections[data]
+        for case in read_cases(path):
+            if data != DATA:
+                case["options"] = ["--catalog", data] + case["options"]
+            total += 1
+            try:
+                error, optimized = run_case(connection, optimizer, case)
+            except (RuntimeError, subprocess.TimeoutExpired) as e:
+                error, optimized = str(e), ""
+            if error is not None:
+                failures += 1
+                print("FAIL %s: %s\n%s\n-- optimized:\n%s\n" % (case["location"], error, case["sql"], optimized))
+    print("%d of %d cases passed" % (total - failures, total))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,34 @@
+-- Schema whose tables share column names, for the equivalence tests of attributes resolved by their from scope.
+-- Used as catalog (--catalog) and as data, the optimizer ignores the inserts.
+
+CREATE TABLE a
+(
+    a_id   INTEGER not null PRIMARY KEY,
+    name   VARCHAR(10) not null,
+    score  INTEGER not null
+);
+
+CREATE TABLE b
+(
+    b_id   INTEGER not null PRIMARY KEY,
+    name   VARCHAR(10) not null,
+    a_ref  INTEGER not null,
+    qty    INTEGER not null
+);
+
+CREATE TABLE c
+(
+    c_id   INTEGER not null PRIMARY KEY,
+    name   VARCHAR(10),
+    qty    INTEGER not null
+);
+
+INSERT INTO a VALUES
+    (1, 'x', 10), (2, 'y', 20), (3, 'z', 30), (4, 'x', 40), (5, 'w', 50), (6, 'y', 60);
+
+INSERT INTO b VALUES
+    (1, 'x', 1, 5), (2, 'y', 1, 7), (3, 'y', 2, 1), (4, 'q', 3, 9), (5, 'x', 4, 2),
+    (6, 'w', 4, 3), (7, 'w', 5, 8), (8, 'z', 6, 4), (9, 'y', 6, 6), (10, 'x', 2, 2);
+
+INSERT INTO c VALUES
+    (1, 'x', 3), (2, 'y', 5), (3, NULL, 7), (4, 'w', 1);
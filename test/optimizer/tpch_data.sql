@@ -0,0 +1,179 @@
+-- Small deterministic TPC-H instance for the optimizer equivalence tests (DuckDB).
+-- Keys and foreign keys are consistent like in dbgen: every lineitem references a partsupp row,
+-- customers with c_custkey divisible by 3 have no orders, every order has 1 to 7 lineitems.
+
+CREATE TABLE region
+(
+    r_regionkey  INTEGER not null PRIMARY KEY,
+    r_name       CHAR(25) not null,
+    r_comment    VARCHAR(152)
+);
+
+CREATE TABLE nation
+(
+    n_nationkey  INTEGER not null PRIMARY KEY,
+    n_name       CHAR(25) not null,
+    n_regionkey  INTEGER not null,
+    n_comment    VARCHAR(152)
+);
+
+CREATE TABLE part
+(
+    p_partkey     BIGINT not null PRIMARY KEY,
+    p_name        VARCHAR(55) not null,
+    p_mfgr        CHAR(25) not null,
+    p_brand       CHAR(10) not null,
+    p_type        VARCHAR(25) not null,
+    p_size        INTEGER not null,
+    p_container   CHAR(10) not null,
+    p_retailprice DECIMAL(15,2) not null,
+    p_comment     VARCHAR(23) not null
+);
+
+CREATE TABLE supplier
+(
+    s_suppkey     BIGINT not null PRIMARY KEY,
+    s_name        CHAR(25) not null,
+    s_address     VARCHAR(40) not null,
+    s_nationkey   INTEGER not null,
+    s_phone       CHAR(15) not null,
+    s_acctbal     DECIMAL(15,2) not null,
+    s_comment     VARCHAR(101) not null
+);
+
+CREATE TABLE partsupp
+(
+    ps_partkey     BIGINT not null,
+    ps_suppkey     BIGINT not null,
+    ps_availqty    BIGINT not null,
+    ps_supplycost  DECIMAL(15,2) not null,
+    ps_comment     VARCHAR(199) not null,
+    PRIMARY KEY(ps_partkey, ps_suppkey)
+);
+
+CREATE TABLE customer
+(
+    c_custkey     BIGINT not null PRIMARY KEY,
+    c_name        VARCHAR(25) not null,
+    c_address     VARCHAR(40) not null,
+    c_nationkey   INTEGER not null,
+    c_phone       CHAR(15) not null,
+    c_acctbal     DECIMAL(15,2) not null,
+    c_mktsegment  CHAR(10) not null,
+    c_comment     VARCHAR(117) not null
+);
+
+CREATE TABLE orders
+(
+    o_orderkey       BIGINT not null PRIMARY KEY,
+    o_custkey        BIGINT not null,
+    o_orderstatus    CHAR(1) not null,
+    o_totalprice     DECIMAL(15,2) not null,
+    o_orderdate      DATE not null,
+    o_orderpriority  CHAR(15) not null,
+    o_clerk          CHAR(15) not null,
+    o_shippriority   INTEGER not null,
+    o_comment        VARCHAR(79) not null
+);
+
+CREATE TABLE lineitem
+(
+    l_orderkey    BIGINT not null,
+    l_partkey     BIGINT not null,
+    l_suppkey     BIGINT not null,
+    l_linenumber  BIGINT not null,
+    l_quantity    DECIMAL(15,2) not null,
+    l_extendedprice  DECIMAL(15,2) not null,
+    l_discount    DECIMAL(15,2) not null,
+    l_tax         DECIMAL(15,2) not null,
+    l_returnflag  CHAR(1) not null,
+    l_linestatus  CHAR(1) not null,
+    l_shipdate    DATE not null,
+    l_commitdate  DATE not null,
+    l_receiptdate DATE not null,
+    l_shipinstruct CHAR(25) not null,
+    l_shipmode     CHAR(10) not null,
+    l_comment      VARCHAR(44) not null,
+    PRIMARY KEY (l_orderkey, l_linenumber)
+);
+
+INSERT INTO region
+SELECT i, ['AFRICA', 'AMERICA', 'ASIA', 'EUROPE', 'MIDDLE EAST'][i+1], 'region ' || i
+FROM range(0, 5) t(i);
+
+INSERT INTO nation
+SELECT i,
+    ['ALGERIA', 'ARGENTINA', 'BRAZIL', 'CANADA', 'EGYPT', 'ETHIOPIA', 'FRANCE', 'GERMANY', 'INDIA', 'INDONESIA',
+     'IRAN', 'IRAQ', 'JAPAN', 'JORDAN', 'KENYA', 'MOROCCO', 'MOZAMBIQUE', 'PERU', 'CHINA', 'ROMANIA',
+     'SAUDI ARABIA', 'VIETNAM', 'RUSSIA', 'UNITED KINGDOM', 'UNITED STATES'][i+1],
+    [0, 1, 1, 1, 4, 0, 3, 3, 2, 2, 4, 4, 2, 4, 0, 0, 0, 1, 2, 3, 4, 2, 3, 3, 1][i+1],
+    'nation ' || i
+FROM range(0, 25) t(i);
+
+INSERT INTO part
+SELECT i,
+    ['almond', 'forest', 'green', 'ivory', 'khaki', 'lace', 'navy', 'peru'][i%8+1] || ' '
+        || ['antique', 'blue', 'chiffon', 'dim', 'green', 'linen', 'moccasin'][i%7+1],
+    'Manufacturer#' || (i%5+1),
+    'Brand#' || (i%5+1) || (i%4+1),
+    ['PROMO', 'STANDARD', 'SMALL', 'MEDIUM', 'LARGE', 'ECONOMY'][i%6+1] || ' '
+        || ['ANODIZED', 'BRUSHED', 'BURNISHED', 'PLATED', 'POLISHED'][i//6%5+1] || ' '
+        || ['TIN', 'NICKEL', 'BRASS', 'STEEL', 'COPPER'][i//7%5+1],
+    i%50+1,
+    ['SM', 'MED', 'LG', 'JUMBO', 'WRAP'][i%5+1] || ' ' || ['CASE', 'BOX', 'BAG', 'JAR', 'PKG', 'PACK', 'CAN', 'DRUM'][i%8+1],
+    900 + (i%200) + (i%100)/100.0,
+    'part ' || i
+FROM range(1, 201) t(i);
+
+INSERT INTO supplier
+SELECT i, 'Supplier#' || lpad(i::VARCHAR, 9, '0'), 'address ' || i, (i + i//25*2)%25,
+    (10 + i%25) || '-' || lpad((i*7%1000)::VARCHAR, 3, '0') || '-555-0100',
+    (i*7919)%11000/1.0 - 999.99,
+    CASE WHEN i%20=0 THEN 'Customer unhappy Complaints' ELSE 'supplier ' || i END
+FROM range(1, 101) t(i);
+
+INSERT INTO partsupp
+SELECT p, (p + j*25)%100 + 1, (p*31 + j*17)%9999 + 1, (p*13 + j*7)%1000 + 1.5, 'partsupp ' || p || ' ' || j
+FROM range(1, 201) t(p), range(0, 4) s(j);
+
+INSERT INTO customer
+SELECT i, 'Customer#' || lpad(i::VARCHAR, 9, '0'), 'address ' || i, i%25,
+    (10 + i%25) || '-' || lpad((i*13%1000)::VARCHAR, 3, '0') || '-555-0100',
+    (i*4817)%11000/1.0 - 999.99,
+    ['AUTOMOBILE', 'BUILDING', 'FURNITURE', 'HOUSEHOLD', 'MACHINERY'][i%5+1],
+    'customer ' || i
+FROM range(1, 301) t(i);
+
+INSERT INTO orders
+SELECT i,
+    CASE WHEN (i*37%299 + 1)%3=0 THEN i*37%299 + 2 ELSE i*37%299 + 1 END,
+    ['F', 'O', 'P'][i%3+1],
+    1000 + (i*7717)%400000/1.0,
+    DATE '1992-01-01' + (i*13%2400)::INTEGER,
+    ['1-URGENT', '2-HIGH', '3-MEDIUM', '4-NOT SPECIFIED', '5-LOW'][i%5+1],
+    'Clerk#' || lpad((i%50)::VARCHAR, 9, '0'),
+    0,
+    CASE WHEN i%17=0 THEN 'some special packages requests' ELSE 'order ' || i END
+FROM range(1, 1501) t(i);
+
+INSERT INTO lineitem
+SELECT o_orderkey, partkey, (partkey + (l%4)*25)%100 + 1, l,
+    quantity,
+    quantity * (900 + partkey%200),
+    ((o_orderkey + l)%11)/100.0,
+    ((o_orderkey + l)%9)/100.0,
+    CASE WHEN o_orderdate + (l*11)::INTEGER > DATE '1995-06-17' THEN 'N' ELSE ['R', 'A'][(o_orderkey + l)%2+1] END,
+    CASE WHEN o_orderdate + (l*11)::INTEGER > DATE '1995-06-17' THEN 'O' ELSE 'F' END,
+    o_orderdate + (l*11)::INTEGER,
+    o_orderdate + (l*9 + 5)::INTEGER,
+    o_orderdate + (l*9 + 5 + CASE WHEN (o_orderkey + l)%4=0 THEN 3 ELSE -2 END)::INTEGER,
+    ['DELIVER IN PERSON', 'COLLECT COD', 'NONE', 'TAKE BACK RETURN'][(o_orderkey + l)%4+1],
+    ['REG AIR', 'AIR', 'RAIL', 'SHIP', 'TRUCK', 'MAIL', 'FOB'][(o_orderkey*3 + l)%7+1],
+    'lineitem ' || o_orderkey || ' ' || l
+FROM (
+    SELECT o_orderkey, o_orderdate, l, (o_orderkey*13 + l*7)%200 + 1 AS partkey,
+        -- a few large orders (TPC-H Q18)
+        CASE WHEN o_orderkey%49=6 THEN 44 + l ELSE (o_orderkey + l*3)%50 + 1 END AS quantity
+    FROM orders, range(1, 8) t(l)
+    WHERE l <= o_orderkey%7 + 1
+) items;